@@ -0,0 +1,88 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBSHADERTRAP_ARENA_H
+#define LIBSHADERTRAP_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace shadertrap {
+
+// A bump allocator for objects that all live exactly as long as the arena.
+// Objects are packed contiguously into large blocks, and are all destroyed,
+// in the reverse order of their creation, when the arena is destroyed; they
+// cannot be freed individually.
+class Arena {
+ public:
+  Arena();
+
+  Arena(const Arena&) = delete;
+
+  Arena& operator=(const Arena&) = delete;
+
+  Arena(Arena&&) = delete;
+
+  Arena& operator=(Arena&&) = delete;
+
+  ~Arena();
+
+  // Constructs a T in the arena, forwarding |args| to its constructor.
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    void* memory = Allocate(sizeof(T), alignof(T));
+    T* result = new (memory) T(std::forward<Args>(args)...);
+    RegisterDestructor(result, std::is_trivially_destructible<T>());
+    return result;
+  }
+
+ private:
+  // Destructors that need to be run when the arena is destroyed form a list,
+  // which is itself allocated in the arena.
+  struct Destructor {
+    void (*destroy)(void*);
+    void* object;
+    Destructor* previous;
+  };
+
+  template <typename T>
+  static void Destroy(void* object) {
+    static_cast<T*>(object)->~T();
+  }
+
+  template <typename T>
+  void RegisterDestructor(T* object, std::false_type /*unused*/) {
+    last_destructor_ = New<Destructor>(
+        Destructor{&Destroy<T>, static_cast<void*>(object), last_destructor_});
+  }
+
+  template <typename T>
+  void RegisterDestructor(T* /*unused*/, std::true_type /*unused*/) {}
+
+  void* Allocate(size_t size, size_t alignment);
+
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  char* current_ = nullptr;
+  size_t remaining_ = 0;
+  size_t next_block_size_;
+  Destructor* last_destructor_ = nullptr;
+};
+
+}  // namespace shadertrap
+
+#endif  // LIBSHADERTRAP_ARENA_H
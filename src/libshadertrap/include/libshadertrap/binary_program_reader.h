@@ -0,0 +1,163 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBSHADERTRAP_BINARY_PROGRAM_READER_H
+#define LIBSHADERTRAP_BINARY_PROGRAM_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "libshadertrap/arena.h"
+#include "libshadertrap/command.h"
+#include "libshadertrap/message_consumer.h"
+#include "libshadertrap/shadertrap_program.h"
+#include "libshadertrap/source_buffer.h"
+#include "libshadertrap/token.h"
+
+namespace shadertrap {
+
+// Loads a program from the binary form produced by BinaryProgramWriter. No
+// parsing is involved: the commands are rebuilt directly, and their tokens,
+// shader text and buffer contents refer to the binary form in place, so that
+// when it is memory-mapped little is copied. Malformed input is reported as an
+// error rather than trusted.
+class BinaryProgramReader {
+ public:
+  // Reads the binary program held by |source|, which is handed on to the
+  // program that is read so that the commands remain valid.
+  BinaryProgramReader(std::unique_ptr<SourceBuffer> source,
+                      MessageConsumer* message_consumer);
+
+  ~BinaryProgramReader();
+
+  BinaryProgramReader(const BinaryProgramReader&) = delete;
+
+  BinaryProgramReader& operator=(const BinaryProgramReader&) = delete;
+
+  BinaryProgramReader(BinaryProgramReader&&) = delete;
+
+  BinaryProgramReader& operator=(BinaryProgramReader&&) = delete;
+
+  // Determines whether |source| holds a binary program, rather than the text
+  // of a script, by checking whether it starts with the binary program magic
+  // number.
+  static bool IsBinaryProgram(const SourceBuffer& source);
+
+  bool Read();
+
+  std::unique_ptr<ShaderTrapProgram> GetProgram();
+
+ private:
+  bool ReadHeader();
+
+  bool ReadStringTable();
+
+  bool ReadCommand();
+
+  bool ReadCommandAssertEqual(const Token* start_token);
+
+  bool ReadCommandAssertPixels(const Token* start_token);
+
+  bool ReadCommandAssertSimilarEmdHistogram(const Token* start_token);
+
+  bool ReadCommandBindSampler(const Token* start_token);
+
+  bool ReadCommandBindStorageBuffer(const Token* start_token);
+
+  bool ReadCommandBindTexture(const Token* start_token);
+
+  bool ReadCommandBindUniformBuffer(const Token* start_token);
+
+  bool ReadCommandCompileShader(const Token* start_token);
+
+  bool ReadCommandCreateBuffer(const Token* start_token);
+
+  bool ReadCommandCreateEmptyTexture2D(const Token* start_token);
+
+  bool ReadCommandCreateProgram(const Token* start_token);
+
+  bool ReadCommandCreateRenderbuffer(const Token* start_token);
+
+  bool ReadCommandCreateSampler(const Token* start_token);
+
+  bool ReadCommandDeclareShader(const Token* start_token);
+
+  bool ReadCommandDumpRenderbuffer(const Token* start_token);
+
+  bool ReadCommandRunCompute(const Token* start_token);
+
+  bool ReadCommandRunGraphics(const Token* start_token);
+
+  bool ReadCommandSetSamplerOrTextureParameter(const Token* start_token);
+
+  bool ReadCommandSetUniform(const Token* start_token);
+
+  bool ReadUint32(uint32_t* result);
+
+  bool ReadSize(size_t* result);
+
+  bool ReadFloat(float* result);
+
+  // Reads an enumeration value, which must be no greater than |last|.
+  // |result| is assigned even on failure, so that callers need not initialize
+  // it.
+  template <typename T>
+  bool ReadEnum(T last, T* result) {
+    *result = last;
+    uint32_t value;
+    if (!ReadUint32(&value)) {
+      return false;
+    }
+    if (value > static_cast<uint32_t>(last)) {
+      return Error("Invalid enumeration value " + std::to_string(value));
+    }
+    *result = static_cast<T>(value);
+    return true;
+  }
+
+  // Reads the index of a string in the string table, yielding the offset and
+  // length of the string within the source.
+  bool ReadStringSlice(std::pair<size_t, size_t>* result);
+
+  bool ReadString(std::string* result);
+
+  bool ReadToken(const Token** result);
+
+  // Reads inline bulk data, yielding a pointer to it within the source.
+  bool ReadBytes(const char** data, size_t* size);
+
+  bool Error(const std::string& message);
+
+  std::unique_ptr<SourceBuffer> source_;
+  MessageConsumer* message_consumer_;
+  std::unique_ptr<Arena> arena_;
+  std::vector<Command*> commands_;
+
+  // The position of the next byte to be read from the source.
+  size_t position_;
+
+  uint32_t num_commands_;
+
+  // The offset and length within the source of each string in the string
+  // table.
+  std::vector<std::pair<size_t, size_t>> strings_;
+};
+
+}  // namespace shadertrap
+
+#endif  // LIBSHADERTRAP_BINARY_PROGRAM_READER_H
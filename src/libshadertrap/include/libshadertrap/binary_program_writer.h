@@ -0,0 +1,135 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBSHADERTRAP_BINARY_PROGRAM_WRITER_H
+#define LIBSHADERTRAP_BINARY_PROGRAM_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "libshadertrap/command_assert_equal.h"
+#include "libshadertrap/command_assert_pixels.h"
+#include "libshadertrap/command_assert_similar_emd_histogram.h"
+#include "libshadertrap/command_bind_sampler.h"
+#include "libshadertrap/command_bind_storage_buffer.h"
+#include "libshadertrap/command_bind_texture.h"
+#include "libshadertrap/command_bind_uniform_buffer.h"
+#include "libshadertrap/command_compile_shader.h"
+#include "libshadertrap/command_create_buffer.h"
+#include "libshadertrap/command_create_empty_texture_2d.h"
+#include "libshadertrap/command_create_program.h"
+#include "libshadertrap/command_create_renderbuffer.h"
+#include "libshadertrap/command_create_sampler.h"
+#include "libshadertrap/command_declare_shader.h"
+#include "libshadertrap/command_dump_renderbuffer.h"
+#include "libshadertrap/command_run_compute.h"
+#include "libshadertrap/command_run_graphics.h"
+#include "libshadertrap/command_set_sampler_or_texture_parameter.h"
+#include "libshadertrap/command_set_uniform.h"
+#include "libshadertrap/command_visitor.h"
+#include "libshadertrap/shadertrap_program.h"
+#include "libshadertrap/token.h"
+
+namespace shadertrap {
+
+// Serializes a parsed program into a compact binary form that
+// BinaryProgramReader can load without parsing, so that a script that is run
+// many times need only be parsed once. The binary form is self-contained: the
+// contents of any files that the script loads are embedded in it.
+class BinaryProgramWriter : public CommandVisitor {
+ public:
+  BinaryProgramWriter();
+
+  // Yields the binary form of |program|.
+  std::string Write(ShaderTrapProgram* program);
+
+  bool VisitAssertEqual(CommandAssertEqual* assert_equal) override;
+
+  bool VisitAssertPixels(CommandAssertPixels* assert_pixels) override;
+
+  bool VisitAssertSimilarEmdHistogram(
+      CommandAssertSimilarEmdHistogram* assert_similar_emd_histogram) override;
+
+  bool VisitBindSampler(CommandBindSampler* bind_sampler) override;
+
+  bool VisitBindStorageBuffer(
+      CommandBindStorageBuffer* bind_storage_buffer) override;
+
+  bool VisitBindTexture(CommandBindTexture* bind_texture) override;
+
+  bool VisitBindUniformBuffer(
+      CommandBindUniformBuffer* bind_uniform_buffer) override;
+
+  bool VisitCompileShader(CommandCompileShader* compile_shader) override;
+
+  bool VisitCreateBuffer(CommandCreateBuffer* create_buffer) override;
+
+  bool VisitCreateSampler(CommandCreateSampler* create_sampler) override;
+
+  bool VisitCreateEmptyTexture2D(
+      CommandCreateEmptyTexture2D* create_empty_texture_2d) override;
+
+  bool VisitCreateProgram(CommandCreateProgram* create_program) override;
+
+  bool VisitCreateRenderbuffer(
+      CommandCreateRenderbuffer* create_renderbuffer) override;
+
+  bool VisitDeclareShader(CommandDeclareShader* declare_shader) override;
+
+  bool VisitDumpRenderbuffer(
+      CommandDumpRenderbuffer* dump_renderbuffer) override;
+
+  bool VisitRunCompute(CommandRunCompute* run_compute) override;
+
+  bool VisitRunGraphics(CommandRunGraphics* run_graphics) override;
+
+  bool VisitSetSamplerOrTextureParameter(
+      CommandSetSamplerOrTextureParameter* set_sampler_or_texture_parameter)
+      override;
+
+  bool VisitSetUniform(CommandSetUniform* set_uniform) override;
+
+ private:
+  void WriteCommandStart(uint32_t tag, const Command& command);
+
+  void WriteUint32(uint32_t value);
+
+  // Sizes are written as 64-bit values, so that a program written on a 64-bit
+  // machine has the same form as one written on a 32-bit machine.
+  void WriteSize(size_t value);
+
+  void WriteFloat(float value);
+
+  // Writes the index of |text| in the string table, adding it to the table if
+  // it is not already present.
+  void WriteString(const std::string& text);
+
+  void WriteToken(const Token& token);
+
+  // Writes |size| bytes at |data| inline.
+  void WriteBytes(const void* data, size_t size);
+
+  // The serialized string table, and the index of each string in it.
+  std::string string_table_;
+  std::unordered_map<std::string, uint32_t> string_indices_;
+
+  // The serialized commands.
+  std::string commands_;
+};
+
+}  // namespace shadertrap
+
+#endif  // LIBSHADERTRAP_BINARY_PROGRAM_WRITER_H
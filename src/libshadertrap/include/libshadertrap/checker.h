@@ -15,8 +15,11 @@
 #ifndef LIBSHADERTRAP_CHECKER_H
 #define LIBSHADERTRAP_CHECKER_H
 
+#include <cstddef>
+#include <initializer_list>
 #include <string>
 #include <unordered_map>
+#include <utility>
 
 #include "libshadertrap/command_assert_equal.h"
 #include "libshadertrap/command_assert_pixels.h"
@@ -93,11 +96,40 @@ class Checker : public CommandVisitor {
 
   bool VisitSetUniform(CommandSetUniform* set_uniform) override;
 
-  bool CheckIdentifierIsFresh(const Token* identifier_token);
-
  private:
+  // The kinds of object that an identifier can denote.
+  enum class ObjectKind {
+    kBuffer,
+    kCompiledShader,
+    kDeclaredShader,
+    kProgram,
+    kRenderbuffer,
+    kSampler,
+    kTexture
+  };
+
+  struct Definition {
+    const Token* identifier;
+    ObjectKind kind;
+    size_t slot;
+  };
+
+  // Defines |identifier| as denoting an object of kind |kind|, yielding the
+  // slot assigned to it, which is the next unused slot. Fails if the
+  // identifier is already defined.
+  std::pair<bool, size_t> DefineIdentifier(const Token* identifier,
+                                           ObjectKind kind);
+
+  // Yields the definition of |identifier|, which must denote an object of one
+  // of |kinds|. Otherwise an error, naming the expected kinds of object as
+  // |description|, is reported at |location| and nullptr is yielded.
+  const Definition* ResolveIdentifier(const std::string& identifier,
+                                      const Token* location,
+                                      std::initializer_list<ObjectKind> kinds,
+                                      const std::string& description);
+
   MessageConsumer* message_consumer_;
-  std::unordered_map<std::string, const Token*> used_identifiers_;
+  std::unordered_map<std::string, Definition> definitions_;
   std::unordered_map<std::string, CommandDeclareShader*> declared_shaders_;
   std::unordered_map<std::string, CommandCompileShader*> compiled_shaders_;
   std::unordered_map<std::string, CommandCreateProgram*> created_programs_;
@@ -12,8 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#ifndef LIBSHADERTRAPTEST_COLLECTING_MESSAGE_CONSUMER_H
-#define LIBSHADERTRAPTEST_COLLECTING_MESSAGE_CONSUMER_H
+#ifndef LIBSHADERTRAP_COLLECTING_MESSAGE_CONSUMER_H
+#define LIBSHADERTRAP_COLLECTING_MESSAGE_CONSUMER_H
 
 #include <cstddef>
 #include <string>
@@ -25,6 +25,8 @@
 
 namespace shadertrap {
 
+// Keeps messages rather than printing them, so that they can be examined, or
+// printed only if they turn out to matter.
 class CollectingMessageConsumer : public MessageConsumer {
  public:
   void Message(Severity severity, const Token* token,
@@ -42,4 +44,4 @@ class CollectingMessageConsumer : public MessageConsumer {
 
 }  // namespace shadertrap
 
-#endif  // LIBSHADERTRAPTEST_COLLECTING_MESSAGE_CONSUMER_H
+#endif  // LIBSHADERTRAP_COLLECTING_MESSAGE_CONSUMER_H
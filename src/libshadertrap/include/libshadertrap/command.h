@@ -15,7 +15,8 @@
 #ifndef LIBSHADERTRAP_COMMAND_H
 #define LIBSHADERTRAP_COMMAND_H
 
-#include <memory>
+#include <cstddef>
+#include <cstdint>
 
 #include "libshadertrap/token.h"
 
@@ -23,9 +24,15 @@ namespace shadertrap {
 
 class CommandVisitor;
 
+// The checker resolves each identifier in a program to a slot: a small integer,
+// dense across the identifiers that the program defines, which the executor
+// uses to index its tables of objects instead of looking identifiers up by
+// name. This is the slot of an identifier that has not yet been resolved.
+const size_t kUnresolvedSlot = SIZE_MAX;
+
 class Command {
  public:
-  explicit Command(std::unique_ptr<Token> start_token);
+  explicit Command(const Token* start_token);
 
   Command(const Command&) = delete;
 
@@ -39,10 +46,10 @@ class Command {
 
   virtual bool Accept(CommandVisitor* visitor) = 0;
 
-  const Token* GetStartToken() const { return start_token_.get(); }
+  const Token* GetStartToken() const { return start_token_; }
 
  private:
-  std::unique_ptr<Token> start_token_;
+  const Token* start_token_;
 };
 
 }  // namespace shadertrap
@@ -15,7 +15,7 @@
 #ifndef LIBSHADERTRAP_COMMAND_ASSERT_EQUAL_H
 #define LIBSHADERTRAP_COMMAND_ASSERT_EQUAL_H
 
-#include <memory>
+#include <cstddef>
 #include <string>
 
 #include "libshadertrap/command.h"
@@ -25,7 +25,7 @@ namespace shadertrap {
 
 class CommandAssertEqual : public Command {
  public:
-  CommandAssertEqual(std::unique_ptr<Token> start_token,
+  CommandAssertEqual(const Token* start_token,
                      std::string buffer_identifier_1,
                      std::string buffer_identifier_2);
 
@@ -39,9 +39,19 @@ class CommandAssertEqual : public Command {
     return buffer_identifier_2_;
   }
 
+  size_t GetBufferSlot1() const { return buffer_slot_1_; }
+
+  void SetBufferSlot1(size_t slot) { buffer_slot_1_ = slot; }
+
+  size_t GetBufferSlot2() const { return buffer_slot_2_; }
+
+  void SetBufferSlot2(size_t slot) { buffer_slot_2_ = slot; }
+
  private:
   std::string buffer_identifier_1_;
   std::string buffer_identifier_2_;
+  size_t buffer_slot_1_;
+  size_t buffer_slot_2_;
 };
 
 }  // namespace shadertrap
@@ -17,7 +17,6 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <memory>
 #include <string>
 
 #include "libshadertrap/command.h"
@@ -27,7 +26,7 @@ namespace shadertrap {
 
 class CommandAssertPixels : public Command {
  public:
-  CommandAssertPixels(std::unique_ptr<Token> start_token, uint8_t expected_r,
+  CommandAssertPixels(const Token* start_token, uint8_t expected_r,
                       uint8_t expected_g, uint8_t expected_b,
                       uint8_t expected_a, std::string renderbuffer_identifier,
                       size_t rectangle_x, size_t rectangle_y,
@@ -55,6 +54,10 @@ class CommandAssertPixels : public Command {
 
   size_t GetRectangleHeight() const { return rectangle_height_; }
 
+  size_t GetRenderbufferSlot() const { return renderbuffer_slot_; }
+
+  void SetRenderbufferSlot(size_t slot) { renderbuffer_slot_ = slot; }
+
  private:
   uint8_t expected_r_;
   uint8_t expected_g_;
@@ -65,6 +68,7 @@ class CommandAssertPixels : public Command {
   size_t rectangle_y_;
   size_t rectangle_width_;
   size_t rectangle_height_;
+  size_t renderbuffer_slot_;
 };
 
 }  // namespace shadertrap
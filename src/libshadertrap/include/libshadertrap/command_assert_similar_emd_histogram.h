@@ -15,7 +15,7 @@
 #ifndef LIBSHADERTRAP_COMMAND_ASSERT_SIMILAR_EMD_HISTOGRAM_H
 #define LIBSHADERTRAP_COMMAND_ASSERT_SIMILAR_EMD_HISTOGRAM_H
 
-#include <memory>
+#include <cstddef>
 #include <string>
 
 #include "libshadertrap/command.h"
@@ -25,7 +25,7 @@ namespace shadertrap {
 
 class CommandAssertSimilarEmdHistogram : public Command {
  public:
-  CommandAssertSimilarEmdHistogram(std::unique_ptr<Token> start_token,
+  CommandAssertSimilarEmdHistogram(const Token* start_token,
                                    std::string buffer_identifier_1,
                                    std::string buffer_identifier_2,
                                    float tolerance);
@@ -42,10 +42,20 @@ class CommandAssertSimilarEmdHistogram : public Command {
 
   float GetTolerance() const { return tolerance_; }
 
+  size_t GetBufferSlot1() const { return buffer_slot_1_; }
+
+  void SetBufferSlot1(size_t slot) { buffer_slot_1_ = slot; }
+
+  size_t GetBufferSlot2() const { return buffer_slot_2_; }
+
+  void SetBufferSlot2(size_t slot) { buffer_slot_2_ = slot; }
+
  private:
   std::string buffer_identifier_1_;
   std::string buffer_identifier_2_;
   float tolerance_;
+  size_t buffer_slot_1_;
+  size_t buffer_slot_2_;
 };
 
 }  // namespace shadertrap
@@ -16,7 +16,6 @@
 #define LIBSHADERTRAP_COMMAND_BIND_SAMPLER_H
 
 #include <cstddef>
-#include <memory>
 #include <string>
 
 #include "libshadertrap/command.h"
@@ -26,7 +25,7 @@ namespace shadertrap {
 
 class CommandBindSampler : public Command {
  public:
-  CommandBindSampler(std::unique_ptr<Token> start_token,
+  CommandBindSampler(const Token* start_token,
                      std::string sampler_identifier, size_t texture_unit_);
 
   bool Accept(CommandVisitor* visitor) override;
@@ -37,9 +36,14 @@ class CommandBindSampler : public Command {
 
   size_t GetTextureUnit() const { return texture_unit_; }
 
+  size_t GetSamplerSlot() const { return sampler_slot_; }
+
+  void SetSamplerSlot(size_t slot) { sampler_slot_ = slot; }
+
  private:
   std::string sampler_identifier_;
   size_t texture_unit_;
+  size_t sampler_slot_;
 };
 
 }  // namespace shadertrap
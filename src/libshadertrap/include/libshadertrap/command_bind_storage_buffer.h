@@ -16,7 +16,6 @@
 #define LIBSHADERTRAP_COMMAND_BIND_STORAGE_BUFFER_H
 
 #include <cstddef>
-#include <memory>
 #include <string>
 
 #include "libshadertrap/command.h"
@@ -26,7 +25,7 @@ namespace shadertrap {
 
 class CommandBindStorageBuffer : public Command {
  public:
-  CommandBindStorageBuffer(std::unique_ptr<Token> start_token,
+  CommandBindStorageBuffer(const Token* start_token,
                            std::string storage_buffer_identifier,
                            size_t binding);
 
@@ -38,9 +37,14 @@ class CommandBindStorageBuffer : public Command {
 
   size_t GetBinding() const { return binding_; }
 
+  size_t GetStorageBufferSlot() const { return storage_buffer_slot_; }
+
+  void SetStorageBufferSlot(size_t slot) { storage_buffer_slot_ = slot; }
+
  private:
   std::string storage_buffer_identifier_;
   size_t binding_;
+  size_t storage_buffer_slot_;
 };
 
 }  // namespace shadertrap
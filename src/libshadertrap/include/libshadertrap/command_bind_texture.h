@@ -16,7 +16,6 @@
 #define LIBSHADERTRAP_COMMAND_BIND_TEXTURE_H
 
 #include <cstddef>
-#include <memory>
 #include <string>
 
 #include "libshadertrap/command.h"
@@ -26,7 +25,7 @@ namespace shadertrap {
 
 class CommandBindTexture : public Command {
  public:
-  CommandBindTexture(std::unique_ptr<Token> start_token,
+  CommandBindTexture(const Token* start_token,
                      std::string texture_identifier, size_t texture_unit);
 
   bool Accept(CommandVisitor* visitor) override;
@@ -37,9 +36,14 @@ class CommandBindTexture : public Command {
 
   size_t GetTextureUnit() const { return texture_unit_; }
 
+  size_t GetTextureSlot() const { return texture_slot_; }
+
+  void SetTextureSlot(size_t slot) { texture_slot_ = slot; }
+
  private:
   std::string texture_identifier_;
   size_t texture_unit_;
+  size_t texture_slot_;
 };
 
 }  // namespace shadertrap
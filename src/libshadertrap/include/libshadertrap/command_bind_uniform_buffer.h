@@ -16,7 +16,6 @@
 #define LIBSHADERTRAP_COMMAND_BIND_UNIFORM_BUFFER_H
 
 #include <cstddef>
-#include <memory>
 #include <string>
 
 #include "libshadertrap/command.h"
@@ -26,7 +25,7 @@ namespace shadertrap {
 
 class CommandBindUniformBuffer : public Command {
  public:
-  CommandBindUniformBuffer(std::unique_ptr<Token> start_token,
+  CommandBindUniformBuffer(const Token* start_token,
                            std::string uniform_buffer_identifier,
                            size_t binding);
 
@@ -38,9 +37,14 @@ class CommandBindUniformBuffer : public Command {
 
   size_t GetBinding() const { return binding_; }
 
+  size_t GetUniformBufferSlot() const { return uniform_buffer_slot_; }
+
+  void SetUniformBufferSlot(size_t slot) { uniform_buffer_slot_ = slot; }
+
  private:
   std::string uniform_buffer_identifier_;
   size_t binding_;
+  size_t uniform_buffer_slot_;
 };
 
 }  // namespace shadertrap
@@ -15,7 +15,7 @@
 #ifndef LIBSHADERTRAP_COMMAND_COMPILE_SHADER_H
 #define LIBSHADERTRAP_COMMAND_COMPILE_SHADER_H
 
-#include <memory>
+#include <cstddef>
 #include <string>
 
 #include "libshadertrap/command.h"
@@ -25,31 +25,41 @@ namespace shadertrap {
 
 class CommandCompileShader : public Command {
  public:
-  CommandCompileShader(std::unique_ptr<Token> start_token,
-                       std::unique_ptr<Token> result_identifier,
-                       std::unique_ptr<Token> shader_identifier);
+  CommandCompileShader(const Token* start_token,
+                       const Token* result_identifier,
+                       const Token* shader_identifier);
 
   bool Accept(CommandVisitor* visitor) override;
 
-  const std::string& GetResultIdentifier() const {
+  std::string GetResultIdentifier() const {
     return result_identifier_->GetText();
   }
 
   const Token* GetResultIdentifierToken() const {
-    return result_identifier_.get();
+    return result_identifier_;
   }
 
-  const std::string& GetShaderIdentifier() const {
+  std::string GetShaderIdentifier() const {
     return shader_identifier_->GetText();
   }
 
   const Token* GetShaderIdentifierToken() const {
-    return shader_identifier_.get();
+    return shader_identifier_;
   }
 
+  size_t GetResultSlot() const { return result_slot_; }
+
+  void SetResultSlot(size_t slot) { result_slot_ = slot; }
+
+  size_t GetShaderSlot() const { return shader_slot_; }
+
+  void SetShaderSlot(size_t slot) { shader_slot_ = slot; }
+
  private:
-  std::unique_ptr<Token> result_identifier_;
-  std::unique_ptr<Token> shader_identifier_;
+  const Token* result_identifier_;
+  const Token* shader_identifier_;
+  size_t result_slot_;
+  size_t shader_slot_;
 };
 
 }  // namespace shadertrap
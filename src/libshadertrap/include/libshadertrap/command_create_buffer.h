@@ -17,7 +17,6 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <memory>
 #include <string>
 #include <vector>
 
@@ -28,49 +27,108 @@ namespace shadertrap {
 
 class CommandCreateBuffer : public Command {
  public:
+  // kNone is used for data that comes from a file, which is untyped.
   enum class InitialDataType { kByte, kFloat, kInt, kUint, kNone };
 
-  CommandCreateBuffer(std::unique_ptr<Token> start_token,
-                      std::unique_ptr<Token> result_identifier,
-                      size_t size_bytes, const std::vector<uint8_t>& byte_data);
-
-  CommandCreateBuffer(std::unique_ptr<Token> start_token,
-                      std::unique_ptr<Token> result_identifier,
-                      size_t size_bytes, const std::vector<float>& float_data);
-
-  CommandCreateBuffer(std::unique_ptr<Token> start_token,
-                      std::unique_ptr<Token> result_identifier,
-                      size_t size_bytes, const std::vector<int32_t>& int_data);
-
-  CommandCreateBuffer(std::unique_ptr<Token> start_token,
-                      std::unique_ptr<Token> result_identifier,
-                      size_t size_bytes,
-                      const std::vector<uint32_t>& uint_data);
+  // A compact description of a buffer's initial data, which is expanded only
+  // when the buffer is created, so that its size does not depend on the size
+  // of the buffer.
+  struct Pattern {
+    enum class Kind { kConstant, kRamp, kRepeat, kRandom };
+
+    Kind kind;
+
+    // Literals, encoded as elements of the buffer's initial data type: the
+    // value of a constant, the start and step of a ramp, or the values to be
+    // repeated.
+    std::vector<uint8_t> elements;
+
+    // The seed of a sequence of pseudo-random values.
+    uint32_t seed;
+  };
+
+  // Creates a buffer initialized from literals: |initial_data| points to
+  // |size_bytes| bytes, holding elements of type |initial_data_type|.
+  CommandCreateBuffer(const Token* start_token, const Token* result_identifier,
+                      size_t size_bytes, InitialDataType initial_data_type,
+                      const uint8_t* initial_data);
+
+  // Creates a buffer initialized by expanding |pattern|, whose elements have
+  // type |initial_data_type|.
+  CommandCreateBuffer(const Token* start_token, const Token* result_identifier,
+                      size_t size_bytes, InitialDataType initial_data_type,
+                      Pattern pattern);
+
+  // Creates a buffer initialized from the file named by the string token
+  // |file|: |initial_data| points to the |initial_data_size| bytes of the file
+  // that follow |offset_bytes|. These may be fewer than |size_bytes|, which
+  // the checker reports.
+  CommandCreateBuffer(const Token* start_token, const Token* result_identifier,
+                      size_t size_bytes, const Token* file, size_t offset_bytes,
+                      const uint8_t* initial_data, size_t initial_data_size);
 
   bool Accept(CommandVisitor* visitor) override;
 
-  const std::string& GetResultIdentifier() const {
+  std::string GetResultIdentifier() const {
     return result_identifier_->GetText();
   }
 
   const Token* GetResultIdentifierToken() const {
-    return result_identifier_.get();
+    return result_identifier_;
   }
 
   size_t GetSizeBytes() const { return size_bytes_; }
 
   bool HasInitialData() const { return has_initial_data_; }
 
-  const std::vector<uint8_t>& GetInitialData() const { return initial_data_; }
+  // The initial data is not owned by the command; it is valid for as long as
+  // the program that the command belongs to. It is null if the data is given
+  // by a pattern.
+  const uint8_t* GetInitialData() const { return initial_data_; }
+
+  size_t GetInitialDataSize() const { return initial_data_size_; }
 
   InitialDataType GetInitialDataType() const { return initial_data_type_; }
 
+  bool HasInitialDataFile() const { return file_ != nullptr; }
+
+  const Token* GetInitialDataFileToken() const { return file_; }
+
+  std::string GetInitialDataFilename() const {
+    return file_->GetText().substr(1, file_->GetText().length() - 2);
+  }
+
+  size_t GetOffsetBytes() const { return offset_bytes_; }
+
+  bool HasInitialDataPattern() const { return has_pattern_; }
+
+  const Pattern& GetInitialDataPattern() const { return pattern_; }
+
+  // Writes the |length_bytes| bytes of the expanded pattern that start at
+  // |offset_bytes| to |destination|. Both must be multiples of the size of an
+  // element, so that the pattern can be expanded a chunk at a time.
+  void ExpandInitialDataPattern(size_t offset_bytes, size_t length_bytes,
+                                uint8_t* destination) const;
+
+  // The size in bytes of an element of type |type|, which must not be kNone.
+  static size_t GetElementSize(InitialDataType type);
+
+  size_t GetResultSlot() const { return result_slot_; }
+
+  void SetResultSlot(size_t slot) { result_slot_ = slot; }
+
  private:
-  std::unique_ptr<Token> result_identifier_;
+  const Token* result_identifier_;
   size_t size_bytes_;
   bool has_initial_data_;
-  std::vector<uint8_t> initial_data_;
+  const uint8_t* initial_data_;
+  size_t initial_data_size_;
   InitialDataType initial_data_type_;
+  const Token* file_;
+  size_t offset_bytes_;
+  bool has_pattern_;
+  Pattern pattern_;
+  size_t result_slot_;
 };
 
 }  // namespace shadertrap
@@ -16,7 +16,6 @@
 #define LIBSHADERTRAP_COMMAND_CREATE_EMPTY_TEXTURE_2D_H
 
 #include <cstddef>
-#include <memory>
 #include <string>
 
 #include "libshadertrap/command.h"
@@ -26,28 +25,33 @@ namespace shadertrap {
 
 class CommandCreateEmptyTexture2D : public Command {
  public:
-  CommandCreateEmptyTexture2D(std::unique_ptr<Token> start_token,
-                              std::unique_ptr<Token> result_identifier,
+  CommandCreateEmptyTexture2D(const Token* start_token,
+                              const Token* result_identifier,
                               size_t width, size_t height);
 
   bool Accept(CommandVisitor* visitor) override;
 
-  const std::string& GetResultIdentifier() const {
+  std::string GetResultIdentifier() const {
     return result_identifier_->GetText();
   }
 
   const Token* GetResultIdentifierToken() const {
-    return result_identifier_.get();
+    return result_identifier_;
   }
 
   size_t GetWidth() const { return width_; }
 
   size_t GetHeight() const { return height_; }
 
+  size_t GetResultSlot() const { return result_slot_; }
+
+  void SetResultSlot(size_t slot) { result_slot_ = slot; }
+
  private:
-  std::unique_ptr<Token> result_identifier_;
+  const Token* result_identifier_;
   size_t width_;
   size_t height_;
+  size_t result_slot_;
 };
 
 }  // namespace shadertrap
@@ -17,7 +17,6 @@
 
 #include <cassert>
 #include <cstddef>
-#include <memory>
 #include <string>
 #include <vector>
 
@@ -29,37 +28,53 @@ namespace shadertrap {
 class CommandCreateProgram : public Command {
  public:
   CommandCreateProgram(
-      std::unique_ptr<Token> start_token,
-      std::unique_ptr<Token> result_identifier,
-      std::vector<std::unique_ptr<Token>> compiled_shader_identifier);
+      const Token* start_token,
+      const Token* result_identifier,
+      std::vector<const Token*> compiled_shader_identifier);
 
   bool Accept(CommandVisitor* visitor) override;
 
-  const std::string& GetResultIdentifier() const {
+  std::string GetResultIdentifier() const {
     return result_identifier_->GetText();
   }
 
   const Token* GetResultIdentifierToken() const {
-    return result_identifier_.get();
+    return result_identifier_;
   }
 
-  const std::string& GetCompiledShaderIdentifier(size_t index) const {
+  std::string GetCompiledShaderIdentifier(size_t index) const {
     return GetCompiledShaderIdentifierToken(index)->GetText();
   }
 
   const Token* GetCompiledShaderIdentifierToken(size_t index) const {
     assert(index < compiled_shader_identifiers_.size() &&
            "Index out of bounds.");
-    return compiled_shader_identifiers_.at(index).get();
+    return compiled_shader_identifiers_.at(index);
   }
 
   size_t GetNumCompiledShaders() const {
     return compiled_shader_identifiers_.size();
   }
 
+  size_t GetResultSlot() const { return result_slot_; }
+
+  void SetResultSlot(size_t slot) { result_slot_ = slot; }
+
+  size_t GetCompiledShaderSlot(size_t index) const {
+    assert(index < compiled_shader_slots_.size() && "Index out of bounds.");
+    return compiled_shader_slots_[index];
+  }
+
+  void SetCompiledShaderSlot(size_t index, size_t slot) {
+    assert(index < compiled_shader_slots_.size() && "Index out of bounds.");
+    compiled_shader_slots_[index] = slot;
+  }
+
  private:
-  std::unique_ptr<Token> result_identifier_;
-  std::vector<std::unique_ptr<Token>> compiled_shader_identifiers_;
+  const Token* result_identifier_;
+  std::vector<const Token*> compiled_shader_identifiers_;
+  size_t result_slot_;
+  std::vector<size_t> compiled_shader_slots_;
 };
 
 }  // namespace shadertrap
@@ -16,7 +16,6 @@
 #define LIBSHADERTRAP_COMMAND_CREATE_RENDERBUFFER_H
 
 #include <cstddef>
-#include <memory>
 #include <string>
 
 #include "libshadertrap/command.h"
@@ -26,8 +25,8 @@ namespace shadertrap {
 
 class CommandCreateRenderbuffer : public Command {
  public:
-  CommandCreateRenderbuffer(std::unique_ptr<Token> start_token,
-                            std::string result_identifier, size_t width,
+  CommandCreateRenderbuffer(const Token* start_token,
+                            const Token* result_identifier, size_t width,
                             size_t height);
 
   bool Accept(CommandVisitor* visitor) override;
@@ -36,12 +35,23 @@ class CommandCreateRenderbuffer : public Command {
 
   size_t GetHeight() const { return height_; }
 
-  const std::string& GetResultIdentifier() const { return result_identifier_; }
+  std::string GetResultIdentifier() const {
+    return result_identifier_->GetText();
+  }
+
+  const Token* GetResultIdentifierToken() const {
+    return result_identifier_;
+  }
+
+  size_t GetResultSlot() const { return result_slot_; }
+
+  void SetResultSlot(size_t slot) { result_slot_ = slot; }
 
  private:
-  std::string result_identifier_;
+  const Token* result_identifier_;
   size_t width_;
   size_t height_;
+  size_t result_slot_;
 };
 
 }  // namespace shadertrap
@@ -15,7 +15,7 @@
 #ifndef LIBSHADERTRAP_COMMAND_CREATE_SAMPLER_H
 #define LIBSHADERTRAP_COMMAND_CREATE_SAMPLER_H
 
-#include <memory>
+#include <cstddef>
 #include <string>
 
 #include "libshadertrap/command.h"
@@ -25,21 +25,26 @@ namespace shadertrap {
 
 class CommandCreateSampler : public Command {
  public:
-  CommandCreateSampler(std::unique_ptr<Token> start_token,
-                       std::unique_ptr<Token> result_identifier);
+  CommandCreateSampler(const Token* start_token,
+                       const Token* result_identifier);
 
   bool Accept(CommandVisitor* visitor) override;
 
-  const std::string& GetResultIdentifier() const {
+  std::string GetResultIdentifier() const {
     return result_identifier_->GetText();
   }
 
   const Token* GetResultIdentifierToken() const {
-    return result_identifier_.get();
+    return result_identifier_;
   }
 
+  size_t GetResultSlot() const { return result_slot_; }
+
+  void SetResultSlot(size_t slot) { result_slot_ = slot; }
+
  private:
-  std::unique_ptr<Token> result_identifier_;
+  const Token* result_identifier_;
+  size_t result_slot_;
 };
 
 }  // namespace shadertrap
@@ -15,7 +15,7 @@
 #ifndef LIBSHADERTRAP_COMMAND_DECLARE_SHADER_H
 #define LIBSHADERTRAP_COMMAND_DECLARE_SHADER_H
 
-#include <memory>
+#include <cstddef>
 #include <string>
 
 #include "libshadertrap/command.h"
@@ -27,28 +27,44 @@ class CommandDeclareShader : public Command {
  public:
   enum class Kind { VERTEX, FRAGMENT, COMPUTE };
 
-  CommandDeclareShader(std::unique_ptr<Token> start_token,
-                       std::unique_ptr<Token> result_identifier, Kind kind,
-                       std::string shader_text);
+  // |shader_text| refers to |shader_text_length| characters, which are not
+  // null-terminated: typically a slice of the script, or of a shader file. They
+  // must outlive the command.
+  CommandDeclareShader(const Token* start_token, const Token* result_identifier,
+                       Kind kind, const char* shader_text,
+                       size_t shader_text_length);
 
   bool Accept(CommandVisitor* visitor) override;
 
-  const std::string& GetResultIdentifier() const {
+  std::string GetResultIdentifier() const {
     return result_identifier_->GetText();
   }
 
   const Token* GetResultIdentifierToken() const {
-    return result_identifier_.get();
+    return result_identifier_;
   }
 
-  const std::string& GetShaderText() const { return shader_text_; }
+  std::string GetShaderText() const {
+    return std::string(shader_text_, shader_text_length_);
+  }
+
+  // The shader text without copying it; it is not null-terminated.
+  const char* GetShaderTextData() const { return shader_text_; }
+
+  size_t GetShaderTextLength() const { return shader_text_length_; }
+
+  Kind GetKind() const { return kind_; }
+
+  size_t GetResultSlot() const { return result_slot_; }
 
-  Kind GetKind() { return kind_; }
+  void SetResultSlot(size_t slot) { result_slot_ = slot; }
 
  private:
-  std::unique_ptr<Token> result_identifier_;
+  const Token* result_identifier_;
   Kind kind_;
-  std::string shader_text_;
+  const char* shader_text_;
+  size_t shader_text_length_;
+  size_t result_slot_;
 };
 
 }  // namespace shadertrap
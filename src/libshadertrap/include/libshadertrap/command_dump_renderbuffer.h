@@ -15,7 +15,7 @@
 #ifndef LIBSHADERTRAP_COMMAND_DUMP_RENDERBUFFER_H
 #define LIBSHADERTRAP_COMMAND_DUMP_RENDERBUFFER_H
 
-#include <memory>
+#include <cstddef>
 #include <string>
 
 #include "libshadertrap/command.h"
@@ -25,7 +25,7 @@ namespace shadertrap {
 
 class CommandDumpRenderbuffer : public Command {
  public:
-  CommandDumpRenderbuffer(std::unique_ptr<Token> start_token,
+  CommandDumpRenderbuffer(const Token* start_token,
                           std::string renderbuffer_identifier,
                           std::string filename);
 
@@ -37,9 +37,14 @@ class CommandDumpRenderbuffer : public Command {
 
   const std::string& GetFilename() const { return filename_; }
 
+  size_t GetRenderbufferSlot() const { return renderbuffer_slot_; }
+
+  void SetRenderbufferSlot(size_t slot) { renderbuffer_slot_ = slot; }
+
  private:
   std::string renderbuffer_identifier_;
   std::string filename_;
+  size_t renderbuffer_slot_;
 };
 
 }  // namespace shadertrap
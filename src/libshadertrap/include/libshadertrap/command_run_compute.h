@@ -16,7 +16,6 @@
 #define LIBSHADERTRAP_COMMAND_RUN_COMPUTE_H
 
 #include <cstddef>
-#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -30,7 +29,7 @@ class CommandRunCompute : public Command {
  public:
   enum class Topology { kTriangles };
 
-  CommandRunCompute(std::unique_ptr<Token> start_token,
+  CommandRunCompute(const Token* start_token,
                     std::string program_identifier, size_t num_groups_x,
                     size_t num_groups_y, size_t num_groups_z);
 
@@ -46,12 +45,17 @@ class CommandRunCompute : public Command {
 
   size_t GetNumGroupsZ() const { return num_groups_z_; }
 
+  size_t GetProgramSlot() const { return program_slot_; }
+
+  void SetProgramSlot(size_t slot) { program_slot_ = slot; }
+
  private:
   std::string program_identifier_;
   std::unordered_map<size_t, VertexAttributeInfo> vertex_data_;
   size_t num_groups_x_;
   size_t num_groups_y_;
   size_t num_groups_z_;
+  size_t program_slot_;
 };
 
 }  // namespace shadertrap
@@ -16,7 +16,6 @@
 #define LIBSHADERTRAP_COMMAND_RUN_GRAPHICS_H
 
 #include <cstddef>
-#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -31,7 +30,7 @@ class CommandRunGraphics : public Command {
   enum class Topology { kTriangles };
 
   CommandRunGraphics(
-      std::unique_ptr<Token> start_token, std::string program_identifier,
+      const Token* start_token, std::string program_identifier,
       std::unordered_map<size_t, VertexAttributeInfo> vertex_data,
       std::string index_data_buffer_identifier, size_t vertex_count,
       Topology topology,
@@ -60,6 +59,32 @@ class CommandRunGraphics : public Command {
     return framebuffer_attachments_;
   }
 
+  size_t GetProgramSlot() const { return program_slot_; }
+
+  void SetProgramSlot(size_t slot) { program_slot_ = slot; }
+
+  size_t GetIndexDataBufferSlot() const { return index_data_buffer_slot_; }
+
+  void SetIndexDataBufferSlot(size_t slot) { index_data_buffer_slot_ = slot; }
+
+  // The slot of the buffer that holds the vertex data for |location|.
+  size_t GetVertexBufferSlot(size_t location) const {
+    return vertex_buffer_slots_.at(location);
+  }
+
+  void SetVertexBufferSlot(size_t location, size_t slot) {
+    vertex_buffer_slots_[location] = slot;
+  }
+
+  // The slot of the renderbuffer or texture attached at |location|.
+  size_t GetFramebufferAttachmentSlot(size_t location) const {
+    return framebuffer_attachment_slots_.at(location);
+  }
+
+  void SetFramebufferAttachmentSlot(size_t location, size_t slot) {
+    framebuffer_attachment_slots_[location] = slot;
+  }
+
  private:
   std::string program_identifier_;
   std::unordered_map<size_t, VertexAttributeInfo> vertex_data_;
@@ -67,6 +92,11 @@ class CommandRunGraphics : public Command {
   size_t vertex_count_;
   Topology topology_;
   std::unordered_map<size_t, std::string> framebuffer_attachments_;
+  size_t program_slot_;
+  size_t index_data_buffer_slot_;
+  // Keyed by location, like |vertex_data_| and |framebuffer_attachments_|.
+  std::unordered_map<size_t, size_t> vertex_buffer_slots_;
+  std::unordered_map<size_t, size_t> framebuffer_attachment_slots_;
 };
 
 }  // namespace shadertrap
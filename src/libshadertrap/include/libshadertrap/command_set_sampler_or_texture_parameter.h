@@ -15,7 +15,7 @@
 #ifndef LIBSHADERTRAP_COMMAND_SET_SAMPLER_OR_TEXTURE_PARAMETER_H
 #define LIBSHADERTRAP_COMMAND_SET_SAMPLER_OR_TEXTURE_PARAMETER_H
 
-#include <memory>
+#include <cstddef>
 #include <string>
 
 #include "libshadertrap/command.h"
@@ -29,7 +29,7 @@ class CommandSetSamplerOrTextureParameter : public Command {
 
   enum class TextureParameterValue { kNearest, kLinear };
 
-  CommandSetSamplerOrTextureParameter(std::unique_ptr<Token> start_token,
+  CommandSetSamplerOrTextureParameter(const Token* start_token,
                                       std::string target_texture_or_sampler,
                                       TextureParameter parameter,
                                       TextureParameterValue parameter_value);
@@ -44,10 +44,19 @@ class CommandSetSamplerOrTextureParameter : public Command {
 
   TextureParameterValue GetParameterValue() const { return parameter_value_; }
 
+  size_t GetTargetTextureOrSamplerSlot() const {
+    return target_texture_or_sampler_slot_;
+  }
+
+  void SetTargetTextureOrSamplerSlot(size_t slot) {
+    target_texture_or_sampler_slot_ = slot;
+  }
+
  private:
   std::string target_texture_or_sampler_;
   TextureParameter parameter_;
   TextureParameterValue parameter_value_;
+  size_t target_texture_or_sampler_slot_;
 };
 
 }  // namespace shadertrap
@@ -16,7 +16,6 @@
 #define LIBSHADERTRAP_COMMAND_SET_UNIFORM_H
 
 #include <cstddef>
-#include <memory>
 #include <string>
 
 #include "libshadertrap/command.h"
@@ -27,7 +26,7 @@ namespace shadertrap {
 
 class CommandSetUniform : public Command {
  public:
-  CommandSetUniform(std::unique_ptr<Token> start_token,
+  CommandSetUniform(const Token* start_token,
                     std::string program_identifier, size_t location,
                     UniformValue value);
 
@@ -41,10 +40,15 @@ class CommandSetUniform : public Command {
 
   const UniformValue& GetValue() const { return value_; }
 
+  size_t GetProgramSlot() const { return program_slot_; }
+
+  void SetProgramSlot(size_t slot) { program_slot_ = slot; }
+
  private:
   std::string program_identifier_;
   size_t location_;
   UniformValue value_;
+  size_t program_slot_;
 };
 
 }  // namespace shadertrap
@@ -17,96 +17,401 @@
 
 #include <glad/glad.h>
 
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "libshadertrap/command_assert_equal.h"
 #include "libshadertrap/command_assert_pixels.h"
 #include "libshadertrap/command_assert_similar_emd_histogram.h"
-#include "libshadertrap/command_bind_sampler.h"
-#include "libshadertrap/command_bind_storage_buffer.h"
-#include "libshadertrap/command_bind_texture.h"
-#include "libshadertrap/command_bind_uniform_buffer.h"
-#include "libshadertrap/command_compile_shader.h"
-#include "libshadertrap/command_create_buffer.h"
-#include "libshadertrap/command_create_empty_texture_2d.h"
-#include "libshadertrap/command_create_program.h"
-#include "libshadertrap/command_create_renderbuffer.h"
-#include "libshadertrap/command_create_sampler.h"
-#include "libshadertrap/command_declare_shader.h"
 #include "libshadertrap/command_dump_renderbuffer.h"
-#include "libshadertrap/command_run_compute.h"
-#include "libshadertrap/command_run_graphics.h"
-#include "libshadertrap/command_set_sampler_or_texture_parameter.h"
-#include "libshadertrap/command_set_uniform.h"
-#include "libshadertrap/command_visitor.h"
+#include "libshadertrap/image_writer.h"
+#include "libshadertrap/instruction.h"
+#include "libshadertrap/lowered_program.h"
 #include "libshadertrap/message_consumer.h"
+#include "libshadertrap/token.h"
 
 namespace shadertrap {
 
-class Executor : public CommandVisitor {
+struct ImageComparison;
+
+// Executes lowered programs using OpenGL. The executor keeps the objects that
+// a program creates in tables indexed by slot, so that executing an
+// instruction involves no lookup by name.
+class Executor {
  public:
+  // How ASSERT_EQUAL compares two renderbuffers.
+  enum class RenderbufferComparison {
+    // Both renderbuffers are read back in full and compared on the CPU. The
+    // first mismatching pixels, in rows from the top, are always reported
+    // individually, followed by a summary of all of them.
+    kOnCpu,
+    // The renderbuffers are compared by a compute shader, and only a summary
+    // of the mismatches is read back. Mismatching pixels are reported
+    // individually only if there are few of them. Where compute shaders are
+    // unavailable, the renderbuffers are read back in full instead.
+    kOnGpu
+  };
+
+  // Where ASSERT_SIMILAR_EMD_HISTOGRAM computes the histograms of the two
+  // renderbuffers.
+  enum class HistogramComputation {
+    // By a compute shader where compute shaders are available, and on the CPU
+    // otherwise.
+    kPreferGpu,
+    // Always on the CPU, from the renderbuffers read back in full, so that
+    // the two ways can be compared.
+    kOnCpu,
+    // Both ways where compute shaders are available, and an error is reported
+    // if the histograms differ, so that the compute shader can be checked.
+    kCheckGpuAgainstCpu
+  };
+
+  // Which memory barriers are issued around the work of RUN_COMPUTE and
+  // RUN_GRAPHICS.
+  enum class MemoryBarriers {
+    // Only the barriers that the lowerer inserted where it found a hazard are
+    // issued, and work is flushed only when it is read back.
+    kInferred,
+    // Every barrier bit is set before each run and wherever the lowerer
+    // inserted a barrier, and the work of each run is flushed after it, which
+    // may help to tell whether a driver mishandles barriers.
+    kConservative
+  };
+
+  // When OpenGL errors are checked for. An error stops execution whichever
+  // way it is found.
+  enum class GlErrorChecking {
+    // glGetError is called after every OpenGL call, and an error crashes the
+    // process naming the call that raised it.
+    kPerCall,
+    // glGetError is called only once after the work of each command, even
+    // where a call's result is checked, and errors are reported against the
+    // command.
+    kPerCommand,
+    // Errors are collected by a KHR_debug message callback, delivered
+    // synchronously, and reported against the command after its work. The
+    // driver's messages describe errors in more detail than glGetError, but
+    // the context should be a debug context for them to be sent; errors that
+    // glGetError flags without a message are reported too. Where KHR_debug is
+    // unavailable, errors are checked per command instead.
+    kDebugCallback
+  };
+
   explicit Executor(MessageConsumer* message_consumer);
 
-  bool VisitAssertEqual(CommandAssertEqual* assert_equal) override;
+  Executor(const Executor&) = delete;
 
-  bool VisitAssertPixels(CommandAssertPixels* assert_pixels) override;
+  Executor& operator=(const Executor&) = delete;
 
-  bool VisitAssertSimilarEmdHistogram(
-      CommandAssertSimilarEmdHistogram* assert_similar_emd_histogram) override;
+  Executor(Executor&&) = delete;
 
-  bool VisitBindSampler(CommandBindSampler* bind_sampler) override;
+  Executor& operator=(Executor&&) = delete;
 
-  bool VisitBindStorageBuffer(
-      CommandBindStorageBuffer* bind_storage_buffer) override;
+  ~Executor();
 
-  bool VisitBindTexture(CommandBindTexture* bind_texture) override;
+  // Executes the instructions of |program| in order, stopping at the first
+  // that fails. Images dumped by the program have all been written when this
+  // returns.
+  bool Execute(const LoweredProgram& program);
 
-  bool VisitBindUniformBuffer(
-      CommandBindUniformBuffer* bind_uniform_buffer) override;
+  void SetRenderbufferComparison(RenderbufferComparison comparison) {
+    renderbuffer_comparison_ = comparison;
+  }
 
-  bool VisitCompileShader(CommandCompileShader* compile_shader) override;
+  void SetHistogramComputation(HistogramComputation histogram_computation) {
+    histogram_computation_ = histogram_computation;
+  }
 
-  bool VisitCreateBuffer(CommandCreateBuffer* create_buffer) override;
+  void SetMemoryBarriers(MemoryBarriers memory_barriers) {
+    memory_barriers_ = memory_barriers;
+  }
 
-  bool VisitCreateSampler(CommandCreateSampler* create_sampler) override;
+  void SetGlErrorChecking(GlErrorChecking gl_error_checking) {
+    gl_error_checking_ = gl_error_checking;
+  }
 
-  bool VisitCreateEmptyTexture2D(
-      CommandCreateEmptyTexture2D* create_empty_texture_2d) override;
+  // The format in which DUMP_RENDERBUFFER writes images; PNG by default.
+  void SetDumpFormat(ImageWriter::Format format) { dump_format_ = format; }
 
-  bool VisitCreateProgram(CommandCreateProgram* create_program) override;
+  // The number of vertex array objects created for draws so far.
+  size_t GetNumVertexArraysCreated() const {
+    return num_vertex_arrays_created_;
+  }
 
-  bool VisitCreateRenderbuffer(
-      CommandCreateRenderbuffer* create_renderbuffer) override;
+  // The number of draws so far that reused a cached vertex array object.
+  size_t GetNumVertexArraysReused() const { return num_vertex_arrays_reused_; }
 
-  bool VisitDeclareShader(CommandDeclareShader* declare_shader) override;
+ private:
+  // An image attached to a framebuffer object: a renderbuffer or a texture,
+  // identified by its OpenGL object, at a color attachment point.
+  struct AttachedImage {
+    GLenum attachment;
+    bool is_renderbuffer;
+    GLuint object;
 
-  bool VisitDumpRenderbuffer(
-      CommandDumpRenderbuffer* dump_renderbuffer) override;
+    bool operator<(const AttachedImage& other) const;
+  };
 
-  bool VisitRunCompute(CommandRunCompute* run_compute) override;
+  // Binds a framebuffer object that has exactly |attached_images| attached to
+  // GL_FRAMEBUFFER. Framebuffer objects are cached by their attachments, so
+  // that each is created, and checked for completeness, only once.
+  void BindFramebuffer(const std::vector<AttachedImage>& attached_images);
 
-  bool VisitRunGraphics(CommandRunGraphics* run_graphics) override;
+  // The state of a vertex array object: the buffer and layout from which each
+  // of its vertex attributes is sourced, and its index buffer.
+  struct VertexArrayState {
+    struct Attribute {
+      GLuint location;
+      GLint dimension;
+      GLsizei stride_bytes;
+      size_t offset_bytes;
+      GLuint buffer;
 
-  bool VisitSetSamplerOrTextureParameter(
-      CommandSetSamplerOrTextureParameter* set_sampler_or_texture_parameter)
-      override;
+      bool operator<(const Attribute& other) const;
+    };
 
-  bool VisitSetUniform(CommandSetUniform* set_uniform) override;
+    std::vector<Attribute> attributes;
+    GLuint index_buffer;
 
- private:
-  bool CheckEqualBuffers(CommandAssertEqual* assert_equal);
+    bool operator<(const VertexArrayState& other) const;
+  };
+
+  // Binds a vertex array object that has state |state|. Vertex array objects
+  // are cached by their state, so that each is specified only once. The
+  // vertex array object is left bound after the draw; nothing else that the
+  // executor does touches vertex array state.
+  void BindVertexArray(const VertexArrayState& state);
+
+  // A readback of the color attachments of a framebuffer into a pixel buffer
+  // object, which is examined once |fence| signals.
+  struct PendingReadback {
+    GLuint pixel_buffer;
+    GLsync fence;
+    size_t size_bytes;
+    std::function<bool(const uint8_t* pixels)> examine;
+  };
+
+  // Starts reading the first |num_attachments| color attachments of the bound
+  // framebuffer, each |width| by |height|, into consecutive regions of a pixel
+  // buffer object, without waiting for rendering to finish. |examine| is
+  // applied to the pixels when the readback is finished. Returns false if an
+  // earlier readback had to be finished to make room, and failed.
+  bool StartReadback(size_t num_attachments, size_t width, size_t height,
+                     std::function<bool(const uint8_t* pixels)> examine);
+
+  // Finishes pending readbacks in the order in which they were started, so
+  // that diagnostics are reported in program order. If |wait| holds, waits
+  // for all of them; otherwise finishes only those whose fences have already
+  // signalled. At the first readback that fails, the remaining readbacks are
+  // abandoned and false is returned.
+  bool FinishReadbacks(bool wait);
+
+  // Must be called before a diagnostic is reported synchronously. Earlier
+  // commands may still have readbacks pending, and their diagnostics belong
+  // before this one, so they are finished first. Returns false if one of them
+  // failed: the first failing command decides the outcome, so execution stops
+  // there without the new diagnostic being reported.
+  bool FinishReadbacksBeforeReport();
+
+  // Waits for the oldest pending readback, and examines its pixels.
+  bool FinishOldestReadback();
+
+  // Discards pending readbacks without examining them.
+  void AbandonReadbacks();
+
+  bool CheckEqualBuffers(const Instruction::AssertEqualOperands& operands);
+
+  bool CheckEqualRenderbuffers(
+      const Instruction::AssertEqualOperands& operands);
+
+  // Reports the recorded mismatches of |comparison| individually, followed by
+  // a summary of all of them.
+  void ReportImageComparison(const CommandAssertEqual* assert_equal,
+                             const ImageComparison& comparison);
+
+  // Compiles and links a compute shader that the executor uses internally,
+  // crashing if that fails.
+  GLuint CreateInternalComputeProgram(const char* shader_text);
+
+  GLuint CreateInternalStorageBuffer(size_t size_bytes);
+
+  // Copies the renderbuffers attached to the first two color attachments of
+  // the bound framebuffer, each |width| by |height|, into the comparison
+  // textures, and binds those to image units 0 and 1.
+  void CopyAttachmentsToComparisonTextures(size_t width, size_t height);
+
+  // Runs |program|, whose work groups are |local_size_x| by |local_size_y|,
+  // over a |width| by |height| grid, with |storage_buffer| at storage buffer
+  // binding 0.
+  void DispatchInternalComputeProgram(GLuint program, GLuint storage_buffer,
+                                      size_t width, size_t height,
+                                      size_t local_size_x,
+                                      size_t local_size_y);
+
+  // Copies the first |size_bytes| bytes of |storage_buffer| into |data|.
+  void ReadInternalStorageBuffer(GLuint storage_buffer, size_t size_bytes,
+                                 void* data);
+
+  // Compares the renderbuffers attached to the first two color attachments of
+  // the bound framebuffer, each |width| by |height|, with a compute shader.
+  bool CompareRenderbuffersOnGpu(const CommandAssertEqual* assert_equal,
+                                 size_t width, size_t height);
+
+  bool ExecuteAssertPixels(const Instruction::AssertPixelsOperands& operands);
+
+  bool ExecuteAssertSimilarEmdHistogram(
+      const Instruction::AssertSimilarEmdHistogramOperands& operands);
+
+  bool ExaminePixels(const CommandAssertPixels* assert_pixels, size_t width,
+                     size_t height, const uint8_t* data);
+
+  // Computes the histograms of two images read back into |pixels| and checks
+  // their earth mover's distance. Unless |gpu_histograms| is empty, the
+  // histograms must also equal it.
+  bool ExamineSimilarEmdHistogram(
+      const CommandAssertSimilarEmdHistogram* assert_similar_emd_histogram,
+      size_t width, size_t height, const uint8_t* pixels,
+      const std::vector<uint32_t>& gpu_histograms);
+
+  // Accumulates into |histograms| the histograms of the renderbuffers
+  // attached to the first two color attachments of the bound framebuffer,
+  // each |width| by |height|, with a compute shader, so that only the
+  // histograms are read back. Returns false if an earlier readback had to be
+  // finished first, and failed.
+  bool ComputeHistogramsOnGpu(size_t width, size_t height,
+                              std::vector<uint32_t>* histograms);
 
-  bool CheckEqualRenderbuffers(CommandAssertEqual* assert_equal);
+  // Checks the earth mover's distance between the per-channel histograms of
+  // two images of |num_pixels| pixels each. |histograms| is indexed by image,
+  // then channel, then bin.
+  bool CheckHistogramEmd(
+      const CommandAssertSimilarEmdHistogram* assert_similar_emd_histogram,
+      size_t num_pixels, const std::vector<uint32_t>& histograms);
+
+  bool ExamineEqualRenderbuffers(const CommandAssertEqual* assert_equal,
+                                 size_t width, size_t height,
+                                 const uint8_t* pixels);
+
+  bool ExecuteCompileShader(
+      const Instruction::CompileShaderOperands& operands);
+
+  bool ExecuteCreateBuffer(const Instruction::CreateBufferOperands& operands);
+
+  bool ExecuteCreateEmptyTexture2D(
+      const Instruction::CreateImageOperands& operands);
+
+  bool ExecuteCreateProgram(const Instruction::CreateProgramOperands& operands,
+                            const LoweredProgram& lowered_program);
+
+  bool ExecuteCreateRenderbuffer(
+      const Instruction::CreateImageOperands& operands);
+
+  bool ExecuteDumpRenderbuffer(
+      const Instruction::DumpRenderbufferOperands& operands);
+
+  bool ExecuteRunCompute(const Instruction::RunComputeOperands& operands);
+
+  bool ExecuteRunGraphics(const Instruction::RunGraphicsOperands& operands,
+                          const LoweredProgram& lowered_program);
+
+  bool ExecuteSetUniform(const Instruction::SetUniformOperands& operands);
+
+  bool ExecuteInstructions(const LoweredProgram& program);
+
+  // Set up and tear down OpenGL error checking as |gl_error_checking_|
+  // requires.
+  void StartGlErrorChecking();
+  void StopGlErrorChecking();
+
+  // Reports the OpenGL errors found since the last check against |token|,
+  // yielding false if there were any.
+  bool CheckGlErrors(const Token* token);
+
+  static void APIENTRY CollectDebugMessage(GLenum source, GLenum type,
+                                           GLuint id, GLenum severity,
+                                           GLsizei length,
+                                           const GLchar* message,
+                                           const void* user_param);
+
+  bool WriteRenderbufferImage(const CommandDumpRenderbuffer* dump_renderbuffer,
+                              size_t width, size_t height, const uint8_t* data);
+
+  // Waits for dumped images to be written, crashing if any could not be.
+  void FinishImageWrites();
+
+  // Reports the outcome of every pending readback and waits for dumped images
+  // to be written, so that nothing done by earlier commands is lost when the
+  // process is about to crash. If a readback fails, the failure of the earlier
+  // command decides the outcome: the crash is not reported, and the process
+  // exits as if execution had stopped at that command.
+  void FinishPendingWork();
+
+  // Finishes the pending work of |executor| when the process crashes.
+  static void FinishPendingWorkBeforeCrash(void* executor);
+
+  // The number of readbacks that may be pending before the oldest is waited
+  // for.
+  static const size_t kMaxPendingReadbacks = 8;
+
+  // How long to wait for a fence between checks for an error, in nanoseconds.
+  static const GLuint64 kReadbackWaitTimeoutNanoseconds = 1000000000;
 
   MessageConsumer* message_consumer_;
-  std::map<std::string, CommandDeclareShader*> declared_shaders_;
-  std::map<std::string, GLuint> created_buffers_;
-  std::map<std::string, GLuint> created_programs_;
-  std::map<std::string, GLuint> created_renderbuffers_;
-  std::map<std::string, GLuint> created_samplers_;
-  std::map<std::string, GLuint> compiled_shaders_;
-  std::map<std::string, GLuint> created_textures_;
+  RenderbufferComparison renderbuffer_comparison_;
+  HistogramComputation histogram_computation_;
+  MemoryBarriers memory_barriers_;
+  GlErrorChecking gl_error_checking_;
+  ImageWriter::Format dump_format_;
+
+  // Objects used to examine renderbuffers on the GPU, created on first use.
+  GLuint comparison_program_;
+  GLuint comparison_result_buffer_;
+  GLuint histogram_program_;
+  GLuint histogram_buffer_;
+  GLuint comparison_textures_[2];
+  size_t comparison_texture_width_;
+  size_t comparison_texture_height_;
+
+  // Each table is indexed by slot, and holds 0 for slots that do not denote
+  // an object of the table's kind.
+  std::vector<GLuint> created_buffers_;
+  std::vector<GLuint> created_programs_;
+  std::vector<GLuint> created_renderbuffers_;
+  std::vector<GLuint> created_samplers_;
+  std::vector<GLuint> compiled_shaders_;
+  std::vector<GLuint> created_textures_;
+
+  // The cached framebuffer objects, which are deleted with the executor.
+  std::map<std::vector<AttachedImage>, GLuint> framebuffers_;
+  // Reused to describe the attachments of each framebuffer to be bound, so
+  // that finding a cached framebuffer object does not allocate.
+  std::vector<AttachedImage> attached_images_;
+
+  // The cached vertex array objects, which are deleted with the executor.
+  std::map<VertexArrayState, GLuint> vertex_arrays_;
+  // Reused in the same way as |attached_images_|.
+  VertexArrayState vertex_array_state_;
+  size_t num_vertex_arrays_created_;
+  size_t num_vertex_arrays_reused_;
+
+  // Readbacks that have been started but not yet examined, oldest first.
+  std::deque<PendingReadback> pending_readbacks_;
+  // Pixel buffer objects that are not in use, for reuse by later readbacks.
+  std::vector<GLuint> free_pixel_buffers_;
+
+  // Errors collected by the debug message callback, which may run on another
+  // thread.
+  std::mutex debug_errors_mutex_;
+  std::vector<std::string> debug_errors_;
+
+  // Encodes and writes dumped images in the background.
+  ImageWriter image_writer_;
 };
 
 }  // namespace shadertrap
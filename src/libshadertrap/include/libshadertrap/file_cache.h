@@ -0,0 +1,56 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBSHADERTRAP_FILE_CACHE_H
+#define LIBSHADERTRAP_FILE_CACHE_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "libshadertrap/source_buffer.h"
+
+namespace shadertrap {
+
+// Loads the files that scripts refer to, such as shader sources and buffer
+// contents. Each file is loaded at most once, however many times it is
+// referred to, whether by a single script or by several scripts parsed with
+// the same cache. Files are identified by the name used to refer to them.
+class FileCache {
+ public:
+  FileCache();
+
+  FileCache(const FileCache&) = delete;
+
+  FileCache& operator=(const FileCache&) = delete;
+
+  FileCache(FileCache&&) = delete;
+
+  FileCache& operator=(FileCache&&) = delete;
+
+  ~FileCache();
+
+  // Yields the contents of |filename|, loading it if it is not already cached,
+  // or nullptr (with an explanation in |error_message|) if it cannot be read.
+  // The contents are shared, so they can outlive the cache.
+  std::shared_ptr<const SourceBuffer> Load(const std::string& filename,
+                                           std::string* error_message);
+
+ private:
+  std::unordered_map<std::string, std::shared_ptr<const SourceBuffer>> files_;
+};
+
+}  // namespace shadertrap
+
+#endif  // LIBSHADERTRAP_FILE_CACHE_H
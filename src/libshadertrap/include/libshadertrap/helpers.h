@@ -28,8 +28,27 @@ void PrintShaderError(GLuint shader);
 
 void PrintProgramError(GLuint program);
 
+// Whether GL_CHECKERR, and so GL_SAFECALL and GL_SAFECALL_NO_ARGS, call
+// glGetError, which is the default. Otherwise errors are left flagged for
+// whoever chose to check them less often. The setting is shared by the whole
+// process, because the macros are used outside of any object that could hold
+// it.
+bool GlErrorsCheckedPerCall();
+
+void SetGlErrorsCheckedPerCall(bool checked);
+
+// Sets a function for crash and errcode_crash to run, with |context|, before
+// they report the error and exit, so that work still in flight, such as
+// diagnostics for earlier commands, is not lost. A null function removes it.
+// The function is removed before it runs, so a crash while it runs exits
+// directly.
+void SetCrashCleanup(void (*cleanup)(void* context), void* context);
+
+void RunCrashCleanup();
+
 #define errcode_crash(errcode, ...)                             \
   do {                                                          \
+    ::shadertrap::RunCrashCleanup();                            \
     printf("%s:%d (%s) ERROR: ", __FILE__, __LINE__, __func__); \
     printf(__VA_ARGS__);                                        \
     printf("\n");                                               \
@@ -38,19 +57,22 @@ void PrintProgramError(GLuint program);
 
 #define crash(...)                                              \
   do {                                                          \
+    ::shadertrap::RunCrashCleanup();                            \
     printf("%s:%d (%s) ERROR: ", __FILE__, __LINE__, __func__); \
     printf(__VA_ARGS__);                                        \
     printf("\n");                                               \
     exit(EXIT_FAILURE);                                         \
   } while (0)
 
-#define GL_CHECKERR(strfunc)                   \
-  do {                                         \
-    GLenum __err = glGetError();               \
-    if (__err != GL_NO_ERROR) {                \
-      crash("OpenGL error: %s(): %s", strfunc, \
-            OpenglErrorString(__err).c_str()); \
-    }                                          \
+#define GL_CHECKERR(strfunc)                     \
+  do {                                           \
+    if (GlErrorsCheckedPerCall()) {              \
+      GLenum __err = glGetError();               \
+      if (__err != GL_NO_ERROR) {                \
+        crash("OpenGL error: %s(): %s", strfunc, \
+              OpenglErrorString(__err).c_str()); \
+      }                                          \
+    }                                            \
   } while (0)
 
 #define GL_SAFECALL(func, ...) \
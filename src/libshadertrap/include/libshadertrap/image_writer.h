@@ -0,0 +1,111 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBSHADERTRAP_IMAGE_WRITER_H
+#define LIBSHADERTRAP_IMAGE_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace shadertrap {
+
+// Writes images to files on a pool of background threads, so that encoding
+// and writing them overlaps with whatever the caller does next, and with each
+// other. The threads are started when the first image is written. Images
+// written to the same file are written in order, so that the last one wins.
+class ImageWriter {
+ public:
+  enum class Format {
+    // PNG, compressed as well as lodepng can by default.
+    kPng,
+    // PNG, compressed with little effort and without searching for the best
+    // filter for each row.
+    kFastPng,
+    // The RGBA bytes of the image, top row first, with no header.
+    kRawRgba,
+    // Binary PPM, which drops the alpha channel.
+    kPpm
+  };
+
+  ImageWriter();
+
+  ImageWriter(const ImageWriter&) = delete;
+
+  ImageWriter& operator=(const ImageWriter&) = delete;
+
+  ImageWriter(ImageWriter&&) = delete;
+
+  ImageWriter& operator=(ImageWriter&&) = delete;
+
+  // Waits for pending images to be written.
+  ~ImageWriter();
+
+  // Queues an image of |width| by |height| RGBA8 pixels, laid out bottom row
+  // first as glReadPixels yields them, to be written to |filename| in
+  // |format|. |pixels| is copied, flipping it the right way up, before this
+  // returns. Blocks while too many images are already queued.
+  void Write(const std::string& filename, Format format, size_t width,
+             size_t height, const uint8_t* pixels);
+
+  // Waits until every queued image has been written. Yields false, and sets
+  // |error| to describe the first failure, if any image could not be written
+  // since the last call.
+  bool Wait(std::string* error);
+
+ private:
+  struct Job {
+    std::string filename;
+    Format format;
+    size_t width;
+    size_t height;
+    // Top row first.
+    std::vector<uint8_t> pixels;
+  };
+
+  // Run by each thread of the pool until the writer is destroyed.
+  void Work();
+
+  // Yields the first queued job whose file is not being written by another
+  // job, or the end of the queue if there is none. As jobs for the same file
+  // are queued in order, this is the earliest job for its file.
+  std::deque<Job>::iterator FindStartableJob();
+
+  // Yields an empty string on success, and a description of the failure
+  // otherwise.
+  static std::string WriteJob(const Job& job);
+
+  std::mutex mutex_;
+  // Signalled when a job is queued or finished, either of which may let a
+  // thread start a job, or when the writer is being destroyed.
+  std::condition_variable job_queued_;
+  // Signalled when a job is taken from the queue or finished.
+  std::condition_variable job_progressed_;
+  std::deque<Job> jobs_;
+  // The files being written by jobs in progress.
+  std::set<std::string> files_in_progress_;
+  bool stopping_;
+  std::string first_error_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace shadertrap
+
+#endif  // LIBSHADERTRAP_IMAGE_WRITER_H
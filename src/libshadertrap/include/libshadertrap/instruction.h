@@ -0,0 +1,218 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBSHADERTRAP_INSTRUCTION_H
+#define LIBSHADERTRAP_INSTRUCTION_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "libshadertrap/command_assert_equal.h"
+#include "libshadertrap/command_assert_pixels.h"
+#include "libshadertrap/command_assert_similar_emd_histogram.h"
+#include "libshadertrap/command_create_buffer.h"
+#include "libshadertrap/command_declare_shader.h"
+#include "libshadertrap/command_dump_renderbuffer.h"
+#include "libshadertrap/command_set_uniform.h"
+
+namespace shadertrap {
+
+// An instruction of a lowered program. It does the work of a single command,
+// with the identifiers that the command uses resolved to slots and its
+// parameters resolved to the values that OpenGL expects, so that executing it
+// involves neither lookups nor conversions.
+//
+// Instructions are plain data. Where an instruction needs more than would fit
+// in it, such as the text of a shader or the initial contents of a buffer, it
+// refers to the command from which it was lowered, or to a range of one of the
+// arrays of its lowered program.
+struct Instruction {
+  enum class Opcode : uint32_t {
+    kAssertEqualBuffers,
+    kAssertEqualRenderbuffers,
+    kAssertPixels,
+    kAssertSimilarEmdHistogram,
+    kBindBufferBase,
+    kBindSampler,
+    kBindTexture,
+    kCompileShader,
+    kCreateBuffer,
+    kCreateEmptyTexture2D,
+    kCreateProgram,
+    kCreateRenderbuffer,
+    kCreateSampler,
+    kDumpRenderbuffer,
+    kMemoryBarrier,
+    kRunCompute,
+    kRunGraphics,
+    kSetSamplerParameter,
+    kSetTextureParameter,
+    kSetUniform
+  };
+
+  // Used by kAssertEqualBuffers and kAssertEqualRenderbuffers.
+  struct AssertEqualOperands {
+    const CommandAssertEqual* command;
+    size_t slot_1;
+    size_t slot_2;
+  };
+
+  struct AssertPixelsOperands {
+    const CommandAssertPixels* command;
+    size_t renderbuffer_slot;
+  };
+
+  struct AssertSimilarEmdHistogramOperands {
+    const CommandAssertSimilarEmdHistogram* command;
+    size_t renderbuffer_slot_1;
+    size_t renderbuffer_slot_2;
+  };
+
+  // Used for both storage and uniform buffers, which differ only in |target|.
+  struct BindBufferBaseOperands {
+    GLenum target;
+    GLuint binding;
+    size_t buffer_slot;
+  };
+
+  struct BindSamplerOperands {
+    GLuint texture_unit;
+    size_t sampler_slot;
+  };
+
+  struct BindTextureOperands {
+    GLenum texture_unit;
+    size_t texture_slot;
+  };
+
+  struct CompileShaderOperands {
+    const CommandDeclareShader* declaration;
+    GLenum shader_kind;
+    size_t result_slot;
+  };
+
+  struct CreateBufferOperands {
+    const CommandCreateBuffer* command;
+    size_t result_slot;
+  };
+
+  // Used by kCreateEmptyTexture2D and kCreateRenderbuffer.
+  struct CreateImageOperands {
+    GLsizei width;
+    GLsizei height;
+    size_t result_slot;
+  };
+
+  // The shaders to be linked are given by a range of the compiled shader slots
+  // of the lowered program.
+  struct CreateProgramOperands {
+    size_t first_compiled_shader;
+    size_t num_compiled_shaders;
+    size_t result_slot;
+  };
+
+  struct CreateSamplerOperands {
+    size_t result_slot;
+  };
+
+  struct DumpRenderbufferOperands {
+    const CommandDumpRenderbuffer* command;
+    size_t renderbuffer_slot;
+  };
+
+  // Inserted by the lowerer before an instruction whose memory accesses must
+  // be ordered after those of earlier shaders.
+  struct MemoryBarrierOperands {
+    GLbitfield barriers;
+  };
+
+  struct RunComputeOperands {
+    size_t program_slot;
+    GLuint num_groups_x;
+    GLuint num_groups_y;
+    GLuint num_groups_z;
+  };
+
+  // The vertex attributes, framebuffer attachments and draw buffers are given
+  // by ranges of the corresponding arrays of the lowered program.
+  struct RunGraphicsOperands {
+    size_t program_slot;
+    size_t index_data_buffer_slot;
+    GLenum topology;
+    GLsizei vertex_count;
+    size_t first_vertex_attribute;
+    size_t num_vertex_attributes;
+    size_t first_framebuffer_attachment;
+    size_t num_framebuffer_attachments;
+    size_t first_draw_buffer;
+    size_t num_draw_buffers;
+  };
+
+  // Used by kSetSamplerParameter and kSetTextureParameter.
+  struct SetParameterOperands {
+    size_t target_slot;
+    GLenum parameter;
+    GLint parameter_value;
+  };
+
+  struct SetUniformOperands {
+    const CommandSetUniform* command;
+    size_t program_slot;
+    GLint location;
+  };
+
+  Opcode opcode;
+  union {
+    AssertEqualOperands assert_equal;
+    AssertPixelsOperands assert_pixels;
+    AssertSimilarEmdHistogramOperands assert_similar_emd_histogram;
+    BindBufferBaseOperands bind_buffer_base;
+    BindSamplerOperands bind_sampler;
+    BindTextureOperands bind_texture;
+    CompileShaderOperands compile_shader;
+    CreateBufferOperands create_buffer;
+    CreateImageOperands create_image;
+    CreateProgramOperands create_program;
+    CreateSamplerOperands create_sampler;
+    DumpRenderbufferOperands dump_renderbuffer;
+    MemoryBarrierOperands memory_barrier;
+    RunComputeOperands run_compute;
+    RunGraphicsOperands run_graphics;
+    SetParameterOperands set_parameter;
+    SetUniformOperands set_uniform;
+  };
+};
+
+// The layout of the data for a vertex attribute used by a kRunGraphics
+// instruction.
+struct VertexAttribute {
+  GLuint location;
+  GLint dimension;
+  GLsizei stride_bytes;
+  size_t offset_bytes;
+  size_t buffer_slot;
+};
+
+// An image attached to the framebuffer by a kRunGraphics instruction.
+struct FramebufferAttachment {
+  GLenum attachment;
+  bool is_renderbuffer;
+  size_t slot;
+};
+
+}  // namespace shadertrap
+
+#endif  // LIBSHADERTRAP_INSTRUCTION_H
@@ -0,0 +1,77 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBSHADERTRAP_LOWERED_PROGRAM_H
+#define LIBSHADERTRAP_LOWERED_PROGRAM_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "libshadertrap/instruction.h"
+#include "libshadertrap/token.h"
+
+namespace shadertrap {
+
+// A program lowered to a flat array of instructions, together with the arrays
+// to which its instructions refer. Some instructions refer to the commands of
+// the program from which it was lowered, which must therefore outlive it.
+class LoweredProgram {
+ public:
+  LoweredProgram(std::vector<Instruction> instructions,
+                 std::vector<const Token*> instruction_tokens,
+                 std::vector<size_t> compiled_shader_slots,
+                 std::vector<VertexAttribute> vertex_attributes,
+                 std::vector<FramebufferAttachment> framebuffer_attachments,
+                 std::vector<GLenum> draw_buffers);
+
+  const std::vector<Instruction>& GetInstructions() const {
+    return instructions_;
+  }
+
+  // The start token of the command for which the instruction at |index| does
+  // work, against which errors in the instruction are reported.
+  const Token* GetInstructionToken(size_t index) const {
+    return instruction_tokens_[index];
+  }
+
+  size_t GetCompiledShaderSlot(size_t index) const {
+    return compiled_shader_slots_[index];
+  }
+
+  const VertexAttribute& GetVertexAttribute(size_t index) const {
+    return vertex_attributes_[index];
+  }
+
+  const FramebufferAttachment& GetFramebufferAttachment(size_t index) const {
+    return framebuffer_attachments_[index];
+  }
+
+  const GLenum* GetDrawBuffers(size_t first) const {
+    return draw_buffers_.data() + first;
+  }
+
+ private:
+  std::vector<Instruction> instructions_;
+  std::vector<const Token*> instruction_tokens_;
+  std::vector<size_t> compiled_shader_slots_;
+  std::vector<VertexAttribute> vertex_attributes_;
+  std::vector<FramebufferAttachment> framebuffer_attachments_;
+  std::vector<GLenum> draw_buffers_;
+};
+
+}  // namespace shadertrap
+
+#endif  // LIBSHADERTRAP_LOWERED_PROGRAM_H
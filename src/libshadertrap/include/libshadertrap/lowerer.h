@@ -0,0 +1,175 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBSHADERTRAP_LOWERER_H
+#define LIBSHADERTRAP_LOWERER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "libshadertrap/command.h"
+#include "libshadertrap/command_assert_equal.h"
+#include "libshadertrap/command_assert_pixels.h"
+#include "libshadertrap/command_assert_similar_emd_histogram.h"
+#include "libshadertrap/command_bind_sampler.h"
+#include "libshadertrap/command_bind_storage_buffer.h"
+#include "libshadertrap/command_bind_texture.h"
+#include "libshadertrap/command_bind_uniform_buffer.h"
+#include "libshadertrap/command_compile_shader.h"
+#include "libshadertrap/command_create_buffer.h"
+#include "libshadertrap/command_create_empty_texture_2d.h"
+#include "libshadertrap/command_create_program.h"
+#include "libshadertrap/command_create_renderbuffer.h"
+#include "libshadertrap/command_create_sampler.h"
+#include "libshadertrap/command_declare_shader.h"
+#include "libshadertrap/command_dump_renderbuffer.h"
+#include "libshadertrap/command_run_compute.h"
+#include "libshadertrap/command_run_graphics.h"
+#include "libshadertrap/command_set_sampler_or_texture_parameter.h"
+#include "libshadertrap/command_set_uniform.h"
+#include "libshadertrap/command_visitor.h"
+#include "libshadertrap/instruction.h"
+#include "libshadertrap/lowered_program.h"
+#include "libshadertrap/token.h"
+
+namespace shadertrap {
+
+// Lowers the commands of a program to instructions for the executor. The
+// program must have been checked, so that its identifiers are resolved to
+// slots.
+//
+// Shader writes to storage buffers are incoherent, so the lowerer also tracks
+// which buffers each command may read and write, and inserts a memory barrier
+// before a command only where it accesses a buffer in a way that conflicts
+// with an earlier shader access. The barrier has just the bits for the kinds
+// of access that need it.
+class Lowerer : public CommandVisitor {
+ public:
+  Lowerer() = default;
+
+  bool VisitAssertEqual(CommandAssertEqual* assert_equal) override;
+
+  bool VisitAssertPixels(CommandAssertPixels* assert_pixels) override;
+
+  bool VisitAssertSimilarEmdHistogram(
+      CommandAssertSimilarEmdHistogram* assert_similar_emd_histogram) override;
+
+  bool VisitBindSampler(CommandBindSampler* bind_sampler) override;
+
+  bool VisitBindStorageBuffer(
+      CommandBindStorageBuffer* bind_storage_buffer) override;
+
+  bool VisitBindTexture(CommandBindTexture* bind_texture) override;
+
+  bool VisitBindUniformBuffer(
+      CommandBindUniformBuffer* bind_uniform_buffer) override;
+
+  bool VisitCompileShader(CommandCompileShader* compile_shader) override;
+
+  bool VisitCreateBuffer(CommandCreateBuffer* create_buffer) override;
+
+  bool VisitCreateSampler(CommandCreateSampler* create_sampler) override;
+
+  bool VisitCreateEmptyTexture2D(
+      CommandCreateEmptyTexture2D* create_empty_texture_2d) override;
+
+  bool VisitCreateProgram(CommandCreateProgram* create_program) override;
+
+  bool VisitCreateRenderbuffer(
+      CommandCreateRenderbuffer* create_renderbuffer) override;
+
+  bool VisitDeclareShader(CommandDeclareShader* declare_shader) override;
+
+  bool VisitDumpRenderbuffer(
+      CommandDumpRenderbuffer* dump_renderbuffer) override;
+
+  bool VisitRunCompute(CommandRunCompute* run_compute) override;
+
+  bool VisitRunGraphics(CommandRunGraphics* run_graphics) override;
+
+  bool VisitSetSamplerOrTextureParameter(
+      CommandSetSamplerOrTextureParameter* set_sampler_or_texture_parameter)
+      override;
+
+  bool VisitSetUniform(CommandSetUniform* set_uniform) override;
+
+  // Yields the instructions for the commands visited so far.
+  std::unique_ptr<LoweredProgram> GetLoweredProgram();
+
+ private:
+  // Adds |instruction|, which does work for |command|.
+  void AddInstruction(const Command& command, const Instruction& instruction);
+
+  std::vector<Instruction> instructions_;
+  std::vector<const Token*> instruction_tokens_;
+  std::vector<size_t> compiled_shader_slots_;
+  std::vector<VertexAttribute> vertex_attributes_;
+  std::vector<FramebufferAttachment> framebuffer_attachments_;
+  std::vector<GLenum> draw_buffers_;
+
+  // What the lowerer needs to know about the objects that the program creates
+  // in order to choose between instructions.
+  std::unordered_map<size_t, const CommandDeclareShader*> declared_shaders_;
+  std::unordered_set<size_t> renderbuffer_slots_;
+  std::unordered_set<size_t> sampler_slots_;
+
+  // An access to a buffer by a command, described by the barrier bit that
+  // orders accesses of its kind after earlier shader writes.
+  struct BufferAccess {
+    size_t buffer_slot;
+    GLbitfield barrier_bit;
+    bool is_shader_write;
+  };
+
+  // What the lowerer knows about the accesses to a buffer that are not yet
+  // ordered by memory barriers.
+  struct BufferHazards {
+    // The kinds of access, as barrier bits, that might not yet see the latest
+    // shader writes to the buffer.
+    GLbitfield unordered_write_barriers;
+    // Whether a command has accessed the buffer since the last shader storage
+    // barrier, so that a shader write to it must wait for that access.
+    bool accessed_since_storage_barrier;
+  };
+
+  // Yields the accesses to buffers made by a command that runs shaders: the
+  // buffers currently bound as storage or uniform buffers, followed by
+  // |other_accesses|. Every bound storage buffer is assumed to be both read
+  // and written.
+  std::vector<BufferAccess> GetShaderBufferAccesses(
+      std::vector<BufferAccess> other_accesses) const;
+
+  // Adds a memory barrier instruction if one is needed before |command|, which
+  // makes |accesses|, and records the accesses. |is_synchronous| is true for
+  // accesses, such as mapping a buffer, that complete before any later
+  // command runs, so that later shader writes need not wait for them.
+  void OrderBufferAccesses(const Command& command,
+                           const std::vector<BufferAccess>& accesses,
+                           bool is_synchronous);
+
+  // The buffer slots bound to each storage and uniform buffer binding.
+  std::unordered_map<GLuint, size_t> storage_buffer_bindings_;
+  std::unordered_map<GLuint, size_t> uniform_buffer_bindings_;
+
+  std::unordered_map<size_t, BufferHazards> buffer_hazards_;
+};
+
+}  // namespace shadertrap
+
+#endif  // LIBSHADERTRAP_LOWERER_H
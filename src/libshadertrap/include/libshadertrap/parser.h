@@ -17,16 +17,19 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <functional>
-#include <map>
+#include <initializer_list>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "libshadertrap/arena.h"
 #include "libshadertrap/command.h"
+#include "libshadertrap/command_create_buffer.h"
+#include "libshadertrap/file_cache.h"
 #include "libshadertrap/message_consumer.h"
 #include "libshadertrap/shadertrap_program.h"
+#include "libshadertrap/source_buffer.h"
 #include "libshadertrap/token.h"
 #include "libshadertrap/uniform_value.h"
 #include "libshadertrap/vertex_attribute_info.h"
@@ -39,6 +42,17 @@ class Parser {
  public:
   Parser(const std::string& input, MessageConsumer* message_consumer);
 
+  // Parses the text held by |source|, which is handed on to the parsed program
+  // so that its tokens remain valid.
+  Parser(std::unique_ptr<SourceBuffer> source,
+         MessageConsumer* message_consumer);
+
+  // As above, but files that the script refers to are loaded via
+  // |file_cache|, which may be shared between parsers so that a file used by
+  // several scripts is only loaded once.
+  Parser(std::unique_ptr<SourceBuffer> source, FileCache* file_cache,
+         MessageConsumer* message_consumer);
+
   ~Parser();
 
   Parser(const Parser&) = delete;
@@ -54,10 +68,47 @@ class Parser {
   std::unique_ptr<ShaderTrapProgram> GetParsedProgram();
 
  private:
+  // Associates a parameter keyword with a handler that parses the value of the
+  // parameter. The handler is referred to rather than copied, so that no
+  // allocation is needed; a ParameterParser must therefore not outlive the
+  // full expression in which it is created.
+  class ParameterParser {
+   public:
+    enum class Presence { kRequired, kOptional };
+
+    template <typename Handler>
+    ParameterParser(Token::Type type, const Handler& handler,
+                    Presence presence = Presence::kRequired)
+        : type_(type),
+          presence_(presence),
+          handler_(&handler),
+          invoke_(&Invoke<Handler>) {}
+
+    Token::Type GetType() const { return type_; }
+
+    bool IsOptional() const { return presence_ == Presence::kOptional; }
+
+    bool operator()() const { return invoke_(handler_); }
+
+   private:
+    template <typename Handler>
+    static bool Invoke(const void* handler) {
+      return (*static_cast<const Handler*>(handler))();
+    }
+
+    Token::Type type_;
+    Presence presence_;
+    const void* handler_;
+    bool (*invoke_)(const void*);
+  };
+
   bool ParseCommand();
 
+  // Parses parameters, in any order, until a token that does not name one of
+  // |parameter_parsers| is reached. No parameter may appear more than once,
+  // and every parameter that is not optional must appear.
   bool ParseParameters(
-      const std::map<Token::Type, std::function<bool()>>& parameter_parsers);
+      std::initializer_list<ParameterParser> parameter_parsers);
 
   bool ParseCommandAssertEqual();
 
@@ -100,7 +151,7 @@ class Parser {
   std::pair<bool, UniformValue> ProcessUniformValue(
       UniformValue::ElementType type,
       const std::pair<bool, size_t>& maybe_array_size,
-      const std::vector<std::unique_ptr<Token>>& values);
+      const std::vector<Token>& values);
 
   std::pair<bool, uint8_t> ParseUint8(const std::string& result_name);
 
@@ -108,13 +159,54 @@ class Parser {
 
   std::pair<bool, float> ParseFloat(const std::string& result_name);
 
+  // Parses the kind of pattern that follows INIT_PATTERN, together with its
+  // arguments. Any literals are added to |values|, to be decoded once the type
+  // of the buffer is known.
+  bool ParseBufferPattern(CommandCreateBuffer::Pattern* pattern,
+                          std::vector<Token>* values);
+
+  // Appends the value of |token| to |data|, as an element of a buffer being
+  // initialized with elements of type |type|. Reports an error and yields
+  // false if the token is not a valid literal of that type.
+  bool AppendBufferLiteral(const Token& token,
+                           CommandCreateBuffer::InitialDataType type,
+                           std::vector<uint8_t>* data);
+
+  // Yield the value of a numeric literal, reporting an error and yielding
+  // false if the literal is malformed or does not fit the result type.
+  bool ConvertIntLiteral(const Token& token, int64_t* result);
+
+  bool ConvertFloatLiteral(const Token& token, float* result);
+
   std::pair<bool, VertexAttributeInfo> ParseVertexAttributeInfo();
 
+  // Loads the file named by the string token |filename|, reporting an error
+  // and yielding nullptr if that is not possible. Unlike the script itself,
+  // such a file cannot be read from standard input. The file's contents are
+  // valid for as long as the arena.
+  const SourceBuffer* LoadFile(const Token& filename);
+
+  // Copies |token| into the arena, for a command to refer to.
+  const Token* RetainToken(const Token& token);
+
+  // The text being parsed. Ownership passes to the parsed program, since the
+  // tokens held by its commands refer to slices of this buffer.
+  std::unique_ptr<SourceBuffer> source_;
+
+  // Holds the parsed commands and the tokens they refer to. Like |source_|,
+  // ownership passes to the parsed program.
+  std::unique_ptr<Arena> arena_;
+
+  // The cache used to load files, which is owned by the parser unless one was
+  // provided.
+  std::unique_ptr<FileCache> owned_file_cache_;
+  FileCache* file_cache_;
+
   std::unique_ptr<Tokenizer> tokenizer_;
 
   MessageConsumer* message_consumer_;
 
-  std::vector<std::unique_ptr<Command>> parsed_commands_;
+  std::vector<Command*> parsed_commands_;
 };
 
 }  // namespace shadertrap
@@ -19,20 +19,34 @@
 #include <memory>
 #include <vector>
 
+#include "libshadertrap/arena.h"
 #include "libshadertrap/command.h"
+#include "libshadertrap/source_buffer.h"
 
 namespace shadertrap {
 
 class ShaderTrapProgram {
  public:
-  explicit ShaderTrapProgram(std::vector<std::unique_ptr<Command>> commands);
+  // The commands, and the tokens they refer to, must have been allocated in
+  // |arena|.
+  ShaderTrapProgram(std::unique_ptr<SourceBuffer> source,
+                    std::unique_ptr<Arena> arena,
+                    std::vector<Command*> commands);
 
   size_t GetNumCommands() { return commands_.size(); }
 
-  Command* GetCommand(size_t index) { return commands_[index].get(); }
+  Command* GetCommand(size_t index) { return commands_[index]; }
+
+  const SourceBuffer* GetSource() const { return source_.get(); }
 
  private:
-  std::vector<std::unique_ptr<Command>> commands_;
+  // The tokens of the program's commands refer to slices of this buffer, so it
+  // is declared first in order that it is destroyed last.
+  std::unique_ptr<SourceBuffer> source_;
+  // Owns the commands and their tokens, which are all released together when
+  // the program is destroyed.
+  std::unique_ptr<Arena> arena_;
+  std::vector<Command*> commands_;
 };
 
 }  // namespace shadertrap
@@ -0,0 +1,71 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBSHADERTRAP_SOURCE_BUFFER_H
+#define LIBSHADERTRAP_SOURCE_BUFFER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace shadertrap {
+
+// An immutable, contiguous buffer holding the text of a script, or the raw
+// contents of a file that a script loads. Tokens refer to slices of this buffer
+// rather than owning copies of their text, so a SourceBuffer must outlive every
+// token derived from it. Its contents never move, which is why it can be
+// neither copied nor moved.
+class SourceBuffer {
+ public:
+  explicit SourceBuffer(std::string data);
+
+  // Yields a buffer holding the contents of |filename|, or nullptr (with an
+  // explanation in |error_message|) if the file cannot be read. Regular files
+  // are memory-mapped rather than copied; other files, such as pipes, are
+  // read into memory. The filename "-" denotes standard input.
+  static std::unique_ptr<SourceBuffer> FromFile(const std::string& filename,
+                                                std::string* error_message);
+
+  SourceBuffer(const SourceBuffer&) = delete;
+
+  SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+  SourceBuffer(SourceBuffer&&) = delete;
+
+  SourceBuffer& operator=(SourceBuffer&&) = delete;
+
+  ~SourceBuffer();
+
+  // The data is not null-terminated: GetSize() must be respected.
+  const char* GetData() const { return data_; }
+
+  size_t GetSize() const { return size_; }
+
+ private:
+  // Takes ownership of a read-only mapping of |size| bytes at |mapping|.
+  SourceBuffer(void* mapping, size_t size);
+
+  // Storage for text that is not memory-mapped.
+  const std::string owned_data_;
+
+  // The address of the file mapping, if the text is memory-mapped.
+  void* const mapping_;
+
+  const char* const data_;
+  const size_t size_;
+};
+
+}  // namespace shadertrap
+
+#endif  // LIBSHADERTRAP_SOURCE_BUFFER_H
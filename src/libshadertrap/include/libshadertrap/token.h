@@ -58,6 +58,7 @@ class Token {
     kKeywordFramebufferAttachments,
     kKeywordHeight,
     kKeywordIndexData,
+    kKeywordInitPattern,
     kKeywordInitType,
     kKeywordInitValues,
     kKeywordLocation,
@@ -99,9 +100,26 @@ class Token {
 
   explicit Token(Type type, size_t line, size_t column);
 
-  Token(Type type, std::string text, size_t line, size_t column);
+  // Creates a token whose text is the slice [offset, offset + length) of
+  // |source|. The token does not own its text: |source| must outlive it.
+  Token(Type type, const char* source, size_t offset, size_t length,
+        size_t line, size_t column);
 
-  const std::string& GetText() const { return text_; }
+  // Materializes the text of the token. Prefer TextEquals() or GetType() for
+  // comparisons, as they do not allocate.
+  std::string GetText() const {
+    return std::string(source_ + offset_, length_);
+  }
+
+  bool TextEquals(const char* text) const;
+
+  // The text of the token, which is not null-terminated: GetLength() must be
+  // respected.
+  const char* GetData() const { return source_ + offset_; }
+
+  size_t GetOffset() const { return offset_; }
+
+  size_t GetLength() const { return length_; }
 
   Type GetType() const { return type_; }
 
@@ -122,8 +140,10 @@ class Token {
   std::string GetLocationString() const;
 
  private:
-  std::string text_;
   Type type_;
+  const char* source_;
+  size_t offset_;
+  size_t length_;
   size_t line_;
   size_t column_;
 };
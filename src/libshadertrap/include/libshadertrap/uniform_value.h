@@ -79,6 +79,11 @@ class UniformValue {
     return reinterpret_cast<const int32_t*>(data_.data());
   }
 
+  // The raw bytes of the data, whatever its type.
+  const char* GetData() const { return data_.data(); }
+
+  size_t GetDataSizeBytes() const { return data_.size(); }
+
  private:
   ElementType element_type_;
   // (false, 0) if there is no array size, otherwise (true, array_size).
@@ -0,0 +1,81 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBSHADERTRAP_BINARY_PROGRAM_FORMAT_H
+#define LIBSHADERTRAP_BINARY_PROGRAM_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace shadertrap {
+
+// The layout of a binary program, as written by BinaryProgramWriter and read
+// by BinaryProgramReader. All integers are stored in the byte order of the
+// machine that wrote the program, which is recorded so that a program written
+// on a machine of the other byte order is rejected rather than misread.
+//
+//   header:       magic, version, byte order mark, number of commands
+//   string table: number of strings, then each string
+//   commands:     for each command, its tag, its start token, then its fields
+//
+// The number of commands and the number of strings are uint32_t, as are
+// enumerations and other small values; all other sizes and counts are
+// uint64_t. A string in the string table is a uint32_t length followed by
+// that many bytes. A token is a uint32_t type, line and column followed by the
+// index of its text in the string table; identifiers and filenames are
+// likewise stored as indices into the string table, so that each is stored
+// only once. Bulk data - shader text and buffer contents - is stored inline as
+// a size followed by that many bytes, so that the commands that use it can
+// refer to it where it lies.
+namespace binary_program_format {
+
+const size_t kMagicSize = 8;
+
+const char kMagic[kMagicSize] = {'S', 'T', 'B', 'I', 'N', '\r', '\n', '\x1a'};
+
+// Must be incremented whenever the layout changes.
+const uint32_t kVersion = 2;
+
+const uint32_t kByteOrderMark = 0x01020304;
+
+enum class CommandTag : uint32_t {
+  kAssertEqual,
+  kAssertPixels,
+  kAssertSimilarEmdHistogram,
+  kBindSampler,
+  kBindStorageBuffer,
+  kBindTexture,
+  kBindUniformBuffer,
+  kCompileShader,
+  kCreateBuffer,
+  kCreateEmptyTexture2D,
+  kCreateProgram,
+  kCreateRenderbuffer,
+  kCreateSampler,
+  kDeclareShader,
+  kDumpRenderbuffer,
+  kRunCompute,
+  kRunGraphics,
+  kSetSamplerOrTextureParameter,
+  kSetUniform
+};
+
+// The ways in which the contents of a buffer can be given.
+enum class BufferContents : uint32_t { kValues, kPattern, kFile };
+
+}  // namespace binary_program_format
+
+}  // namespace shadertrap
+
+#endif  // LIBSHADERTRAP_BINARY_PROGRAM_FORMAT_H
@@ -0,0 +1,107 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBSHADERTRAP_DATA_COMPARISON_H
+#define LIBSHADERTRAP_DATA_COMPARISON_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace shadertrap {
+
+// Routines for comparing the contents of two buffers or two images, as
+// ASSERT_EQUAL and ASSERT_SIMILAR_EMD_HISTOGRAM do. Equal stretches are
+// skipped many bytes at a time, using SSE2 or AVX2 when the target supports
+// it, and large inputs are split across several threads. Each comparison
+// summarizes the mismatches and records only the first few, so that the cost
+// of reporting is bounded however many there are.
+
+// Finds the first index in [begin, end) at which |data_1| and |data_2| differ,
+// or |end| if they agree on the whole range.
+size_t FindMismatch(const uint8_t* data_1, const uint8_t* data_2, size_t begin,
+                    size_t end);
+
+struct ByteMismatch {
+  size_t index;
+  uint8_t value_1;
+  uint8_t value_2;
+};
+
+struct BufferComparison {
+  size_t num_mismatches;
+  // The lowest and highest indices at which the buffers differ; meaningful
+  // only if there is a mismatch.
+  size_t first_index;
+  size_t last_index;
+  // The largest absolute difference between corresponding bytes.
+  uint8_t max_delta;
+  // The first mismatches, in order of index.
+  std::vector<ByteMismatch> first_mismatches;
+};
+
+// Compares two buffers of |size| bytes, recording at most |max_recorded|
+// mismatches individually.
+BufferComparison CompareBuffers(const uint8_t* data_1, const uint8_t* data_2,
+                                size_t size, size_t max_recorded);
+
+// A pixel at which two images differ. As in all diagnostics, y increases
+// downwards.
+struct PixelMismatch {
+  size_t x;
+  size_t y;
+  uint8_t pixel_1[4];
+  uint8_t pixel_2[4];
+};
+
+struct ImageComparison {
+  size_t num_mismatches;
+  // The smallest rectangle containing every mismatch; meaningful only if
+  // there is a mismatch.
+  size_t min_x;
+  size_t min_y;
+  size_t max_x;
+  size_t max_y;
+  // The largest absolute difference in each of the four channels.
+  uint8_t max_channel_delta[4];
+  // The first mismatches, in order of row from the top, then column.
+  std::vector<PixelMismatch> first_mismatches;
+};
+
+// Compares two RGBA8 images of |width| by |height| pixels, laid out bottom
+// row first as glReadPixels yields them, recording at most |max_recorded|
+// mismatches individually.
+ImageComparison CompareImages(const uint8_t* image_1, const uint8_t* image_2,
+                              size_t width, size_t height,
+                              size_t max_recorded);
+
+// The number of bins in the histogram of each channel of an image.
+const size_t kNumHistogramBins = 256;
+
+// Adds the per-channel histograms of an RGBA8 image of |num_pixels| pixels to
+// |histograms|, which holds 4 * kNumHistogramBins counts, indexed by channel,
+// then bin.
+void AccumulateHistograms(const uint8_t* image, size_t num_pixels,
+                          uint32_t* histograms);
+
+// Yields the earth mover's distance between the histograms of two images of
+// |num_pixels| pixels each, normalized to the range [0, 1], for the channel in
+// which it is greatest. Each of |histograms_1| and |histograms_2| is laid out
+// as for AccumulateHistograms.
+double MaxHistogramEmd(const uint32_t* histograms_1,
+                       const uint32_t* histograms_2, size_t num_pixels);
+
+}  // namespace shadertrap
+
+#endif  // LIBSHADERTRAP_DATA_COMPARISON_H
@@ -0,0 +1,40 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBSHADERTRAP_NUMBER_PARSING_H
+#define LIBSHADERTRAP_NUMBER_PARSING_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace shadertrap {
+
+// Converters for the text of numeric literal tokens. Unlike the standard
+// library conversions they do not depend on the current locale, do not need a
+// null-terminated string and do not allocate, so that they can be applied
+// directly to slices of the script.
+
+// Parses an integer literal: an optional '-' followed by decimal digits.
+// Yields false if |text| is not of this form, or if its value does not fit in
+// an int64_t.
+bool ParseIntLiteral(const char* text, size_t length, int64_t* result);
+
+// Parses a float literal: an optional '-' followed by decimal digits
+// containing at most one '.', with at least one digit. Yields false if |text|
+// is not of this form. The result is correctly rounded.
+bool ParseFloatLiteral(const char* text, size_t length, float* result);
+
+}  // namespace shadertrap
+
+#endif  // LIBSHADERTRAP_NUMBER_PARSING_H
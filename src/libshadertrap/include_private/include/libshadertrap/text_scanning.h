@@ -0,0 +1,40 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBSHADERTRAP_TEXT_SCANNING_H
+#define LIBSHADERTRAP_TEXT_SCANNING_H
+
+#include <cstddef>
+
+namespace shadertrap {
+
+// Routines for scanning script text many bytes at a time. Each searches the
+// range [begin, end) of |data|, and those that search for a byte yield |end|
+// if there is no such byte. SSE2 or AVX2 is used when the target supports it,
+// with a portable fallback otherwise.
+
+// Finds the first byte that is not whitespace (NUL, tab, newline, form feed,
+// carriage return or space).
+size_t FindNonWhitespace(const char* data, size_t begin, size_t end);
+
+size_t FindNewline(const char* data, size_t begin, size_t end);
+
+// Finds the first double quote or newline.
+size_t FindQuoteOrNewline(const char* data, size_t begin, size_t end);
+
+size_t CountNewlines(const char* data, size_t begin, size_t end);
+
+}  // namespace shadertrap
+
+#endif  // LIBSHADERTRAP_TEXT_SCANNING_H
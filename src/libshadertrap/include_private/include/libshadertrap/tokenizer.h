@@ -16,44 +16,79 @@
 #define LIBSHADERTRAP_TOKENIZER_H
 
 #include <cstddef>
-#include <memory>
 #include <string>
-#include <unordered_map>
 
+#include "libshadertrap/source_buffer.h"
 #include "libshadertrap/token.h"
 
 namespace shadertrap {
 
 class Tokenizer {
  public:
-  explicit Tokenizer(std::string data);
+  // The tokens that are produced refer to slices of |source|, which must
+  // outlive both the tokenizer and its tokens.
+  explicit Tokenizer(const SourceBuffer* source);
 
-  std::unique_ptr<Token> PeekNextToken();
+  // Peeking is cheap: the peeked token is lexed once and cached, so that the
+  // following call to NextToken() (in the same mode) does not lex it again.
+  Token PeekNextToken();
 
-  std::unique_ptr<Token> NextToken();
+  Token NextToken();
 
-  std::unique_ptr<Token> PeekNextToken(bool ignore_whitespace_and_comments);
+  Token PeekNextToken(bool ignore_whitespace_and_comments);
 
-  std::unique_ptr<Token> NextToken(bool ignore_whitespace_and_comments);
+  Token NextToken(bool ignore_whitespace_and_comments);
 
   void SkipWhitespace();
 
-  std::string SkipLine();
+  // Skips to the start of the next line.
+  void SkipLine();
+
+  // The offset into the source of the next character to be processed.
+  size_t GetPosition() const { return position_; }
 
   static std::string KeywordToString(Token::Type keyword_token_type);
 
  private:
-  void AdvanceCharacter();
+  // A token that has been lexed by PeekNextToken() but not yet consumed,
+  // together with the tokenizer state just after the token.
+  struct Lookahead {
+    bool valid = false;
+    Token token{Token::Type::kUnknown, 0, 0};
+    size_t position = 0;
+    size_t line = 0;
+    size_t line_start = 0;
+  };
+
+  Token LexToken(bool ignore_whitespace_and_comments);
+
+  void InvalidateLookahead();
+
+  // Moves forward to |new_position|, counting the newlines passed over.
+  void AdvanceTo(size_t new_position);
+
+  size_t GetColumn() const { return position_ - line_start_ + 1; }
+
+  // Unlike SkipWhitespace() and SkipLine(), these do not invalidate the
+  // lookahead slots, so that they can be used while lexing a peeked token.
+  void ConsumeWhitespace();
+
+  void ConsumeLine();
 
   void SkipWhitespaceAndComments();
 
-  std::string data_;
+  const char* data_;
+  size_t length_;
   size_t position_ = 0;
   size_t line_ = 1;
-  size_t column_ = 1;
-
-  static const std::unordered_map<std::string, Token::Type>
-      keyword_to_token_type;
+  // The position at which the current line starts; the column is derived from
+  // this so that it does not need to be maintained byte by byte.
+  size_t line_start_ = 0;
+
+  // Whether whitespace and comments are skipped affects which token comes
+  // next, so each mode has its own lookahead slot.
+  Lookahead lookahead_raw_;
+  Lookahead lookahead_skipping_;
 };
 
 }  // namespace shadertrap
@@ -0,0 +1,65 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libshadertrap/arena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace shadertrap {
+
+namespace {
+
+const size_t kInitialBlockSize = 4096;
+
+const size_t kMaxBlockSize = 1024 * 1024;
+
+}  // namespace
+
+Arena::Arena() : next_block_size_(kInitialBlockSize) {}
+
+Arena::~Arena() {
+  for (Destructor* destructor = last_destructor_; destructor != nullptr;
+       destructor = destructor->previous) {
+    destructor->destroy(destructor->object);
+  }
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+  assert(alignment <= alignof(std::max_align_t) &&
+         "Over-aligned types are not supported.");
+  auto padding = [this, alignment]() -> size_t {
+    const auto address = reinterpret_cast<uintptr_t>(current_);
+    return (alignment - address % alignment) % alignment;
+  };
+  if (current_ == nullptr || padding() + size > remaining_) {
+    // Blocks are allocated with new[], so they are suitably aligned for any
+    // fundamental type. They grow geometrically, so that a large program
+    // needs few of them.
+    const size_t block_size = std::max(next_block_size_, size);
+    blocks_.emplace_back(new char[block_size]);
+    current_ = blocks_.back().get();
+    remaining_ = block_size;
+    next_block_size_ = std::min(next_block_size_ * 2, kMaxBlockSize);
+  }
+  const size_t skip = padding();
+  void* result = current_ + skip;
+  current_ += skip + size;
+  remaining_ -= skip + size;
+  return result;
+}
+
+}  // namespace shadertrap
@@ -0,0 +1,752 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libshadertrap/binary_program_reader.h"
+
+#include <cassert>
+#include <cstring>
+#include <unordered_map>
+
+#include "libshadertrap/binary_program_format.h"
+#include "libshadertrap/command_assert_equal.h"
+#include "libshadertrap/command_assert_pixels.h"
+#include "libshadertrap/command_assert_similar_emd_histogram.h"
+#include "libshadertrap/command_bind_sampler.h"
+#include "libshadertrap/command_bind_storage_buffer.h"
+#include "libshadertrap/command_bind_texture.h"
+#include "libshadertrap/command_bind_uniform_buffer.h"
+#include "libshadertrap/command_compile_shader.h"
+#include "libshadertrap/command_create_buffer.h"
+#include "libshadertrap/command_create_empty_texture_2d.h"
+#include "libshadertrap/command_create_program.h"
+#include "libshadertrap/command_create_renderbuffer.h"
+#include "libshadertrap/command_create_sampler.h"
+#include "libshadertrap/command_declare_shader.h"
+#include "libshadertrap/command_dump_renderbuffer.h"
+#include "libshadertrap/command_run_compute.h"
+#include "libshadertrap/command_run_graphics.h"
+#include "libshadertrap/command_set_sampler_or_texture_parameter.h"
+#include "libshadertrap/command_set_uniform.h"
+#include "libshadertrap/make_unique.h"
+#include "libshadertrap/uniform_value.h"
+#include "libshadertrap/vertex_attribute_info.h"
+
+namespace shadertrap {
+
+namespace {
+
+// Copies |size| bytes at |data| into a vector of elements of type T.
+template <typename T>
+std::vector<T> ToVector(const char* data, size_t size) {
+  std::vector<T> result(size / sizeof(T));
+  if (!result.empty()) {
+    memcpy(result.data(), data, size);
+  }
+  return result;
+}
+
+// The number of 4-byte components in a single element of |element_type|.
+size_t GetNumUniformComponents(UniformValue::ElementType element_type) {
+  switch (element_type) {
+    case UniformValue::ElementType::kFloat:
+    case UniformValue::ElementType::kInt:
+    case UniformValue::ElementType::kUint:
+      return 1;
+    case UniformValue::ElementType::kVec2:
+    case UniformValue::ElementType::kIvec2:
+    case UniformValue::ElementType::kUvec2:
+      return 2;
+    case UniformValue::ElementType::kVec3:
+    case UniformValue::ElementType::kIvec3:
+    case UniformValue::ElementType::kUvec3:
+      return 3;
+    case UniformValue::ElementType::kVec4:
+    case UniformValue::ElementType::kIvec4:
+    case UniformValue::ElementType::kUvec4:
+    case UniformValue::ElementType::kMat2x2:
+      return 4;
+    case UniformValue::ElementType::kMat2x3:
+    case UniformValue::ElementType::kMat3x2:
+      return 6;
+    case UniformValue::ElementType::kMat2x4:
+    case UniformValue::ElementType::kMat4x2:
+      return 8;
+    case UniformValue::ElementType::kMat3x3:
+      return 9;
+    case UniformValue::ElementType::kMat3x4:
+    case UniformValue::ElementType::kMat4x3:
+      return 12;
+    case UniformValue::ElementType::kMat4x4:
+      return 16;
+  }
+  assert(false && "Unreachable.");
+  return 0;
+}
+
+template <typename T>
+UniformValue MakeUniformValue(UniformValue::ElementType element_type,
+                              bool is_array, size_t array_size,
+                              const char* data, size_t size) {
+  if (is_array) {
+    return UniformValue(element_type, ToVector<T>(data, size), array_size);
+  }
+  return UniformValue(element_type, ToVector<T>(data, size));
+}
+
+}  // namespace
+
+BinaryProgramReader::BinaryProgramReader(std::unique_ptr<SourceBuffer> source,
+                                         MessageConsumer* message_consumer)
+    : source_(std::move(source)),
+      message_consumer_(message_consumer),
+      arena_(MakeUnique<Arena>()),
+      position_(0),
+      num_commands_(0) {}
+
+BinaryProgramReader::~BinaryProgramReader() = default;
+
+bool BinaryProgramReader::IsBinaryProgram(const SourceBuffer& source) {
+  return source.GetSize() >= binary_program_format::kMagicSize &&
+         memcmp(source.GetData(), binary_program_format::kMagic,
+                binary_program_format::kMagicSize) == 0;
+}
+
+bool BinaryProgramReader::Read() {
+  if (!ReadHeader() || !ReadStringTable()) {
+    return false;
+  }
+  for (uint32_t index = 0; index < num_commands_; index++) {
+    if (!ReadCommand()) {
+      return false;
+    }
+  }
+  if (position_ != source_->GetSize()) {
+    return Error("Unexpected data after the last command");
+  }
+  return true;
+}
+
+std::unique_ptr<ShaderTrapProgram> BinaryProgramReader::GetProgram() {
+  return MakeUnique<ShaderTrapProgram>(std::move(source_), std::move(arena_),
+                                       std::move(commands_));
+}
+
+bool BinaryProgramReader::ReadHeader() {
+  if (!IsBinaryProgram(*source_)) {
+    return Error("Not a binary program");
+  }
+  position_ = binary_program_format::kMagicSize;
+  uint32_t version;
+  uint32_t byte_order_mark;
+  if (!ReadUint32(&version) || !ReadUint32(&byte_order_mark)) {
+    return false;
+  }
+  if (version != binary_program_format::kVersion) {
+    return Error("Unsupported binary program version " +
+                 std::to_string(version) + "; expected version " +
+                 std::to_string(binary_program_format::kVersion));
+  }
+  if (byte_order_mark != binary_program_format::kByteOrderMark) {
+    return Error(
+        "The binary program was written on a machine with a different byte "
+        "order");
+  }
+  return ReadUint32(&num_commands_);
+}
+
+bool BinaryProgramReader::ReadStringTable() {
+  uint32_t num_strings;
+  if (!ReadUint32(&num_strings)) {
+    return false;
+  }
+  for (uint32_t index = 0; index < num_strings; index++) {
+    uint32_t length;
+    if (!ReadUint32(&length)) {
+      return false;
+    }
+    if (length > source_->GetSize() - position_) {
+      return Error("Truncated binary program");
+    }
+    strings_.emplace_back(position_, length);
+    position_ += length;
+  }
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommand() {
+  binary_program_format::CommandTag tag;
+  const Token* start_token;
+  if (!ReadEnum(binary_program_format::CommandTag::kSetUniform, &tag) ||
+      !ReadToken(&start_token)) {
+    return false;
+  }
+  switch (tag) {
+    case binary_program_format::CommandTag::kAssertEqual:
+      return ReadCommandAssertEqual(start_token);
+    case binary_program_format::CommandTag::kAssertPixels:
+      return ReadCommandAssertPixels(start_token);
+    case binary_program_format::CommandTag::kAssertSimilarEmdHistogram:
+      return ReadCommandAssertSimilarEmdHistogram(start_token);
+    case binary_program_format::CommandTag::kBindSampler:
+      return ReadCommandBindSampler(start_token);
+    case binary_program_format::CommandTag::kBindStorageBuffer:
+      return ReadCommandBindStorageBuffer(start_token);
+    case binary_program_format::CommandTag::kBindTexture:
+      return ReadCommandBindTexture(start_token);
+    case binary_program_format::CommandTag::kBindUniformBuffer:
+      return ReadCommandBindUniformBuffer(start_token);
+    case binary_program_format::CommandTag::kCompileShader:
+      return ReadCommandCompileShader(start_token);
+    case binary_program_format::CommandTag::kCreateBuffer:
+      return ReadCommandCreateBuffer(start_token);
+    case binary_program_format::CommandTag::kCreateEmptyTexture2D:
+      return ReadCommandCreateEmptyTexture2D(start_token);
+    case binary_program_format::CommandTag::kCreateProgram:
+      return ReadCommandCreateProgram(start_token);
+    case binary_program_format::CommandTag::kCreateRenderbuffer:
+      return ReadCommandCreateRenderbuffer(start_token);
+    case binary_program_format::CommandTag::kCreateSampler:
+      return ReadCommandCreateSampler(start_token);
+    case binary_program_format::CommandTag::kDeclareShader:
+      return ReadCommandDeclareShader(start_token);
+    case binary_program_format::CommandTag::kDumpRenderbuffer:
+      return ReadCommandDumpRenderbuffer(start_token);
+    case binary_program_format::CommandTag::kRunCompute:
+      return ReadCommandRunCompute(start_token);
+    case binary_program_format::CommandTag::kRunGraphics:
+      return ReadCommandRunGraphics(start_token);
+    case binary_program_format::CommandTag::kSetSamplerOrTextureParameter:
+      return ReadCommandSetSamplerOrTextureParameter(start_token);
+    case binary_program_format::CommandTag::kSetUniform:
+      return ReadCommandSetUniform(start_token);
+  }
+  return Error("Unknown command");
+}
+
+bool BinaryProgramReader::ReadCommandAssertEqual(const Token* start_token) {
+  std::string buffer_identifier_1;
+  std::string buffer_identifier_2;
+  if (!ReadString(&buffer_identifier_1) || !ReadString(&buffer_identifier_2)) {
+    return false;
+  }
+  commands_.push_back(arena_->New<CommandAssertEqual>(
+      start_token, buffer_identifier_1, buffer_identifier_2));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandAssertPixels(const Token* start_token) {
+  uint32_t expected[4];
+  for (auto& component : expected) {
+    if (!ReadUint32(&component)) {
+      return false;
+    }
+    if (component > UINT8_MAX) {
+      return Error("Invalid color component " + std::to_string(component));
+    }
+  }
+  std::string renderbuffer_identifier;
+  size_t rectangle_x;
+  size_t rectangle_y;
+  size_t rectangle_width;
+  size_t rectangle_height;
+  if (!ReadString(&renderbuffer_identifier) || !ReadSize(&rectangle_x) ||
+      !ReadSize(&rectangle_y) || !ReadSize(&rectangle_width) ||
+      !ReadSize(&rectangle_height)) {
+    return false;
+  }
+  commands_.push_back(arena_->New<CommandAssertPixels>(
+      start_token, static_cast<uint8_t>(expected[0]),
+      static_cast<uint8_t>(expected[1]), static_cast<uint8_t>(expected[2]),
+      static_cast<uint8_t>(expected[3]), renderbuffer_identifier, rectangle_x,
+      rectangle_y, rectangle_width, rectangle_height));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandAssertSimilarEmdHistogram(
+    const Token* start_token) {
+  std::string buffer_identifier_1;
+  std::string buffer_identifier_2;
+  float tolerance;
+  if (!ReadString(&buffer_identifier_1) || !ReadString(&buffer_identifier_2) ||
+      !ReadFloat(&tolerance)) {
+    return false;
+  }
+  commands_.push_back(arena_->New<CommandAssertSimilarEmdHistogram>(
+      start_token, buffer_identifier_1, buffer_identifier_2, tolerance));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandBindSampler(const Token* start_token) {
+  std::string sampler_identifier;
+  size_t texture_unit;
+  if (!ReadString(&sampler_identifier) || !ReadSize(&texture_unit)) {
+    return false;
+  }
+  commands_.push_back(arena_->New<CommandBindSampler>(
+      start_token, sampler_identifier, texture_unit));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandBindStorageBuffer(
+    const Token* start_token) {
+  std::string storage_buffer_identifier;
+  size_t binding;
+  if (!ReadString(&storage_buffer_identifier) || !ReadSize(&binding)) {
+    return false;
+  }
+  commands_.push_back(arena_->New<CommandBindStorageBuffer>(
+      start_token, storage_buffer_identifier, binding));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandBindTexture(const Token* start_token) {
+  std::string texture_identifier;
+  size_t texture_unit;
+  if (!ReadString(&texture_identifier) || !ReadSize(&texture_unit)) {
+    return false;
+  }
+  commands_.push_back(arena_->New<CommandBindTexture>(
+      start_token, texture_identifier, texture_unit));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandBindUniformBuffer(
+    const Token* start_token) {
+  std::string uniform_buffer_identifier;
+  size_t binding;
+  if (!ReadString(&uniform_buffer_identifier) || !ReadSize(&binding)) {
+    return false;
+  }
+  commands_.push_back(arena_->New<CommandBindUniformBuffer>(
+      start_token, uniform_buffer_identifier, binding));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandCompileShader(const Token* start_token) {
+  const Token* result_identifier;
+  const Token* shader_identifier;
+  if (!ReadToken(&result_identifier) || !ReadToken(&shader_identifier)) {
+    return false;
+  }
+  commands_.push_back(arena_->New<CommandCompileShader>(
+      start_token, result_identifier, shader_identifier));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandCreateBuffer(const Token* start_token) {
+  const Token* result_identifier;
+  size_t size_bytes;
+  binary_program_format::BufferContents contents;
+  if (!ReadToken(&result_identifier) || !ReadSize(&size_bytes) ||
+      !ReadEnum(binary_program_format::BufferContents::kFile, &contents)) {
+    return false;
+  }
+  switch (contents) {
+    case binary_program_format::BufferContents::kValues: {
+      CommandCreateBuffer::InitialDataType initial_data_type;
+      const char* data;
+      size_t size;
+      if (!ReadEnum(CommandCreateBuffer::InitialDataType::kNone,
+                    &initial_data_type) ||
+          !ReadBytes(&data, &size)) {
+        return false;
+      }
+      if (size != size_bytes) {
+        return Error("The contents of buffer '" +
+                     result_identifier->GetText() +
+                     "' do not match its size");
+      }
+      commands_.push_back(arena_->New<CommandCreateBuffer>(
+          start_token, result_identifier, size_bytes, initial_data_type,
+          reinterpret_cast<const uint8_t*>(data)));
+      return true;
+    }
+    case binary_program_format::BufferContents::kPattern: {
+      CommandCreateBuffer::InitialDataType initial_data_type;
+      CommandCreateBuffer::Pattern pattern;
+      const char* elements;
+      size_t elements_size;
+      if (!ReadEnum(CommandCreateBuffer::InitialDataType::kNone,
+                    &initial_data_type) ||
+          !ReadEnum(CommandCreateBuffer::Pattern::Kind::kRandom,
+                    &pattern.kind) ||
+          !ReadBytes(&elements, &elements_size) ||
+          !ReadUint32(&pattern.seed)) {
+        return false;
+      }
+      // The invariants that the parser establishes for a pattern must be
+      // checked, as the command relies on them.
+      if (initial_data_type == CommandCreateBuffer::InitialDataType::kNone ||
+          size_bytes %
+                  CommandCreateBuffer::GetElementSize(initial_data_type) !=
+              0) {
+        return Error("Invalid pattern for buffer '" +
+                     result_identifier->GetText() + "'");
+      }
+      const size_t element_size =
+          CommandCreateBuffer::GetElementSize(initial_data_type);
+      bool elements_ok = false;
+      switch (pattern.kind) {
+        case CommandCreateBuffer::Pattern::Kind::kConstant:
+          elements_ok = elements_size == element_size;
+          break;
+        case CommandCreateBuffer::Pattern::Kind::kRamp:
+          elements_ok = elements_size == 2 * element_size;
+          break;
+        case CommandCreateBuffer::Pattern::Kind::kRepeat:
+          elements_ok =
+              elements_size > 0 && elements_size % element_size == 0;
+          break;
+        case CommandCreateBuffer::Pattern::Kind::kRandom:
+          elements_ok = elements_size == 0;
+          break;
+      }
+      if (!elements_ok) {
+        return Error("Invalid pattern for buffer '" +
+                     result_identifier->GetText() + "'");
+      }
+      pattern.elements.assign(elements, elements + elements_size);
+      commands_.push_back(arena_->New<CommandCreateBuffer>(
+          start_token, result_identifier, size_bytes, initial_data_type,
+          std::move(pattern)));
+      return true;
+    }
+    case binary_program_format::BufferContents::kFile: {
+      const Token* file;
+      size_t offset_bytes;
+      const char* data;
+      size_t size;
+      if (!ReadToken(&file) || !ReadSize(&offset_bytes) ||
+          !ReadBytes(&data, &size)) {
+        return false;
+      }
+      if (!file->IsString() || file->GetLength() < 2) {
+        return Error("Invalid filename for buffer '" +
+                     result_identifier->GetText() + "'");
+      }
+      commands_.push_back(arena_->New<CommandCreateBuffer>(
+          start_token, result_identifier, size_bytes, file, offset_bytes,
+          reinterpret_cast<const uint8_t*>(data), size));
+      return true;
+    }
+  }
+  return Error("Unknown buffer contents");
+}
+
+bool BinaryProgramReader::ReadCommandCreateEmptyTexture2D(
+    const Token* start_token) {
+  const Token* result_identifier;
+  size_t width;
+  size_t height;
+  if (!ReadToken(&result_identifier) || !ReadSize(&width) ||
+      !ReadSize(&height)) {
+    return false;
+  }
+  commands_.push_back(arena_->New<CommandCreateEmptyTexture2D>(
+      start_token, result_identifier, width, height));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandCreateProgram(const Token* start_token) {
+  const Token* result_identifier;
+  size_t num_compiled_shaders;
+  if (!ReadToken(&result_identifier) || !ReadSize(&num_compiled_shaders)) {
+    return false;
+  }
+  std::vector<const Token*> compiled_shader_identifiers;
+  for (size_t index = 0; index < num_compiled_shaders; index++) {
+    const Token* compiled_shader_identifier;
+    if (!ReadToken(&compiled_shader_identifier)) {
+      return false;
+    }
+    compiled_shader_identifiers.push_back(compiled_shader_identifier);
+  }
+  commands_.push_back(arena_->New<CommandCreateProgram>(
+      start_token, result_identifier, std::move(compiled_shader_identifiers)));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandCreateRenderbuffer(
+    const Token* start_token) {
+  const Token* result_identifier;
+  size_t width;
+  size_t height;
+  if (!ReadToken(&result_identifier) || !ReadSize(&width) ||
+      !ReadSize(&height)) {
+    return false;
+  }
+  commands_.push_back(arena_->New<CommandCreateRenderbuffer>(
+      start_token, result_identifier, width, height));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandCreateSampler(const Token* start_token) {
+  const Token* result_identifier;
+  if (!ReadToken(&result_identifier)) {
+    return false;
+  }
+  commands_.push_back(
+      arena_->New<CommandCreateSampler>(start_token, result_identifier));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandDeclareShader(const Token* start_token) {
+  const Token* result_identifier;
+  CommandDeclareShader::Kind kind;
+  const char* shader_text;
+  size_t shader_text_length;
+  if (!ReadToken(&result_identifier) ||
+      !ReadEnum(CommandDeclareShader::Kind::COMPUTE, &kind) ||
+      !ReadBytes(&shader_text, &shader_text_length)) {
+    return false;
+  }
+  commands_.push_back(arena_->New<CommandDeclareShader>(
+      start_token, result_identifier, kind, shader_text, shader_text_length));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandDumpRenderbuffer(
+    const Token* start_token) {
+  std::string renderbuffer_identifier;
+  std::string filename;
+  if (!ReadString(&renderbuffer_identifier) || !ReadString(&filename)) {
+    return false;
+  }
+  commands_.push_back(arena_->New<CommandDumpRenderbuffer>(
+      start_token, renderbuffer_identifier, filename));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandRunCompute(const Token* start_token) {
+  std::string program_identifier;
+  size_t num_groups_x;
+  size_t num_groups_y;
+  size_t num_groups_z;
+  if (!ReadString(&program_identifier) || !ReadSize(&num_groups_x) ||
+      !ReadSize(&num_groups_y) || !ReadSize(&num_groups_z)) {
+    return false;
+  }
+  commands_.push_back(arena_->New<CommandRunCompute>(
+      start_token, program_identifier, num_groups_x, num_groups_y,
+      num_groups_z));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandRunGraphics(const Token* start_token) {
+  std::string program_identifier;
+  size_t num_vertex_attributes;
+  if (!ReadString(&program_identifier) || !ReadSize(&num_vertex_attributes)) {
+    return false;
+  }
+  std::unordered_map<size_t, VertexAttributeInfo> vertex_data;
+  for (size_t index = 0; index < num_vertex_attributes; index++) {
+    size_t location;
+    std::string buffer_identifier;
+    size_t offset_bytes;
+    size_t stride_bytes;
+    size_t dimension;
+    if (!ReadSize(&location) || !ReadString(&buffer_identifier) ||
+        !ReadSize(&offset_bytes) || !ReadSize(&stride_bytes) ||
+        !ReadSize(&dimension)) {
+      return false;
+    }
+    vertex_data.insert({location, VertexAttributeInfo(buffer_identifier,
+                                                      offset_bytes,
+                                                      stride_bytes,
+                                                      dimension)});
+  }
+  std::string index_data_buffer_identifier;
+  size_t vertex_count;
+  CommandRunGraphics::Topology topology;
+  size_t num_framebuffer_attachments;
+  if (!ReadString(&index_data_buffer_identifier) ||
+      !ReadSize(&vertex_count) ||
+      !ReadEnum(CommandRunGraphics::Topology::kTriangles, &topology) ||
+      !ReadSize(&num_framebuffer_attachments)) {
+    return false;
+  }
+  std::unordered_map<size_t, std::string> framebuffer_attachments;
+  for (size_t index = 0; index < num_framebuffer_attachments; index++) {
+    size_t location;
+    std::string renderbuffer_identifier;
+    if (!ReadSize(&location) || !ReadString(&renderbuffer_identifier)) {
+      return false;
+    }
+    framebuffer_attachments.insert({location, renderbuffer_identifier});
+  }
+  commands_.push_back(arena_->New<CommandRunGraphics>(
+      start_token, program_identifier, std::move(vertex_data),
+      index_data_buffer_identifier, vertex_count, topology,
+      std::move(framebuffer_attachments)));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandSetSamplerOrTextureParameter(
+    const Token* start_token) {
+  std::string target_texture_or_sampler;
+  CommandSetSamplerOrTextureParameter::TextureParameter parameter;
+  CommandSetSamplerOrTextureParameter::TextureParameterValue parameter_value;
+  if (!ReadString(&target_texture_or_sampler) ||
+      !ReadEnum(
+          CommandSetSamplerOrTextureParameter::TextureParameter::kMinFilter,
+          &parameter) ||
+      !ReadEnum(
+          CommandSetSamplerOrTextureParameter::TextureParameterValue::kLinear,
+          &parameter_value)) {
+    return false;
+  }
+  commands_.push_back(arena_->New<CommandSetSamplerOrTextureParameter>(
+      start_token, target_texture_or_sampler, parameter, parameter_value));
+  return true;
+}
+
+bool BinaryProgramReader::ReadCommandSetUniform(const Token* start_token) {
+  std::string program_identifier;
+  size_t location;
+  UniformValue::ElementType element_type;
+  uint32_t is_array;
+  size_t array_size;
+  const char* data;
+  size_t size;
+  if (!ReadString(&program_identifier) || !ReadSize(&location) ||
+      !ReadEnum(UniformValue::ElementType::kMat4x4, &element_type) ||
+      !ReadUint32(&is_array) || !ReadSize(&array_size) ||
+      !ReadBytes(&data, &size)) {
+    return false;
+  }
+  // All uniform components, whatever their type, are 4 bytes in size. The
+  // executor reads as many elements as the array size, or one element, so at
+  // least that much data must be present.
+  const size_t element_size = 4 * GetNumUniformComponents(element_type);
+  if (is_array > 1 || size % 4 != 0 ||
+      (is_array == 1 && array_size > size / element_size) ||
+      (is_array == 0 && size < element_size)) {
+    return Error("Invalid value for uniform at location " +
+                 std::to_string(location));
+  }
+  switch (element_type) {
+    case UniformValue::ElementType::kInt:
+    case UniformValue::ElementType::kIvec2:
+    case UniformValue::ElementType::kIvec3:
+    case UniformValue::ElementType::kIvec4:
+      commands_.push_back(arena_->New<CommandSetUniform>(
+          start_token, program_identifier, location,
+          MakeUniformValue<int32_t>(element_type, is_array == 1, array_size,
+                                    data, size)));
+      return true;
+    case UniformValue::ElementType::kUint:
+    case UniformValue::ElementType::kUvec2:
+    case UniformValue::ElementType::kUvec3:
+    case UniformValue::ElementType::kUvec4:
+      commands_.push_back(arena_->New<CommandSetUniform>(
+          start_token, program_identifier, location,
+          MakeUniformValue<uint32_t>(element_type, is_array == 1, array_size,
+                                     data, size)));
+      return true;
+    default:
+      commands_.push_back(arena_->New<CommandSetUniform>(
+          start_token, program_identifier, location,
+          MakeUniformValue<float>(element_type, is_array == 1, array_size,
+                                  data, size)));
+      return true;
+  }
+}
+
+bool BinaryProgramReader::ReadUint32(uint32_t* result) {
+  if (source_->GetSize() - position_ < sizeof(uint32_t)) {
+    return Error("Truncated binary program");
+  }
+  // The data is copied out, as the source need not be suitably aligned.
+  memcpy(result, source_->GetData() + position_, sizeof(uint32_t));
+  position_ += sizeof(uint32_t);
+  return true;
+}
+
+bool BinaryProgramReader::ReadSize(size_t* result) {
+  if (source_->GetSize() - position_ < sizeof(uint64_t)) {
+    return Error("Truncated binary program");
+  }
+  uint64_t value;
+  memcpy(&value, source_->GetData() + position_, sizeof(uint64_t));
+  position_ += sizeof(uint64_t);
+  if (value > SIZE_MAX) {
+    return Error("Size " + std::to_string(value) + " is too large");
+  }
+  *result = static_cast<size_t>(value);
+  return true;
+}
+
+bool BinaryProgramReader::ReadFloat(float* result) {
+  if (source_->GetSize() - position_ < sizeof(float)) {
+    return Error("Truncated binary program");
+  }
+  memcpy(result, source_->GetData() + position_, sizeof(float));
+  position_ += sizeof(float);
+  return true;
+}
+
+bool BinaryProgramReader::ReadStringSlice(std::pair<size_t, size_t>* result) {
+  uint32_t index;
+  if (!ReadUint32(&index)) {
+    return false;
+  }
+  if (index >= strings_.size()) {
+    return Error("Invalid string index " + std::to_string(index));
+  }
+  *result = strings_[index];
+  return true;
+}
+
+bool BinaryProgramReader::ReadString(std::string* result) {
+  std::pair<size_t, size_t> slice;
+  if (!ReadStringSlice(&slice)) {
+    return false;
+  }
+  result->assign(source_->GetData() + slice.first, slice.second);
+  return true;
+}
+
+bool BinaryProgramReader::ReadToken(const Token** result) {
+  Token::Type type;
+  uint32_t line;
+  uint32_t column;
+  std::pair<size_t, size_t> slice;
+  if (!ReadEnum(Token::Type::kUnknown, &type) || !ReadUint32(&line) ||
+      !ReadUint32(&column) || !ReadStringSlice(&slice)) {
+    return false;
+  }
+  *result = arena_->New<Token>(type, source_->GetData(), slice.first,
+                               slice.second, line, column);
+  return true;
+}
+
+bool BinaryProgramReader::ReadBytes(const char** data, size_t* size) {
+  if (!ReadSize(size)) {
+    return false;
+  }
+  if (*size > source_->GetSize() - position_) {
+    return Error("Truncated binary program");
+  }
+  *data = source_->GetData() + position_;
+  position_ += *size;
+  return true;
+}
+
+bool BinaryProgramReader::Error(const std::string& message) {
+  message_consumer_->Message(MessageConsumer::Severity::kError, nullptr,
+                             message);
+  return false;
+}
+
+}  // namespace shadertrap
@@ -0,0 +1,356 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libshadertrap/binary_program_writer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "libshadertrap/binary_program_format.h"
+#include "libshadertrap/uniform_value.h"
+#include "libshadertrap/vertex_attribute_info.h"
+
+namespace shadertrap {
+
+namespace {
+
+uint32_t ToTag(binary_program_format::CommandTag tag) {
+  return static_cast<uint32_t>(tag);
+}
+
+void AppendUint32(uint32_t value, std::string* output) {
+  output->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+}  // namespace
+
+BinaryProgramWriter::BinaryProgramWriter() = default;
+
+std::string BinaryProgramWriter::Write(ShaderTrapProgram* program) {
+  string_table_.clear();
+  string_indices_.clear();
+  commands_.clear();
+  VisitCommands(program);
+
+  std::string result(binary_program_format::kMagic,
+                     binary_program_format::kMagicSize);
+  AppendUint32(binary_program_format::kVersion, &result);
+  AppendUint32(binary_program_format::kByteOrderMark, &result);
+  AppendUint32(static_cast<uint32_t>(program->GetNumCommands()), &result);
+  AppendUint32(static_cast<uint32_t>(string_indices_.size()), &result);
+  result.append(string_table_);
+  result.append(commands_);
+  return result;
+}
+
+bool BinaryProgramWriter::VisitAssertEqual(CommandAssertEqual* assert_equal) {
+  WriteCommandStart(ToTag(binary_program_format::CommandTag::kAssertEqual),
+                    *assert_equal);
+  WriteString(assert_equal->GetBufferIdentifier1());
+  WriteString(assert_equal->GetBufferIdentifier2());
+  return true;
+}
+
+bool BinaryProgramWriter::VisitAssertPixels(
+    CommandAssertPixels* assert_pixels) {
+  WriteCommandStart(ToTag(binary_program_format::CommandTag::kAssertPixels),
+                    *assert_pixels);
+  WriteUint32(assert_pixels->GetExpectedR());
+  WriteUint32(assert_pixels->GetExpectedG());
+  WriteUint32(assert_pixels->GetExpectedB());
+  WriteUint32(assert_pixels->GetExpectedA());
+  WriteString(assert_pixels->GetRenderbufferIdentifier());
+  WriteSize(assert_pixels->GetRectangleX());
+  WriteSize(assert_pixels->GetRectangleY());
+  WriteSize(assert_pixels->GetRectangleWidth());
+  WriteSize(assert_pixels->GetRectangleHeight());
+  return true;
+}
+
+bool BinaryProgramWriter::VisitAssertSimilarEmdHistogram(
+    CommandAssertSimilarEmdHistogram* assert_similar_emd_histogram) {
+  WriteCommandStart(
+      ToTag(binary_program_format::CommandTag::kAssertSimilarEmdHistogram),
+      *assert_similar_emd_histogram);
+  WriteString(assert_similar_emd_histogram->GetBufferIdentifier1());
+  WriteString(assert_similar_emd_histogram->GetBufferIdentifier2());
+  WriteFloat(assert_similar_emd_histogram->GetTolerance());
+  return true;
+}
+
+bool BinaryProgramWriter::VisitBindSampler(CommandBindSampler* bind_sampler) {
+  WriteCommandStart(ToTag(binary_program_format::CommandTag::kBindSampler),
+                    *bind_sampler);
+  WriteString(bind_sampler->GetSamplerIdentifier());
+  WriteSize(bind_sampler->GetTextureUnit());
+  return true;
+}
+
+bool BinaryProgramWriter::VisitBindStorageBuffer(
+    CommandBindStorageBuffer* bind_storage_buffer) {
+  WriteCommandStart(
+      ToTag(binary_program_format::CommandTag::kBindStorageBuffer),
+      *bind_storage_buffer);
+  WriteString(bind_storage_buffer->GetStorageBufferIdentifier());
+  WriteSize(bind_storage_buffer->GetBinding());
+  return true;
+}
+
+bool BinaryProgramWriter::VisitBindTexture(CommandBindTexture* bind_texture) {
+  WriteCommandStart(ToTag(binary_program_format::CommandTag::kBindTexture),
+                    *bind_texture);
+  WriteString(bind_texture->GetTextureIdentifier());
+  WriteSize(bind_texture->GetTextureUnit());
+  return true;
+}
+
+bool BinaryProgramWriter::VisitBindUniformBuffer(
+    CommandBindUniformBuffer* bind_uniform_buffer) {
+  WriteCommandStart(
+      ToTag(binary_program_format::CommandTag::kBindUniformBuffer),
+      *bind_uniform_buffer);
+  WriteString(bind_uniform_buffer->GetUniformBufferIdentifier());
+  WriteSize(bind_uniform_buffer->GetBinding());
+  return true;
+}
+
+bool BinaryProgramWriter::VisitCompileShader(
+    CommandCompileShader* compile_shader) {
+  WriteCommandStart(ToTag(binary_program_format::CommandTag::kCompileShader),
+                    *compile_shader);
+  WriteToken(*compile_shader->GetResultIdentifierToken());
+  WriteToken(*compile_shader->GetShaderIdentifierToken());
+  return true;
+}
+
+bool BinaryProgramWriter::VisitCreateBuffer(
+    CommandCreateBuffer* create_buffer) {
+  WriteCommandStart(ToTag(binary_program_format::CommandTag::kCreateBuffer),
+                    *create_buffer);
+  WriteToken(*create_buffer->GetResultIdentifierToken());
+  WriteSize(create_buffer->GetSizeBytes());
+  if (create_buffer->HasInitialDataFile()) {
+    // The part of the file that the buffer uses is embedded, so that the
+    // binary program does not depend on the file.
+    WriteUint32(
+        static_cast<uint32_t>(binary_program_format::BufferContents::kFile));
+    WriteToken(*create_buffer->GetInitialDataFileToken());
+    WriteSize(create_buffer->GetOffsetBytes());
+    WriteBytes(create_buffer->GetInitialData(),
+               create_buffer->GetInitialDataSize());
+  } else if (create_buffer->HasInitialDataPattern()) {
+    const CommandCreateBuffer::Pattern& pattern =
+        create_buffer->GetInitialDataPattern();
+    WriteUint32(
+        static_cast<uint32_t>(binary_program_format::BufferContents::kPattern));
+    WriteUint32(static_cast<uint32_t>(create_buffer->GetInitialDataType()));
+    WriteUint32(static_cast<uint32_t>(pattern.kind));
+    WriteBytes(pattern.elements.data(), pattern.elements.size());
+    WriteUint32(pattern.seed);
+  } else {
+    WriteUint32(
+        static_cast<uint32_t>(binary_program_format::BufferContents::kValues));
+    WriteUint32(static_cast<uint32_t>(create_buffer->GetInitialDataType()));
+    WriteBytes(create_buffer->GetInitialData(),
+               create_buffer->GetInitialDataSize());
+  }
+  return true;
+}
+
+bool BinaryProgramWriter::VisitCreateSampler(
+    CommandCreateSampler* create_sampler) {
+  WriteCommandStart(ToTag(binary_program_format::CommandTag::kCreateSampler),
+                    *create_sampler);
+  WriteToken(*create_sampler->GetResultIdentifierToken());
+  return true;
+}
+
+bool BinaryProgramWriter::VisitCreateEmptyTexture2D(
+    CommandCreateEmptyTexture2D* create_empty_texture_2d) {
+  WriteCommandStart(
+      ToTag(binary_program_format::CommandTag::kCreateEmptyTexture2D),
+      *create_empty_texture_2d);
+  WriteToken(*create_empty_texture_2d->GetResultIdentifierToken());
+  WriteSize(create_empty_texture_2d->GetWidth());
+  WriteSize(create_empty_texture_2d->GetHeight());
+  return true;
+}
+
+bool BinaryProgramWriter::VisitCreateProgram(
+    CommandCreateProgram* create_program) {
+  WriteCommandStart(ToTag(binary_program_format::CommandTag::kCreateProgram),
+                    *create_program);
+  WriteToken(*create_program->GetResultIdentifierToken());
+  WriteSize(create_program->GetNumCompiledShaders());
+  for (size_t index = 0; index < create_program->GetNumCompiledShaders();
+       index++) {
+    WriteToken(*create_program->GetCompiledShaderIdentifierToken(index));
+  }
+  return true;
+}
+
+bool BinaryProgramWriter::VisitCreateRenderbuffer(
+    CommandCreateRenderbuffer* create_renderbuffer) {
+  WriteCommandStart(
+      ToTag(binary_program_format::CommandTag::kCreateRenderbuffer),
+      *create_renderbuffer);
+  WriteToken(*create_renderbuffer->GetResultIdentifierToken());
+  WriteSize(create_renderbuffer->GetWidth());
+  WriteSize(create_renderbuffer->GetHeight());
+  return true;
+}
+
+bool BinaryProgramWriter::VisitDeclareShader(
+    CommandDeclareShader* declare_shader) {
+  WriteCommandStart(ToTag(binary_program_format::CommandTag::kDeclareShader),
+                    *declare_shader);
+  WriteToken(*declare_shader->GetResultIdentifierToken());
+  WriteUint32(static_cast<uint32_t>(declare_shader->GetKind()));
+  WriteBytes(declare_shader->GetShaderTextData(),
+             declare_shader->GetShaderTextLength());
+  return true;
+}
+
+bool BinaryProgramWriter::VisitDumpRenderbuffer(
+    CommandDumpRenderbuffer* dump_renderbuffer) {
+  WriteCommandStart(
+      ToTag(binary_program_format::CommandTag::kDumpRenderbuffer),
+      *dump_renderbuffer);
+  WriteString(dump_renderbuffer->GetRenderbufferIdentifier());
+  WriteString(dump_renderbuffer->GetFilename());
+  return true;
+}
+
+bool BinaryProgramWriter::VisitRunCompute(CommandRunCompute* run_compute) {
+  WriteCommandStart(ToTag(binary_program_format::CommandTag::kRunCompute),
+                    *run_compute);
+  WriteString(run_compute->GetProgramIdentifier());
+  WriteSize(run_compute->GetNumGroupsX());
+  WriteSize(run_compute->GetNumGroupsY());
+  WriteSize(run_compute->GetNumGroupsZ());
+  return true;
+}
+
+bool BinaryProgramWriter::VisitRunGraphics(CommandRunGraphics* run_graphics) {
+  WriteCommandStart(ToTag(binary_program_format::CommandTag::kRunGraphics),
+                    *run_graphics);
+  WriteString(run_graphics->GetProgramIdentifier());
+
+  // The maps are written in order of location, so that the binary form of a
+  // program does not depend on the iteration order of unordered maps.
+  std::vector<size_t> locations;
+  for (const auto& entry : run_graphics->GetVertexData()) {
+    locations.push_back(entry.first);
+  }
+  std::sort(locations.begin(), locations.end());
+  WriteSize(locations.size());
+  for (size_t location : locations) {
+    const VertexAttributeInfo& vertex_attribute_info =
+        run_graphics->GetVertexData().at(location);
+    WriteSize(location);
+    WriteString(vertex_attribute_info.GetBufferIdentifier());
+    WriteSize(vertex_attribute_info.GetOffsetBytes());
+    WriteSize(vertex_attribute_info.GetStrideBytes());
+    WriteSize(vertex_attribute_info.GetDimension());
+  }
+
+  WriteString(run_graphics->GetIndexDataBufferIdentifier());
+  WriteSize(run_graphics->GetVertexCount());
+  WriteUint32(static_cast<uint32_t>(run_graphics->GetTopology()));
+
+  locations.clear();
+  for (const auto& entry : run_graphics->GetFramebufferAttachments()) {
+    locations.push_back(entry.first);
+  }
+  std::sort(locations.begin(), locations.end());
+  WriteSize(locations.size());
+  for (size_t location : locations) {
+    WriteSize(location);
+    WriteString(run_graphics->GetFramebufferAttachments().at(location));
+  }
+  return true;
+}
+
+bool BinaryProgramWriter::VisitSetSamplerOrTextureParameter(
+    CommandSetSamplerOrTextureParameter* set_sampler_or_texture_parameter) {
+  WriteCommandStart(
+      ToTag(binary_program_format::CommandTag::kSetSamplerOrTextureParameter),
+      *set_sampler_or_texture_parameter);
+  WriteString(set_sampler_or_texture_parameter->GetTargetTextureOrSampler());
+  WriteUint32(static_cast<uint32_t>(
+      set_sampler_or_texture_parameter->GetParameter()));
+  WriteUint32(static_cast<uint32_t>(
+      set_sampler_or_texture_parameter->GetParameterValue()));
+  return true;
+}
+
+bool BinaryProgramWriter::VisitSetUniform(CommandSetUniform* set_uniform) {
+  WriteCommandStart(ToTag(binary_program_format::CommandTag::kSetUniform),
+                    *set_uniform);
+  WriteString(set_uniform->GetProgramIdentifier());
+  WriteSize(set_uniform->GetLocation());
+  const UniformValue& value = set_uniform->GetValue();
+  WriteUint32(static_cast<uint32_t>(value.GetElementType()));
+  WriteUint32(value.IsArray() ? 1U : 0U);
+  WriteSize(value.IsArray() ? value.GetArraySize() : 0U);
+  WriteBytes(value.GetData(), value.GetDataSizeBytes());
+  return true;
+}
+
+void BinaryProgramWriter::WriteCommandStart(uint32_t tag,
+                                            const Command& command) {
+  WriteUint32(tag);
+  WriteToken(*command.GetStartToken());
+}
+
+void BinaryProgramWriter::WriteUint32(uint32_t value) {
+  AppendUint32(value, &commands_);
+}
+
+void BinaryProgramWriter::WriteSize(size_t value) {
+  auto value_64 = static_cast<uint64_t>(value);
+  commands_.append(reinterpret_cast<const char*>(&value_64),
+                   sizeof(value_64));
+}
+
+void BinaryProgramWriter::WriteFloat(float value) {
+  commands_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void BinaryProgramWriter::WriteString(const std::string& text) {
+  auto inserted = string_indices_.insert(
+      {text, static_cast<uint32_t>(string_indices_.size())});
+  if (inserted.second) {
+    AppendUint32(static_cast<uint32_t>(text.length()), &string_table_);
+    string_table_.append(text);
+  }
+  WriteUint32(inserted.first->second);
+}
+
+void BinaryProgramWriter::WriteToken(const Token& token) {
+  WriteUint32(static_cast<uint32_t>(token.GetType()));
+  WriteUint32(static_cast<uint32_t>(token.GetLine()));
+  WriteUint32(static_cast<uint32_t>(token.GetColumn()));
+  WriteString(token.GetText());
+}
+
+void BinaryProgramWriter::WriteBytes(const void* data, size_t size) {
+  WriteSize(size);
+  if (size > 0) {
+    commands_.append(static_cast<const char*>(data), size);
+  }
+}
+
+}  // namespace shadertrap
@@ -15,6 +15,7 @@
 #include "libshadertrap/checker.h"
 
 #include <cstddef>
+#include <sstream>
 
 namespace shadertrap {
 
@@ -22,95 +23,193 @@ Checker::Checker(MessageConsumer* message_consumer)
     : message_consumer_(message_consumer) {}
 
 bool Checker::VisitAssertEqual(CommandAssertEqual* command_assert_equal) {
-  // TODO(afd): Either both arguments must be renderbuffers or both arguments
-  //  must be buffers
   // TODO(afd): Both arguments must have the same dimensions
-  (void)command_assert_equal;
+  const auto* buffer_1 = ResolveIdentifier(
+      command_assert_equal->GetBufferIdentifier1(),
+      command_assert_equal->GetStartToken(),
+      {ObjectKind::kBuffer, ObjectKind::kRenderbuffer},
+      "buffer or renderbuffer");
+  const auto* buffer_2 = ResolveIdentifier(
+      command_assert_equal->GetBufferIdentifier2(),
+      command_assert_equal->GetStartToken(),
+      {ObjectKind::kBuffer, ObjectKind::kRenderbuffer},
+      "buffer or renderbuffer");
+  if (buffer_1 == nullptr || buffer_2 == nullptr) {
+    return false;
+  }
+  if (buffer_1->kind != buffer_2->kind) {
+    message_consumer_->Message(
+        MessageConsumer::Severity::kError,
+        command_assert_equal->GetStartToken(),
+        "Arguments to 'ASSERT_EQUAL' must both be buffers or both be "
+        "renderbuffers");
+    return false;
+  }
+  command_assert_equal->SetBufferSlot1(buffer_1->slot);
+  command_assert_equal->SetBufferSlot2(buffer_2->slot);
   return true;
 }
 
 bool Checker::VisitAssertPixels(CommandAssertPixels* command_assert_pixels) {
-  // TODO(afd): first argument must be a renderbuffer
   // TODO(afd): the rectangle must be in-bounds
-  (void)command_assert_pixels;
+  const auto* renderbuffer = ResolveIdentifier(
+      command_assert_pixels->GetRenderbufferIdentifier(),
+      command_assert_pixels->GetStartToken(), {ObjectKind::kRenderbuffer},
+      "renderbuffer");
+  if (renderbuffer == nullptr) {
+    return false;
+  }
+  command_assert_pixels->SetRenderbufferSlot(renderbuffer->slot);
   return true;
 }
 
 bool Checker::VisitAssertSimilarEmdHistogram(
     CommandAssertSimilarEmdHistogram* command_assert_similar_emd_histogram) {
-  (void)command_assert_similar_emd_histogram;
+  const auto* renderbuffer_1 = ResolveIdentifier(
+      command_assert_similar_emd_histogram->GetBufferIdentifier1(),
+      command_assert_similar_emd_histogram->GetStartToken(),
+      {ObjectKind::kRenderbuffer}, "renderbuffer");
+  const auto* renderbuffer_2 = ResolveIdentifier(
+      command_assert_similar_emd_histogram->GetBufferIdentifier2(),
+      command_assert_similar_emd_histogram->GetStartToken(),
+      {ObjectKind::kRenderbuffer}, "renderbuffer");
+  if (renderbuffer_1 == nullptr || renderbuffer_2 == nullptr) {
+    return false;
+  }
+  command_assert_similar_emd_histogram->SetBufferSlot1(renderbuffer_1->slot);
+  command_assert_similar_emd_histogram->SetBufferSlot2(renderbuffer_2->slot);
   return true;
 }
 
 bool Checker::VisitBindSampler(CommandBindSampler* command_bind_sampler) {
-  (void)command_bind_sampler;
+  const auto* sampler = ResolveIdentifier(
+      command_bind_sampler->GetSamplerIdentifier(),
+      command_bind_sampler->GetStartToken(), {ObjectKind::kSampler},
+      "sampler");
+  if (sampler == nullptr) {
+    return false;
+  }
+  command_bind_sampler->SetSamplerSlot(sampler->slot);
   return true;
 }
 
 bool Checker::VisitBindStorageBuffer(
     CommandBindStorageBuffer* command_bind_storage_buffer) {
-  (void)command_bind_storage_buffer;
+  const auto* buffer = ResolveIdentifier(
+      command_bind_storage_buffer->GetStorageBufferIdentifier(),
+      command_bind_storage_buffer->GetStartToken(), {ObjectKind::kBuffer},
+      "buffer");
+  if (buffer == nullptr) {
+    return false;
+  }
+  command_bind_storage_buffer->SetStorageBufferSlot(buffer->slot);
   return true;
 }
 
 bool Checker::VisitBindTexture(CommandBindTexture* command_bind_texture) {
-  (void)command_bind_texture;
+  const auto* texture = ResolveIdentifier(
+      command_bind_texture->GetTextureIdentifier(),
+      command_bind_texture->GetStartToken(), {ObjectKind::kTexture},
+      "texture");
+  if (texture == nullptr) {
+    return false;
+  }
+  command_bind_texture->SetTextureSlot(texture->slot);
   return true;
 }
 
 bool Checker::VisitBindUniformBuffer(
     CommandBindUniformBuffer* command_bind_uniform_buffer) {
-  (void)command_bind_uniform_buffer;
+  const auto* buffer = ResolveIdentifier(
+      command_bind_uniform_buffer->GetUniformBufferIdentifier(),
+      command_bind_uniform_buffer->GetStartToken(), {ObjectKind::kBuffer},
+      "buffer");
+  if (buffer == nullptr) {
+    return false;
+  }
+  command_bind_uniform_buffer->SetUniformBufferSlot(buffer->slot);
   return true;
 }
 
 bool Checker::VisitCompileShader(CommandCompileShader* compile_shader) {
-  if (!CheckIdentifierIsFresh(compile_shader->GetResultIdentifierToken())) {
+  auto result_slot = DefineIdentifier(
+      compile_shader->GetResultIdentifierToken(), ObjectKind::kCompiledShader);
+  if (!result_slot.first) {
     return false;
   }
-  if (declared_shaders_.count(compile_shader->GetShaderIdentifier()) == 0) {
-    message_consumer_->Message(
-        MessageConsumer::Severity::kError,
-        compile_shader->GetShaderIdentifierToken(),
-        "Identifier '" + compile_shader->GetShaderIdentifier() +
-            "' does not correspond to a declared shader");
+  const auto* shader = ResolveIdentifier(
+      compile_shader->GetShaderIdentifier(),
+      compile_shader->GetShaderIdentifierToken(),
+      {ObjectKind::kDeclaredShader}, "declared shader");
+  if (shader == nullptr) {
     return false;
   }
+  compile_shader->SetResultSlot(result_slot.second);
+  compile_shader->SetShaderSlot(shader->slot);
   compiled_shaders_.insert(
       {compile_shader->GetResultIdentifier(), compile_shader});
   return true;
 }
 
 bool Checker::VisitCreateBuffer(CommandCreateBuffer* command_create_buffer) {
-  if (!CheckIdentifierIsFresh(
-          command_create_buffer->GetResultIdentifierToken())) {
+  auto result_slot = DefineIdentifier(
+      command_create_buffer->GetResultIdentifierToken(), ObjectKind::kBuffer);
+  if (!result_slot.first) {
+    return false;
+  }
+  command_create_buffer->SetResultSlot(result_slot.second);
+  if (command_create_buffer->HasInitialDataFile() &&
+      command_create_buffer->GetInitialDataSize() <
+          command_create_buffer->GetSizeBytes()) {
+    std::stringstream stringstream;
+    stringstream << "Size mismatch: buffer '"
+                 << command_create_buffer->GetResultIdentifier()
+                 << "' declared with size "
+                 << command_create_buffer->GetSizeBytes()
+                 << " bytes, but file '"
+                 << command_create_buffer->GetInitialDataFilename()
+                 << "' provides only "
+                 << command_create_buffer->GetInitialDataSize()
+                 << " bytes from offset "
+                 << command_create_buffer->GetOffsetBytes();
+    message_consumer_->Message(
+        MessageConsumer::Severity::kError,
+        command_create_buffer->GetInitialDataFileToken(), stringstream.str());
     return false;
   }
   return true;
 }
 
 bool Checker::VisitCreateSampler(CommandCreateSampler* command_create_sampler) {
-  if (!CheckIdentifierIsFresh(
-          command_create_sampler->GetResultIdentifierToken())) {
+  auto result_slot = DefineIdentifier(
+      command_create_sampler->GetResultIdentifierToken(), ObjectKind::kSampler);
+  if (!result_slot.first) {
     return false;
   }
+  command_create_sampler->SetResultSlot(result_slot.second);
   return true;
 }
 
 bool Checker::VisitCreateEmptyTexture2D(
     CommandCreateEmptyTexture2D* command_create_empty_texture_2d) {
-  if (!CheckIdentifierIsFresh(
-          command_create_empty_texture_2d->GetResultIdentifierToken())) {
+  auto result_slot = DefineIdentifier(
+      command_create_empty_texture_2d->GetResultIdentifierToken(),
+      ObjectKind::kTexture);
+  if (!result_slot.first) {
     return false;
   }
+  command_create_empty_texture_2d->SetResultSlot(result_slot.second);
   return true;
 }
 
 bool Checker::VisitCreateProgram(CommandCreateProgram* create_program) {
   bool result = true;
-  if (!CheckIdentifierIsFresh(create_program->GetResultIdentifierToken())) {
+  auto result_slot = DefineIdentifier(
+      create_program->GetResultIdentifierToken(), ObjectKind::kProgram);
+  if (!result_slot.first) {
     result = false;
   } else {
+    create_program->SetResultSlot(result_slot.second);
     created_programs_.insert(
         {create_program->GetResultIdentifier(), create_program});
   }
@@ -121,13 +220,13 @@ bool Checker::VisitCreateProgram(CommandCreateProgram* create_program) {
        index++) {
     const auto* compiled_shader_identifier =
         create_program->GetCompiledShaderIdentifierToken(index);
-    if (compiled_shaders_.count(compiled_shader_identifier->GetText()) == 0) {
-      message_consumer_->Message(
-          MessageConsumer::Severity::kError, compiled_shader_identifier,
-          "Identifier '" + compiled_shader_identifier->GetText() +
-              "' does not correspond to a compiled shader");
+    const auto* compiled_shader = ResolveIdentifier(
+        compiled_shader_identifier->GetText(), compiled_shader_identifier,
+        {ObjectKind::kCompiledShader}, "compiled shader");
+    if (compiled_shader == nullptr) {
       result = false;
     } else {
+      create_program->SetCompiledShaderSlot(index, compiled_shader->slot);
       auto shader_kind =
           declared_shaders_
               .at(compiled_shaders_.at(compiled_shader_identifier->GetText())
@@ -215,15 +314,24 @@ bool Checker::VisitCreateProgram(CommandCreateProgram* create_program) {
 
 bool Checker::VisitCreateRenderbuffer(
     CommandCreateRenderbuffer* command_create_renderbuffer) {
-  (void)command_create_renderbuffer;
+  auto result_slot =
+      DefineIdentifier(command_create_renderbuffer->GetResultIdentifierToken(),
+                       ObjectKind::kRenderbuffer);
+  if (!result_slot.first) {
+    return false;
+  }
+  command_create_renderbuffer->SetResultSlot(result_slot.second);
   return true;
 }
 
 bool Checker::VisitDeclareShader(CommandDeclareShader* declare_shader) {
-  if (!CheckIdentifierIsFresh(declare_shader->GetResultIdentifierToken())) {
+  auto result_slot = DefineIdentifier(
+      declare_shader->GetResultIdentifierToken(), ObjectKind::kDeclaredShader);
+  if (!result_slot.first) {
     return false;
   }
   // TODO(afd): Invoke glslang to check that the shader is valid.
+  declare_shader->SetResultSlot(result_slot.second);
   declared_shaders_.insert(
       {declare_shader->GetResultIdentifier(), declare_shader});
   return true;
@@ -231,44 +339,130 @@ bool Checker::VisitDeclareShader(CommandDeclareShader* declare_shader) {
 
 bool Checker::VisitDumpRenderbuffer(
     CommandDumpRenderbuffer* command_dump_renderbuffer) {
-  (void)command_dump_renderbuffer;
+  const auto* renderbuffer = ResolveIdentifier(
+      command_dump_renderbuffer->GetRenderbufferIdentifier(),
+      command_dump_renderbuffer->GetStartToken(), {ObjectKind::kRenderbuffer},
+      "renderbuffer");
+  if (renderbuffer == nullptr) {
+    return false;
+  }
+  command_dump_renderbuffer->SetRenderbufferSlot(renderbuffer->slot);
   return true;
 }
 
 bool Checker::VisitRunCompute(CommandRunCompute* command_run_compute) {
   // TODO(afd): Check that the given program is a compute program.
-  (void)command_run_compute;
+  const auto* program = ResolveIdentifier(
+      command_run_compute->GetProgramIdentifier(),
+      command_run_compute->GetStartToken(), {ObjectKind::kProgram}, "program");
+  if (program == nullptr) {
+    return false;
+  }
+  command_run_compute->SetProgramSlot(program->slot);
   return true;
 }
 
 bool Checker::VisitRunGraphics(CommandRunGraphics* command_run_graphics) {
   // TODO(afd): Check that the given program is a graphics program.
-  (void)command_run_graphics;
-  return true;
+  bool result = true;
+  const auto* program = ResolveIdentifier(
+      command_run_graphics->GetProgramIdentifier(),
+      command_run_graphics->GetStartToken(), {ObjectKind::kProgram}, "program");
+  if (program == nullptr) {
+    result = false;
+  } else {
+    command_run_graphics->SetProgramSlot(program->slot);
+  }
+  for (const auto& entry : command_run_graphics->GetVertexData()) {
+    const auto* buffer = ResolveIdentifier(
+        entry.second.GetBufferIdentifier(),
+        command_run_graphics->GetStartToken(), {ObjectKind::kBuffer}, "buffer");
+    if (buffer == nullptr) {
+      result = false;
+    } else {
+      command_run_graphics->SetVertexBufferSlot(entry.first, buffer->slot);
+    }
+  }
+  const auto* index_data_buffer = ResolveIdentifier(
+      command_run_graphics->GetIndexDataBufferIdentifier(),
+      command_run_graphics->GetStartToken(), {ObjectKind::kBuffer}, "buffer");
+  if (index_data_buffer == nullptr) {
+    result = false;
+  } else {
+    command_run_graphics->SetIndexDataBufferSlot(index_data_buffer->slot);
+  }
+  for (const auto& entry : command_run_graphics->GetFramebufferAttachments()) {
+    const auto* attachment = ResolveIdentifier(
+        entry.second, command_run_graphics->GetStartToken(),
+        {ObjectKind::kRenderbuffer, ObjectKind::kTexture},
+        "renderbuffer or texture");
+    if (attachment == nullptr) {
+      result = false;
+    } else {
+      command_run_graphics->SetFramebufferAttachmentSlot(entry.first,
+                                                         attachment->slot);
+    }
+  }
+  return result;
 }
 
 bool Checker::VisitSetSamplerOrTextureParameter(
     CommandSetSamplerOrTextureParameter*
         command_set_sampler_or_texture_parameter) {
-  (void)command_set_sampler_or_texture_parameter;
+  const auto* target = ResolveIdentifier(
+      command_set_sampler_or_texture_parameter->GetTargetTextureOrSampler(),
+      command_set_sampler_or_texture_parameter->GetStartToken(),
+      {ObjectKind::kSampler, ObjectKind::kTexture}, "sampler or texture");
+  if (target == nullptr) {
+    return false;
+  }
+  command_set_sampler_or_texture_parameter->SetTargetTextureOrSamplerSlot(
+      target->slot);
   return true;
 }
 
 bool Checker::VisitSetUniform(CommandSetUniform* command_set_uniform) {
-  (void)command_set_uniform;
+  const auto* program = ResolveIdentifier(
+      command_set_uniform->GetProgramIdentifier(),
+      command_set_uniform->GetStartToken(), {ObjectKind::kProgram}, "program");
+  if (program == nullptr) {
+    return false;
+  }
+  command_set_uniform->SetProgramSlot(program->slot);
   return true;
 }
 
-bool Checker::CheckIdentifierIsFresh(const Token* identifier) {
-  if (used_identifiers_.count(identifier->GetText()) > 0) {
+std::pair<bool, size_t> Checker::DefineIdentifier(const Token* identifier,
+                                                  ObjectKind kind) {
+  auto existing = definitions_.find(identifier->GetText());
+  if (existing != definitions_.end()) {
     message_consumer_->Message(
         MessageConsumer::Severity::kError, identifier,
         "Identifier '" + identifier->GetText() + "' already used at " +
-            used_identifiers_.at(identifier->GetText())->GetLocationString());
-    return false;
+            existing->second.identifier->GetLocationString());
+    return {false, kUnresolvedSlot};
   }
-  used_identifiers_.insert({identifier->GetText(), identifier});
-  return true;
+  // Slots are dense: the n-th identifier to be defined gets slot n.
+  size_t slot = definitions_.size();
+  definitions_.insert({identifier->GetText(), {identifier, kind, slot}});
+  return {true, slot};
+}
+
+const Checker::Definition* Checker::ResolveIdentifier(
+    const std::string& identifier, const Token* location,
+    std::initializer_list<ObjectKind> kinds, const std::string& description) {
+  auto definition = definitions_.find(identifier);
+  if (definition != definitions_.end()) {
+    for (auto kind : kinds) {
+      if (definition->second.kind == kind) {
+        return &definition->second;
+      }
+    }
+  }
+  message_consumer_->Message(MessageConsumer::Severity::kError, location,
+                             "Identifier '" + identifier +
+                                 "' does not correspond to a " + description);
+  return nullptr;
 }
 
 }  // namespace shadertrap
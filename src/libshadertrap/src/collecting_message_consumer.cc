@@ -12,13 +12,16 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include "libshadertraptest/collecting_message_consumer.h"
+#include "libshadertrap/collecting_message_consumer.h"
 
 namespace shadertrap {
 
 void CollectingMessageConsumer::Message(Severity severity, const Token* token,
                                         const std::string& message) {
-  messages_.emplace_back(severity, token->GetLocationString() + ": " + message);
+  messages_.emplace_back(
+      severity,
+      (token == nullptr ? "unknown location" : token->GetLocationString()) +
+          ": " + message);
 }
 
 }  // namespace shadertrap
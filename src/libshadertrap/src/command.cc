@@ -14,13 +14,11 @@
 
 #include "libshadertrap/command.h"
 
-#include <utility>
-
 namespace shadertrap {
 
 Command::~Command() = default;
 
-Command::Command(std::unique_ptr<Token> start_token)
-    : start_token_(std::move(start_token)) {}
+Command::Command(const Token* start_token)
+    : start_token_(start_token) {}
 
 }  // namespace shadertrap
@@ -20,12 +20,14 @@
 
 namespace shadertrap {
 
-CommandAssertEqual::CommandAssertEqual(std::unique_ptr<Token> start_token,
+CommandAssertEqual::CommandAssertEqual(const Token* start_token,
                                        std::string buffer_identifier_1,
                                        std::string buffer_identifier_2)
-    : Command(std::move(start_token)),
+    : Command(start_token),
       buffer_identifier_1_(std::move(buffer_identifier_1)),
-      buffer_identifier_2_(std::move(buffer_identifier_2)) {}
+      buffer_identifier_2_(std::move(buffer_identifier_2)),
+      buffer_slot_1_(kUnresolvedSlot),
+      buffer_slot_2_(kUnresolvedSlot) {}
 
 bool CommandAssertEqual::Accept(CommandVisitor* visitor) {
   return visitor->VisitAssertEqual(this);
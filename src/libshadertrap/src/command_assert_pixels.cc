@@ -20,14 +20,14 @@
 
 namespace shadertrap {
 
-CommandAssertPixels::CommandAssertPixels(std::unique_ptr<Token> start_token,
+CommandAssertPixels::CommandAssertPixels(const Token* start_token,
                                          uint8_t expected_r, uint8_t expected_g,
                                          uint8_t expected_b, uint8_t expected_a,
                                          std::string renderbuffer_identifier,
                                          size_t rectangle_x, size_t rectangle_y,
                                          size_t rectangle_width,
                                          size_t rectangle_height)
-    : Command(std::move(start_token)),
+    : Command(start_token),
       expected_r_(expected_r),
       expected_g_(expected_g),
       expected_b_(expected_b),
@@ -36,7 +36,8 @@ CommandAssertPixels::CommandAssertPixels(std::unique_ptr<Token> start_token,
       rectangle_x_(rectangle_x),
       rectangle_y_(rectangle_y),
       rectangle_width_(rectangle_width),
-      rectangle_height_(rectangle_height) {}
+      rectangle_height_(rectangle_height),
+      renderbuffer_slot_(kUnresolvedSlot) {}
 
 bool CommandAssertPixels::Accept(CommandVisitor* visitor) {
   return visitor->VisitAssertPixels(this);
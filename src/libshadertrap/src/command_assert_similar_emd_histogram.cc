@@ -21,12 +21,14 @@
 namespace shadertrap {
 
 CommandAssertSimilarEmdHistogram::CommandAssertSimilarEmdHistogram(
-    std::unique_ptr<Token> start_token, std::string buffer_identifier_1,
+    const Token* start_token, std::string buffer_identifier_1,
     std::string buffer_identifier_2, float tolerance)
-    : Command(std::move(start_token)),
+    : Command(start_token),
       buffer_identifier_1_(std::move(buffer_identifier_1)),
       buffer_identifier_2_(std::move(buffer_identifier_2)),
-      tolerance_(tolerance) {}
+      tolerance_(tolerance),
+      buffer_slot_1_(kUnresolvedSlot),
+      buffer_slot_2_(kUnresolvedSlot) {}
 
 bool CommandAssertSimilarEmdHistogram::Accept(CommandVisitor* visitor) {
   return visitor->VisitAssertSimilarEmdHistogram(this);
@@ -20,12 +20,13 @@
 
 namespace shadertrap {
 
-CommandBindSampler::CommandBindSampler(std::unique_ptr<Token> start_token,
+CommandBindSampler::CommandBindSampler(const Token* start_token,
                                        std::string sampler_identifier,
                                        size_t texture_unit)
-    : Command(std::move(start_token)),
+    : Command(start_token),
       sampler_identifier_(std::move(sampler_identifier)),
-      texture_unit_(texture_unit) {}
+      texture_unit_(texture_unit),
+      sampler_slot_(kUnresolvedSlot) {}
 
 bool CommandBindSampler::Accept(CommandVisitor* visitor) {
   return visitor->VisitBindSampler(this);
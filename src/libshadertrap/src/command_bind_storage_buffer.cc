@@ -21,11 +21,12 @@
 namespace shadertrap {
 
 CommandBindStorageBuffer::CommandBindStorageBuffer(
-    std::unique_ptr<Token> start_token, std::string storage_buffer_identifier,
+    const Token* start_token, std::string storage_buffer_identifier,
     size_t binding)
-    : Command(std::move(start_token)),
+    : Command(start_token),
       storage_buffer_identifier_(std::move(storage_buffer_identifier)),
-      binding_(binding) {}
+      binding_(binding),
+      storage_buffer_slot_(kUnresolvedSlot) {}
 
 bool CommandBindStorageBuffer::Accept(CommandVisitor* visitor) {
   return visitor->VisitBindStorageBuffer(this);
@@ -20,12 +20,13 @@
 
 namespace shadertrap {
 
-CommandBindTexture::CommandBindTexture(std::unique_ptr<Token> start_token,
+CommandBindTexture::CommandBindTexture(const Token* start_token,
                                        std::string texture_identifier,
                                        size_t texture_unit)
-    : Command(std::move(start_token)),
+    : Command(start_token),
       texture_identifier_(std::move(texture_identifier)),
-      texture_unit_(texture_unit) {}
+      texture_unit_(texture_unit),
+      texture_slot_(kUnresolvedSlot) {}
 
 bool CommandBindTexture::Accept(CommandVisitor* visitor) {
   return visitor->VisitBindTexture(this);
@@ -21,11 +21,12 @@
 namespace shadertrap {
 
 CommandBindUniformBuffer::CommandBindUniformBuffer(
-    std::unique_ptr<Token> start_token, std::string uniform_buffer_identifier,
+    const Token* start_token, std::string uniform_buffer_identifier,
     size_t binding)
-    : Command(std::move(start_token)),
+    : Command(start_token),
       uniform_buffer_identifier_(std::move(uniform_buffer_identifier)),
-      binding_(binding) {}
+      binding_(binding),
+      uniform_buffer_slot_(kUnresolvedSlot) {}
 
 bool CommandBindUniformBuffer::Accept(CommandVisitor* visitor) {
   return visitor->VisitBindUniformBuffer(this);
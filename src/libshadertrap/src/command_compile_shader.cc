@@ -14,19 +14,19 @@
 
 #include "libshadertrap/command_compile_shader.h"
 
-#include <utility>
-
 #include "libshadertrap/command_visitor.h"
 
 namespace shadertrap {
 
 CommandCompileShader::CommandCompileShader(
-    std::unique_ptr<Token> start_token,
-    std::unique_ptr<Token> result_identifier,
-    std::unique_ptr<Token> shader_identifier)
-    : Command(std::move(start_token)),
-      result_identifier_(std::move(result_identifier)),
-      shader_identifier_(std::move(shader_identifier)) {}
+    const Token* start_token,
+    const Token* result_identifier,
+    const Token* shader_identifier)
+    : Command(start_token),
+      result_identifier_(result_identifier),
+      shader_identifier_(shader_identifier),
+      result_slot_(kUnresolvedSlot),
+      shader_slot_(kUnresolvedSlot) {}
 
 bool CommandCompileShader::Accept(CommandVisitor* visitor) {
   return visitor->VisitCompileShader(this);
@@ -22,64 +22,167 @@
 
 namespace shadertrap {
 
-CommandCreateBuffer::CommandCreateBuffer(
-    std::unique_ptr<Token> start_token,
-    std::unique_ptr<Token> result_identifier, size_t size_bytes,
-    const std::vector<uint8_t>& byte_data)
-    : Command(std::move(start_token)),
-      result_identifier_(std::move(result_identifier)),
-      size_bytes_(size_bytes),
-      has_initial_data_(true),
-      initial_data_type_(InitialDataType::kByte) {
-  assert(size_bytes == byte_data.size() && "Size mismatch.");
-  initial_data_.resize(size_bytes);
-  memcpy(initial_data_.data(), byte_data.data(), size_bytes);
-}
-
-CommandCreateBuffer::CommandCreateBuffer(
-    std::unique_ptr<Token> start_token,
-    std::unique_ptr<Token> result_identifier, size_t size_bytes,
-    const std::vector<float>& float_data)
-    : Command(std::move(start_token)),
-      result_identifier_(std::move(result_identifier)),
+CommandCreateBuffer::CommandCreateBuffer(const Token* start_token,
+                                         const Token* result_identifier,
+                                         size_t size_bytes,
+                                         InitialDataType initial_data_type,
+                                         const uint8_t* initial_data)
+    : Command(start_token),
+      result_identifier_(result_identifier),
       size_bytes_(size_bytes),
       has_initial_data_(true),
-      initial_data_type_(InitialDataType::kFloat) {
-  assert(size_bytes == sizeof(float) * float_data.size() && "Size mismatch.");
-  initial_data_.resize(size_bytes);
-  memcpy(initial_data_.data(), float_data.data(), size_bytes);
-}
+      initial_data_(initial_data),
+      initial_data_size_(size_bytes),
+      initial_data_type_(initial_data_type),
+      file_(nullptr),
+      offset_bytes_(0),
+      has_pattern_(false),
+      pattern_(),
+      result_slot_(kUnresolvedSlot) {}
 
-CommandCreateBuffer::CommandCreateBuffer(
-    std::unique_ptr<Token> start_token,
-    std::unique_ptr<Token> result_identifier, size_t size_bytes,
-    const std::vector<int32_t>& int_data)
-    : Command(std::move(start_token)),
-      result_identifier_(std::move(result_identifier)),
+CommandCreateBuffer::CommandCreateBuffer(const Token* start_token,
+                                         const Token* result_identifier,
+                                         size_t size_bytes,
+                                         InitialDataType initial_data_type,
+                                         Pattern pattern)
+    : Command(start_token),
+      result_identifier_(result_identifier),
       size_bytes_(size_bytes),
       has_initial_data_(true),
-      initial_data_type_(InitialDataType::kInt) {
-  assert(size_bytes == sizeof(int32_t) * int_data.size() && "Size mismatch.");
-  initial_data_.resize(size_bytes);
-  memcpy(initial_data_.data(), int_data.data(), size_bytes);
+      initial_data_(nullptr),
+      initial_data_size_(size_bytes),
+      initial_data_type_(initial_data_type),
+      file_(nullptr),
+      offset_bytes_(0),
+      has_pattern_(true),
+      pattern_(std::move(pattern)),
+      result_slot_(kUnresolvedSlot) {
+  assert(initial_data_type != InitialDataType::kNone &&
+         "A pattern must have a type.");
+  assert(size_bytes % GetElementSize(initial_data_type) == 0 &&
+         "The size must be a whole number of elements.");
 }
 
 CommandCreateBuffer::CommandCreateBuffer(
-    std::unique_ptr<Token> start_token,
-    std::unique_ptr<Token> result_identifier, size_t size_bytes,
-    const std::vector<uint32_t>& uint_data)
-    : Command(std::move(start_token)),
-      result_identifier_(std::move(result_identifier)),
+    const Token* start_token, const Token* result_identifier,
+    size_t size_bytes, const Token* file, size_t offset_bytes,
+    const uint8_t* initial_data, size_t initial_data_size)
+    : Command(start_token),
+      result_identifier_(result_identifier),
       size_bytes_(size_bytes),
       has_initial_data_(true),
-      initial_data_type_(InitialDataType::kUint) {
-  assert(size_bytes == sizeof(uint32_t) * uint_data.size() && "Size mismatch.");
-  initial_data_.resize(size_bytes);
-  memcpy(initial_data_.data(), uint_data.data(), size_bytes);
+      initial_data_(initial_data),
+      initial_data_size_(initial_data_size),
+      initial_data_type_(InitialDataType::kNone),
+      file_(file),
+      offset_bytes_(offset_bytes),
+      has_pattern_(false),
+      pattern_(),
+      result_slot_(kUnresolvedSlot) {
+  assert(file->IsString() && "The file must be named by a string.");
 }
 
 bool CommandCreateBuffer::Accept(CommandVisitor* visitor) {
   return visitor->VisitCreateBuffer(this);
 }
 
+void CommandCreateBuffer::ExpandInitialDataPattern(size_t offset_bytes,
+                                                   size_t length_bytes,
+                                                   uint8_t* destination) const {
+  assert(has_pattern_ && "The buffer is not initialized with a pattern.");
+  const size_t element_size = GetElementSize(initial_data_type_);
+  assert(offset_bytes % element_size == 0 && length_bytes % element_size == 0 &&
+         "The region to expand must be a whole number of elements.");
+  const size_t first_element = offset_bytes / element_size;
+  const size_t num_elements = length_bytes / element_size;
+  switch (pattern_.kind) {
+    case Pattern::Kind::kConstant:
+    case Pattern::Kind::kRepeat: {
+      const size_t num_values = pattern_.elements.size() / element_size;
+      for (size_t index = 0; index < num_elements; index++) {
+        memcpy(destination + index * element_size,
+               pattern_.elements.data() +
+                   ((first_element + index) % num_values) * element_size,
+               element_size);
+      }
+      return;
+    }
+    case Pattern::Kind::kRamp:
+      if (initial_data_type_ == InitialDataType::kFloat) {
+        float start;
+        float step;
+        memcpy(&start, pattern_.elements.data(), sizeof(float));
+        memcpy(&step, pattern_.elements.data() + sizeof(float), sizeof(float));
+        for (size_t index = 0; index < num_elements; index++) {
+          // The value is computed afresh for each element, rather than by
+          // repeated addition, so that rounding errors do not accumulate.
+          auto value = static_cast<float>(
+              static_cast<double>(start) +
+              static_cast<double>(first_element + index) *
+                  static_cast<double>(step));
+          memcpy(destination + index * sizeof(float), &value, sizeof(float));
+        }
+      } else if (initial_data_type_ == InitialDataType::kByte) {
+        const uint8_t start = pattern_.elements[0];
+        const uint8_t step = pattern_.elements[1];
+        for (size_t index = 0; index < num_elements; index++) {
+          destination[index] =
+              static_cast<uint8_t>(start + (first_element + index) * step);
+        }
+      } else {
+        // Signed and unsigned integer ramps wrap around identically in two's
+        // complement, so both are computed with unsigned arithmetic.
+        uint32_t start;
+        uint32_t step;
+        memcpy(&start, pattern_.elements.data(), sizeof(uint32_t));
+        memcpy(&step, pattern_.elements.data() + sizeof(uint32_t),
+               sizeof(uint32_t));
+        for (size_t index = 0; index < num_elements; index++) {
+          auto value = static_cast<uint32_t>(
+              start + static_cast<uint32_t>(first_element + index) * step);
+          memcpy(destination + index * sizeof(uint32_t), &value,
+                 sizeof(uint32_t));
+        }
+      }
+      return;
+    case Pattern::Kind::kRandom:
+      for (size_t index = 0; index < num_elements; index++) {
+        // Each element is derived from its index by the SplitMix64 generator,
+        // so that any region of the sequence can be produced on its own.
+        uint64_t value = pattern_.seed + (first_element + index + 1) *
+                                             0x9E3779B97F4A7C15ULL;
+        value = (value ^ (value >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27U)) * 0x94D049BB133111EBULL;
+        value = value ^ (value >> 31U);
+        switch (initial_data_type_) {
+          case InitialDataType::kByte:
+            destination[index] = static_cast<uint8_t>(value >> 56U);
+            break;
+          case InitialDataType::kFloat: {
+            // A float in [0, 1), using as many bits as a float can hold.
+            auto float_value =
+                static_cast<float>(value >> 40U) * (1.0F / 16777216.0F);
+            memcpy(destination + index * sizeof(float), &float_value,
+                   sizeof(float));
+            break;
+          }
+          case InitialDataType::kInt:
+          case InitialDataType::kUint:
+          case InitialDataType::kNone: {
+            auto int_value = static_cast<uint32_t>(value >> 32U);
+            memcpy(destination + index * sizeof(uint32_t), &int_value,
+                   sizeof(uint32_t));
+            break;
+          }
+        }
+      }
+      return;
+  }
+}
+
+size_t CommandCreateBuffer::GetElementSize(InitialDataType type) {
+  assert(type != InitialDataType::kNone && "Untyped data has no elements.");
+  return type == InitialDataType::kByte ? 1U : 4U;
+}
+
 }  // namespace shadertrap
@@ -14,19 +14,18 @@
 
 #include "libshadertrap/command_create_empty_texture_2d.h"
 
-#include <utility>
-
 #include "libshadertrap/command_visitor.h"
 
 namespace shadertrap {
 
 CommandCreateEmptyTexture2D::CommandCreateEmptyTexture2D(
-    std::unique_ptr<Token> start_token,
-    std::unique_ptr<Token> result_identifier, size_t width, size_t height)
-    : Command(std::move(start_token)),
-      result_identifier_(std::move(result_identifier)),
+    const Token* start_token,
+    const Token* result_identifier, size_t width, size_t height)
+    : Command(start_token),
+      result_identifier_(result_identifier),
       width_(width),
-      height_(height) {}
+      height_(height),
+      result_slot_(kUnresolvedSlot) {}
 
 bool CommandCreateEmptyTexture2D::Accept(CommandVisitor* visitor) {
   return visitor->VisitCreateEmptyTexture2D(this);
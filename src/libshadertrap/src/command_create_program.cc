@@ -21,12 +21,15 @@
 namespace shadertrap {
 
 CommandCreateProgram::CommandCreateProgram(
-    std::unique_ptr<Token> start_token,
-    std::unique_ptr<Token> result_identifier,
-    std::vector<std::unique_ptr<Token>> compiled_shader_identifiers)
-    : Command(std::move(start_token)),
-      result_identifier_(std::move(result_identifier)),
-      compiled_shader_identifiers_(std::move(compiled_shader_identifiers)) {
+    const Token* start_token,
+    const Token* result_identifier,
+    std::vector<const Token*> compiled_shader_identifiers)
+    : Command(start_token),
+      result_identifier_(result_identifier),
+      compiled_shader_identifiers_(std::move(compiled_shader_identifiers)),
+      result_slot_(kUnresolvedSlot),
+      compiled_shader_slots_(compiled_shader_identifiers_.size(),
+                             kUnresolvedSlot) {
   assert(!compiled_shader_identifiers_.empty() &&
          "At least one compiled shader identifier should be provided.");
 }
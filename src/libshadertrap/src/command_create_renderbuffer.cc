@@ -14,19 +14,18 @@
 
 #include "libshadertrap/command_create_renderbuffer.h"
 
-#include <utility>
-
 #include "libshadertrap/command_visitor.h"
 
 namespace shadertrap {
 
 CommandCreateRenderbuffer::CommandCreateRenderbuffer(
-    std::unique_ptr<Token> start_token, std::string result_identifier,
-    size_t width, size_t height)
-    : Command(std::move(start_token)),
-      result_identifier_(std::move(result_identifier)),
+    const Token* start_token, const Token* result_identifier, size_t width,
+    size_t height)
+    : Command(start_token),
+      result_identifier_(result_identifier),
       width_(width),
-      height_(height) {}
+      height_(height),
+      result_slot_(kUnresolvedSlot) {}
 
 bool CommandCreateRenderbuffer::Accept(CommandVisitor* visitor) {
   return visitor->VisitCreateRenderbuffer(this);
@@ -14,17 +14,16 @@
 
 #include "libshadertrap/command_create_sampler.h"
 
-#include <utility>
-
 #include "libshadertrap/command_visitor.h"
 
 namespace shadertrap {
 
 CommandCreateSampler::CommandCreateSampler(
-    std::unique_ptr<Token> start_token,
-    std::unique_ptr<Token> result_identifier)
-    : Command(std::move(start_token)),
-      result_identifier_(std::move(result_identifier)) {}
+    const Token* start_token,
+    const Token* result_identifier)
+    : Command(start_token),
+      result_identifier_(result_identifier),
+      result_slot_(kUnresolvedSlot) {}
 
 bool CommandCreateSampler::Accept(CommandVisitor* visitor) {
   return visitor->VisitCreateSampler(this);
@@ -14,20 +14,20 @@
 
 #include "libshadertrap/command_declare_shader.h"
 
-#include <utility>
-
 #include "libshadertrap/command_visitor.h"
 
 namespace shadertrap {
 
-CommandDeclareShader::CommandDeclareShader(
-    std::unique_ptr<Token> start_token,
-    std::unique_ptr<Token> result_identifier, Kind kind,
-    std::string shader_text)
-    : Command(std::move(start_token)),
-      result_identifier_(std::move(result_identifier)),
+CommandDeclareShader::CommandDeclareShader(const Token* start_token,
+                                           const Token* result_identifier,
+                                           Kind kind, const char* shader_text,
+                                           size_t shader_text_length)
+    : Command(start_token),
+      result_identifier_(result_identifier),
       kind_(kind),
-      shader_text_(std::move(shader_text)) {}
+      shader_text_(shader_text),
+      shader_text_length_(shader_text_length),
+      result_slot_(kUnresolvedSlot) {}
 
 bool CommandDeclareShader::Accept(CommandVisitor* visitor) {
   return visitor->VisitDeclareShader(this);
@@ -21,11 +21,12 @@
 namespace shadertrap {
 
 CommandDumpRenderbuffer::CommandDumpRenderbuffer(
-    std::unique_ptr<Token> start_token, std::string renderbuffer_identifier,
+    const Token* start_token, std::string renderbuffer_identifier,
     std::string filename)
-    : Command(std::move(start_token)),
+    : Command(start_token),
       renderbuffer_identifier_(std::move(renderbuffer_identifier)),
-      filename_(std::move(filename)) {}
+      filename_(std::move(filename)),
+      renderbuffer_slot_(kUnresolvedSlot) {}
 
 bool CommandDumpRenderbuffer::Accept(CommandVisitor* visitor) {
   return visitor->VisitDumpRenderbuffer(this);
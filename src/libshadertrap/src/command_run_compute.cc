@@ -20,15 +20,16 @@
 
 namespace shadertrap {
 
-CommandRunCompute::CommandRunCompute(std::unique_ptr<Token> start_token,
+CommandRunCompute::CommandRunCompute(const Token* start_token,
                                      std::string program_identifier,
                                      size_t num_groups_x, size_t num_groups_y,
                                      size_t num_groups_z)
-    : Command(std::move(start_token)),
+    : Command(start_token),
       program_identifier_(std::move(program_identifier)),
       num_groups_x_(num_groups_x),
       num_groups_y_(num_groups_y),
-      num_groups_z_(num_groups_z) {}
+      num_groups_z_(num_groups_z),
+      program_slot_(kUnresolvedSlot) {}
 
 bool CommandRunCompute::Accept(CommandVisitor* visitor) {
   return visitor->VisitRunCompute(this);
@@ -21,12 +21,13 @@
 namespace shadertrap {
 
 CommandSetSamplerOrTextureParameter::CommandSetSamplerOrTextureParameter(
-    std::unique_ptr<Token> start_token, std::string target_texture_or_sampler,
+    const Token* start_token, std::string target_texture_or_sampler,
     TextureParameter parameter, TextureParameterValue parameter_value)
-    : Command(std::move(start_token)),
+    : Command(start_token),
       target_texture_or_sampler_(std::move(target_texture_or_sampler)),
       parameter_(parameter),
-      parameter_value_(parameter_value) {}
+      parameter_value_(parameter_value),
+      target_texture_or_sampler_slot_(kUnresolvedSlot) {}
 
 bool CommandSetSamplerOrTextureParameter::Accept(CommandVisitor* visitor) {
   return visitor->VisitSetSamplerOrTextureParameter(this);
@@ -20,13 +20,14 @@
 
 namespace shadertrap {
 
-CommandSetUniform::CommandSetUniform(std::unique_ptr<Token> start_token,
+CommandSetUniform::CommandSetUniform(const Token* start_token,
                                      std::string program_identifier,
                                      size_t location, UniformValue value)
-    : Command(std::move(start_token)),
+    : Command(start_token),
       program_identifier_(std::move(program_identifier)),
       location_(location),
-      value_(std::move(value)) {}
+      value_(std::move(value)),
+      program_slot_(kUnresolvedSlot) {}
 
 bool CommandSetUniform::Accept(CommandVisitor* visitor) {
   return visitor->VisitSetUniform(this);
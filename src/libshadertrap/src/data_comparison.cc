@@ -0,0 +1,380 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libshadertrap/data_comparison.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SHADERTRAP_COMPARE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SHADERTRAP_COMPARE_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace shadertrap {
+
+namespace {
+
+// Inputs smaller than this are compared on the calling thread, as starting
+// threads would cost more than it saves.
+const size_t kMinBytesPerThread = 4 * 1024 * 1024;
+
+#if defined(SHADERTRAP_COMPARE_AVX2) || defined(SHADERTRAP_COMPARE_SSE2)
+
+// Yields a mask with bit i set if byte i of |data_1| and |data_2| agree, for
+// each byte of a vector.
+#if defined(SHADERTRAP_COMPARE_AVX2)
+const size_t kVectorSize = 32;
+const uint32_t kAllLanes = 0xFFFFFFFFU;
+
+uint32_t EqualMask(const uint8_t* data_1, const uint8_t* data_2) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data_1)),
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data_2)))));
+}
+#else
+const size_t kVectorSize = 16;
+const uint32_t kAllLanes = 0xFFFFU;
+
+uint32_t EqualMask(const uint8_t* data_1, const uint8_t* data_2) {
+  return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(data_1)),
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(data_2)))));
+}
+#endif
+
+// Yields the index of the lowest set bit of |mask|, which must be non-zero.
+size_t LowestSetBit(uint32_t mask) {
+#if defined(_MSC_VER)
+  unsigned long result;  // NOLINT(google-runtime-int)
+  _BitScanForward(&result, mask);
+  return static_cast<size_t>(result);
+#else
+  return static_cast<size_t>(__builtin_ctz(mask));
+#endif
+}
+
+#endif
+
+uint8_t AbsoluteDifference(uint8_t value_1, uint8_t value_2) {
+  return static_cast<uint8_t>(value_1 > value_2 ? value_1 - value_2
+                                                : value_2 - value_1);
+}
+
+// Splits [0, count) into contiguous pieces of at least |min_per_piece|, one
+// per available thread, and applies |process| to each piece, on a thread of
+// its own if there is more than one. Yields the results in order of piece.
+template <typename Result, typename Process>
+std::vector<Result> ProcessInPieces(size_t count, size_t min_per_piece,
+                                    Process process) {
+  size_t num_pieces = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  num_pieces = std::min(num_pieces, std::max<size_t>(count / min_per_piece, 1));
+  const size_t per_piece = (count + num_pieces - 1) / num_pieces;
+  std::vector<Result> results(num_pieces);
+  if (num_pieces == 1) {
+    results[0] = process(0, count);
+    return results;
+  }
+  std::vector<std::thread> threads;
+  for (size_t piece = 0; piece < num_pieces; piece++) {
+    const size_t begin = std::min(piece * per_piece, count);
+    const size_t end = std::min(begin + per_piece, count);
+    threads.emplace_back([&results, &process, piece, begin, end]() {
+      results[piece] = process(begin, end);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return results;
+}
+
+BufferComparison NoBufferMismatches() { return {0, 0, 0, 0, {}}; }
+
+ImageComparison NoImageMismatches() {
+  return {0, 0, 0, 0, 0, {0, 0, 0, 0}, {}};
+}
+
+// Compares bytes [begin, end) of two buffers.
+BufferComparison CompareBufferRange(const uint8_t* data_1,
+                                    const uint8_t* data_2, size_t begin,
+                                    size_t end, size_t max_recorded) {
+  BufferComparison result = NoBufferMismatches();
+  for (size_t index = FindMismatch(data_1, data_2, begin, end); index < end;
+       index = FindMismatch(data_1, data_2, index, end)) {
+    if (result.num_mismatches == 0) {
+      result.first_index = index;
+    }
+    // Mismatches tend to come in runs, which are handled a byte at a time
+    // rather than by restarting the search after each byte.
+    for (; index < end && data_1[index] != data_2[index]; index++) {
+      result.num_mismatches++;
+      result.max_delta = std::max(
+          result.max_delta, AbsoluteDifference(data_1[index], data_2[index]));
+      if (result.first_mismatches.size() < max_recorded) {
+        result.first_mismatches.push_back(
+            {index, data_1[index], data_2[index]});
+      }
+    }
+    result.last_index = index - 1;
+  }
+  return result;
+}
+
+// Compares rows [begin, end) of two images, counting rows from the top.
+ImageComparison CompareImageRows(const uint8_t* image_1,
+                                 const uint8_t* image_2, size_t width,
+                                 size_t height, size_t begin, size_t end,
+                                 size_t max_recorded) {
+  ImageComparison result = NoImageMismatches();
+  const size_t row_bytes = width * 4;
+  for (size_t y = begin; y < end; y++) {
+    const size_t row_offset = (height - y - 1) * row_bytes;
+    const uint8_t* row_1 = image_1 + row_offset;
+    const uint8_t* row_2 = image_2 + row_offset;
+    for (size_t position = FindMismatch(row_1, row_2, 0, row_bytes);
+         position < row_bytes;
+         position = FindMismatch(row_1, row_2, position, row_bytes)) {
+      size_t x = position / 4;
+      if (result.num_mismatches == 0) {
+        result.min_x = x;
+        result.min_y = y;
+        result.max_x = x;
+      }
+      result.min_x = std::min(result.min_x, x);
+      result.max_y = y;
+      // As for buffers, a run of mismatching pixels is handled a pixel at a
+      // time.
+      for (; x < width && std::memcmp(row_1 + x * 4, row_2 + x * 4, 4) != 0;
+           x++) {
+        const uint8_t* pixel_1 = row_1 + x * 4;
+        const uint8_t* pixel_2 = row_2 + x * 4;
+        result.num_mismatches++;
+        for (size_t channel = 0; channel < 4; channel++) {
+          result.max_channel_delta[channel] =
+              std::max(result.max_channel_delta[channel],
+                       AbsoluteDifference(pixel_1[channel], pixel_2[channel]));
+        }
+        if (result.first_mismatches.size() < max_recorded) {
+          PixelMismatch mismatch = {x, y, {}, {}};
+          std::copy(pixel_1, pixel_1 + 4, mismatch.pixel_1);
+          std::copy(pixel_2, pixel_2 + 4, mismatch.pixel_2);
+          result.first_mismatches.push_back(mismatch);
+        }
+      }
+      result.max_x = std::max(result.max_x, x - 1);
+      position = x * 4;
+    }
+  }
+  return result;
+}
+
+// The number of histograms kept for each channel while counting. Consecutive
+// pixels are counted in different histograms, so that runs of equal values,
+// as in uniform images, do not make each increment wait for the previous one
+// to be stored.
+const size_t kNumSubHistograms = 4;
+
+using SubHistograms = uint32_t[kNumSubHistograms][4][kNumHistogramBins];
+
+// Counts one pixel in |histograms|, which are indexed by channel, then bin.
+void CountPixel(const uint8_t* pixel,
+                uint32_t (*histograms)[kNumHistogramBins]) {
+  histograms[0][pixel[0]]++;
+  histograms[1][pixel[1]]++;
+  histograms[2][pixel[2]]++;
+  histograms[3][pixel[3]]++;
+}
+
+// Counts pixels [begin, end) of |image|, yielding 4 * kNumHistogramBins
+// counts indexed by channel, then bin.
+std::vector<uint32_t> CountPixelRange(const uint8_t* image, size_t begin,
+                                      size_t end) {
+  // 16 KB, which fits comfortably in the L1 cache of the CPUs of interest.
+  SubHistograms sub_histograms;
+  std::memset(sub_histograms, 0, sizeof(sub_histograms));
+  size_t pixel = begin;
+  for (; pixel + kNumSubHistograms <= end; pixel += kNumSubHistograms) {
+    const uint8_t* data = image + pixel * 4;
+    CountPixel(data, sub_histograms[0]);
+    CountPixel(data + 4, sub_histograms[1]);
+    CountPixel(data + 8, sub_histograms[2]);
+    CountPixel(data + 12, sub_histograms[3]);
+  }
+  for (; pixel < end; pixel++) {
+    CountPixel(image + pixel * 4, sub_histograms[0]);
+  }
+  std::vector<uint32_t> result(4 * kNumHistogramBins, 0);
+  for (size_t channel = 0; channel < 4; channel++) {
+    for (size_t bin = 0; bin < kNumHistogramBins; bin++) {
+      uint32_t count = 0;
+      for (const auto& sub_histogram : sub_histograms) {
+        count += sub_histogram[channel][bin];
+      }
+      result[channel * kNumHistogramBins + bin] = count;
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+size_t FindMismatch(const uint8_t* data_1, const uint8_t* data_2, size_t begin,
+                    size_t end) {
+  size_t position = begin;
+#if defined(SHADERTRAP_COMPARE_AVX2) || defined(SHADERTRAP_COMPARE_SSE2)
+  for (; position + kVectorSize <= end; position += kVectorSize) {
+    const uint32_t equal = EqualMask(data_1 + position, data_2 + position);
+    if (equal != kAllLanes) {
+      return position + LowestSetBit(~equal & kAllLanes);
+    }
+  }
+#endif
+  while (position < end && data_1[position] == data_2[position]) {
+    position++;
+  }
+  return position;
+}
+
+BufferComparison CompareBuffers(const uint8_t* data_1, const uint8_t* data_2,
+                                size_t size, size_t max_recorded) {
+  std::vector<BufferComparison> pieces = ProcessInPieces<BufferComparison>(
+      size, kMinBytesPerThread,
+      [data_1, data_2, max_recorded](size_t begin, size_t end) {
+        return CompareBufferRange(data_1, data_2, begin, end, max_recorded);
+      });
+  BufferComparison result = NoBufferMismatches();
+  for (const auto& piece : pieces) {
+    if (piece.num_mismatches == 0) {
+      continue;
+    }
+    if (result.num_mismatches == 0) {
+      result.first_index = piece.first_index;
+    }
+    result.num_mismatches += piece.num_mismatches;
+    result.last_index = piece.last_index;
+    result.max_delta = std::max(result.max_delta, piece.max_delta);
+    for (const auto& mismatch : piece.first_mismatches) {
+      if (result.first_mismatches.size() == max_recorded) {
+        break;
+      }
+      result.first_mismatches.push_back(mismatch);
+    }
+  }
+  return result;
+}
+
+ImageComparison CompareImages(const uint8_t* image_1, const uint8_t* image_2,
+                              size_t width, size_t height,
+                              size_t max_recorded) {
+  std::vector<ImageComparison> pieces = ProcessInPieces<ImageComparison>(
+      height, std::max<size_t>(kMinBytesPerThread / (width * 4 + 1), 1),
+      [image_1, image_2, width, height, max_recorded](size_t begin,
+                                                      size_t end) {
+        return CompareImageRows(image_1, image_2, width, height, begin, end,
+                                max_recorded);
+      });
+  ImageComparison result = NoImageMismatches();
+  for (const auto& piece : pieces) {
+    if (piece.num_mismatches == 0) {
+      continue;
+    }
+    if (result.num_mismatches == 0) {
+      result.min_x = piece.min_x;
+      result.min_y = piece.min_y;
+      result.max_x = piece.max_x;
+    }
+    result.num_mismatches += piece.num_mismatches;
+    result.min_x = std::min(result.min_x, piece.min_x);
+    result.max_x = std::max(result.max_x, piece.max_x);
+    result.max_y = piece.max_y;
+    for (size_t channel = 0; channel < 4; channel++) {
+      result.max_channel_delta[channel] =
+          std::max(result.max_channel_delta[channel],
+                   piece.max_channel_delta[channel]);
+    }
+    for (const auto& mismatch : piece.first_mismatches) {
+      if (result.first_mismatches.size() == max_recorded) {
+        break;
+      }
+      result.first_mismatches.push_back(mismatch);
+    }
+  }
+  return result;
+}
+
+void AccumulateHistograms(const uint8_t* image, size_t num_pixels,
+                          uint32_t* histograms) {
+  // Pixels are split evenly, regardless of rows, as their order does not
+  // matter.
+  std::vector<std::vector<uint32_t>> pieces =
+      ProcessInPieces<std::vector<uint32_t>>(
+          num_pixels, kMinBytesPerThread / 4,
+          [image](size_t begin, size_t end) {
+            return CountPixelRange(image, begin, end);
+          });
+  for (const auto& piece : pieces) {
+    for (size_t index = 0; index < piece.size(); index++) {
+      histograms[index] += piece[index];
+    }
+  }
+}
+
+double MaxHistogramEmd(const uint32_t* histograms_1,
+                       const uint32_t* histograms_2, size_t num_pixels) {
+  const size_t num_bins = kNumHistogramBins;
+
+  // Earth movers's distance: Calculate the minimal cost of moving "earth" to
+  // transform the first histogram into the second, where each bin of the
+  // histogram can be thought of as a column of units of earth. The cost is the
+  // amount of earth moved times the distance carried (the distance is the
+  // number of adjacent bins over which the earth is carried). Calculate this
+  // using the cumulative difference of the bins, which works as long as both
+  // histograms have the same amount of earth. Sum the absolute values of the
+  // cumulative difference to get the final cost of how much (and how far) the
+  // earth was moved.
+  double max_emd = 0;
+
+  for (size_t channel = 0; channel < 4; ++channel) {
+    const uint32_t* histogram_1 = &histograms_1[channel * num_bins];
+    const uint32_t* histogram_2 = &histograms_2[channel * num_bins];
+    double diff_total = 0;
+    double diff_accum = 0;
+
+    for (size_t i = 0; i < num_bins; ++i) {
+      double hist_normalized_0 = static_cast<double>(histogram_1[i]) /
+                                 static_cast<double>(num_pixels);
+      double hist_normalized_1 = static_cast<double>(histogram_2[i]) /
+                                 static_cast<double>(num_pixels);
+      diff_accum += hist_normalized_0 - hist_normalized_1;
+      diff_total += std::fabs(diff_accum);
+    }
+    // Normalize to range 0..1
+    double emd = diff_total / num_bins;
+    max_emd = std::max(max_emd, emd);
+  }
+  return max_emd;
+}
+
+}  // namespace shadertrap
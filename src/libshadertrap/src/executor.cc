@@ -16,44 +16,566 @@
 
 #include <algorithm>
 #include <cassert>
-#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <functional>
 #include <initializer_list>
+#include <mutex>
 #include <sstream>
-#include <unordered_map>
+#include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+#include "libshadertrap/command.h"
+#include "libshadertrap/command_assert_equal.h"
+#include "libshadertrap/command_assert_pixels.h"
+#include "libshadertrap/command_assert_similar_emd_histogram.h"
+#include "libshadertrap/command_create_buffer.h"
+#include "libshadertrap/command_declare_shader.h"
+#include "libshadertrap/command_dump_renderbuffer.h"
+#include "libshadertrap/command_set_uniform.h"
+#include "libshadertrap/data_comparison.h"
 #include "libshadertrap/helpers.h"
+#include "libshadertrap/image_writer.h"
 #include "libshadertrap/uniform_value.h"
-#include "libshadertrap/vertex_attribute_info.h"
-#include "lodepng/lodepng.h"
 
 // RGBA
 #define CHANNELS (4)
 
 namespace shadertrap {
 
+namespace {
+
+// The amount of a buffer's initial data pattern that is expanded at a time.
+// This is a whole number of elements of any type.
+const size_t kPatternChunkBytes = 1024 * 1024;
+
+// The number of mismatching bytes or pixels that ASSERT_EQUAL reports
+// individually; any further mismatches are only summarized.
+const size_t kMaxReportedMismatches = 16;
+
+// The number of mismatching pixels that a comparison of renderbuffers on the
+// GPU records individually. This, and the local size below, must agree with
+// |kComparisonShaderText|.
+const uint32_t kMaxRecordedMismatches = 64;
+
+// The local size, in each dimension, of the comparison compute shader.
+const size_t kComparisonLocalSize = 8;
+
+// The layout of the buffer that the comparison compute shader writes. The
+// bounding box is in OpenGL's coordinates, with y increasing upwards, and
+// each recorded mismatch holds its coordinates and the two pixels, packed.
+// The padding aligns the recorded mismatches as std430 requires.
+struct ComparisonResult {
+  uint32_t num_mismatches;
+  uint32_t min_x;
+  uint32_t min_y;
+  uint32_t max_x;
+  uint32_t max_y;
+  uint32_t max_channel_delta[4];
+  uint32_t padding[3];
+  uint32_t mismatches[kMaxRecordedMismatches][4];
+};
+
+// Compares two images, given as image units 0 and 1, pixel by pixel.
+const char* const kComparisonShaderText = R"(#version 310 es
+layout(local_size_x = 8, local_size_y = 8) in;
+layout(rgba8, binding = 0) readonly uniform highp image2D image_1;
+layout(rgba8, binding = 1) readonly uniform highp image2D image_2;
+layout(std430, binding = 0) buffer ComparisonResult {
+  uint num_mismatches;
+  uint min_x;
+  uint min_y;
+  uint max_x;
+  uint max_y;
+  uint max_channel_delta[4];
+  uint padding[3];
+  uvec4 mismatches[64];
+};
+void main() {
+  ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+  ivec2 size = imageSize(image_1);
+  if (coord.x >= size.x || coord.y >= size.y) {
+    return;
+  }
+  uint pixel_1 = packUnorm4x8(imageLoad(image_1, coord));
+  uint pixel_2 = packUnorm4x8(imageLoad(image_2, coord));
+  if (pixel_1 == pixel_2) {
+    return;
+  }
+  uint index = atomicAdd(num_mismatches, 1u);
+  atomicMin(min_x, uint(coord.x));
+  atomicMin(min_y, uint(coord.y));
+  atomicMax(max_x, uint(coord.x));
+  atomicMax(max_y, uint(coord.y));
+  for (uint channel = 0u; channel < 4u; channel++) {
+    int value_1 = int((pixel_1 >> (8u * channel)) & 255u);
+    int value_2 = int((pixel_2 >> (8u * channel)) & 255u);
+    atomicMax(max_channel_delta[channel], uint(abs(value_1 - value_2)));
+  }
+  if (index < uint(mismatches.length())) {
+    mismatches[index] = uvec4(uvec2(coord), pixel_1, pixel_2);
+  }
+}
+)";
+
+// The local size of the histogram compute shader, which must agree with
+// |kHistogramShaderText|. A work group of 128 invocations is the most that
+// OpenGL ES 3.1 guarantees.
+const size_t kHistogramLocalSizeX = 16;
+const size_t kHistogramLocalSizeY = 8;
+
+// Accumulates the per-channel histograms of two images, given as image units
+// 0 and 1, indexed by image, then channel, then bin. Each work group counts
+// into shared memory, and adds its non-zero counts to the buffer.
+const char* const kHistogramShaderText = R"(#version 310 es
+layout(local_size_x = 16, local_size_y = 8) in;
+layout(rgba8, binding = 0) readonly uniform highp image2D image_1;
+layout(rgba8, binding = 1) readonly uniform highp image2D image_2;
+layout(std430, binding = 0) buffer Histograms {
+  uint counts[2048];
+};
+shared uint local_counts[2048];
+const uint kInvocations = gl_WorkGroupSize.x * gl_WorkGroupSize.y;
+void main() {
+  for (uint i = gl_LocalInvocationIndex; i < 2048u; i += kInvocations) {
+    local_counts[i] = 0u;
+  }
+  barrier();
+  ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+  ivec2 size = imageSize(image_1);
+  if (coord.x < size.x && coord.y < size.y) {
+    uint pixels[2] = uint[2](packUnorm4x8(imageLoad(image_1, coord)),
+                             packUnorm4x8(imageLoad(image_2, coord)));
+    for (uint image = 0u; image < 2u; image++) {
+      for (uint channel = 0u; channel < 4u; channel++) {
+        uint bin = (pixels[image] >> (8u * channel)) & 255u;
+        atomicAdd(local_counts[(image * 4u + channel) * 256u + bin], 1u);
+      }
+    }
+  }
+  barrier();
+  for (uint i = gl_LocalInvocationIndex; i < 2048u; i += kInvocations) {
+    if (local_counts[i] != 0u) {
+      atomicAdd(counts[i], local_counts[i]);
+    }
+  }
+}
+)";
+
+// Compute shaders, which the executor's internal programs need, are core
+// from OpenGL ES 3.1.
+bool ComputeShadersAreAvailable() { return GLAD_GL_ES_VERSION_3_1 != 0; }
+
+// Records |value| as the entry of |table| for |slot|, growing the table as
+// needed.
+template <typename T>
+void SetSlot(std::vector<T>* table, size_t slot, T value) {
+  assert(slot != kUnresolvedSlot && "Identifier has not been resolved.");
+  if (table->size() <= slot) {
+    table->resize(slot + 1, T());
+  }
+  (*table)[slot] = value;
+}
+
+// Determines whether |table| has an entry for |slot|.
+template <typename T>
+bool HasSlot(const std::vector<T>& table, size_t slot) {
+  return slot < table.size() && table[slot] != T();
+}
+
+// Yields the entry of |table| for |slot|, which must exist.
+template <typename T>
+T GetSlot(const std::vector<T>& table, size_t slot) {
+  assert(HasSlot(table, slot) && "No entry for slot.");
+  return table[slot];
+}
+
+}  // namespace
+
 Executor::Executor(MessageConsumer* message_consumer)
-    : message_consumer_(message_consumer) {}
+    : message_consumer_(message_consumer),
+      renderbuffer_comparison_(RenderbufferComparison::kOnCpu),
+      histogram_computation_(HistogramComputation::kPreferGpu),
+      memory_barriers_(MemoryBarriers::kInferred),
+      gl_error_checking_(GlErrorChecking::kPerCall),
+      dump_format_(ImageWriter::Format::kPng),
+      comparison_program_(0),
+      comparison_result_buffer_(0),
+      histogram_program_(0),
+      histogram_buffer_(0),
+      comparison_textures_{0, 0},
+      comparison_texture_width_(0),
+      comparison_texture_height_(0),
+      vertex_array_state_({{}, 0}),
+      num_vertex_arrays_created_(0),
+      num_vertex_arrays_reused_(0) {}
+
+Executor::~Executor() {
+  for (const auto& entry : framebuffers_) {
+    glDeleteFramebuffers(1, &entry.second);
+  }
+  for (const auto& entry : vertex_arrays_) {
+    glDeleteVertexArrays(1, &entry.second);
+  }
+  for (const auto& readback : pending_readbacks_) {
+    glDeleteSync(readback.fence);
+    glDeleteBuffers(1, &readback.pixel_buffer);
+  }
+  for (auto pixel_buffer : free_pixel_buffers_) {
+    glDeleteBuffers(1, &pixel_buffer);
+  }
+  if (comparison_program_ != 0) {
+    glDeleteProgram(comparison_program_);
+    glDeleteBuffers(1, &comparison_result_buffer_);
+  }
+  if (histogram_program_ != 0) {
+    glDeleteProgram(histogram_program_);
+    glDeleteBuffers(1, &histogram_buffer_);
+  }
+  if (comparison_textures_[0] != 0) {
+    glDeleteTextures(2, comparison_textures_);
+  }
+}
 
-bool Executor::VisitAssertEqual(CommandAssertEqual* assert_equal) {
-  if (created_renderbuffers_.count(assert_equal->GetBufferIdentifier1()) != 0) {
-    return CheckEqualRenderbuffers(assert_equal);
+bool Executor::Execute(const LoweredProgram& program) {
+  SetCrashCleanup(FinishPendingWorkBeforeCrash, this);
+  StartGlErrorChecking();
+  bool result = ExecuteInstructions(program);
+  FinishImageWrites();
+  StopGlErrorChecking();
+  SetCrashCleanup(nullptr, nullptr);
+  return result;
+}
+
+bool Executor::ExecuteInstructions(const LoweredProgram& program) {
+  const auto& instructions = program.GetInstructions();
+  for (size_t index = 0; index < instructions.size(); index++) {
+    const Instruction& instruction = instructions[index];
+    bool result = true;
+    switch (instruction.opcode) {
+      case Instruction::Opcode::kAssertEqualBuffers:
+        result = CheckEqualBuffers(instruction.assert_equal);
+        break;
+      case Instruction::Opcode::kAssertEqualRenderbuffers:
+        result = CheckEqualRenderbuffers(instruction.assert_equal);
+        break;
+      case Instruction::Opcode::kAssertPixels:
+        result = ExecuteAssertPixels(instruction.assert_pixels);
+        break;
+      case Instruction::Opcode::kAssertSimilarEmdHistogram:
+        result = ExecuteAssertSimilarEmdHistogram(
+            instruction.assert_similar_emd_histogram);
+        break;
+      case Instruction::Opcode::kBindBufferBase:
+        GL_SAFECALL(glBindBufferBase, instruction.bind_buffer_base.target,
+                    instruction.bind_buffer_base.binding,
+                    GetSlot(created_buffers_,
+                            instruction.bind_buffer_base.buffer_slot));
+        break;
+      case Instruction::Opcode::kBindSampler:
+        GL_SAFECALL(
+            glBindSampler, instruction.bind_sampler.texture_unit,
+            GetSlot(created_samplers_, instruction.bind_sampler.sampler_slot));
+        break;
+      case Instruction::Opcode::kBindTexture:
+        GL_SAFECALL(glActiveTexture, instruction.bind_texture.texture_unit);
+        GL_SAFECALL(
+            glBindTexture, GL_TEXTURE_2D,
+            GetSlot(created_textures_, instruction.bind_texture.texture_slot));
+        break;
+      case Instruction::Opcode::kCompileShader:
+        result = ExecuteCompileShader(instruction.compile_shader);
+        break;
+      case Instruction::Opcode::kCreateBuffer:
+        result = ExecuteCreateBuffer(instruction.create_buffer);
+        break;
+      case Instruction::Opcode::kCreateEmptyTexture2D:
+        result = ExecuteCreateEmptyTexture2D(instruction.create_image);
+        break;
+      case Instruction::Opcode::kCreateProgram:
+        result = ExecuteCreateProgram(instruction.create_program, program);
+        break;
+      case Instruction::Opcode::kCreateRenderbuffer:
+        result = ExecuteCreateRenderbuffer(instruction.create_image);
+        break;
+      case Instruction::Opcode::kCreateSampler: {
+        GLuint sampler;
+        GL_SAFECALL(glGenSamplers, 1, &sampler);
+        SetSlot(&created_samplers_, instruction.create_sampler.result_slot,
+                sampler);
+        break;
+      }
+      case Instruction::Opcode::kDumpRenderbuffer:
+        result = ExecuteDumpRenderbuffer(instruction.dump_renderbuffer);
+        break;
+      case Instruction::Opcode::kMemoryBarrier:
+        // Not every barrier precedes a run, so in conservative mode a full
+        // barrier is issued in place of each inferred one as well.
+        GL_SAFECALL(glMemoryBarrier,
+                    memory_barriers_ == MemoryBarriers::kConservative
+                        ? GL_ALL_BARRIER_BITS
+                        : instruction.memory_barrier.barriers);
+        break;
+      case Instruction::Opcode::kRunCompute:
+        result = ExecuteRunCompute(instruction.run_compute);
+        break;
+      case Instruction::Opcode::kRunGraphics:
+        result = ExecuteRunGraphics(instruction.run_graphics, program);
+        break;
+      case Instruction::Opcode::kSetSamplerParameter:
+        GL_SAFECALL(
+            glSamplerParameteri,
+            GetSlot(created_samplers_, instruction.set_parameter.target_slot),
+            instruction.set_parameter.parameter,
+            instruction.set_parameter.parameter_value);
+        break;
+      case Instruction::Opcode::kSetTextureParameter:
+        GL_SAFECALL(
+            glBindTexture, GL_TEXTURE_2D,
+            GetSlot(created_textures_, instruction.set_parameter.target_slot));
+        GL_SAFECALL(glTexParameteri, GL_TEXTURE_2D,
+                    instruction.set_parameter.parameter,
+                    instruction.set_parameter.parameter_value);
+        break;
+      case Instruction::Opcode::kSetUniform:
+        result = ExecuteSetUniform(instruction.set_uniform);
+        break;
+    }
+    if (!result) {
+      // Earlier commands must still report the outcome of their readbacks,
+      // and an OpenGL error may be why the instruction failed. If an earlier
+      // command failed, only its failure is reported.
+      if (FinishReadbacks(true)) {
+        CheckGlErrors(program.GetInstructionToken(index));
+      }
+      return false;
+    }
+    if (!CheckGlErrors(program.GetInstructionToken(index)) ||
+        !FinishReadbacks(false)) {
+      return false;
+    }
   }
-  assert(created_buffers_.count(assert_equal->GetBufferIdentifier1()) != 0);
-  return CheckEqualBuffers(assert_equal);
+  // Errors raised while examining the last readbacks cannot be pinned to a
+  // command.
+  return FinishReadbacks(true) && CheckGlErrors(nullptr);
 }
 
-bool Executor::VisitAssertPixels(CommandAssertPixels* assert_pixels) {
-  GLuint framebuffer_object_id;
-  GL_SAFECALL(glGenFramebuffers, 1, &framebuffer_object_id);
-  GL_SAFECALL(glBindFramebuffer, GL_FRAMEBUFFER, framebuffer_object_id);
-  GL_SAFECALL(
-      glFramebufferRenderbuffer, GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-      GL_RENDERBUFFER,
-      created_renderbuffers_.at(assert_pixels->GetRenderbufferIdentifier()));
+void Executor::StartGlErrorChecking() {
+  if (gl_error_checking_ == GlErrorChecking::kDebugCallback) {
+    if (GLAD_GL_ES_VERSION_3_2 == 0) {
+      // KHR_debug is core from OpenGL ES 3.2.
+      gl_error_checking_ = GlErrorChecking::kPerCommand;
+    } else {
+      GL_SAFECALL(glDebugMessageCallback, CollectDebugMessage, this);
+      GL_SAFECALL(glDebugMessageControl, GL_DONT_CARE, GL_DONT_CARE,
+                  GL_DONT_CARE, 0, nullptr, GL_FALSE);
+      GL_SAFECALL(glDebugMessageControl, GL_DONT_CARE, GL_DEBUG_TYPE_ERROR,
+                  GL_DONT_CARE, 0, nullptr, GL_TRUE);
+      GL_SAFECALL(glEnable, GL_DEBUG_OUTPUT);
+      // Messages are then delivered during the call that raises them, so
+      // they are reported against the right command, and none arrive after
+      // the last check.
+      GL_SAFECALL(glEnable, GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }
+  }
+  SetGlErrorsCheckedPerCall(gl_error_checking_ == GlErrorChecking::kPerCall);
+}
+
+void Executor::StopGlErrorChecking() {
+  if (gl_error_checking_ == GlErrorChecking::kPerCall) {
+    return;
+  }
+  if (gl_error_checking_ == GlErrorChecking::kDebugCallback) {
+    GL_SAFECALL(glDisable, GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    GL_SAFECALL(glDisable, GL_DEBUG_OUTPUT);
+    GL_SAFECALL(glDebugMessageCallback, nullptr, nullptr);
+  }
+  // Errors are drained by each check, and execution succeeds only if the
+  // final check finds none, so any error still flagged was raised by an
+  // instruction whose failure has already been reported; it must not be
+  // blamed on the next checked call.
+  while (glGetError() != GL_NO_ERROR) {
+  }
+  SetGlErrorsCheckedPerCall(true);
+}
+
+bool Executor::CheckGlErrors(const Token* token) {
+  std::vector<std::string> errors;
+  switch (gl_error_checking_) {
+    case GlErrorChecking::kPerCall:
+      return true;
+    case GlErrorChecking::kPerCommand:
+      for (GLenum error = glGetError(); error != GL_NO_ERROR;
+           error = glGetError()) {
+        errors.push_back(OpenglErrorString(error));
+      }
+      break;
+    case GlErrorChecking::kDebugCallback: {
+      {
+        std::lock_guard<std::mutex> lock(debug_errors_mutex_);
+        errors.swap(debug_errors_);
+      }
+      // The errors are also flagged as usual. They are drained regardless,
+      // but reported only if the driver sent no messages for them, as it may
+      // if the context is not a debug context.
+      std::vector<std::string> flagged_errors;
+      for (GLenum error = glGetError(); error != GL_NO_ERROR;
+           error = glGetError()) {
+        flagged_errors.push_back(OpenglErrorString(error));
+      }
+      if (errors.empty()) {
+        errors.swap(flagged_errors);
+      }
+      break;
+    }
+  }
+  if (errors.empty()) {
+    return true;
+  }
+  if (!FinishReadbacksBeforeReport()) {
+    return false;
+  }
+  for (const auto& error : errors) {
+    message_consumer_->Message(MessageConsumer::Severity::kError, token,
+                               "OpenGL error: " + error);
+  }
+  return false;
+}
+
+void APIENTRY Executor::CollectDebugMessage(GLenum /*source*/, GLenum type,
+                                            GLuint /*id*/, GLenum /*severity*/,
+                                            GLsizei length,
+                                            const GLchar* message,
+                                            const void* user_param) {
+  if (type != GL_DEBUG_TYPE_ERROR) {
+    return;
+  }
+  auto* executor = static_cast<Executor*>(const_cast<void*>(user_param));
+  std::lock_guard<std::mutex> lock(executor->debug_errors_mutex_);
+  executor->debug_errors_.push_back(
+      length < 0 ? std::string(message)
+                 : std::string(message, static_cast<size_t>(length)));
+}
+
+bool Executor::StartReadback(
+    size_t num_attachments, size_t width, size_t height,
+    std::function<bool(const uint8_t* pixels)> examine) {
+  if (pending_readbacks_.size() == kMaxPendingReadbacks) {
+    // Waiting for the oldest readback bounds the memory held in pixel buffer
+    // objects.
+    if (!FinishOldestReadback()) {
+      AbandonReadbacks();
+      return false;
+    }
+  }
+  const size_t image_size_bytes = width * height * CHANNELS;
+  PendingReadback readback;
+  if (free_pixel_buffers_.empty()) {
+    GL_SAFECALL(glGenBuffers, 1, &readback.pixel_buffer);
+  } else {
+    readback.pixel_buffer = free_pixel_buffers_.back();
+    free_pixel_buffers_.pop_back();
+  }
+  readback.size_bytes = num_attachments * image_size_bytes;
+  readback.examine = std::move(examine);
+  GL_SAFECALL(glBindBuffer, GL_PIXEL_PACK_BUFFER, readback.pixel_buffer);
+  GL_SAFECALL(glBufferData, GL_PIXEL_PACK_BUFFER,
+              static_cast<GLsizeiptr>(readback.size_bytes), nullptr,
+              GL_STREAM_READ);
+  for (size_t index = 0; index < num_attachments; index++) {
+    GL_SAFECALL(glReadBuffer,
+                GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(index));
+    // With a pixel pack buffer bound, the final argument is an offset into the
+    // buffer rather than a client pointer.
+    GL_SAFECALL(glReadPixels, 0, 0, static_cast<GLsizei>(width),
+                static_cast<GLsizei>(height), GL_RGBA, GL_UNSIGNED_BYTE,
+                reinterpret_cast<void*>(index * image_size_bytes));
+  }
+  GL_SAFECALL(glBindBuffer, GL_PIXEL_PACK_BUFFER, 0);
+  readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  GL_CHECKERR("glFenceSync");
+  // Polling a fence does not flush, so flush here to make sure that the fence
+  // eventually signals.
+  GL_SAFECALL_NO_ARGS(glFlush);
+  pending_readbacks_.push_back(std::move(readback));
+  return true;
+}
+
+bool Executor::FinishReadbacks(bool wait) {
+  while (!pending_readbacks_.empty()) {
+    if (!wait) {
+      GLenum status = glClientWaitSync(pending_readbacks_.front().fence, 0, 0);
+      GL_CHECKERR("glClientWaitSync");
+      if (status == GL_TIMEOUT_EXPIRED) {
+        return true;
+      }
+      if (status == GL_WAIT_FAILED) {
+        crash("%s", "Failed to wait for a pixel readback");
+      }
+    }
+    if (!FinishOldestReadback()) {
+      AbandonReadbacks();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Executor::FinishReadbacksBeforeReport() { return FinishReadbacks(true); }
+
+bool Executor::FinishOldestReadback() {
+  assert(!pending_readbacks_.empty() && "No readback to finish.");
+  PendingReadback readback = std::move(pending_readbacks_.front());
+  pending_readbacks_.pop_front();
+  while (true) {
+    GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                     kReadbackWaitTimeoutNanoseconds);
+    GL_CHECKERR("glClientWaitSync");
+    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+      break;
+    }
+    if (status == GL_WAIT_FAILED) {
+      crash("%s", "Failed to wait for a pixel readback");
+    }
+  }
+  GL_SAFECALL(glDeleteSync, readback.fence);
+  GL_SAFECALL(glBindBuffer, GL_PIXEL_PACK_BUFFER, readback.pixel_buffer);
+  const void* pixels =
+      glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                       static_cast<GLsizeiptr>(readback.size_bytes),
+                       GL_MAP_READ_BIT);
+  GL_CHECKERR("glMapBufferRange");
+  if (pixels == nullptr) {
+    crash("%s", "Failed to map a pixel buffer object");
+  }
+  // The examining function does not use OpenGL, so the pixel buffer object
+  // is still bound when it returns.
+  bool result = readback.examine(static_cast<const uint8_t*>(pixels));
+  GL_SAFECALL(glUnmapBuffer, GL_PIXEL_PACK_BUFFER);
+  GL_SAFECALL(glBindBuffer, GL_PIXEL_PACK_BUFFER, 0);
+  free_pixel_buffers_.push_back(readback.pixel_buffer);
+  return result;
+}
+
+void Executor::AbandonReadbacks() {
+  for (const auto& readback : pending_readbacks_) {
+    GL_SAFECALL(glDeleteSync, readback.fence);
+    free_pixel_buffers_.push_back(readback.pixel_buffer);
+  }
+  pending_readbacks_.clear();
+}
+
+bool Executor::ExecuteAssertPixels(
+    const Instruction::AssertPixelsOperands& operands) {
+  const CommandAssertPixels* assert_pixels = operands.command;
+  attached_images_.clear();
+  attached_images_.push_back(
+      {GL_COLOR_ATTACHMENT0, true,
+       GetSlot(created_renderbuffers_, operands.renderbuffer_slot)});
+  BindFramebuffer(attached_images_);
   size_t width;
   size_t height;
   {
@@ -66,20 +588,16 @@ bool Executor::VisitAssertPixels(CommandAssertPixels* assert_pixels) {
     width = static_cast<size_t>(temp_width);
     height = static_cast<size_t>(temp_height);
   }
+  return StartReadback(
+      1, width, height,
+      [this, assert_pixels, width, height](const uint8_t* data) {
+        return ExaminePixels(assert_pixels, width, height, data);
+      });
+}
 
-  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-  if (status != GL_FRAMEBUFFER_COMPLETE) {
-    crash(
-        "Problem with OpenGL framebuffer after specifying color render buffer: "
-        "n%xn",
-        status);
-  }
-
-  std::vector<std::uint8_t> data(width * height * CHANNELS);
-  GL_SAFECALL(glReadBuffer, GL_COLOR_ATTACHMENT0);
-  GL_SAFECALL(glReadPixels, 0, 0, static_cast<GLint>(width),
-              static_cast<GLint>(height), GL_RGBA, GL_UNSIGNED_BYTE,
-              data.data());
+bool Executor::ExaminePixels(const CommandAssertPixels* assert_pixels,
+                             size_t width, size_t height,
+                             const uint8_t* data) {
   for (size_t y = assert_pixels->GetRectangleY();
        y < assert_pixels->GetRectangleY() + assert_pixels->GetRectangleHeight();
        y++) {
@@ -87,7 +605,8 @@ bool Executor::VisitAssertPixels(CommandAssertPixels* assert_pixels) {
          x <
          assert_pixels->GetRectangleX() + assert_pixels->GetRectangleWidth();
          x++) {
-      uint8_t* start_of_pixel = &data[(height - y - 1) * width * 4 + x * 4];
+      const uint8_t* start_of_pixel =
+          &data[(height - y - 1) * width * 4 + x * 4];
       uint8_t r = start_of_pixel[0];
       uint8_t g = start_of_pixel[1];
       uint8_t b = start_of_pixel[2];
@@ -120,13 +639,15 @@ bool Executor::VisitAssertPixels(CommandAssertPixels* assert_pixels) {
   return true;
 }
 
-bool Executor::VisitAssertSimilarEmdHistogram(
-    CommandAssertSimilarEmdHistogram* assert_similar_emd_histogram) {
+bool Executor::ExecuteAssertSimilarEmdHistogram(
+    const Instruction::AssertSimilarEmdHistogramOperands& operands) {
+  const CommandAssertSimilarEmdHistogram* assert_similar_emd_histogram =
+      operands.command;
   GLuint renderbuffers[2];
-  renderbuffers[0] = created_renderbuffers_.at(
-      assert_similar_emd_histogram->GetBufferIdentifier1());
-  renderbuffers[1] = created_renderbuffers_.at(
-      assert_similar_emd_histogram->GetBufferIdentifier2());
+  renderbuffers[0] =
+      GetSlot(created_renderbuffers_, operands.renderbuffer_slot_1);
+  renderbuffers[1] =
+      GetSlot(created_renderbuffers_, operands.renderbuffer_slot_2);
 
   size_t width[2] = {0, 0};
   size_t height[2] = {0, 0};
@@ -147,6 +668,11 @@ bool Executor::VisitAssertSimilarEmdHistogram(
     }
   }
 
+  if ((width[0] != width[1] || height[0] != height[1]) &&
+      !FinishReadbacksBeforeReport()) {
+    return false;
+  }
+
   if (width[0] != width[1]) {
     std::stringstream stringstream;
     stringstream << "The widths of "
@@ -173,77 +699,99 @@ bool Executor::VisitAssertSimilarEmdHistogram(
     return false;
   }
 
-  GLuint framebuffer_object_id;
-  GL_SAFECALL(glGenFramebuffers, 1, &framebuffer_object_id);
-  GL_SAFECALL(glBindFramebuffer, GL_FRAMEBUFFER, framebuffer_object_id);
+  attached_images_.clear();
   for (auto index : {0, 1}) {
-    GL_SAFECALL(glFramebufferRenderbuffer, GL_FRAMEBUFFER,
-                GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(index),
-                GL_RENDERBUFFER, renderbuffers[index]);
-  }
-  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-  if (status != GL_FRAMEBUFFER_COMPLETE) {
-    crash(
-        "Problem with OpenGL framebuffer after specifying color render buffer: "
-        "n%xn",
-        status);
+    attached_images_.push_back(
+        {GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(index), true,
+         renderbuffers[index]});
   }
-
-  std::vector<std::uint8_t> data[2];
-  for (auto index : {0, 1}) {
-    data[index].resize(width[index] * height[index] * CHANNELS);
-    GL_SAFECALL(glReadBuffer,
-                GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(index));
-    GL_SAFECALL(glReadPixels, 0, 0, static_cast<GLint>(width[index]),
-                static_cast<GLint>(height[index]), GL_RGBA, GL_UNSIGNED_BYTE,
-                data[index].data());
+  BindFramebuffer(attached_images_);
+  const size_t common_width = width[0];
+  const size_t common_height = height[0];
+  std::vector<uint32_t> gpu_histograms;
+  if (histogram_computation_ != HistogramComputation::kOnCpu &&
+      ComputeShadersAreAvailable()) {
+    if (!ComputeHistogramsOnGpu(common_width, common_height,
+                                &gpu_histograms)) {
+      return false;
+    }
+    if (histogram_computation_ == HistogramComputation::kPreferGpu) {
+      return CheckHistogramEmd(assert_similar_emd_histogram,
+                               common_width * common_height, gpu_histograms);
+    }
   }
+  return StartReadback(
+      2, common_width, common_height,
+      [this, assert_similar_emd_histogram, common_width, common_height,
+       gpu_histograms](const uint8_t* pixels) {
+        return ExamineSimilarEmdHistogram(assert_similar_emd_histogram,
+                                          common_width, common_height, pixels,
+                                          gpu_histograms);
+      });
+}
 
-  const size_t num_bins = 256;
+bool Executor::ExamineSimilarEmdHistogram(
+    const CommandAssertSimilarEmdHistogram* assert_similar_emd_histogram,
+    size_t width, size_t height, const uint8_t* pixels,
+    const std::vector<uint32_t>& gpu_histograms) {
+  const uint8_t* data[2] = {pixels, pixels + width * height * CHANNELS};
 
-  std::vector<std::vector<uint64_t>> histogram[2];
-  for (auto index : {0, 1}) {
-    for (size_t channel = 0; channel < 4; channel++) {
-      histogram[index].emplace_back(std::vector<uint64_t>(num_bins, 0));
-    }
-    for (size_t y = 0; y < height[index]; y++) {
-      for (size_t x = 0; x < width[index]; x++) {
-        for (size_t channel = 0; channel < 4; channel++) {
-          histogram[index][channel]
-                   [data[index][y * width[index] * 4 + x * 4 + channel]]++;
-        }
-      }
-    }
+  std::vector<uint32_t> histograms(2 * CHANNELS * kNumHistogramBins, 0);
+  for (size_t index = 0; index < 2; index++) {
+    AccumulateHistograms(data[index], width * height,
+                         &histograms[index * CHANNELS * kNumHistogramBins]);
+  }
+  if (!gpu_histograms.empty() && gpu_histograms != histograms) {
+    const double gpu_emd = MaxHistogramEmd(
+        &gpu_histograms[0], &gpu_histograms[CHANNELS * kNumHistogramBins],
+        width * height);
+    const double cpu_emd = MaxHistogramEmd(
+        &histograms[0], &histograms[CHANNELS * kNumHistogramBins],
+        width * height);
+    message_consumer_->Message(
+        MessageConsumer::Severity::kError,
+        assert_similar_emd_histogram->GetStartToken(),
+        "The histograms computed by a compute shader differ from those "
+        "computed on the CPU, with EMD values of " +
+            std::to_string(gpu_emd) + " and " + std::to_string(cpu_emd));
+    return false;
   }
+  return CheckHistogramEmd(assert_similar_emd_histogram, width * height,
+                           histograms);
+}
 
-  // Earth movers's distance: Calculate the minimal cost of moving "earth" to
-  // transform the first histogram into the second, where each bin of the
-  // histogram can be thought of as a column of units of earth. The cost is the
-  // amount of earth moved times the distance carried (the distance is the
-  // number of adjacent bins over which the earth is carried). Calculate this
-  // using the cumulative difference of the bins, which works as long as both
-  // histograms have the same amount of earth. Sum the absolute values of the
-  // cumulative difference to get the final cost of how much (and how far) the
-  // earth was moved.
-  double max_emd = 0;
-
-  for (size_t channel = 0; channel < 4; ++channel) {
-    double diff_total = 0;
-    double diff_accum = 0;
-
-    for (size_t i = 0; i < num_bins; ++i) {
-      double hist_normalized_0 = static_cast<double>(histogram[0][channel][i]) /
-                                 static_cast<double>(width[0] * height[0]);
-      double hist_normalized_1 = static_cast<double>(histogram[1][channel][i]) /
-                                 static_cast<double>(width[1] * height[1]);
-      diff_accum += hist_normalized_0 - hist_normalized_1;
-      diff_total += std::fabs(diff_accum);
-    }
-    // Normalize to range 0..1
-    double emd = diff_total / num_bins;
-    max_emd = std::max(max_emd, emd);
+bool Executor::ComputeHistogramsOnGpu(size_t width, size_t height,
+                                      std::vector<uint32_t>* histograms) {
+  histograms->assign(2 * CHANNELS * kNumHistogramBins, 0);
+  const size_t histograms_size_bytes = histograms->size() * sizeof(uint32_t);
+  if (histogram_program_ == 0) {
+    histogram_program_ = CreateInternalComputeProgram(kHistogramShaderText);
+    histogram_buffer_ = CreateInternalStorageBuffer(histograms_size_bytes);
+  }
+  CopyAttachmentsToComparisonTextures(width, height);
+  GL_SAFECALL(glBindBuffer, GL_SHADER_STORAGE_BUFFER, histogram_buffer_);
+  GL_SAFECALL(glBufferSubData, GL_SHADER_STORAGE_BUFFER, 0,
+              static_cast<GLsizeiptr>(histograms_size_bytes),
+              histograms->data());
+  DispatchInternalComputeProgram(histogram_program_, histogram_buffer_, width,
+                                 height, kHistogramLocalSizeX,
+                                 kHistogramLocalSizeY);
+
+  if (!FinishReadbacksBeforeReport()) {
+    return false;
   }
 
+  ReadInternalStorageBuffer(histogram_buffer_, histograms_size_bytes,
+                            histograms->data());
+  return true;
+}
+
+bool Executor::CheckHistogramEmd(
+    const CommandAssertSimilarEmdHistogram* assert_similar_emd_histogram,
+    size_t num_pixels, const std::vector<uint32_t>& histograms) {
+  const double max_emd =
+      MaxHistogramEmd(&histograms[0], &histograms[CHANNELS * kNumHistogramBins],
+                      num_pixels);
   if (max_emd >
       static_cast<double>(assert_similar_emd_histogram->GetTolerance())) {
     message_consumer_->Message(
@@ -256,172 +804,141 @@ bool Executor::VisitAssertSimilarEmdHistogram(
   return true;
 }
 
-bool Executor::VisitBindSampler(CommandBindSampler* bind_sampler) {
-  GL_SAFECALL(glBindSampler,
-              static_cast<GLuint>(bind_sampler->GetTextureUnit()),
-              created_samplers_.at(bind_sampler->GetSamplerIdentifier()));
-  return true;
-}
-
-bool Executor::VisitBindStorageBuffer(
-    CommandBindStorageBuffer* bind_storage_buffer) {
-  GL_SAFECALL(
-      glBindBufferBase, GL_SHADER_STORAGE_BUFFER,
-      static_cast<GLuint>(bind_storage_buffer->GetBinding()),
-      created_buffers_.at(bind_storage_buffer->GetStorageBufferIdentifier()));
-  return true;
-}
-
-bool Executor::VisitBindTexture(CommandBindTexture* bind_texture) {
-  GL_SAFECALL(
-      glActiveTexture,
-      GL_TEXTURE0 + static_cast<GLenum>(bind_texture->GetTextureUnit()));
-  GL_SAFECALL(glBindTexture, GL_TEXTURE_2D,
-              created_textures_.at(bind_texture->GetTextureIdentifier()));
-  return true;
-}
-
-bool Executor::VisitBindUniformBuffer(
-    CommandBindUniformBuffer* bind_uniform_buffer) {
-  GL_SAFECALL(
-      glBindBufferBase, GL_UNIFORM_BUFFER,
-      static_cast<GLuint>(bind_uniform_buffer->GetBinding()),
-      created_buffers_.at(bind_uniform_buffer->GetUniformBufferIdentifier()));
-  return true;
-}
-
-bool Executor::VisitCompileShader(CommandCompileShader* compile_shader) {
-  assert(declared_shaders_.count(compile_shader->GetShaderIdentifier()) == 1 &&
-         "Shader not declared.");
-  assert(compiled_shaders_.count(compile_shader->GetResultIdentifier()) == 0 &&
+bool Executor::ExecuteCompileShader(
+    const Instruction::CompileShaderOperands& operands) {
+  assert(!HasSlot(compiled_shaders_, operands.result_slot) &&
          "Identifier already in use for compiled shader.");
-  CommandDeclareShader* shader_declaration =
-      declared_shaders_.at(compile_shader->GetShaderIdentifier());
-  GLenum shader_kind = GL_NONE;
-  switch (shader_declaration->GetKind()) {
-    case CommandDeclareShader::Kind::VERTEX:
-      shader_kind = GL_VERTEX_SHADER;
-      break;
-    case CommandDeclareShader::Kind::FRAGMENT:
-      shader_kind = GL_FRAGMENT_SHADER;
-      break;
-    case CommandDeclareShader::Kind::COMPUTE:
-      shader_kind = GL_COMPUTE_SHADER;
-      break;
-  }
-  GLuint shader = glCreateShader(shader_kind);
+  const CommandDeclareShader* shader_declaration = operands.declaration;
+  GLuint shader = glCreateShader(operands.shader_kind);
   GL_CHECKERR("glCreateShader");
-  const char* temp = shader_declaration->GetShaderText().c_str();
-  GL_SAFECALL(glShaderSource, shader, 1, &temp, nullptr);
+  const char* text = shader_declaration->GetShaderTextData();
+  auto length = static_cast<GLint>(shader_declaration->GetShaderTextLength());
+  GL_SAFECALL(glShaderSource, shader, 1, &text, &length);
   GL_SAFECALL(glCompileShader, shader);
   GLint status = 0;
   GL_SAFECALL(glGetShaderiv, shader, GL_COMPILE_STATUS, &status);
   if (status == 0) {
+    if (!FinishReadbacksBeforeReport()) {
+      return false;
+    }
     PrintShaderError(shader);
     errcode_crash(COMPILE_ERROR_EXIT_CODE, "Shader compilation failed");
   }
-  compiled_shaders_.insert({compile_shader->GetResultIdentifier(), shader});
+  SetSlot(&compiled_shaders_, operands.result_slot, shader);
   return true;
 }
 
-bool Executor::VisitCreateBuffer(CommandCreateBuffer* create_buffer) {
+bool Executor::ExecuteCreateBuffer(
+    const Instruction::CreateBufferOperands& operands) {
+  const CommandCreateBuffer* create_buffer = operands.command;
   GLuint buffer;
   GL_SAFECALL(glGenBuffers, 1, &buffer);
   // We arbitrarily bind to the ARRAY_BUFFER target.
   GL_SAFECALL(glBindBuffer, GL_ARRAY_BUFFER, buffer);
-  if (create_buffer->HasInitialData()) {
+  if (create_buffer->HasInitialDataPattern()) {
+    GL_SAFECALL(glBufferData, GL_ARRAY_BUFFER,
+                static_cast<GLuint>(create_buffer->GetSizeBytes()), nullptr,
+                GL_STREAM_DRAW);
+    // The pattern is expanded straight into the buffer, a chunk at a time, so
+    // that no copy of the whole of the buffer's data is needed.
+    for (size_t offset = 0; offset < create_buffer->GetSizeBytes();
+         offset += kPatternChunkBytes) {
+      const size_t length =
+          std::min(kPatternChunkBytes, create_buffer->GetSizeBytes() - offset);
+      auto* mapped_buffer = static_cast<uint8_t*>(glMapBufferRange(
+          GL_ARRAY_BUFFER, static_cast<GLintptr>(offset),
+          static_cast<GLsizeiptr>(length),
+          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+      if (mapped_buffer == nullptr) {
+        GL_CHECKERR("glMapBufferRange");
+        if (!FinishReadbacksBeforeReport()) {
+          return false;
+        }
+        message_consumer_->Message(
+            MessageConsumer::Severity::kError, create_buffer->GetStartToken(),
+            "Failed to map " + create_buffer->GetResultIdentifier() +
+                " to initialize it");
+        return false;
+      }
+      create_buffer->ExpandInitialDataPattern(offset, length, mapped_buffer);
+      GL_SAFECALL(glUnmapBuffer, GL_ARRAY_BUFFER);
+    }
+  } else if (create_buffer->HasInitialData()) {
     GL_SAFECALL(glBufferData, GL_ARRAY_BUFFER,
                 static_cast<GLuint>(create_buffer->GetSizeBytes()),
-                create_buffer->GetInitialData().data(), GL_STREAM_DRAW);
+                create_buffer->GetInitialData(), GL_STREAM_DRAW);
   } else {
     GL_SAFECALL(glBufferData, GL_ARRAY_BUFFER,
                 static_cast<GLuint>(create_buffer->GetSizeBytes()), nullptr,
                 GL_STREAM_DRAW);
   }
-  created_buffers_.insert({create_buffer->GetResultIdentifier(), buffer});
-  return true;
-}
-
-bool Executor::VisitCreateSampler(CommandCreateSampler* create_sampler) {
-  GLuint sampler;
-  GL_SAFECALL(glGenSamplers, 1, &sampler);
-  created_samplers_.insert({create_sampler->GetResultIdentifier(), sampler});
+  SetSlot(&created_buffers_, operands.result_slot, buffer);
   return true;
 }
 
-bool Executor::VisitCreateEmptyTexture2D(
-    CommandCreateEmptyTexture2D* create_empty_texture_2d) {
+bool Executor::ExecuteCreateEmptyTexture2D(
+    const Instruction::CreateImageOperands& operands) {
   GLuint texture;
   GL_SAFECALL(glGenTextures, 1, &texture);
   GL_SAFECALL(glBindTexture, GL_TEXTURE_2D, texture);
-  GL_SAFECALL(glTexImage2D, GL_TEXTURE_2D, 0, GL_RGBA,
-              static_cast<GLsizei>(create_empty_texture_2d->GetWidth()),
-              static_cast<GLsizei>(create_empty_texture_2d->GetHeight()), 0,
-              GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-  created_textures_.insert(
-      {create_empty_texture_2d->GetResultIdentifier(), texture});
+  GL_SAFECALL(glTexImage2D, GL_TEXTURE_2D, 0, GL_RGBA, operands.width,
+              operands.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  SetSlot(&created_textures_, operands.result_slot, texture);
   return true;
 }
 
-bool Executor::VisitCreateProgram(CommandCreateProgram* create_program) {
-  assert(created_programs_.count(create_program->GetResultIdentifier()) == 0 &&
+bool Executor::ExecuteCreateProgram(
+    const Instruction::CreateProgramOperands& operands,
+    const LoweredProgram& lowered_program) {
+  assert(!HasSlot(created_programs_, operands.result_slot) &&
          "Identifier already in use for created program.");
   GLuint program = glCreateProgram();
   GL_CHECKERR("glCreateProgram");
   if (program == 0) {
     crash("glCreateProgram()");
   }
-  for (size_t index = 0; index < create_program->GetNumCompiledShaders();
+  for (size_t index = operands.first_compiled_shader;
+       index < operands.first_compiled_shader + operands.num_compiled_shaders;
        index++) {
-    assert(compiled_shaders_.count(
-               create_program->GetCompiledShaderIdentifier(index)) == 1 &&
-           "Compiled shader not found.");
-    GL_SAFECALL(glAttachShader, program,
-                compiled_shaders_.at(
-                    create_program->GetCompiledShaderIdentifier(index)));
+    GL_SAFECALL(
+        glAttachShader, program,
+        GetSlot(compiled_shaders_,
+                lowered_program.GetCompiledShaderSlot(index)));
   }
   GL_SAFECALL(glLinkProgram, program);
   GLint status = 0;
   GL_SAFECALL(glGetProgramiv, program, GL_LINK_STATUS, &status);
   if (status == 0) {
+    if (!FinishReadbacksBeforeReport()) {
+      return false;
+    }
     PrintProgramError(program);
     errcode_crash(LINK_ERROR_EXIT_CODE, "Program linking failed");
   }
-  created_programs_.insert({create_program->GetResultIdentifier(), program});
+  SetSlot(&created_programs_, operands.result_slot, program);
   return true;
 }
 
-bool Executor::VisitCreateRenderbuffer(
-    CommandCreateRenderbuffer* create_renderbuffer) {
+bool Executor::ExecuteCreateRenderbuffer(
+    const Instruction::CreateImageOperands& operands) {
   GLuint render_buffer;
   GL_SAFECALL(glGenRenderbuffers, 1, &render_buffer);
   GL_SAFECALL(glBindRenderbuffer, GL_RENDERBUFFER, render_buffer);
 
-  GL_SAFECALL(glRenderbufferStorage, GL_RENDERBUFFER, GL_RGBA8,
-              static_cast<GLsizei>(create_renderbuffer->GetWidth()),
-              static_cast<GLsizei>(create_renderbuffer->GetHeight()));
-  created_renderbuffers_.insert(
-      {create_renderbuffer->GetResultIdentifier(), render_buffer});
-  return true;
-}
-
-bool Executor::VisitDeclareShader(CommandDeclareShader* declare_shader) {
-  assert(declared_shaders_.count(declare_shader->GetResultIdentifier()) == 0 &&
-         "Shader with this name already declared.");
-  declared_shaders_.insert(
-      {declare_shader->GetResultIdentifier(), declare_shader});
+  GL_SAFECALL(glRenderbufferStorage, GL_RENDERBUFFER, GL_RGBA8, operands.width,
+              operands.height);
+  SetSlot(&created_renderbuffers_, operands.result_slot, render_buffer);
   return true;
 }
 
-bool Executor::VisitDumpRenderbuffer(
-    CommandDumpRenderbuffer* dump_renderbuffer) {
-  GLuint framebuffer_object_id;
-  GL_SAFECALL(glGenFramebuffers, 1, &framebuffer_object_id);
-  GL_SAFECALL(glBindFramebuffer, GL_FRAMEBUFFER, framebuffer_object_id);
-  GL_SAFECALL(glFramebufferRenderbuffer, GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-              GL_RENDERBUFFER,
-              created_renderbuffers_.at(
-                  dump_renderbuffer->GetRenderbufferIdentifier()));
+bool Executor::ExecuteDumpRenderbuffer(
+    const Instruction::DumpRenderbufferOperands& operands) {
+  const CommandDumpRenderbuffer* dump_renderbuffer = operands.command;
+  attached_images_.clear();
+  attached_images_.push_back(
+      {GL_COLOR_ATTACHMENT0, true,
+       GetSlot(created_renderbuffers_, operands.renderbuffer_slot)});
+  BindFramebuffer(attached_images_);
   size_t width;
   size_t height;
   {
@@ -434,181 +951,126 @@ bool Executor::VisitDumpRenderbuffer(
     width = static_cast<size_t>(temp_width);
     height = static_cast<size_t>(temp_height);
   }
+  return StartReadback(
+      1, width, height,
+      [this, dump_renderbuffer, width, height](const uint8_t* data) {
+        return WriteRenderbufferImage(dump_renderbuffer, width, height, data);
+      });
+}
 
-  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-  if (status != GL_FRAMEBUFFER_COMPLETE) {
-    crash(
-        "Problem with OpenGL framebuffer after specifying color render buffer: "
-        "n%xn",
-        status);
-  }
+bool Executor::WriteRenderbufferImage(
+    const CommandDumpRenderbuffer* dump_renderbuffer, size_t width,
+    size_t height, const uint8_t* data) {
+  image_writer_.Write(dump_renderbuffer->GetFilename(), dump_format_, width,
+                      height, data);
+  return true;
+}
 
-  std::vector<std::uint8_t> data(width * height * CHANNELS);
-  GL_SAFECALL(glReadBuffer, GL_COLOR_ATTACHMENT0);
-  GL_SAFECALL(glReadPixels, 0, 0, static_cast<GLint>(width),
-              static_cast<GLint>(height), GL_RGBA, GL_UNSIGNED_BYTE,
-              data.data());
-  std::vector<std::uint8_t> flipped_data(width * height * CHANNELS);
-  for (size_t h = 0; h < height; h++) {
-    for (size_t col = 0; col < width * CHANNELS; col++) {
-      flipped_data[h * width * CHANNELS + col] =
-          data[(height - h - 1) * width * CHANNELS + col];
-    }
+void Executor::FinishPendingWork() {
+  const bool readbacks_succeeded = FinishReadbacks(true);
+  std::string error;
+  if (!image_writer_.Wait(&error)) {
+    message_consumer_->Message(MessageConsumer::Severity::kError, nullptr,
+                               error);
   }
-  unsigned png_error = lodepng::encode(
-      dump_renderbuffer->GetFilename(), flipped_data,
-      static_cast<unsigned int>(width), static_cast<unsigned int>(height));
-  if (png_error != 0) {
-    crash("lodepng: %s", lodepng_error_text(png_error));
+  if (!readbacks_succeeded) {
+    // Whether the failure was found before the crash depends only on timing,
+    // so the crash is not reported, and the process exits with the status of
+    // a failed execution.
+    exit(EXIT_FAILURE);
   }
-  GL_SAFECALL(glDeleteFramebuffers, 1, &framebuffer_object_id);
-  return true;
 }
 
-bool Executor::VisitRunCompute(CommandRunCompute* run_compute) {
-  GL_SAFECALL(glMemoryBarrier, GL_ALL_BARRIER_BITS);
+void Executor::FinishPendingWorkBeforeCrash(void* executor) {
+  static_cast<Executor*>(executor)->FinishPendingWork();
+}
+
+void Executor::FinishImageWrites() {
+  std::string error;
+  if (!image_writer_.Wait(&error)) {
+    crash("%s", error.c_str());
+  }
+}
+
+bool Executor::ExecuteRunCompute(
+    const Instruction::RunComputeOperands& operands) {
+  if (memory_barriers_ == MemoryBarriers::kConservative) {
+    GL_SAFECALL(glMemoryBarrier, GL_ALL_BARRIER_BITS);
+  }
 
   GL_SAFECALL(glUseProgram,
-              created_programs_.at(run_compute->GetProgramIdentifier()));
+              GetSlot(created_programs_, operands.program_slot));
 
-  GL_SAFECALL(glDispatchCompute,
-              static_cast<GLuint>(run_compute->GetNumGroupsX()),
-              static_cast<GLuint>(run_compute->GetNumGroupsY()),
-              static_cast<GLuint>(run_compute->GetNumGroupsZ()));
+  GL_SAFECALL(glDispatchCompute, operands.num_groups_x, operands.num_groups_y,
+              operands.num_groups_z);
 
-  GL_SAFECALL_NO_ARGS(glFlush);
+  if (memory_barriers_ == MemoryBarriers::kConservative) {
+    GL_SAFECALL_NO_ARGS(glFlush);
+  }
 
   return true;
 }
 
-bool Executor::VisitRunGraphics(CommandRunGraphics* run_graphics) {
-  GL_SAFECALL(glMemoryBarrier, GL_ALL_BARRIER_BITS);
+bool Executor::ExecuteRunGraphics(
+    const Instruction::RunGraphicsOperands& operands,
+    const LoweredProgram& lowered_program) {
+  if (memory_barriers_ == MemoryBarriers::kConservative) {
+    GL_SAFECALL(glMemoryBarrier, GL_ALL_BARRIER_BITS);
+  }
 
-  auto vertex_data = run_graphics->GetVertexData();
-  for (const auto& entry : vertex_data) {
-    GL_SAFECALL(glBindBuffer, GL_ARRAY_BUFFER,
-                created_buffers_.at(entry.second.GetBufferIdentifier()));
-    GL_SAFECALL(glEnableVertexAttribArray, static_cast<GLuint>(entry.first));
-    GL_SAFECALL(glVertexAttribPointer, static_cast<GLuint>(entry.first),
-                static_cast<GLsizei>(entry.second.GetDimension()), GL_FLOAT,
-                GL_FALSE, static_cast<GLsizei>(entry.second.GetStrideBytes()),
-                reinterpret_cast<void*>(entry.second.GetOffsetBytes()));
+  vertex_array_state_.attributes.clear();
+  for (size_t index = operands.first_vertex_attribute;
+       index < operands.first_vertex_attribute + operands.num_vertex_attributes;
+       index++) {
+    const VertexAttribute& vertex_attribute =
+        lowered_program.GetVertexAttribute(index);
+    vertex_array_state_.attributes.push_back(
+        {vertex_attribute.location, vertex_attribute.dimension,
+         vertex_attribute.stride_bytes, vertex_attribute.offset_bytes,
+         GetSlot(created_buffers_, vertex_attribute.buffer_slot)});
   }
+  vertex_array_state_.index_buffer =
+      GetSlot(created_buffers_, operands.index_data_buffer_slot);
+  BindVertexArray(vertex_array_state_);
 
   GL_SAFECALL(glUseProgram,
-              created_programs_.at(run_graphics->GetProgramIdentifier()));
-
-  GLuint framebuffer_object_id;
-  GL_SAFECALL(glGenFramebuffers, 1, &framebuffer_object_id);
-  GL_SAFECALL(glBindFramebuffer, GL_FRAMEBUFFER, framebuffer_object_id);
+              GetSlot(created_programs_, operands.program_slot));
 
-  auto framebuffer_attachments = run_graphics->GetFramebufferAttachments();
-  assert(framebuffer_attachments.size() <= 32 && "Too many renderbuffers.");
-  size_t max_location = 0;
-  for (const auto& entry : framebuffer_attachments) {
-    max_location = std::max(max_location, entry.first);
-  }
-  std::vector<GLenum> draw_buffers;
-  for (size_t i = 0; i <= max_location; i++) {
-    if (framebuffer_attachments.count(i) > 0) {
-      GLenum color_attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(i);
-      auto output_buffer = framebuffer_attachments.at(i);
-      if (created_renderbuffers_.count(output_buffer) != 0) {
-        GL_SAFECALL(glFramebufferRenderbuffer, GL_FRAMEBUFFER, color_attachment,
-                    GL_RENDERBUFFER,
-                    created_renderbuffers_.at(framebuffer_attachments.at(i)));
-      } else {
-        GL_SAFECALL(glFramebufferTexture, GL_FRAMEBUFFER, color_attachment,
-                    created_textures_.at(framebuffer_attachments.at(i)), 0);
-      }
-      draw_buffers.push_back(color_attachment);
-    } else {
-      draw_buffers.push_back(GL_NONE);
-    }
-  }
-
-  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-  if (status != GL_FRAMEBUFFER_COMPLETE) {
-    crash(
-        "Problem with OpenGL framebuffer after specifying color render buffer: "
-        "n%xn",
-        status);
+  attached_images_.clear();
+  for (size_t index = operands.first_framebuffer_attachment;
+       index < operands.first_framebuffer_attachment +
+                   operands.num_framebuffer_attachments;
+       index++) {
+    const FramebufferAttachment& attachment =
+        lowered_program.GetFramebufferAttachment(index);
+    attached_images_.push_back(
+        {attachment.attachment, attachment.is_renderbuffer,
+         attachment.is_renderbuffer
+             ? GetSlot(created_renderbuffers_, attachment.slot)
+             : GetSlot(created_textures_, attachment.slot)});
   }
+  BindFramebuffer(attached_images_);
 
-  GL_SAFECALL(glDrawBuffers, static_cast<GLsizei>(draw_buffers.size()),
-              draw_buffers.data());
+  GL_SAFECALL(glDrawBuffers, static_cast<GLsizei>(operands.num_draw_buffers),
+              lowered_program.GetDrawBuffers(operands.first_draw_buffer));
 
   GL_SAFECALL(glClearColor, 0.0F, 0.0F, 0.0F, 1.0F);
   GL_SAFECALL(glClear, GL_COLOR_BUFFER_BIT);
 
-  GL_SAFECALL(
-      glBindBuffer, GL_ELEMENT_ARRAY_BUFFER,
-      created_buffers_.at(run_graphics->GetIndexDataBufferIdentifier()));
-  GLenum topology = GL_NONE;
-  switch (run_graphics->GetTopology()) {
-    case CommandRunGraphics::Topology::kTriangles:
-      topology = GL_TRIANGLES;
-      break;
-  }
-  GL_SAFECALL(glDrawElements, topology,
-              static_cast<GLsizei>(run_graphics->GetVertexCount()),
+  GL_SAFECALL(glDrawElements, operands.topology, operands.vertex_count,
               GL_UNSIGNED_INT, reinterpret_cast<GLvoid*>(0));
 
-  GL_SAFECALL_NO_ARGS(glFlush);
-
-  for (const auto& entry : run_graphics->GetVertexData()) {
-    GL_SAFECALL(glDisableVertexAttribArray, static_cast<GLuint>(entry.first));
-  }
-
-  GL_SAFECALL(glDeleteFramebuffers, 1, &framebuffer_object_id);
-  return true;
-}
-
-bool Executor::VisitSetSamplerOrTextureParameter(
-    CommandSetSamplerOrTextureParameter* set_sampler_or_texture_parameter) {
-  GLenum parameter = GL_NONE;
-  switch (set_sampler_or_texture_parameter->GetParameter()) {
-    case CommandSetSamplerOrTextureParameter::TextureParameter::kMagFilter:
-      parameter = GL_TEXTURE_MAG_FILTER;
-      break;
-    case CommandSetSamplerOrTextureParameter::TextureParameter::kMinFilter:
-      parameter = GL_TEXTURE_MIN_FILTER;
-      break;
-  }
-  GLint parameter_value = GL_NONE;
-  switch (set_sampler_or_texture_parameter->GetParameterValue()) {
-    case CommandSetSamplerOrTextureParameter::TextureParameterValue::kNearest:
-      parameter_value = GL_NEAREST;
-      break;
-    case CommandSetSamplerOrTextureParameter::TextureParameterValue::kLinear:
-      parameter_value = GL_LINEAR;
-      break;
-  }
-  if (created_samplers_.count(
-          set_sampler_or_texture_parameter->GetTargetTextureOrSampler()) > 0) {
-    GL_SAFECALL(
-        glSamplerParameteri,
-        created_samplers_.at(
-            set_sampler_or_texture_parameter->GetTargetTextureOrSampler()),
-        parameter, parameter_value);
-  } else {
-    assert(created_textures_.count(
-               set_sampler_or_texture_parameter->GetTargetTextureOrSampler()) >
-               0 &&
-           "Unknown texture or sampler.");
-    GL_SAFECALL(
-        glBindTexture, GL_TEXTURE_2D,
-        created_textures_.at(
-            set_sampler_or_texture_parameter->GetTargetTextureOrSampler()));
-    GL_SAFECALL(glTexParameteri, GL_TEXTURE_2D, parameter, parameter_value);
+  if (memory_barriers_ == MemoryBarriers::kConservative) {
+    GL_SAFECALL_NO_ARGS(glFlush);
   }
   return true;
 }
 
-bool Executor::VisitSetUniform(CommandSetUniform* set_uniform) {
-  GLuint program = created_programs_.at(set_uniform->GetProgramIdentifier());
-  auto uniform_location = static_cast<GLint>(set_uniform->GetLocation());
-  const UniformValue& uniform_value = set_uniform->GetValue();
+bool Executor::ExecuteSetUniform(
+    const Instruction::SetUniformOperands& operands) {
+  GLuint program = GetSlot(created_programs_, operands.program_slot);
+  GLint uniform_location = operands.location;
+  const UniformValue& uniform_value = operands.command->GetValue();
   switch (uniform_value.GetElementType()) {
     case UniformValue::ElementType::kFloat:
       if (uniform_value.IsArray()) {
@@ -672,19 +1134,87 @@ bool Executor::VisitSetUniform(CommandSetUniform* set_uniform) {
   return true;
 }
 
-bool Executor::CheckEqualRenderbuffers(CommandAssertEqual* assert_equal) {
-  assert(created_renderbuffers_.count(assert_equal->GetBufferIdentifier1()) !=
-             0 &&
-         "Expected a renderbuffer");
-  assert(created_renderbuffers_.count(assert_equal->GetBufferIdentifier2()) !=
-             0 &&
-         "Expected a renderbuffer");
+bool Executor::AttachedImage::operator<(const AttachedImage& other) const {
+  if (attachment != other.attachment) {
+    return attachment < other.attachment;
+  }
+  if (is_renderbuffer != other.is_renderbuffer) {
+    return is_renderbuffer < other.is_renderbuffer;
+  }
+  return object < other.object;
+}
+
+void Executor::BindFramebuffer(
+    const std::vector<AttachedImage>& attached_images) {
+  auto existing = framebuffers_.find(attached_images);
+  if (existing != framebuffers_.end()) {
+    GL_SAFECALL(glBindFramebuffer, GL_FRAMEBUFFER, existing->second);
+    return;
+  }
+  GLuint framebuffer_object_id;
+  GL_SAFECALL(glGenFramebuffers, 1, &framebuffer_object_id);
+  GL_SAFECALL(glBindFramebuffer, GL_FRAMEBUFFER, framebuffer_object_id);
+  for (const auto& attached_image : attached_images) {
+    if (attached_image.is_renderbuffer) {
+      GL_SAFECALL(glFramebufferRenderbuffer, GL_FRAMEBUFFER,
+                  attached_image.attachment, GL_RENDERBUFFER,
+                  attached_image.object);
+    } else {
+      GL_SAFECALL(glFramebufferTexture, GL_FRAMEBUFFER,
+                  attached_image.attachment, attached_image.object, 0);
+    }
+  }
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    crash(
+        "Problem with OpenGL framebuffer after specifying color render buffer: "
+        "n%xn",
+        status);
+  }
+  framebuffers_.insert({attached_images, framebuffer_object_id});
+}
 
+bool Executor::VertexArrayState::Attribute::operator<(
+    const Attribute& other) const {
+  return std::tie(location, dimension, stride_bytes, offset_bytes, buffer) <
+         std::tie(other.location, other.dimension, other.stride_bytes,
+                  other.offset_bytes, other.buffer);
+}
+
+bool Executor::VertexArrayState::operator<(
+    const VertexArrayState& other) const {
+  return std::tie(attributes, index_buffer) <
+         std::tie(other.attributes, other.index_buffer);
+}
+
+void Executor::BindVertexArray(const VertexArrayState& state) {
+  auto existing = vertex_arrays_.find(state);
+  if (existing != vertex_arrays_.end()) {
+    num_vertex_arrays_reused_++;
+    GL_SAFECALL(glBindVertexArray, existing->second);
+    return;
+  }
+  num_vertex_arrays_created_++;
+  GLuint vertex_array;
+  GL_SAFECALL(glGenVertexArrays, 1, &vertex_array);
+  GL_SAFECALL(glBindVertexArray, vertex_array);
+  for (const auto& attribute : state.attributes) {
+    GL_SAFECALL(glBindBuffer, GL_ARRAY_BUFFER, attribute.buffer);
+    GL_SAFECALL(glEnableVertexAttribArray, attribute.location);
+    GL_SAFECALL(glVertexAttribPointer, attribute.location, attribute.dimension,
+                GL_FLOAT, GL_FALSE, attribute.stride_bytes,
+                reinterpret_cast<void*>(attribute.offset_bytes));
+  }
+  GL_SAFECALL(glBindBuffer, GL_ELEMENT_ARRAY_BUFFER, state.index_buffer);
+  vertex_arrays_.insert({state, vertex_array});
+}
+
+bool Executor::CheckEqualRenderbuffers(
+    const Instruction::AssertEqualOperands& operands) {
+  const CommandAssertEqual* assert_equal = operands.command;
   GLuint renderbuffers[2];
-  renderbuffers[0] =
-      created_renderbuffers_.at(assert_equal->GetBufferIdentifier1());
-  renderbuffers[1] =
-      created_renderbuffers_.at(assert_equal->GetBufferIdentifier2());
+  renderbuffers[0] = GetSlot(created_renderbuffers_, operands.slot_1);
+  renderbuffers[1] = GetSlot(created_renderbuffers_, operands.slot_2);
 
   size_t width[2] = {0, 0};
   size_t height[2] = {0, 0};
@@ -705,6 +1235,11 @@ bool Executor::CheckEqualRenderbuffers(CommandAssertEqual* assert_equal) {
     }
   }
 
+  if ((width[0] != width[1] || height[0] != height[1]) &&
+      !FinishReadbacksBeforeReport()) {
+    return false;
+  }
+
   if (width[0] != width[1]) {
     std::stringstream stringstream;
     stringstream << "The widths of " << assert_equal->GetBufferIdentifier1()
@@ -727,79 +1262,267 @@ bool Executor::CheckEqualRenderbuffers(CommandAssertEqual* assert_equal) {
     return false;
   }
 
-  GLuint framebuffer_object_id;
-  GL_SAFECALL(glGenFramebuffers, 1, &framebuffer_object_id);
-  GL_SAFECALL(glBindFramebuffer, GL_FRAMEBUFFER, framebuffer_object_id);
+  attached_images_.clear();
   for (auto index : {0, 1}) {
-    GL_SAFECALL(glFramebufferRenderbuffer, GL_FRAMEBUFFER,
-                GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(index),
-                GL_RENDERBUFFER, renderbuffers[index]);
+    attached_images_.push_back(
+        {GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(index), true,
+         renderbuffers[index]});
   }
-  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-  if (status != GL_FRAMEBUFFER_COMPLETE) {
-    crash(
-        "Problem with OpenGL framebuffer after specifying color render buffer: "
-        "n%xn",
-        status);
+  BindFramebuffer(attached_images_);
+  const size_t common_width = width[0];
+  const size_t common_height = height[0];
+  if (renderbuffer_comparison_ == RenderbufferComparison::kOnGpu &&
+      ComputeShadersAreAvailable()) {
+    return CompareRenderbuffersOnGpu(assert_equal, common_width,
+                                     common_height);
   }
+  return StartReadback(
+      2, common_width, common_height,
+      [this, assert_equal, common_width, common_height](const uint8_t* pixels) {
+        return ExamineEqualRenderbuffers(assert_equal, common_width,
+                                         common_height, pixels);
+      });
+}
+
+bool Executor::ExamineEqualRenderbuffers(const CommandAssertEqual* assert_equal,
+                                         size_t width, size_t height,
+                                         const uint8_t* pixels) {
+  ImageComparison comparison =
+      CompareImages(pixels, pixels + width * height * CHANNELS, width, height,
+                    kMaxReportedMismatches);
+  if (comparison.num_mismatches == 0) {
+    return true;
+  }
+  ReportImageComparison(assert_equal, comparison);
+  return false;
+}
 
-  std::vector<std::uint8_t> data[2];
+void Executor::ReportImageComparison(const CommandAssertEqual* assert_equal,
+                                     const ImageComparison& comparison) {
+  for (const auto& mismatch : comparison.first_mismatches) {
+    std::stringstream stringstream;
+    stringstream << "Pixel mismatch at position (" << mismatch.x << ", "
+                 << mismatch.y << "): " << assert_equal->GetBufferIdentifier1()
+                 << "[" << mismatch.x << "][" << mismatch.y << "] == ("
+                 << static_cast<uint32_t>(mismatch.pixel_1[0]) << ", "
+                 << static_cast<uint32_t>(mismatch.pixel_1[1]) << ", "
+                 << static_cast<uint32_t>(mismatch.pixel_1[2]) << ", "
+                 << static_cast<uint32_t>(mismatch.pixel_1[3]) << "), vs. "
+                 << assert_equal->GetBufferIdentifier2() << "[" << mismatch.x
+                 << "][" << mismatch.y << "] == ("
+                 << static_cast<uint32_t>(mismatch.pixel_2[0]) << ", "
+                 << static_cast<uint32_t>(mismatch.pixel_2[1]) << ", "
+                 << static_cast<uint32_t>(mismatch.pixel_2[2]) << ", "
+                 << static_cast<uint32_t>(mismatch.pixel_2[3]) << ")";
+    message_consumer_->Message(MessageConsumer::Severity::kError,
+                               assert_equal->GetStartToken(),
+                               stringstream.str());
+  }
+  std::stringstream stringstream;
+  stringstream << assert_equal->GetBufferIdentifier1() << " and "
+               << assert_equal->GetBufferIdentifier2() << " differ at "
+               << comparison.num_mismatches
+               << " pixels, all within the rectangle from (" << comparison.min_x
+               << ", " << comparison.min_y << ") to (" << comparison.max_x
+               << ", " << comparison.max_y
+               << "); the largest differences per channel are ("
+               << static_cast<uint32_t>(comparison.max_channel_delta[0]) << ", "
+               << static_cast<uint32_t>(comparison.max_channel_delta[1]) << ", "
+               << static_cast<uint32_t>(comparison.max_channel_delta[2]) << ", "
+               << static_cast<uint32_t>(comparison.max_channel_delta[3])
+               << ")";
+  message_consumer_->Message(MessageConsumer::Severity::kError,
+                             assert_equal->GetStartToken(), stringstream.str());
+}
+
+GLuint Executor::CreateInternalComputeProgram(const char* shader_text) {
+  GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+  GL_CHECKERR("glCreateShader");
+  GL_SAFECALL(glShaderSource, shader, 1, &shader_text, nullptr);
+  GL_SAFECALL(glCompileShader, shader);
+  GLint status = 0;
+  GL_SAFECALL(glGetShaderiv, shader, GL_COMPILE_STATUS, &status);
+  if (status == 0) {
+    FinishPendingWork();
+    PrintShaderError(shader);
+    crash("%s", "Compilation of an internal compute shader failed");
+  }
+  GLuint program = glCreateProgram();
+  GL_CHECKERR("glCreateProgram");
+  GL_SAFECALL(glAttachShader, program, shader);
+  GL_SAFECALL(glLinkProgram, program);
+  GL_SAFECALL(glGetProgramiv, program, GL_LINK_STATUS, &status);
+  if (status == 0) {
+    FinishPendingWork();
+    PrintProgramError(program);
+    crash("%s", "Linking of an internal compute program failed");
+  }
+  GL_SAFECALL(glDeleteShader, shader);
+  return program;
+}
+
+GLuint Executor::CreateInternalStorageBuffer(size_t size_bytes) {
+  GLuint buffer;
+  GL_SAFECALL(glGenBuffers, 1, &buffer);
+  GL_SAFECALL(glBindBuffer, GL_SHADER_STORAGE_BUFFER, buffer);
+  GL_SAFECALL(glBufferData, GL_SHADER_STORAGE_BUFFER,
+              static_cast<GLsizeiptr>(size_bytes), nullptr, GL_DYNAMIC_READ);
+  return buffer;
+}
+
+void Executor::CopyAttachmentsToComparisonTextures(size_t width,
+                                                   size_t height) {
+  // Compute shaders cannot read renderbuffers, so their contents are copied
+  // into the textures. The texture binding that this disturbs, including by
+  // replacing the textures, is restored.
+  GLint saved_texture;
+  GL_SAFECALL(glGetIntegerv, GL_TEXTURE_BINDING_2D, &saved_texture);
+  if (width != comparison_texture_width_ ||
+      height != comparison_texture_height_) {
+    // Image units require textures with immutable storage, so the textures
+    // are replaced, rather than resized, when the size of the renderbuffers
+    // that are compared changes.
+    if (comparison_textures_[0] != 0) {
+      GL_SAFECALL(glDeleteTextures, 2, comparison_textures_);
+    }
+    GL_SAFECALL(glGenTextures, 2, comparison_textures_);
+    for (auto texture : comparison_textures_) {
+      GL_SAFECALL(glBindTexture, GL_TEXTURE_2D, texture);
+      GL_SAFECALL(glTexStorage2D, GL_TEXTURE_2D, 1, GL_RGBA8,
+                  static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+    }
+    comparison_texture_width_ = width;
+    comparison_texture_height_ = height;
+  }
   for (auto index : {0, 1}) {
-    data[index].resize(width[index] * height[index] * CHANNELS);
     GL_SAFECALL(glReadBuffer,
                 GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(index));
-    GL_SAFECALL(glReadPixels, 0, 0, static_cast<GLsizei>(width[index]),
-                static_cast<GLsizei>(height[index]), GL_RGBA, GL_UNSIGNED_BYTE,
-                data[index].data());
-  }
-
-  bool result = true;
-  for (size_t y = 0; y < static_cast<size_t>(height[0]); y++) {
-    for (size_t x = 0; x < static_cast<size_t>(width[0]); x++) {
-      size_t offset = (static_cast<size_t>(height[0]) - y - 1) *
-                          static_cast<size_t>(width[0]) * 4 +
-                      x * 4;
-      bool all_match = true;
-      for (size_t component = 0; component < 4; component++) {
-        if (data[0][offset + component] != data[1][offset + component]) {
-          all_match = false;
-          break;
-        }
-      }
-      if (!all_match) {
-        std::stringstream stringstream;
-        stringstream << "Pixel mismatch at position (" << x << ", " << y
-                     << "): " << assert_equal->GetBufferIdentifier1() << "["
-                     << x << "][" << y << "] == ("
-                     << static_cast<uint32_t>(data[0][offset]) << ", "
-                     << static_cast<uint32_t>(data[0][offset + 1]) << ", "
-                     << static_cast<uint32_t>(data[0][offset + 2]) << ", "
-                     << static_cast<uint32_t>(data[0][offset + 3]) << "), vs. "
-                     << assert_equal->GetBufferIdentifier2() << "[" << x << "]["
-                     << y << "] == (" << static_cast<uint32_t>(data[1][offset])
-                     << ", " << static_cast<uint32_t>(data[1][offset + 1])
-                     << ", " << static_cast<uint32_t>(data[1][offset + 2])
-                     << ", " << static_cast<uint32_t>(data[1][offset + 3])
-                     << ")";
-        message_consumer_->Message(MessageConsumer::Severity::kError,
-                                   assert_equal->GetStartToken(),
-                                   stringstream.str());
-        result = false;
+    GL_SAFECALL(glBindTexture, GL_TEXTURE_2D, comparison_textures_[index]);
+    GL_SAFECALL(glCopyTexSubImage2D, GL_TEXTURE_2D, 0, 0, 0, 0, 0,
+                static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+    GL_SAFECALL(glBindImageTexture, static_cast<GLuint>(index),
+                comparison_textures_[index], 0, GL_FALSE, 0, GL_READ_ONLY,
+                GL_RGBA8);
+  }
+  GL_SAFECALL(glBindTexture, GL_TEXTURE_2D, static_cast<GLuint>(saved_texture));
+}
+
+void Executor::DispatchInternalComputeProgram(GLuint program,
+                                              GLuint storage_buffer,
+                                              size_t width, size_t height,
+                                              size_t local_size_x,
+                                              size_t local_size_y) {
+  // The storage buffer binding that this disturbs is restored; the program
+  // binding is set afresh by every command that needs it.
+  GLint saved_storage_buffer;
+  GL_SAFECALL(glGetIntegeri_v, GL_SHADER_STORAGE_BUFFER_BINDING, 0,
+              &saved_storage_buffer);
+  GL_SAFECALL(glBindBufferBase, GL_SHADER_STORAGE_BUFFER, 0, storage_buffer);
+  GL_SAFECALL(glUseProgram, program);
+  GL_SAFECALL(glDispatchCompute,
+              static_cast<GLuint>((width + local_size_x - 1) / local_size_x),
+              static_cast<GLuint>((height + local_size_y - 1) / local_size_y),
+              1);
+  GL_SAFECALL(glBindBufferBase, GL_SHADER_STORAGE_BUFFER, 0,
+              static_cast<GLuint>(saved_storage_buffer));
+  GL_SAFECALL(glMemoryBarrier, GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+void Executor::ReadInternalStorageBuffer(GLuint storage_buffer,
+                                         size_t size_bytes, void* data) {
+  GL_SAFECALL(glBindBuffer, GL_SHADER_STORAGE_BUFFER, storage_buffer);
+  const void* mapped_buffer =
+      glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0,
+                       static_cast<GLsizeiptr>(size_bytes), GL_MAP_READ_BIT);
+  GL_CHECKERR("glMapBufferRange");
+  if (mapped_buffer == nullptr) {
+    crash("%s", "Failed to map an internal storage buffer");
+  }
+  std::memcpy(data, mapped_buffer, size_bytes);
+  GL_SAFECALL(glUnmapBuffer, GL_SHADER_STORAGE_BUFFER);
+}
+
+bool Executor::CompareRenderbuffersOnGpu(const CommandAssertEqual* assert_equal,
+                                         size_t width, size_t height) {
+  if (comparison_program_ == 0) {
+    comparison_program_ = CreateInternalComputeProgram(kComparisonShaderText);
+    comparison_result_buffer_ =
+        CreateInternalStorageBuffer(sizeof(ComparisonResult));
+  }
+  CopyAttachmentsToComparisonTextures(width, height);
+
+  const uint32_t initial_header[9] = {0, UINT32_MAX, UINT32_MAX, 0, 0,
+                                      0, 0,          0,          0};
+  GL_SAFECALL(glBindBuffer, GL_SHADER_STORAGE_BUFFER,
+              comparison_result_buffer_);
+  GL_SAFECALL(glBufferSubData, GL_SHADER_STORAGE_BUFFER, 0,
+              static_cast<GLsizeiptr>(sizeof(initial_header)), initial_header);
+  DispatchInternalComputeProgram(comparison_program_,
+                                 comparison_result_buffer_, width, height,
+                                 kComparisonLocalSize, kComparisonLocalSize);
+
+  if (!FinishReadbacksBeforeReport()) {
+    return false;
+  }
+
+  ComparisonResult result;
+  ReadInternalStorageBuffer(comparison_result_buffer_,
+                            sizeof(ComparisonResult), &result);
+
+  if (result.num_mismatches == 0) {
+    return true;
+  }
+  // The shader works in OpenGL's coordinates, with y increasing upwards.
+  ImageComparison comparison = {result.num_mismatches,
+                                result.min_x,
+                                height - 1 - result.max_y,
+                                result.max_x,
+                                height - 1 - result.min_y,
+                                {},
+                                {}};
+  for (size_t channel = 0; channel < 4; channel++) {
+    comparison.max_channel_delta[channel] =
+        static_cast<uint8_t>(result.max_channel_delta[channel]);
+  }
+  // If every mismatch was recorded, the first of them can be reported just
+  // as a full readback would report them. Otherwise which of them were
+  // recorded depends on scheduling, so only the summary, which does not, is
+  // reported.
+  if (result.num_mismatches <= kMaxRecordedMismatches) {
+    for (uint32_t index = 0; index < result.num_mismatches; index++) {
+      const uint32_t* recorded = result.mismatches[index];
+      PixelMismatch mismatch = {recorded[0], height - 1 - recorded[1], {}, {}};
+      for (size_t channel = 0; channel < 4; channel++) {
+        mismatch.pixel_1[channel] =
+            static_cast<uint8_t>(recorded[2] >> (8 * channel));
+        mismatch.pixel_2[channel] =
+            static_cast<uint8_t>(recorded[3] >> (8 * channel));
       }
+      comparison.first_mismatches.push_back(mismatch);
+    }
+    std::sort(comparison.first_mismatches.begin(),
+              comparison.first_mismatches.end(),
+              [](const PixelMismatch& first, const PixelMismatch& second) {
+                return std::make_pair(first.y, first.x) <
+                       std::make_pair(second.y, second.x);
+              });
+    if (comparison.first_mismatches.size() > kMaxReportedMismatches) {
+      comparison.first_mismatches.resize(kMaxReportedMismatches);
     }
   }
-  return result;
+  ReportImageComparison(assert_equal, comparison);
+  return false;
 }
 
-bool Executor::CheckEqualBuffers(CommandAssertEqual* assert_equal) {
-  assert(created_buffers_.count(assert_equal->GetBufferIdentifier1()) != 0 &&
-         "Expected a buffer");
-  assert(created_buffers_.count(assert_equal->GetBufferIdentifier2()) != 0 &&
-         "Expected a buffer");
-
+bool Executor::CheckEqualBuffers(
+    const Instruction::AssertEqualOperands& operands) {
+  if (!FinishReadbacksBeforeReport()) {
+    return false;
+  }
+  const CommandAssertEqual* assert_equal = operands.command;
   GLuint buffers[2];
-  buffers[0] = created_buffers_.at(assert_equal->GetBufferIdentifier1());
-  buffers[1] = created_buffers_.at(assert_equal->GetBufferIdentifier2());
+  buffers[0] = GetSlot(created_buffers_, operands.slot_1);
+  buffers[1] = GetSlot(created_buffers_, operands.slot_2);
 
   GLint64 buffer_size[2]{0, 0};
   for (auto index : {0, 1}) {
@@ -834,27 +1557,38 @@ bool Executor::CheckEqualBuffers(CommandAssertEqual* assert_equal) {
     }
   }
 
-  bool result = true;
-  for (size_t index = 0; index < static_cast<size_t>(buffer_size[0]); index++) {
-    // We only get here if the calls to glMapBufferRange succeeded, in which
-    // case the contents of |mapped_buffer| cannot be null.
-    uint8_t value_1 =
-        mapped_buffer[0][index];  // NOLINT(clang-analyzer-core.NullDereference)
-    uint8_t value_2 =
-        mapped_buffer[1][index];  // NOLINT(clang-analyzer-core.NullDereference)
-    if (value_1 != value_2) {
-      std::stringstream stringstream;
-      stringstream << "Byte mismatch at index " << index << ": "
-                   << assert_equal->GetBufferIdentifier1() << "[" << index
-                   << "] == " << static_cast<uint32_t>(value_1) << ", "
-                   << assert_equal->GetBufferIdentifier2() << "[" << index
-                   << "] == " << static_cast<uint32_t>(value_2);
-      message_consumer_->Message(MessageConsumer::Severity::kError,
-                                 assert_equal->GetStartToken(),
-                                 stringstream.str());
-      result = false;
-    }
+  // We only get here if the calls to glMapBufferRange succeeded, in which
+  // case the contents of |mapped_buffer| cannot be null.
+  BufferComparison comparison = CompareBuffers(
+      mapped_buffer[0], mapped_buffer[1], static_cast<size_t>(buffer_size[0]),
+      kMaxReportedMismatches);
+  for (const auto& mismatch : comparison.first_mismatches) {
+    std::stringstream stringstream;
+    stringstream << "Byte mismatch at index " << mismatch.index << ": "
+                 << assert_equal->GetBufferIdentifier1() << "["
+                 << mismatch.index
+                 << "] == " << static_cast<uint32_t>(mismatch.value_1) << ", "
+                 << assert_equal->GetBufferIdentifier2() << "["
+                 << mismatch.index
+                 << "] == " << static_cast<uint32_t>(mismatch.value_2);
+    message_consumer_->Message(MessageConsumer::Severity::kError,
+                               assert_equal->GetStartToken(),
+                               stringstream.str());
+  }
+  if (comparison.num_mismatches > 0) {
+    std::stringstream stringstream;
+    stringstream << assert_equal->GetBufferIdentifier1() << " and "
+                 << assert_equal->GetBufferIdentifier2() << " differ at "
+                 << comparison.num_mismatches
+                 << " bytes, all between indices " << comparison.first_index
+                 << " and " << comparison.last_index
+                 << "; the largest difference is "
+                 << static_cast<uint32_t>(comparison.max_delta);
+    message_consumer_->Message(MessageConsumer::Severity::kError,
+                               assert_equal->GetStartToken(),
+                               stringstream.str());
   }
+  const bool result = comparison.num_mismatches == 0;
 
   for (auto index : {0, 1}) {
     GL_SAFECALL(glBindBuffer, GL_ARRAY_BUFFER, buffers[index]);
@@ -0,0 +1,40 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libshadertrap/file_cache.h"
+
+#include <utility>
+
+namespace shadertrap {
+
+FileCache::FileCache() = default;
+
+FileCache::~FileCache() = default;
+
+std::shared_ptr<const SourceBuffer> FileCache::Load(
+    const std::string& filename, std::string* error_message) {
+  auto existing = files_.find(filename);
+  if (existing != files_.end()) {
+    return existing->second;
+  }
+  std::shared_ptr<const SourceBuffer> file =
+      SourceBuffer::FromFile(filename, error_message);
+  if (file == nullptr) {
+    return nullptr;
+  }
+  files_.insert({filename, file});
+  return file;
+}
+
+}  // namespace shadertrap
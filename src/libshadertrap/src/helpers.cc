@@ -19,6 +19,34 @@
 
 namespace shadertrap {
 
+namespace {
+
+bool gl_errors_checked_per_call = true;
+
+void (*crash_cleanup)(void* context) = nullptr;
+void* crash_cleanup_context = nullptr;
+
+}  // namespace
+
+void SetCrashCleanup(void (*cleanup)(void* context), void* context) {
+  crash_cleanup = cleanup;
+  crash_cleanup_context = context;
+}
+
+void RunCrashCleanup() {
+  void (*cleanup)(void* context) = crash_cleanup;
+  crash_cleanup = nullptr;
+  if (cleanup != nullptr) {
+    cleanup(crash_cleanup_context);
+  }
+}
+
+bool GlErrorsCheckedPerCall() { return gl_errors_checked_per_call; }
+
+void SetGlErrorsCheckedPerCall(bool checked) {
+  gl_errors_checked_per_call = checked;
+}
+
 std::string OpenglErrorString(GLenum err) {
   switch (err) {
     case GL_INVALID_ENUM:
@@ -0,0 +1,188 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libshadertrap/image_writer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include "lodepng/lodepng.h"
+
+namespace shadertrap {
+
+namespace {
+
+// How many images may be queued per thread before Write blocks, which bounds
+// the memory held by copies of images.
+const size_t kMaxQueuedJobsPerThread = 2;
+
+std::string WriteFile(const std::string& filename, const std::string& header,
+                      const std::vector<uint8_t>& data) {
+  std::ofstream file(filename, std::ios::binary);
+  file.write(header.data(), static_cast<std::streamsize>(header.size()));
+  file.write(reinterpret_cast<const char*>(data.data()),
+             static_cast<std::streamsize>(data.size()));
+  file.close();
+  if (!file) {
+    return "Could not write '" + filename + "'";
+  }
+  return "";
+}
+
+}  // namespace
+
+ImageWriter::ImageWriter() : stopping_(false) {}
+
+ImageWriter::~ImageWriter() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_progressed_.wait(lock, [this]() {
+      return jobs_.empty() && files_in_progress_.empty();
+    });
+    stopping_ = true;
+  }
+  job_queued_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ImageWriter::Write(const std::string& filename, Format format,
+                        size_t width, size_t height, const uint8_t* pixels) {
+  Job job = {filename, format, width, height, {}};
+  job.pixels.resize(width * height * 4);
+  const size_t row_bytes = width * 4;
+  // Rows are addressed through data() rather than operator[], as the pixels
+  // are empty for an image with no columns.
+  for (size_t row = 0; row < height; row++) {
+    std::memcpy(job.pixels.data() + row * row_bytes,
+                pixels + (height - row - 1) * row_bytes, row_bytes);
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (threads_.empty()) {
+      const size_t num_threads =
+          std::max<size_t>(std::thread::hardware_concurrency(), 1);
+      for (size_t i = 0; i < num_threads; i++) {
+        threads_.emplace_back(&ImageWriter::Work, this);
+      }
+    }
+    job_progressed_.wait(lock, [this]() {
+      return jobs_.size() < kMaxQueuedJobsPerThread * threads_.size();
+    });
+    jobs_.push_back(std::move(job));
+  }
+  job_queued_.notify_one();
+}
+
+bool ImageWriter::Wait(std::string* error) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_progressed_.wait(lock, [this]() {
+    return jobs_.empty() && files_in_progress_.empty();
+  });
+  if (first_error_.empty()) {
+    return true;
+  }
+  *error = std::move(first_error_);
+  first_error_.clear();
+  return false;
+}
+
+void ImageWriter::Work() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      job_queued_.wait(lock, [this]() {
+        return stopping_ || FindStartableJob() != jobs_.end();
+      });
+      auto startable_job = FindStartableJob();
+      if (startable_job == jobs_.end()) {
+        return;
+      }
+      job = std::move(*startable_job);
+      jobs_.erase(startable_job);
+      files_in_progress_.insert(job.filename);
+    }
+    job_progressed_.notify_all();
+    std::string error = WriteJob(job);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (first_error_.empty()) {
+        first_error_ = std::move(error);
+      }
+      files_in_progress_.erase(job.filename);
+    }
+    job_progressed_.notify_all();
+    job_queued_.notify_all();
+  }
+}
+
+std::deque<ImageWriter::Job>::iterator ImageWriter::FindStartableJob() {
+  return std::find_if(jobs_.begin(), jobs_.end(), [this](const Job& job) {
+    return files_in_progress_.count(job.filename) == 0;
+  });
+}
+
+std::string ImageWriter::WriteJob(const Job& job) {
+  switch (job.format) {
+    case Format::kPng: {
+      unsigned png_error = lodepng::encode(
+          job.filename, job.pixels, static_cast<unsigned int>(job.width),
+          static_cast<unsigned int>(job.height));
+      if (png_error != 0) {
+        return std::string("lodepng: ") + lodepng_error_text(png_error);
+      }
+      return "";
+    }
+    case Format::kFastPng: {
+      lodepng::State state;
+      // The image is written as RGBA, as it is given, rather than analyzed for
+      // a smaller color type, and every row is left unfiltered.
+      state.encoder.auto_convert = 0;
+      state.encoder.filter_strategy = LFS_ZERO;
+      state.encoder.zlibsettings.windowsize = 512;
+      state.encoder.zlibsettings.nicematch = 32;
+      state.encoder.zlibsettings.lazymatching = 0;
+      std::vector<unsigned char> png;
+      unsigned png_error = lodepng::encode(
+          png, job.pixels, static_cast<unsigned int>(job.width),
+          static_cast<unsigned int>(job.height), state);
+      if (png_error == 0) {
+        png_error = lodepng::save_file(png, job.filename);
+      }
+      if (png_error != 0) {
+        return std::string("lodepng: ") + lodepng_error_text(png_error);
+      }
+      return "";
+    }
+    case Format::kRawRgba:
+      return WriteFile(job.filename, "", job.pixels);
+    case Format::kPpm: {
+      std::vector<uint8_t> rgb(job.width * job.height * 3);
+      for (size_t pixel = 0; pixel < job.width * job.height; pixel++) {
+        std::memcpy(&rgb[pixel * 3], &job.pixels[pixel * 4], 3);
+      }
+      return WriteFile(job.filename,
+                       "P6\n" + std::to_string(job.width) + " " +
+                           std::to_string(job.height) + "\n255\n",
+                       rgb);
+    }
+  }
+  return "Unknown image format";
+}
+
+}  // namespace shadertrap
@@ -0,0 +1,35 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libshadertrap/lowered_program.h"
+
+#include <utility>
+
+namespace shadertrap {
+
+LoweredProgram::LoweredProgram(
+    std::vector<Instruction> instructions,
+    std::vector<const Token*> instruction_tokens,
+    std::vector<size_t> compiled_shader_slots,
+    std::vector<VertexAttribute> vertex_attributes,
+    std::vector<FramebufferAttachment> framebuffer_attachments,
+    std::vector<GLenum> draw_buffers)
+    : instructions_(std::move(instructions)),
+      instruction_tokens_(std::move(instruction_tokens)),
+      compiled_shader_slots_(std::move(compiled_shader_slots)),
+      vertex_attributes_(std::move(vertex_attributes)),
+      framebuffer_attachments_(std::move(framebuffer_attachments)),
+      draw_buffers_(std::move(draw_buffers)) {}
+
+}  // namespace shadertrap
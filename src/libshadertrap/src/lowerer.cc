@@ -0,0 +1,440 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libshadertrap/lowerer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "libshadertrap/make_unique.h"
+#include "libshadertrap/vertex_attribute_info.h"
+
+namespace shadertrap {
+
+namespace {
+
+Instruction MakeInstruction(Instruction::Opcode opcode) {
+  Instruction result{};
+  result.opcode = opcode;
+  return result;
+}
+
+// The barrier bits for every kind of access that the commands of a program
+// can make to a buffer. Shaders cannot write to textures or renderbuffers
+// other than by rendering to them, which needs no barrier.
+const GLbitfield kBufferBarrierBits =
+    GL_SHADER_STORAGE_BARRIER_BIT | GL_UNIFORM_BARRIER_BIT |
+    GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT |
+    GL_BUFFER_UPDATE_BARRIER_BIT;
+
+}  // namespace
+
+bool Lowerer::VisitAssertEqual(CommandAssertEqual* assert_equal) {
+  const bool is_renderbuffer =
+      renderbuffer_slots_.count(assert_equal->GetBufferSlot1()) != 0;
+  if (!is_renderbuffer) {
+    // The buffers are mapped and read synchronously.
+    OrderBufferAccesses(*assert_equal,
+                        {{assert_equal->GetBufferSlot1(),
+                          GL_BUFFER_UPDATE_BARRIER_BIT, false},
+                         {assert_equal->GetBufferSlot2(),
+                          GL_BUFFER_UPDATE_BARRIER_BIT, false}},
+                        true);
+  }
+  auto instruction =
+      MakeInstruction(is_renderbuffer
+                          ? Instruction::Opcode::kAssertEqualRenderbuffers
+                          : Instruction::Opcode::kAssertEqualBuffers);
+  instruction.assert_equal.command = assert_equal;
+  instruction.assert_equal.slot_1 = assert_equal->GetBufferSlot1();
+  instruction.assert_equal.slot_2 = assert_equal->GetBufferSlot2();
+  AddInstruction(*assert_equal, instruction);
+  return true;
+}
+
+bool Lowerer::VisitAssertPixels(CommandAssertPixels* assert_pixels) {
+  auto instruction = MakeInstruction(Instruction::Opcode::kAssertPixels);
+  instruction.assert_pixels.command = assert_pixels;
+  instruction.assert_pixels.renderbuffer_slot =
+      assert_pixels->GetRenderbufferSlot();
+  AddInstruction(*assert_pixels, instruction);
+  return true;
+}
+
+bool Lowerer::VisitAssertSimilarEmdHistogram(
+    CommandAssertSimilarEmdHistogram* assert_similar_emd_histogram) {
+  auto instruction =
+      MakeInstruction(Instruction::Opcode::kAssertSimilarEmdHistogram);
+  instruction.assert_similar_emd_histogram.command =
+      assert_similar_emd_histogram;
+  instruction.assert_similar_emd_histogram.renderbuffer_slot_1 =
+      assert_similar_emd_histogram->GetBufferSlot1();
+  instruction.assert_similar_emd_histogram.renderbuffer_slot_2 =
+      assert_similar_emd_histogram->GetBufferSlot2();
+  AddInstruction(*assert_similar_emd_histogram, instruction);
+  return true;
+}
+
+bool Lowerer::VisitBindSampler(CommandBindSampler* bind_sampler) {
+  auto instruction = MakeInstruction(Instruction::Opcode::kBindSampler);
+  instruction.bind_sampler.texture_unit =
+      static_cast<GLuint>(bind_sampler->GetTextureUnit());
+  instruction.bind_sampler.sampler_slot = bind_sampler->GetSamplerSlot();
+  AddInstruction(*bind_sampler, instruction);
+  return true;
+}
+
+bool Lowerer::VisitBindStorageBuffer(
+    CommandBindStorageBuffer* bind_storage_buffer) {
+  storage_buffer_bindings_[static_cast<GLuint>(
+      bind_storage_buffer->GetBinding())] =
+      bind_storage_buffer->GetStorageBufferSlot();
+  auto instruction = MakeInstruction(Instruction::Opcode::kBindBufferBase);
+  instruction.bind_buffer_base.target = GL_SHADER_STORAGE_BUFFER;
+  instruction.bind_buffer_base.binding =
+      static_cast<GLuint>(bind_storage_buffer->GetBinding());
+  instruction.bind_buffer_base.buffer_slot =
+      bind_storage_buffer->GetStorageBufferSlot();
+  AddInstruction(*bind_storage_buffer, instruction);
+  return true;
+}
+
+bool Lowerer::VisitBindTexture(CommandBindTexture* bind_texture) {
+  auto instruction = MakeInstruction(Instruction::Opcode::kBindTexture);
+  instruction.bind_texture.texture_unit =
+      GL_TEXTURE0 + static_cast<GLenum>(bind_texture->GetTextureUnit());
+  instruction.bind_texture.texture_slot = bind_texture->GetTextureSlot();
+  AddInstruction(*bind_texture, instruction);
+  return true;
+}
+
+bool Lowerer::VisitBindUniformBuffer(
+    CommandBindUniformBuffer* bind_uniform_buffer) {
+  uniform_buffer_bindings_[static_cast<GLuint>(
+      bind_uniform_buffer->GetBinding())] =
+      bind_uniform_buffer->GetUniformBufferSlot();
+  auto instruction = MakeInstruction(Instruction::Opcode::kBindBufferBase);
+  instruction.bind_buffer_base.target = GL_UNIFORM_BUFFER;
+  instruction.bind_buffer_base.binding =
+      static_cast<GLuint>(bind_uniform_buffer->GetBinding());
+  instruction.bind_buffer_base.buffer_slot =
+      bind_uniform_buffer->GetUniformBufferSlot();
+  AddInstruction(*bind_uniform_buffer, instruction);
+  return true;
+}
+
+bool Lowerer::VisitCompileShader(CommandCompileShader* compile_shader) {
+  assert(declared_shaders_.count(compile_shader->GetShaderSlot()) != 0 &&
+         "Shader not declared.");
+  const CommandDeclareShader* declaration =
+      declared_shaders_.at(compile_shader->GetShaderSlot());
+  auto instruction = MakeInstruction(Instruction::Opcode::kCompileShader);
+  instruction.compile_shader.declaration = declaration;
+  switch (declaration->GetKind()) {
+    case CommandDeclareShader::Kind::VERTEX:
+      instruction.compile_shader.shader_kind = GL_VERTEX_SHADER;
+      break;
+    case CommandDeclareShader::Kind::FRAGMENT:
+      instruction.compile_shader.shader_kind = GL_FRAGMENT_SHADER;
+      break;
+    case CommandDeclareShader::Kind::COMPUTE:
+      instruction.compile_shader.shader_kind = GL_COMPUTE_SHADER;
+      break;
+  }
+  instruction.compile_shader.result_slot = compile_shader->GetResultSlot();
+  AddInstruction(*compile_shader, instruction);
+  return true;
+}
+
+bool Lowerer::VisitCreateBuffer(CommandCreateBuffer* create_buffer) {
+  auto instruction = MakeInstruction(Instruction::Opcode::kCreateBuffer);
+  instruction.create_buffer.command = create_buffer;
+  instruction.create_buffer.result_slot = create_buffer->GetResultSlot();
+  AddInstruction(*create_buffer, instruction);
+  return true;
+}
+
+bool Lowerer::VisitCreateSampler(CommandCreateSampler* create_sampler) {
+  sampler_slots_.insert(create_sampler->GetResultSlot());
+  auto instruction = MakeInstruction(Instruction::Opcode::kCreateSampler);
+  instruction.create_sampler.result_slot = create_sampler->GetResultSlot();
+  AddInstruction(*create_sampler, instruction);
+  return true;
+}
+
+bool Lowerer::VisitCreateEmptyTexture2D(
+    CommandCreateEmptyTexture2D* create_empty_texture_2d) {
+  auto instruction =
+      MakeInstruction(Instruction::Opcode::kCreateEmptyTexture2D);
+  instruction.create_image.width =
+      static_cast<GLsizei>(create_empty_texture_2d->GetWidth());
+  instruction.create_image.height =
+      static_cast<GLsizei>(create_empty_texture_2d->GetHeight());
+  instruction.create_image.result_slot =
+      create_empty_texture_2d->GetResultSlot();
+  AddInstruction(*create_empty_texture_2d, instruction);
+  return true;
+}
+
+bool Lowerer::VisitCreateProgram(CommandCreateProgram* create_program) {
+  auto instruction = MakeInstruction(Instruction::Opcode::kCreateProgram);
+  instruction.create_program.first_compiled_shader =
+      compiled_shader_slots_.size();
+  instruction.create_program.num_compiled_shaders =
+      create_program->GetNumCompiledShaders();
+  instruction.create_program.result_slot = create_program->GetResultSlot();
+  for (size_t index = 0; index < create_program->GetNumCompiledShaders();
+       index++) {
+    compiled_shader_slots_.push_back(
+        create_program->GetCompiledShaderSlot(index));
+  }
+  AddInstruction(*create_program, instruction);
+  return true;
+}
+
+bool Lowerer::VisitCreateRenderbuffer(
+    CommandCreateRenderbuffer* create_renderbuffer) {
+  renderbuffer_slots_.insert(create_renderbuffer->GetResultSlot());
+  auto instruction = MakeInstruction(Instruction::Opcode::kCreateRenderbuffer);
+  instruction.create_image.width =
+      static_cast<GLsizei>(create_renderbuffer->GetWidth());
+  instruction.create_image.height =
+      static_cast<GLsizei>(create_renderbuffer->GetHeight());
+  instruction.create_image.result_slot = create_renderbuffer->GetResultSlot();
+  AddInstruction(*create_renderbuffer, instruction);
+  return true;
+}
+
+bool Lowerer::VisitDeclareShader(CommandDeclareShader* declare_shader) {
+  // Declaring a shader does no work of its own: the declaration is referred
+  // to by the instructions that compile it.
+  declared_shaders_.insert({declare_shader->GetResultSlot(), declare_shader});
+  return true;
+}
+
+bool Lowerer::VisitDumpRenderbuffer(
+    CommandDumpRenderbuffer* dump_renderbuffer) {
+  auto instruction = MakeInstruction(Instruction::Opcode::kDumpRenderbuffer);
+  instruction.dump_renderbuffer.command = dump_renderbuffer;
+  instruction.dump_renderbuffer.renderbuffer_slot =
+      dump_renderbuffer->GetRenderbufferSlot();
+  AddInstruction(*dump_renderbuffer, instruction);
+  return true;
+}
+
+bool Lowerer::VisitRunCompute(CommandRunCompute* run_compute) {
+  OrderBufferAccesses(*run_compute, GetShaderBufferAccesses({}), false);
+  auto instruction = MakeInstruction(Instruction::Opcode::kRunCompute);
+  instruction.run_compute.program_slot = run_compute->GetProgramSlot();
+  instruction.run_compute.num_groups_x =
+      static_cast<GLuint>(run_compute->GetNumGroupsX());
+  instruction.run_compute.num_groups_y =
+      static_cast<GLuint>(run_compute->GetNumGroupsY());
+  instruction.run_compute.num_groups_z =
+      static_cast<GLuint>(run_compute->GetNumGroupsZ());
+  AddInstruction(*run_compute, instruction);
+  return true;
+}
+
+bool Lowerer::VisitRunGraphics(CommandRunGraphics* run_graphics) {
+  std::vector<BufferAccess> fetches;
+  fetches.push_back({run_graphics->GetIndexDataBufferSlot(),
+                     GL_ELEMENT_ARRAY_BARRIER_BIT, false});
+  for (const auto& entry : run_graphics->GetVertexData()) {
+    fetches.push_back({run_graphics->GetVertexBufferSlot(entry.first),
+                       GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT, false});
+  }
+  OrderBufferAccesses(*run_graphics,
+                      GetShaderBufferAccesses(std::move(fetches)), false);
+  auto instruction = MakeInstruction(Instruction::Opcode::kRunGraphics);
+  instruction.run_graphics.program_slot = run_graphics->GetProgramSlot();
+  instruction.run_graphics.index_data_buffer_slot =
+      run_graphics->GetIndexDataBufferSlot();
+  switch (run_graphics->GetTopology()) {
+    case CommandRunGraphics::Topology::kTriangles:
+      instruction.run_graphics.topology = GL_TRIANGLES;
+      break;
+  }
+  instruction.run_graphics.vertex_count =
+      static_cast<GLsizei>(run_graphics->GetVertexCount());
+
+  instruction.run_graphics.first_vertex_attribute = vertex_attributes_.size();
+  for (const auto& entry : run_graphics->GetVertexData()) {
+    VertexAttribute vertex_attribute{};
+    vertex_attribute.location = static_cast<GLuint>(entry.first);
+    vertex_attribute.dimension =
+        static_cast<GLint>(entry.second.GetDimension());
+    vertex_attribute.stride_bytes =
+        static_cast<GLsizei>(entry.second.GetStrideBytes());
+    vertex_attribute.offset_bytes = entry.second.GetOffsetBytes();
+    vertex_attribute.buffer_slot =
+        run_graphics->GetVertexBufferSlot(entry.first);
+    vertex_attributes_.push_back(vertex_attribute);
+  }
+  // The attributes are put in order of location, so that draws with the same
+  // vertex data lower to the same attributes, in the same order.
+  std::sort(vertex_attributes_.begin() +
+                static_cast<std::ptrdiff_t>(
+                    instruction.run_graphics.first_vertex_attribute),
+            vertex_attributes_.end(),
+            [](const VertexAttribute& first, const VertexAttribute& second) {
+              return first.location < second.location;
+            });
+  instruction.run_graphics.num_vertex_attributes =
+      run_graphics->GetVertexData().size();
+
+  // There is a draw buffer for each location up to the greatest that has an
+  // attachment; it is GL_NONE for locations that have none.
+  const auto& attachments = run_graphics->GetFramebufferAttachments();
+  assert(attachments.size() <= 32 && "Too many renderbuffers.");
+  size_t max_location = 0;
+  for (const auto& entry : attachments) {
+    max_location = std::max(max_location, entry.first);
+  }
+  instruction.run_graphics.first_framebuffer_attachment =
+      framebuffer_attachments_.size();
+  instruction.run_graphics.first_draw_buffer = draw_buffers_.size();
+  for (size_t location = 0; location <= max_location; location++) {
+    if (attachments.count(location) == 0) {
+      draw_buffers_.push_back(GL_NONE);
+      continue;
+    }
+    FramebufferAttachment attachment{};
+    attachment.attachment =
+        GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(location);
+    attachment.slot = run_graphics->GetFramebufferAttachmentSlot(location);
+    attachment.is_renderbuffer =
+        renderbuffer_slots_.count(attachment.slot) != 0;
+    framebuffer_attachments_.push_back(attachment);
+    draw_buffers_.push_back(attachment.attachment);
+  }
+  instruction.run_graphics.num_framebuffer_attachments =
+      framebuffer_attachments_.size() -
+      instruction.run_graphics.first_framebuffer_attachment;
+  instruction.run_graphics.num_draw_buffers =
+      draw_buffers_.size() - instruction.run_graphics.first_draw_buffer;
+  AddInstruction(*run_graphics, instruction);
+  return true;
+}
+
+bool Lowerer::VisitSetSamplerOrTextureParameter(
+    CommandSetSamplerOrTextureParameter* set_sampler_or_texture_parameter) {
+  const size_t target =
+      set_sampler_or_texture_parameter->GetTargetTextureOrSamplerSlot();
+  auto instruction =
+      MakeInstruction(sampler_slots_.count(target) != 0
+                          ? Instruction::Opcode::kSetSamplerParameter
+                          : Instruction::Opcode::kSetTextureParameter);
+  instruction.set_parameter.target_slot = target;
+  switch (set_sampler_or_texture_parameter->GetParameter()) {
+    case CommandSetSamplerOrTextureParameter::TextureParameter::kMagFilter:
+      instruction.set_parameter.parameter = GL_TEXTURE_MAG_FILTER;
+      break;
+    case CommandSetSamplerOrTextureParameter::TextureParameter::kMinFilter:
+      instruction.set_parameter.parameter = GL_TEXTURE_MIN_FILTER;
+      break;
+  }
+  switch (set_sampler_or_texture_parameter->GetParameterValue()) {
+    case CommandSetSamplerOrTextureParameter::TextureParameterValue::kNearest:
+      instruction.set_parameter.parameter_value = GL_NEAREST;
+      break;
+    case CommandSetSamplerOrTextureParameter::TextureParameterValue::kLinear:
+      instruction.set_parameter.parameter_value = GL_LINEAR;
+      break;
+  }
+  AddInstruction(*set_sampler_or_texture_parameter, instruction);
+  return true;
+}
+
+bool Lowerer::VisitSetUniform(CommandSetUniform* set_uniform) {
+  auto instruction = MakeInstruction(Instruction::Opcode::kSetUniform);
+  instruction.set_uniform.command = set_uniform;
+  instruction.set_uniform.program_slot = set_uniform->GetProgramSlot();
+  instruction.set_uniform.location =
+      static_cast<GLint>(set_uniform->GetLocation());
+  AddInstruction(*set_uniform, instruction);
+  return true;
+}
+
+std::vector<Lowerer::BufferAccess> Lowerer::GetShaderBufferAccesses(
+    std::vector<BufferAccess> other_accesses) const {
+  std::vector<BufferAccess> result;
+  for (const auto& entry : storage_buffer_bindings_) {
+    result.push_back({entry.second, GL_SHADER_STORAGE_BARRIER_BIT, true});
+  }
+  for (const auto& entry : uniform_buffer_bindings_) {
+    result.push_back({entry.second, GL_UNIFORM_BARRIER_BIT, false});
+  }
+  result.insert(result.end(), other_accesses.begin(), other_accesses.end());
+  return result;
+}
+
+void Lowerer::OrderBufferAccesses(const Command& command,
+                                  const std::vector<BufferAccess>& accesses,
+                                  bool is_synchronous) {
+  GLbitfield barriers = 0;
+  for (const auto& access : accesses) {
+    auto hazards = buffer_hazards_.find(access.buffer_slot);
+    if (hazards == buffer_hazards_.end()) {
+      continue;
+    }
+    // Read after write, or write after write.
+    barriers |= hazards->second.unordered_write_barriers & access.barrier_bit;
+    // Write after read.
+    if (access.is_shader_write &&
+        hazards->second.accessed_since_storage_barrier) {
+      barriers |= GL_SHADER_STORAGE_BARRIER_BIT;
+    }
+  }
+  if (barriers != 0) {
+    auto instruction = MakeInstruction(Instruction::Opcode::kMemoryBarrier);
+    instruction.memory_barrier.barriers = barriers;
+    AddInstruction(command, instruction);
+    // The barrier orders all earlier accesses, not just those of this command.
+    for (auto& entry : buffer_hazards_) {
+      entry.second.unordered_write_barriers &= ~barriers;
+      if ((barriers & GL_SHADER_STORAGE_BARRIER_BIT) != 0) {
+        entry.second.accessed_since_storage_barrier = false;
+      }
+    }
+  }
+  for (const auto& access : accesses) {
+    BufferHazards& hazards = buffer_hazards_[access.buffer_slot];
+    if (access.is_shader_write) {
+      hazards.unordered_write_barriers = kBufferBarrierBits;
+    }
+    if (!is_synchronous) {
+      hazards.accessed_since_storage_barrier = true;
+    }
+  }
+}
+
+void Lowerer::AddInstruction(const Command& command,
+                             const Instruction& instruction) {
+  instructions_.push_back(instruction);
+  instruction_tokens_.push_back(command.GetStartToken());
+}
+
+std::unique_ptr<LoweredProgram> Lowerer::GetLoweredProgram() {
+  return MakeUnique<LoweredProgram>(
+      std::move(instructions_), std::move(instruction_tokens_),
+      std::move(compiled_shader_slots_),
+      std::move(vertex_attributes_), std::move(framebuffer_attachments_),
+      std::move(draw_buffers_));
+}
+
+}  // namespace shadertrap
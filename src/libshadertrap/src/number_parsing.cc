@@ -0,0 +1,169 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libshadertrap/number_parsing.h"
+
+#include <cmath>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <string>
+
+namespace shadertrap {
+
+namespace {
+
+// Powers of ten that are exactly representable as doubles.
+const double kExactPowersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                    1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                    1e18, 1e19, 1e20, 1e21, 1e22};
+
+const size_t kMaxExactPowerOfTen =
+    sizeof(kExactPowersOfTen) / sizeof(kExactPowersOfTen[0]) - 1;
+
+// Powers of ten up to this are also exactly representable as floats.
+const size_t kMaxExactFloatPowerOfTen = 10;
+
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+// Used for the rare literals whose value cannot be computed exactly from a
+// mantissa and a power of ten. The stream is given the classic locale, so that
+// '.' is always the decimal separator.
+bool ParseFloatLiteralSlow(const char* text, size_t length, float* result) {
+  std::istringstream stream(std::string(text, length));
+  stream.imbue(std::locale::classic());
+  stream >> *result;
+  return !stream.fail();
+}
+
+// Determines whether |value| lies exactly halfway between two adjacent
+// floats, in which case rounding it to float can differ from rounding the
+// exact decimal value that it approximates.
+bool IsFloatMidpoint(double value) {
+  const auto rounded = static_cast<float>(value);
+  const auto rounded_as_double = static_cast<double>(rounded);
+  if (rounded_as_double == value) {
+    return false;
+  }
+  const float towards = value > rounded_as_double
+                           ? std::numeric_limits<float>::max()
+                           : std::numeric_limits<float>::lowest();
+  const float neighbour = std::nextafter(rounded, towards);
+  return (rounded_as_double + static_cast<double>(neighbour)) / 2.0 == value;
+}
+
+}  // namespace
+
+bool ParseIntLiteral(const char* text, size_t length, int64_t* result) {
+  size_t position = 0;
+  const bool negative = length > 0 && text[0] == '-';
+  if (negative) {
+    position++;
+  }
+  if (position == length) {
+    return false;
+  }
+  // The magnitude of the most negative value is one more than that of the
+  // most positive value.
+  const uint64_t limit =
+      static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) +
+      (negative ? 1U : 0U);
+  uint64_t magnitude = 0;
+  for (; position < length; position++) {
+    if (!IsDigit(text[position])) {
+      return false;
+    }
+    const auto digit = static_cast<uint64_t>(text[position] - '0');
+    if (magnitude > (limit - digit) / 10) {
+      return false;
+    }
+    magnitude = magnitude * 10 + digit;
+  }
+  if (!negative) {
+    *result = static_cast<int64_t>(magnitude);
+  } else if (magnitude == limit) {
+    *result = std::numeric_limits<int64_t>::min();
+  } else {
+    *result = -static_cast<int64_t>(magnitude);
+  }
+  return true;
+}
+
+bool ParseFloatLiteral(const char* text, size_t length, float* result) {
+  size_t position = 0;
+  const bool negative = length > 0 && text[0] == '-';
+  if (negative) {
+    position++;
+  }
+  // The literal is read as an integer mantissa and a count of the digits that
+  // follow the decimal point.
+  uint64_t mantissa = 0;
+  size_t fraction_digits = 0;
+  size_t digits = 0;
+  bool seen_point = false;
+  bool mantissa_overflowed = false;
+  for (; position < length; position++) {
+    const char c = text[position];
+    if (c == '.') {
+      if (seen_point) {
+        return false;
+      }
+      seen_point = true;
+      continue;
+    }
+    if (!IsDigit(c)) {
+      return false;
+    }
+    digits++;
+    if (mantissa > (std::numeric_limits<uint64_t>::max() - 9) / 10) {
+      mantissa_overflowed = true;
+      continue;
+    }
+    mantissa = mantissa * 10 + static_cast<uint64_t>(c - '0');
+    if (seen_point) {
+      fraction_digits++;
+    }
+  }
+  if (digits == 0) {
+    return false;
+  }
+  if (mantissa_overflowed) {
+    return ParseFloatLiteralSlow(text, length, result);
+  }
+  // When the mantissa and the power of ten are both exactly representable, a
+  // single correctly-rounded division gives the correctly-rounded result.
+  float value;
+  if (mantissa <= (1U << 24U) && fraction_digits <= kMaxExactFloatPowerOfTen) {
+    value = static_cast<float>(mantissa) /
+            static_cast<float>(kExactPowersOfTen[fraction_digits]);
+  } else if (mantissa <= (1ULL << 53U) &&
+             fraction_digits <= kMaxExactPowerOfTen) {
+    // The same holds in double precision, and rounding the double to float
+    // then gives the correctly-rounded float, unless the double is exactly
+    // halfway between two floats.
+    const double double_value = static_cast<double>(mantissa) /
+                                kExactPowersOfTen[fraction_digits];
+    if (IsFloatMidpoint(double_value)) {
+      return ParseFloatLiteralSlow(text, length, result);
+    }
+    value = static_cast<float>(double_value);
+  } else {
+    return ParseFloatLiteralSlow(text, length, result);
+  }
+  *result = negative ? -value : value;
+  return true;
+}
+
+}  // namespace shadertrap
@@ -14,8 +14,11 @@
 
 #include "libshadertrap/parser.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
-#include <set>
+#include <cstdint>
+#include <cstring>
 #include <sstream>
 #include <unordered_map>
 #include <utility>
@@ -40,19 +43,50 @@
 #include "libshadertrap/command_set_sampler_or_texture_parameter.h"
 #include "libshadertrap/command_set_uniform.h"
 #include "libshadertrap/make_unique.h"
+#include "libshadertrap/number_parsing.h"
 #include "libshadertrap/token.h"
 #include "libshadertrap/tokenizer.h"
 
 namespace shadertrap {
 
+namespace {
+
+// The most parameters that a command can take; ParseParameters() tracks the
+// parameters it has seen using a 32-bit mask.
+const size_t kMaxParameters = 32;
+
+// Appends the bytes of |value| to |data|, in host byte order.
+template <typename T>
+void AppendBytes(T value, std::vector<uint8_t>* data) {
+  const size_t offset = data->size();
+  data->resize(offset + sizeof(T));
+  memcpy(data->data() + offset, &value, sizeof(T));
+}
+
+}  // namespace
+
 Parser::Parser(const std::string& input, MessageConsumer* message_consumer)
-    : tokenizer_(MakeUnique<Tokenizer>(input)),
+    : Parser(MakeUnique<SourceBuffer>(input), message_consumer) {}
+
+Parser::Parser(std::unique_ptr<SourceBuffer> source,
+               MessageConsumer* message_consumer)
+    : Parser(std::move(source), nullptr, message_consumer) {}
+
+Parser::Parser(std::unique_ptr<SourceBuffer> source, FileCache* file_cache,
+               MessageConsumer* message_consumer)
+    : source_(std::move(source)),
+      arena_(MakeUnique<Arena>()),
+      owned_file_cache_(file_cache == nullptr ? MakeUnique<FileCache>()
+                                              : nullptr),
+      file_cache_(file_cache == nullptr ? owned_file_cache_.get()
+                                        : file_cache),
+      tokenizer_(MakeUnique<Tokenizer>(source_.get())),
       message_consumer_(message_consumer) {}
 
 Parser::~Parser() = default;
 
 bool Parser::Parse() {
-  while (!tokenizer_->PeekNextToken()->IsEOS()) {
+  while (!tokenizer_->PeekNextToken().IsEOS()) {
     if (!ParseCommand()) {
       return false;
     }
@@ -62,7 +96,7 @@ bool Parser::Parse() {
 
 bool Parser::ParseCommand() {
   auto token = tokenizer_->PeekNextToken();
-  switch (token->GetType()) {
+  switch (token.GetType()) {
     case Token::Type::kKeywordAssertEqual:
       return ParseCommandAssertEqual();
     case Token::Type::kKeywordAssertPixels:
@@ -103,8 +137,8 @@ bool Parser::ParseCommand() {
     case Token::Type::kKeywordSetUniform:
       return ParseCommandSetUniform();
     default:
-      message_consumer_->Message(MessageConsumer::Severity::kError, token.get(),
-                                 "Unknown command: '" + token->GetText() + "'");
+      message_consumer_->Message(MessageConsumer::Severity::kError, &token,
+                                 "Unknown command: '" + token.GetText() + "'");
       return false;
   }
 }
@@ -116,31 +150,31 @@ bool Parser::ParseCommandAssertEqual() {
   if (!ParseParameters({{Token::Type::kKeywordBuffer1,
                          [this, &buffer_identifier_1]() -> bool {
                            auto token = tokenizer_->NextToken();
-                           if (!token->IsIdentifier()) {
+                           if (!token.IsIdentifier()) {
                              message_consumer_->Message(
-                                 MessageConsumer::Severity::kError, token.get(),
+                                 MessageConsumer::Severity::kError, &token,
                                  "Expected identifier for first renderbuffer "
                                  "to be compared");
                            }
-                           buffer_identifier_1 = token->GetText();
+                           buffer_identifier_1 = token.GetText();
                            return true;
                          }},
                         {Token::Type::kKeywordBuffer2,
                          [this, &buffer_identifier_2]() -> bool {
                            auto token = tokenizer_->NextToken();
-                           if (!token->IsIdentifier()) {
+                           if (!token.IsIdentifier()) {
                              message_consumer_->Message(
-                                 MessageConsumer::Severity::kError, token.get(),
+                                 MessageConsumer::Severity::kError, &token,
                                  "Expected identifier for second renderbuffer "
                                  "to be compared");
                            }
-                           buffer_identifier_2 = token->GetText();
+                           buffer_identifier_2 = token.GetText();
                            return true;
                          }}})) {
     return false;
   }
-  parsed_commands_.push_back(MakeUnique<CommandAssertEqual>(
-      std::move(start_token), buffer_identifier_1, buffer_identifier_2));
+  parsed_commands_.push_back(arena_->New<CommandAssertEqual>(
+      RetainToken(start_token), buffer_identifier_1, buffer_identifier_2));
   return true;
 }
 
@@ -183,13 +217,13 @@ bool Parser::ParseCommandAssertPixels() {
                         {Token::Type::kKeywordRenderbuffer,
                          [this, &renderbuffer_identifier]() -> bool {
                            auto token = tokenizer_->NextToken();
-                           if (!token->IsIdentifier()) {
+                           if (!token.IsIdentifier()) {
                              message_consumer_->Message(
-                                 MessageConsumer::Severity::kError, token.get(),
+                                 MessageConsumer::Severity::kError, &token,
                                  "Expected renderbuffer identifier");
                              return false;
                            }
-                           renderbuffer_identifier = token->GetText();
+                           renderbuffer_identifier = token.GetText();
                            return true;
                          }},
                         {Token::Type::kKeywordRectangle,
@@ -219,8 +253,8 @@ bool Parser::ParseCommandAssertPixels() {
                          }}})) {
     return false;
   }
-  parsed_commands_.push_back(MakeUnique<CommandAssertPixels>(
-      std::move(start_token), expected_r, expected_g, expected_b, expected_a,
+  parsed_commands_.push_back(arena_->New<CommandAssertPixels>(
+      RetainToken(start_token), expected_r, expected_g, expected_b, expected_a,
       renderbuffer_identifier, rectangle_x, rectangle_y, rectangle_width,
       rectangle_height));
   return true;
@@ -235,23 +269,23 @@ bool Parser::ParseCommandAssertSimilarEmdHistogram() {
           {{Token::Type::kKeywordBuffer1,
             [this, &buffer_identifier_1]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (!token->IsIdentifier()) {
+              if (!token.IsIdentifier()) {
                 message_consumer_->Message(
-                    MessageConsumer::Severity::kError, token.get(),
+                    MessageConsumer::Severity::kError, &token,
                     "Expected identifier for first buffer to be compared");
               }
-              buffer_identifier_1 = token->GetText();
+              buffer_identifier_1 = token.GetText();
               return true;
             }},
            {Token::Type::kKeywordBuffer2,
             [this, &buffer_identifier_2]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (!token->IsIdentifier()) {
+              if (!token.IsIdentifier()) {
                 message_consumer_->Message(
-                    MessageConsumer::Severity::kError, token.get(),
+                    MessageConsumer::Severity::kError, &token,
                     "Expected identifier for second buffer to be compared");
               }
-              buffer_identifier_2 = token->GetText();
+              buffer_identifier_2 = token.GetText();
               return true;
             }},
            {Token::Type::kKeywordTolerance, [this, &tolerance]() -> bool {
@@ -264,8 +298,8 @@ bool Parser::ParseCommandAssertSimilarEmdHistogram() {
             }}})) {
     return false;
   }
-  parsed_commands_.push_back(MakeUnique<CommandAssertSimilarEmdHistogram>(
-      std::move(start_token), buffer_identifier_1, buffer_identifier_2,
+  parsed_commands_.push_back(arena_->New<CommandAssertSimilarEmdHistogram>(
+      RetainToken(start_token), buffer_identifier_1, buffer_identifier_2,
       tolerance));
   return true;
 }
@@ -278,14 +312,14 @@ bool Parser::ParseCommandBindSampler() {
           {{Token::Type::kKeywordSampler,
             [this, &sampler_identifier]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (!token->IsIdentifier()) {
+              if (!token.IsIdentifier()) {
                 message_consumer_->Message(
-                    MessageConsumer::Severity::kError, token.get(),
+                    MessageConsumer::Severity::kError, &token,
                     "Expected identifier for the sampler being bound, got '" +
-                        token->GetText() + "'");
+                        token.GetText() + "'");
                 return false;
               }
-              sampler_identifier = token->GetText();
+              sampler_identifier = token.GetText();
               return true;
             }},
            {Token::Type::kKeywordTextureUnit, [this, &texture_unit]() -> bool {
@@ -298,8 +332,8 @@ bool Parser::ParseCommandBindSampler() {
             }}})) {
     return false;
   }
-  parsed_commands_.push_back(MakeUnique<CommandBindSampler>(
-      std::move(start_token), sampler_identifier, texture_unit));
+  parsed_commands_.push_back(arena_->New<CommandBindSampler>(
+      RetainToken(start_token), sampler_identifier, texture_unit));
   return true;
 }
 
@@ -311,14 +345,14 @@ bool Parser::ParseCommandBindStorageBuffer() {
           {{Token::Type::kKeywordBuffer,
             [this, &buffer_identifier]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (!token->IsIdentifier()) {
+              if (!token.IsIdentifier()) {
                 message_consumer_->Message(
-                    MessageConsumer::Severity::kError, token.get(),
+                    MessageConsumer::Severity::kError, &token,
                     "Expected identifier for storage buffer, got '" +
-                        token->GetText() + "'");
+                        token.GetText() + "'");
                 return false;
               }
-              buffer_identifier = token->GetText();
+              buffer_identifier = token.GetText();
               return true;
             }},
            {Token::Type::kKeywordBinding, [this, &binding]() -> bool {
@@ -331,8 +365,8 @@ bool Parser::ParseCommandBindStorageBuffer() {
             }}})) {
     return false;
   }
-  parsed_commands_.push_back(MakeUnique<CommandBindStorageBuffer>(
-      std::move(start_token), buffer_identifier, binding));
+  parsed_commands_.push_back(arena_->New<CommandBindStorageBuffer>(
+      RetainToken(start_token), buffer_identifier, binding));
   return true;
 }
 
@@ -344,14 +378,14 @@ bool Parser::ParseCommandBindTexture() {
           {{Token::Type::kKeywordTexture,
             [this, &texture_identifier]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (!token->IsIdentifier()) {
+              if (!token.IsIdentifier()) {
                 message_consumer_->Message(
-                    MessageConsumer::Severity::kError, token.get(),
+                    MessageConsumer::Severity::kError, &token,
                     "Expected identifier for the sampler being bound, got '" +
-                        token->GetText() + "'");
+                        token.GetText() + "'");
                 return false;
               }
-              texture_identifier = token->GetText();
+              texture_identifier = token.GetText();
               return true;
             }},
            {Token::Type::kKeywordTextureUnit, [this, &texture_unit]() -> bool {
@@ -364,8 +398,8 @@ bool Parser::ParseCommandBindTexture() {
             }}})) {
     return false;
   }
-  parsed_commands_.push_back(MakeUnique<CommandBindTexture>(
-      std::move(start_token), texture_identifier, texture_unit));
+  parsed_commands_.push_back(arena_->New<CommandBindTexture>(
+      RetainToken(start_token), texture_identifier, texture_unit));
   return true;
 }
 
@@ -377,14 +411,14 @@ bool Parser::ParseCommandBindUniformBuffer() {
           {{Token::Type::kKeywordBuffer,
             [this, &buffer_identifier]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (!token->IsIdentifier()) {
+              if (!token.IsIdentifier()) {
                 message_consumer_->Message(
-                    MessageConsumer::Severity::kError, token.get(),
+                    MessageConsumer::Severity::kError, &token,
                     "Expected identifier for uniform buffer, got '" +
-                        token->GetText() + "'");
+                        token.GetText() + "'");
                 return false;
               }
-              buffer_identifier = token->GetText();
+              buffer_identifier = token.GetText();
               return true;
             }},
            {Token::Type::kKeywordBinding, [this, &binding]() -> bool {
@@ -397,51 +431,51 @@ bool Parser::ParseCommandBindUniformBuffer() {
             }}})) {
     return false;
   }
-  parsed_commands_.push_back(MakeUnique<CommandBindUniformBuffer>(
-      std::move(start_token), buffer_identifier, binding));
+  parsed_commands_.push_back(arena_->New<CommandBindUniformBuffer>(
+      RetainToken(start_token), buffer_identifier, binding));
   return true;
 }
 
 bool Parser::ParseCommandCompileShader() {
   auto start_token = tokenizer_->NextToken();
-  std::unique_ptr<Token> result_identifier = tokenizer_->NextToken();
-  if (!result_identifier->IsIdentifier()) {
+  auto result_identifier = tokenizer_->NextToken();
+  if (!result_identifier.IsIdentifier()) {
     message_consumer_->Message(
-        MessageConsumer::Severity::kError, result_identifier.get(),
+        MessageConsumer::Severity::kError, &result_identifier,
         "Expected an identifier for the shader being compiled, got '" +
-            result_identifier->GetText() + "'");
+            result_identifier.GetText() + "'");
     return false;
   }
   auto shader_token = tokenizer_->NextToken();
-  if (shader_token->GetType() != Token::Type::kKeywordShader) {
+  if (shader_token.GetType() != Token::Type::kKeywordShader) {
     message_consumer_->Message(
-        MessageConsumer::Severity::kError, shader_token.get(),
-        "Expected 'SHADER' keyword, got '" + shader_token->GetText() + "'");
+        MessageConsumer::Severity::kError, &shader_token,
+        "Expected 'SHADER' keyword, got '" + shader_token.GetText() + "'");
     return false;
   }
-  std::unique_ptr<Token> shader_identifier = tokenizer_->NextToken();
-  if (!shader_identifier->IsIdentifier()) {
+  auto shader_identifier = tokenizer_->NextToken();
+  if (!shader_identifier.IsIdentifier()) {
     message_consumer_->Message(MessageConsumer::Severity::kError,
-                               shader_identifier.get(),
+                               &shader_identifier,
                                "Expected an identifier for the source of the "
                                "shader being compiled, got '" +
-                                   shader_identifier->GetText() + "'");
+                                   shader_identifier.GetText() + "'");
     return false;
   }
-  parsed_commands_.push_back(MakeUnique<CommandCompileShader>(
-      std::move(start_token), std::move(result_identifier),
-      std::move(shader_identifier)));
+  parsed_commands_.push_back(arena_->New<CommandCompileShader>(
+      RetainToken(start_token), RetainToken(result_identifier),
+      RetainToken(shader_identifier)));
   return true;
 }
 
 bool Parser::ParseCommandCreateEmptyTexture2d() {
   auto start_token = tokenizer_->NextToken();
   auto result_identifier = tokenizer_->NextToken();
-  if (!result_identifier->IsIdentifier()) {
+  if (!result_identifier.IsIdentifier()) {
     message_consumer_->Message(MessageConsumer::Severity::kError,
-                               result_identifier.get(),
+                               &result_identifier,
                                "Expected identifier for texture, got '" +
-                                   result_identifier->GetText() + "'");
+                                   result_identifier.GetText() + "'");
     return false;
   }
   size_t width;
@@ -466,24 +500,40 @@ bool Parser::ParseCommandCreateEmptyTexture2d() {
             }}})) {
     return false;
   }
-  parsed_commands_.push_back(MakeUnique<CommandCreateEmptyTexture2D>(
-      std::move(start_token), std::move(result_identifier), width, height));
+  parsed_commands_.push_back(arena_->New<CommandCreateEmptyTexture2D>(
+      RetainToken(start_token), RetainToken(result_identifier), width, height));
   return true;
 }
 
 bool Parser::ParseCommandCreateBuffer() {
   auto start_token = tokenizer_->NextToken();
   auto result_identifier = tokenizer_->NextToken();
-  if (!result_identifier->IsIdentifier()) {
+  if (!result_identifier.IsIdentifier()) {
     message_consumer_->Message(
-        MessageConsumer::Severity::kError, result_identifier.get(),
+        MessageConsumer::Severity::kError, &result_identifier,
         "Expected an identifier for the buffer being created, got '" +
-            result_identifier->GetText() + "'");
+            result_identifier.GetText() + "'");
     return false;
   }
   size_t size_bytes;
-  std::vector<std::unique_ptr<Token>> values;
-  CommandCreateBuffer::InitialDataType type;
+  CommandCreateBuffer::InitialDataType type =
+      CommandCreateBuffer::InitialDataType::kNone;
+  // Literals are decoded straight into the buffer's data if INIT_TYPE has
+  // already been seen; otherwise they are kept until it is known.
+  bool has_init_values = false;
+  std::vector<uint8_t> initial_data;
+  std::vector<Token> deferred_values;
+  // Alternatively, the buffer's data can be given by a pattern, whose literals
+  // are decoded once the type is known.
+  bool has_init_pattern = false;
+  CommandCreateBuffer::Pattern pattern{
+      CommandCreateBuffer::Pattern::Kind::kConstant, {}, 0};
+  std::vector<Token> pattern_values;
+  // Alternatively, the buffer's data can come from a file.
+  Token file_token(Token::Type::kUnknown, 0, 0);
+  const SourceBuffer* file = nullptr;
+  bool has_offset_bytes = false;
+  size_t offset_bytes = 0;
   if (!ParseParameters(
           {{Token::Type::kKeywordSizeBytes,
             [this, &size_bytes]() -> bool {
@@ -497,171 +547,343 @@ bool Parser::ParseCommandCreateBuffer() {
            {Token::Type::kKeywordInitType,
             [this, &type]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (token->GetText() == "byte") {
+              if (token.TextEquals("byte")) {
                 type = CommandCreateBuffer::InitialDataType::kByte;
-              } else if (token->GetText() == "float") {
+              } else if (token.TextEquals("float")) {
                 type = CommandCreateBuffer::InitialDataType::kFloat;
-              } else if (token->GetText() == "int") {
+              } else if (token.TextEquals("int")) {
                 type = CommandCreateBuffer::InitialDataType::kInt;
-              } else if (token->GetText() == "uint") {
+              } else if (token.TextEquals("uint")) {
                 type = CommandCreateBuffer::InitialDataType::kUint;
               } else {
                 message_consumer_->Message(
-                    MessageConsumer::Severity::kError, token.get(),
+                    MessageConsumer::Severity::kError, &token,
                     "The type for buffer initialization must be one of "
                     "'float', 'int' or 'uint', got '" +
-                        token->GetText() + "'");
+                        token.GetText() + "'");
                 return false;
               }
               return true;
-            }},
-           {Token::Type::kKeywordInitValues, [this, &values]() -> bool {
-              while (tokenizer_->PeekNextToken()->IsIntLiteral() ||
-                     tokenizer_->PeekNextToken()->IsFloatLiteral()) {
-                values.push_back(tokenizer_->NextToken());
+            },
+            ParameterParser::Presence::kOptional},
+           {Token::Type::kKeywordInitValues,
+            [this, &type, &has_init_values, &initial_data,
+             &deferred_values]() -> bool {
+              has_init_values = true;
+              while (true) {
+                auto token = tokenizer_->PeekNextToken();
+                if (!token.IsIntLiteral() && !token.IsFloatLiteral()) {
+                  break;
+                }
+                tokenizer_->NextToken();
+                if (type == CommandCreateBuffer::InitialDataType::kNone) {
+                  deferred_values.push_back(token);
+                } else if (!AppendBufferLiteral(token, type, &initial_data)) {
+                  return false;
+                }
               }
               return true;
-            }}})) {
+            },
+            ParameterParser::Presence::kOptional},
+           {Token::Type::kKeywordInitPattern,
+            [this, &has_init_pattern, &pattern, &pattern_values]() -> bool {
+              has_init_pattern = true;
+              return ParseBufferPattern(&pattern, &pattern_values);
+            },
+            ParameterParser::Presence::kOptional},
+           {Token::Type::kKeywordFile,
+            [this, &file_token, &file]() -> bool {
+              file_token = tokenizer_->NextToken();
+              file = LoadFile(file_token);
+              return file != nullptr;
+            },
+            ParameterParser::Presence::kOptional},
+           {Token::Type::kKeywordOffsetBytes,
+            [this, &has_offset_bytes, &offset_bytes]() -> bool {
+              auto maybe_offset = ParseUint32("offset");
+              if (!maybe_offset.first) {
+                return false;
+              }
+              has_offset_bytes = true;
+              offset_bytes = maybe_offset.second;
+              return true;
+            },
+            ParameterParser::Presence::kOptional}})) {
     return false;
   }
-  size_t element_size =
-      type == CommandCreateBuffer::InitialDataType::kByte ? 1U : 4U;
-  if (size_bytes != element_size * values.size()) {
+  if (file != nullptr) {
+    if (type != CommandCreateBuffer::InitialDataType::kNone ||
+        has_init_values || has_init_pattern) {
+      message_consumer_->Message(
+          MessageConsumer::Severity::kError, &start_token,
+          "A buffer initialized from a file cannot also have 'INIT_TYPE', "
+          "'INIT_VALUES' or 'INIT_PATTERN'");
+      return false;
+    }
+    // An offset beyond the end of the file leaves no data, which the checker
+    // reports.
+    const size_t start = std::min(offset_bytes, file->GetSize());
+    parsed_commands_.push_back(arena_->New<CommandCreateBuffer>(
+        RetainToken(start_token), RetainToken(result_identifier), size_bytes,
+        RetainToken(file_token), offset_bytes,
+        reinterpret_cast<const uint8_t*>(file->GetData()) + start,
+        file->GetSize() - start));
+    return true;
+  }
+  if (has_offset_bytes) {
+    message_consumer_->Message(
+        MessageConsumer::Severity::kError, &start_token,
+        "'OFFSET_BYTES' can only be used for a buffer initialized from a "
+        "file");
+    return false;
+  }
+  if (has_init_values && has_init_pattern) {
+    message_consumer_->Message(
+        MessageConsumer::Severity::kError, &start_token,
+        "A buffer cannot have both 'INIT_VALUES' and 'INIT_PATTERN'");
+    return false;
+  }
+  if (type == CommandCreateBuffer::InitialDataType::kNone ||
+      (!has_init_values && !has_init_pattern)) {
+    // Without a file, INIT_TYPE is required, together with either INIT_VALUES
+    // or INIT_PATTERN.
+    auto next_token = tokenizer_->PeekNextToken();
+    if (type == CommandCreateBuffer::InitialDataType::kNone) {
+      message_consumer_->Message(MessageConsumer::Severity::kError,
+                                 &next_token,
+                                 "Missing parameter 'INIT_TYPE'");
+    }
+    if (!has_init_values && !has_init_pattern) {
+      message_consumer_->Message(
+          MessageConsumer::Severity::kError, &next_token,
+          "Missing parameter 'INIT_VALUES' or 'INIT_PATTERN'");
+    }
+    return false;
+  }
+  size_t element_size = CommandCreateBuffer::GetElementSize(type);
+  if (has_init_pattern) {
+    for (const auto& value : pattern_values) {
+      if (!AppendBufferLiteral(value, type, &pattern.elements)) {
+        return false;
+      }
+    }
+    if (size_bytes % element_size != 0) {
+      std::stringstream stringstream;
+      stringstream << "Size mismatch: buffer '" << result_identifier.GetText()
+                   << "' declared with size " << size_bytes
+                   << " bytes, which is not a whole number of "
+                   << element_size << "-byte elements";
+      message_consumer_->Message(MessageConsumer::Severity::kError,
+                                 &start_token, stringstream.str());
+      return false;
+    }
+    parsed_commands_.push_back(arena_->New<CommandCreateBuffer>(
+        RetainToken(start_token), RetainToken(result_identifier), size_bytes,
+        type, std::move(pattern)));
+    return true;
+  }
+  for (const auto& value : deferred_values) {
+    if (!AppendBufferLiteral(value, type, &initial_data)) {
+      return false;
+    }
+  }
+  if (size_bytes != initial_data.size()) {
     std::stringstream stringstream;
-    stringstream << "Size mismatch: buffer '" << result_identifier->GetText()
+    stringstream << "Size mismatch: buffer '" << result_identifier.GetText()
                  << "' declared with size " << size_bytes
-                 << " bytes, but initialized with " << values.size() << " "
-                 << element_size << "-byte elements";
+                 << " bytes, but initialized with "
+                 << initial_data.size() / element_size << " " << element_size
+                 << "-byte elements";
     message_consumer_->Message(MessageConsumer::Severity::kError,
-                               start_token.get(), stringstream.str());
+                               &start_token, stringstream.str());
     return false;
   }
+  // The data is moved into the arena rather than copied into the command, so
+  // that the command can refer to it in the same way as to a file's data.
+  const auto* arena_data =
+      arena_->New<std::vector<uint8_t>>(std::move(initial_data));
+  parsed_commands_.push_back(arena_->New<CommandCreateBuffer>(
+      RetainToken(start_token), RetainToken(result_identifier), size_bytes,
+      type, arena_data->data()));
+  return true;
+}
+
+bool Parser::ParseBufferPattern(CommandCreateBuffer::Pattern* pattern,
+                                std::vector<Token>* values) {
+  auto take_value = [this, values]() -> bool {
+    auto token = tokenizer_->NextToken();
+    if (!token.IsIntLiteral() && !token.IsFloatLiteral()) {
+      message_consumer_->Message(
+          MessageConsumer::Severity::kError, &token,
+          "Expected a numeric literal for the pattern, got '" +
+              token.GetText() + "'");
+      return false;
+    }
+    values->push_back(token);
+    return true;
+  };
+  auto kind = tokenizer_->NextToken();
+  if (kind.TextEquals("constant")) {
+    pattern->kind = CommandCreateBuffer::Pattern::Kind::kConstant;
+    return take_value();
+  }
+  if (kind.TextEquals("ramp")) {
+    pattern->kind = CommandCreateBuffer::Pattern::Kind::kRamp;
+    return take_value() && take_value();
+  }
+  if (kind.TextEquals("repeat")) {
+    pattern->kind = CommandCreateBuffer::Pattern::Kind::kRepeat;
+    if (!take_value()) {
+      return false;
+    }
+    while (tokenizer_->PeekNextToken().IsIntLiteral() ||
+           tokenizer_->PeekNextToken().IsFloatLiteral()) {
+      values->push_back(tokenizer_->NextToken());
+    }
+    return true;
+  }
+  if (kind.TextEquals("random")) {
+    pattern->kind = CommandCreateBuffer::Pattern::Kind::kRandom;
+    auto maybe_seed = ParseUint32("seed");
+    if (!maybe_seed.first) {
+      return false;
+    }
+    pattern->seed = maybe_seed.second;
+    return true;
+  }
+  message_consumer_->Message(
+      MessageConsumer::Severity::kError, &kind,
+      "The pattern for buffer initialization must be one of 'constant', "
+      "'ramp', 'repeat' or 'random', got '" +
+          kind.GetText() + "'");
+  return false;
+}
+
+bool Parser::AppendBufferLiteral(const Token& token,
+                                 CommandCreateBuffer::InitialDataType type,
+                                 std::vector<uint8_t>* data) {
   switch (type) {
     case CommandCreateBuffer::InitialDataType::kByte: {
-      std::vector<uint8_t> byte_data;
-      for (const auto& value : values) {
-        if (!value->IsIntLiteral()) {
-          message_consumer_->Message(
-              MessageConsumer::Severity::kError, value.get(),
-              "Byte literal expected, got '" + value->GetText() + "'");
-          return false;
-        }
-        int32_t parsed_value = std::stoi(value->GetText());
-        if (parsed_value < 0 || parsed_value >= UINT8_MAX) {
-          message_consumer_->Message(
-              MessageConsumer::Severity::kError, value.get(),
-              "Byte literal in range [0, 255] expected, got '" +
-                  value->GetText() + "'");
-          return false;
-        }
-        byte_data.emplace_back(static_cast<uint8_t>(parsed_value));
+      if (!token.IsIntLiteral()) {
+        message_consumer_->Message(
+            MessageConsumer::Severity::kError, &token,
+            "Byte literal expected, got '" + token.GetText() + "'");
+        return false;
       }
-      parsed_commands_.push_back(MakeUnique<CommandCreateBuffer>(
-          std::move(start_token), std::move(result_identifier), size_bytes,
-          byte_data));
-      break;
+      int64_t value;
+      if (!ConvertIntLiteral(token, &value)) {
+        return false;
+      }
+      if (value < 0 || value > UINT8_MAX) {
+        message_consumer_->Message(
+            MessageConsumer::Severity::kError, &token,
+            "Byte literal in range [0, 255] expected, got '" +
+                token.GetText() + "'");
+        return false;
+      }
+      data->push_back(static_cast<uint8_t>(value));
+      return true;
     }
     case CommandCreateBuffer::InitialDataType::kFloat: {
-      std::vector<float> float_data;
-      for (const auto& value : values) {
-        if (!value->IsFloatLiteral()) {
-          message_consumer_->Message(
-              MessageConsumer::Severity::kError, value.get(),
-              "Expected float literal, got '" + value->GetText() + "'");
-          return false;
-        }
-        float_data.emplace_back(std::stof(value->GetText()));
+      if (!token.IsFloatLiteral()) {
+        message_consumer_->Message(
+            MessageConsumer::Severity::kError, &token,
+            "Expected float literal, got '" + token.GetText() + "'");
+        return false;
       }
-      parsed_commands_.push_back(MakeUnique<CommandCreateBuffer>(
-          std::move(start_token), std::move(result_identifier), size_bytes,
-          float_data));
-      break;
+      float value;
+      if (!ConvertFloatLiteral(token, &value)) {
+        return false;
+      }
+      AppendBytes(value, data);
+      return true;
     }
     case CommandCreateBuffer::InitialDataType::kInt: {
-      std::vector<int32_t> int_data;
-      for (const auto& value : values) {
-        if (!value->IsIntLiteral()) {
-          message_consumer_->Message(
-              MessageConsumer::Severity::kError, value.get(),
-              "Expected int literal, got '" + value->GetText() + "'");
-          return false;
-        }
-        int_data.emplace_back(std::stoi(value->GetText()));
+      if (!token.IsIntLiteral()) {
+        message_consumer_->Message(
+            MessageConsumer::Severity::kError, &token,
+            "Expected int literal, got '" + token.GetText() + "'");
+        return false;
       }
-      parsed_commands_.push_back(MakeUnique<CommandCreateBuffer>(
-          std::move(start_token), std::move(result_identifier), size_bytes,
-          int_data));
-      break;
+      int64_t value;
+      if (!ConvertIntLiteral(token, &value)) {
+        return false;
+      }
+      if (value < INT32_MIN || value > INT32_MAX) {
+        message_consumer_->Message(
+            MessageConsumer::Severity::kError, &token,
+            "int literal out of range, got '" + token.GetText() + "'");
+        return false;
+      }
+      AppendBytes(static_cast<int32_t>(value), data);
+      return true;
     }
     default: {
       assert(type == CommandCreateBuffer::InitialDataType::kUint &&
              "Unexpected type.");
-      std::vector<uint32_t> uint_data;
-      for (const auto& value : values) {
-        if (!value->IsIntLiteral()) {
-          message_consumer_->Message(
-              MessageConsumer::Severity::kError, value.get(),
-              "Expected uint literal, got '" + value->GetText() + "'");
-          return false;
-        }
-        int64_t uint_value = std::stoi(value->GetText());
-        if (uint_value < 0) {
-          message_consumer_->Message(
-              MessageConsumer::Severity::kError, value.get(),
-              "uint literal value cannot be negative, got '" +
-                  value->GetText() + "'");
-          return false;
-        }
-        if (uint_value > UINT32_MAX) {
-          message_consumer_->Message(
-              MessageConsumer::Severity::kError, value.get(),
-              "uint literal out of range, got '" + value->GetText() + "'");
-          return false;
-        }
-        uint_data.emplace_back(static_cast<uint32_t>(uint_value));
+      if (!token.IsIntLiteral()) {
+        message_consumer_->Message(
+            MessageConsumer::Severity::kError, &token,
+            "Expected uint literal, got '" + token.GetText() + "'");
+        return false;
       }
-      parsed_commands_.push_back(MakeUnique<CommandCreateBuffer>(
-          std::move(start_token), std::move(result_identifier), size_bytes,
-          uint_data));
-      break;
+      int64_t value;
+      if (!ConvertIntLiteral(token, &value)) {
+        return false;
+      }
+      if (value < 0) {
+        message_consumer_->Message(
+            MessageConsumer::Severity::kError, &token,
+            "uint literal value cannot be negative, got '" + token.GetText() +
+                "'");
+        return false;
+      }
+      if (value > UINT32_MAX) {
+        message_consumer_->Message(
+            MessageConsumer::Severity::kError, &token,
+            "uint literal out of range, got '" + token.GetText() + "'");
+        return false;
+      }
+      AppendBytes(static_cast<uint32_t>(value), data);
+      return true;
     }
   }
-  return true;
 }
 
 bool Parser::ParseCommandCreateProgram() {
   auto start_token = tokenizer_->NextToken();
   auto result_identifier = tokenizer_->NextToken();
-  if (!result_identifier->IsIdentifier()) {
+  if (!result_identifier.IsIdentifier()) {
     message_consumer_->Message(
-        MessageConsumer::Severity::kError, result_identifier.get(),
+        MessageConsumer::Severity::kError, &result_identifier,
         "Expected an identifier for the program being created, got '" +
-            result_identifier->GetText() + "'");
+            result_identifier.GetText() + "'");
     return false;
   }
   auto shaders_token = tokenizer_->NextToken();
-  if (shaders_token->GetType() != Token::Type::kKeywordShaders) {
+  if (shaders_token.GetType() != Token::Type::kKeywordShaders) {
     message_consumer_->Message(MessageConsumer::Severity::kError,
-                               shaders_token.get(),
+                               &shaders_token,
                                "Expected keyword 'SHADERS' before the series "
                                "of compiled shaders for the program, got '" +
-                                   shaders_token->GetText() + "'");
+                                   shaders_token.GetText() + "'");
     return false;
   }
   auto should_be_first_shader = tokenizer_->PeekNextToken();
-  if (!should_be_first_shader->IsIdentifier()) {
+  if (!should_be_first_shader.IsIdentifier()) {
     message_consumer_->Message(
-        MessageConsumer::Severity::kError, should_be_first_shader.get(),
+        MessageConsumer::Severity::kError, &should_be_first_shader,
         "Expected the identifier of at least one compiled shader, got '" +
-            should_be_first_shader->GetText() + "'");
+            should_be_first_shader.GetText() + "'");
     return false;
   }
-  std::vector<std::unique_ptr<Token>> compiled_shader_identifiers;
-  while (tokenizer_->PeekNextToken()->IsIdentifier()) {
-    compiled_shader_identifiers.push_back(tokenizer_->NextToken());
+  std::vector<const Token*> compiled_shader_identifiers;
+  while (tokenizer_->PeekNextToken().IsIdentifier()) {
+    compiled_shader_identifiers.push_back(
+        RetainToken(tokenizer_->NextToken()));
   }
-  parsed_commands_.push_back(MakeUnique<CommandCreateProgram>(
-      std::move(start_token), std::move(result_identifier),
+  parsed_commands_.push_back(arena_->New<CommandCreateProgram>(
+      RetainToken(start_token), RetainToken(result_identifier),
       std::move(compiled_shader_identifiers)));
   return true;
 }
@@ -669,11 +891,11 @@ bool Parser::ParseCommandCreateProgram() {
 bool Parser::ParseCommandCreateRenderbuffer() {
   auto start_token = tokenizer_->NextToken();
   auto result_identifier = tokenizer_->NextToken();
-  if (!result_identifier->IsIdentifier()) {
+  if (!result_identifier.IsIdentifier()) {
     message_consumer_->Message(
-        MessageConsumer::Severity::kError, result_identifier.get(),
+        MessageConsumer::Severity::kError, &result_identifier,
         "Expected an identifier for the program being created, got '" +
-            result_identifier->GetText() + "'");
+            result_identifier.GetText() + "'");
     return false;
   }
   size_t width;
@@ -698,23 +920,24 @@ bool Parser::ParseCommandCreateRenderbuffer() {
             }}})) {
     return false;
   }
-  parsed_commands_.push_back(MakeUnique<CommandCreateRenderbuffer>(
-      std::move(start_token), result_identifier->GetText(), width, height));
+  parsed_commands_.push_back(arena_->New<CommandCreateRenderbuffer>(
+      RetainToken(start_token), RetainToken(result_identifier), width,
+      height));
   return true;
 }
 
 bool Parser::ParseCommandCreateSampler() {
   auto start_token = tokenizer_->NextToken();
   auto token = tokenizer_->NextToken();
-  if (!token->IsIdentifier()) {
+  if (!token.IsIdentifier()) {
     message_consumer_->Message(
-        MessageConsumer::Severity::kError, token.get(),
+        MessageConsumer::Severity::kError, &token,
         "Expected identifier for the sampler being created, got '" +
-            token->GetText() + "'");
+            token.GetText() + "'");
     return false;
   }
-  parsed_commands_.push_back(MakeUnique<CommandCreateSampler>(
-      std::move(start_token), std::move(token)));
+  parsed_commands_.push_back(arena_->New<CommandCreateSampler>(
+      RetainToken(start_token), RetainToken(token)));
   return true;
 }
 
@@ -730,15 +953,15 @@ bool Parser::ParseCommandRunCompute() {
           {{Token::Type::kKeywordProgram,
             [this, &program_identifier]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (!token->IsIdentifier()) {
+              if (!token.IsIdentifier()) {
                 message_consumer_->Message(MessageConsumer::Severity::kError,
-                                           token.get(),
+                                           &token,
                                            "Expected an identifier for the "
                                            "compute program to be run, got '" +
-                                               token->GetText() + "'");
+                                               token.GetText() + "'");
                 return false;
               }
-              program_identifier = token->GetText();
+              program_identifier = token.GetText();
               return true;
             }},
            {Token::Type::kKeywordNumGroupsX,
@@ -769,9 +992,9 @@ bool Parser::ParseCommandRunCompute() {
             }}})) {
     return false;
   }
-  parsed_commands_.push_back(
-      MakeUnique<CommandRunCompute>(std::move(start_token), program_identifier,
-                                    num_groups_x, num_groups_y, num_groups_z));
+  parsed_commands_.push_back(arena_->New<CommandRunCompute>(
+      RetainToken(start_token), program_identifier, num_groups_x, num_groups_y,
+      num_groups_z));
   return true;
 }
 
@@ -789,37 +1012,38 @@ bool Parser::ParseCommandRunGraphics() {
           {{Token::Type::kKeywordProgram,
             [this, &program_identifier]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (!token->IsIdentifier()) {
+              if (!token.IsIdentifier()) {
                 message_consumer_->Message(MessageConsumer::Severity::kError,
-                                           token.get(),
+                                           &token,
                                            "Expected an identifier for the "
                                            "graphics program to be run, got '" +
-                                               token->GetText() + "'");
+                                               token.GetText() + "'");
                 return false;
               }
-              program_identifier = token->GetText();
+              program_identifier = token.GetText();
               return true;
             }},
            {Token::Type::kKeywordVertexData,
             [this, &vertex_data]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (token->GetText() != "[") {
+              if (token.GetType() != Token::Type::kSquareBracketOpen) {
                 message_consumer_->Message(
-                    MessageConsumer::Severity::kError, token.get(),
+                    MessageConsumer::Severity::kError, &token,
                     "Expected '[' to commence start of vertex data, got '" +
-                        token->GetText() + "'");
+                        token.GetText() + "'");
                 return false;
               }
-              while (tokenizer_->PeekNextToken()->GetText() != "]") {
+              while (tokenizer_->PeekNextToken().GetType() !=
+                     Token::Type::kSquareBracketClose) {
                 auto maybe_location = ParseUint32("location");
                 if (!maybe_location.first) {
                   return false;
                 }
                 token = tokenizer_->NextToken();
-                if (token->GetText() != "->") {
+                if (token.GetType() != Token::Type::kArrow) {
                   message_consumer_->Message(
-                      MessageConsumer::Severity::kError, token.get(),
-                      "Expected '->', got '" + token->GetText() + "'");
+                      MessageConsumer::Severity::kError, &token,
+                      "Expected '->', got '" + token.GetText() + "'");
                   return false;
                 }
                 std::pair<bool, VertexAttributeInfo> maybe_vertex_list =
@@ -829,13 +1053,15 @@ bool Parser::ParseCommandRunGraphics() {
                 }
                 vertex_data.insert(
                     {maybe_location.second, maybe_vertex_list.second});
-                token = tokenizer_->PeekNextToken();
-                if (token->GetText() == ",") {
+                auto separator = tokenizer_->PeekNextToken();
+                if (separator.GetType() == Token::Type::kComma) {
                   tokenizer_->NextToken();
-                } else if (token->GetText() != "]") {
+                } else if (separator.GetType() !=
+                           Token::Type::kSquareBracketClose) {
                   message_consumer_->Message(
-                      MessageConsumer::Severity::kError, token.get(),
-                      "Expected ',' or ']', got '" + token->GetText() + "'");
+                      MessageConsumer::Severity::kError, &separator,
+                      "Expected ',' or ']', got '" + separator.GetText() +
+                          "'");
                   return false;
                 }
               }
@@ -845,14 +1071,14 @@ bool Parser::ParseCommandRunGraphics() {
            {Token::Type::kKeywordIndexData,
             [this, &index_data_buffer_identifier]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (!token->IsIdentifier()) {
+              if (!token.IsIdentifier()) {
                 message_consumer_->Message(
-                    MessageConsumer::Severity::kError, token.get(),
+                    MessageConsumer::Severity::kError, &token,
                     "Expected identifier for index data buffer, got '" +
-                        token->GetText() + "'");
+                        token.GetText() + "'");
                 return false;
               }
-              index_data_buffer_identifier = token->GetText();
+              index_data_buffer_identifier = token.GetText();
               return true;
             }},
            {Token::Type::kKeywordVertexCount,
@@ -867,12 +1093,12 @@ bool Parser::ParseCommandRunGraphics() {
            {Token::Type::kKeywordTopology,
             [this, &topology]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (token->GetType() == Token::Type::kKeywordTriangles) {
+              if (token.GetType() == Token::Type::kKeywordTriangles) {
                 topology = CommandRunGraphics::Topology::kTriangles;
               } else {
                 message_consumer_->Message(
-                    MessageConsumer::Severity::kError, token.get(),
-                    "Unknown or unsupported topology: '" + token->GetText() +
+                    MessageConsumer::Severity::kError, &token,
+                    "Unknown or unsupported topology: '" + token.GetText() +
                         "'");
                 return false;
               }
@@ -881,43 +1107,46 @@ bool Parser::ParseCommandRunGraphics() {
            {Token::Type::kKeywordFramebufferAttachments,
             [this, &framebuffer_attachments]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (token->GetText() != "[") {
+              if (token.GetType() != Token::Type::kSquareBracketOpen) {
                 message_consumer_->Message(MessageConsumer::Severity::kError,
-                                           token.get(),
+                                           &token,
                                            "Expected '[' to commence start of "
                                            "framebuffer attachments, got '" +
-                                               token->GetText() + "'");
+                                               token.GetText() + "'");
                 return false;
               }
-              while (tokenizer_->PeekNextToken()->GetText() != "]") {
+              while (tokenizer_->PeekNextToken().GetType() !=
+                     Token::Type::kSquareBracketClose) {
                 auto maybe_location = ParseUint32("location");
                 if (!maybe_location.first) {
                   return false;
                 }
                 token = tokenizer_->NextToken();
-                if (token->GetText() != "->") {
+                if (token.GetType() != Token::Type::kArrow) {
                   message_consumer_->Message(
-                      MessageConsumer::Severity::kError, token.get(),
-                      "Expected '->', got '" + token->GetText() + "'");
+                      MessageConsumer::Severity::kError, &token,
+                      "Expected '->', got '" + token.GetText() + "'");
                   return false;
                 }
                 token = tokenizer_->NextToken();
-                if (!token->IsIdentifier()) {
+                if (!token.IsIdentifier()) {
                   message_consumer_->Message(
-                      MessageConsumer::Severity::kError, token.get(),
+                      MessageConsumer::Severity::kError, &token,
                       "Expected identifier for framebuffer attachment, got '" +
-                          token->GetText() + "'");
+                          token.GetText() + "'");
                   return false;
                 }
                 framebuffer_attachments.insert(
-                    {maybe_location.second, token->GetText()});
-                token = tokenizer_->PeekNextToken();
-                if (token->GetText() == ",") {
+                    {maybe_location.second, token.GetText()});
+                auto separator = tokenizer_->PeekNextToken();
+                if (separator.GetType() == Token::Type::kComma) {
                   tokenizer_->NextToken();
-                } else if (token->GetText() != "]") {
+                } else if (separator.GetType() !=
+                           Token::Type::kSquareBracketClose) {
                   message_consumer_->Message(
-                      MessageConsumer::Severity::kError, token.get(),
-                      "Expected ',' or ']', got '" + token->GetText() + "'");
+                      MessageConsumer::Severity::kError, &separator,
+                      "Expected ',' or ']', got '" + separator.GetText() +
+                          "'");
                   return false;
                 }
               }
@@ -926,8 +1155,8 @@ bool Parser::ParseCommandRunGraphics() {
             }}})) {
     return false;
   }
-  parsed_commands_.push_back(MakeUnique<CommandRunGraphics>(
-      std::move(start_token), program_identifier, vertex_data,
+  parsed_commands_.push_back(arena_->New<CommandRunGraphics>(
+      RetainToken(start_token), program_identifier, vertex_data,
       index_data_buffer_identifier, vertex_count, topology,
       framebuffer_attachments));
   return true;
@@ -935,44 +1164,61 @@ bool Parser::ParseCommandRunGraphics() {
 
 bool Parser::ParseCommandDeclareShader() {
   auto start_token = tokenizer_->NextToken();
-  std::unique_ptr<Token> result_identifier = tokenizer_->NextToken();
-  if (!result_identifier->IsIdentifier()) {
+  auto result_identifier = tokenizer_->NextToken();
+  if (!result_identifier.IsIdentifier()) {
     message_consumer_->Message(
-        MessageConsumer::Severity::kError, result_identifier.get(),
+        MessageConsumer::Severity::kError, &result_identifier,
         "Expected an identifier for the shader being declared, got '" +
-            result_identifier->GetText() + "'");
+            result_identifier.GetText() + "'");
     return false;
   }
   auto shader_kind = tokenizer_->NextToken();
-  if (shader_kind->GetType() != Token::Type::kKeywordVertex &&
-      shader_kind->GetType() != Token::Type::kKeywordFragment &&
-      shader_kind->GetType() != Token::Type::kKeywordCompute) {
+  if (shader_kind.GetType() != Token::Type::kKeywordVertex &&
+      shader_kind.GetType() != Token::Type::kKeywordFragment &&
+      shader_kind.GetType() != Token::Type::kKeywordCompute) {
     message_consumer_->Message(
-        MessageConsumer::Severity::kError, shader_kind.get(),
+        MessageConsumer::Severity::kError, &shader_kind,
         "Expected 'VERTEX', 'FRAGMENT' or 'COMPUTE' to specify "
         "which kind of shader this is, got '" +
-            shader_kind->GetText() + "'");
+            shader_kind.GetText() + "'");
     return false;
   }
   tokenizer_->SkipWhitespace();
-  std::stringstream stringstream;
-  while (true) {
-    auto token = tokenizer_->PeekNextToken(false);
-    if (token->IsEOS()) {
-      message_consumer_->Message(
-          MessageConsumer::Severity::kError, token.get(),
-          "Unexpected end of script when processing shader text");
+  // The shader text is either held in a file, or is given inline, up to a
+  // line that starts with 'END'. Either way, the command refers to the text
+  // where it lies rather than copying it.
+  const char* shader_text;
+  size_t shader_text_length;
+  if (tokenizer_->PeekNextToken(false).GetType() == Token::Type::kKeywordFile) {
+    tokenizer_->NextToken(false);
+    const SourceBuffer* file = LoadFile(tokenizer_->NextToken());
+    if (file == nullptr) {
       return false;
     }
-    if (token->GetText() == "END") {
-      break;
+    shader_text = file->GetData();
+    shader_text_length = file->GetSize();
+  } else {
+    const size_t shader_text_start = tokenizer_->GetPosition();
+    while (true) {
+      auto token = tokenizer_->PeekNextToken(false);
+      if (token.IsEOS()) {
+        message_consumer_->Message(
+            MessageConsumer::Severity::kError, &token,
+            "Unexpected end of script when processing shader text");
+        return false;
+      }
+      if (token.GetType() == Token::Type::kKeywordEnd) {
+        break;
+      }
+      tokenizer_->SkipLine();
     }
-    stringstream << tokenizer_->SkipLine();
+    shader_text = source_->GetData() + shader_text_start;
+    shader_text_length = tokenizer_->GetPosition() - shader_text_start;
+    tokenizer_->NextToken();
   }
-  tokenizer_->NextToken();
   CommandDeclareShader::Kind declare_shader_kind =
       CommandDeclareShader::Kind::VERTEX;
-  switch (shader_kind->GetType()) {
+  switch (shader_kind.GetType()) {
     case Token::Type::kKeywordVertex:
       declare_shader_kind = CommandDeclareShader::Kind::VERTEX;
       break;
@@ -987,9 +1233,9 @@ bool Parser::ParseCommandDeclareShader() {
       break;
   }
 
-  parsed_commands_.push_back(MakeUnique<CommandDeclareShader>(
-      std::move(start_token), std::move(result_identifier), declare_shader_kind,
-      stringstream.str()));
+  parsed_commands_.push_back(arena_->New<CommandDeclareShader>(
+      RetainToken(start_token), RetainToken(result_identifier),
+      declare_shader_kind, shader_text, shader_text_length));
   return true;
 }
 
@@ -1001,40 +1247,40 @@ bool Parser::ParseCommandDumpRenderbuffer() {
           {{Token::Type::kKeywordRenderbuffer,
             [this, &renderbuffer_identifier]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (!token->IsIdentifier()) {
+              if (!token.IsIdentifier()) {
                 message_consumer_->Message(
-                    MessageConsumer::Severity::kError, token.get(),
+                    MessageConsumer::Severity::kError, &token,
                     "Expected renderbuffer identifier, got '" +
-                        token->GetText() + "'");
+                        token.GetText() + "'");
                 return false;
               }
-              renderbuffer_identifier = token->GetText();
+              renderbuffer_identifier = token.GetText();
               return true;
             }},
            {Token::Type::kKeywordFile, [this, &filename]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (!token->IsString()) {
+              if (!token.IsString()) {
                 message_consumer_->Message(
-                    MessageConsumer::Severity::kError, token.get(),
+                    MessageConsumer::Severity::kError, &token,
                     "Exected file to which to dump renderbuffer, got '" +
-                        token->GetText() + "'");
+                        token.GetText() + "'");
                 return false;
               }
               filename =
-                  token->GetText().substr(1, token->GetText().length() - 2);
+                  token.GetText().substr(1, token.GetText().length() - 2);
               return true;
             }}})) {
     return false;
   }
-  parsed_commands_.push_back(MakeUnique<CommandDumpRenderbuffer>(
-      std::move(start_token), renderbuffer_identifier, filename));
+  parsed_commands_.push_back(arena_->New<CommandDumpRenderbuffer>(
+      RetainToken(start_token), renderbuffer_identifier, filename));
   return true;
 }
 
 bool Parser::ParseCommandSetTextureOrSamplerParameter() {
   auto start_token = tokenizer_->NextToken();
   const bool is_set_texture =
-      start_token->GetType() == Token::Type::kKeywordSetTextureParameter;
+      start_token.GetType() == Token::Type::kKeywordSetTextureParameter;
   bool got_target_identifier = false;
   std::string target_identifier;
   bool got_parameter = false;
@@ -1044,73 +1290,74 @@ bool Parser::ParseCommandSetTextureOrSamplerParameter() {
       CommandSetSamplerOrTextureParameter::TextureParameterValue::kNearest;
 
   while (true) {
-    auto token = tokenizer_->PeekNextToken();
-    if (token->GetType() == Token::Type::kKeywordSampler ||
-        token->GetType() == Token::Type::kKeywordTexture) {
-      token = tokenizer_->NextToken();
+    auto next_token_type = tokenizer_->PeekNextToken().GetType();
+    if (next_token_type == Token::Type::kKeywordSampler ||
+        next_token_type == Token::Type::kKeywordTexture) {
+      auto token = tokenizer_->NextToken();
       Token::Type expected_token = is_set_texture
                                        ? Token::Type::kKeywordTexture
                                        : Token::Type::kKeywordSampler;
-      if (token->GetType() != expected_token) {
+      if (token.GetType() != expected_token) {
         message_consumer_->Message(
-            MessageConsumer::Severity::kError, token.get(),
+            MessageConsumer::Severity::kError, &token,
             "The 'SET_" + Tokenizer::KeywordToString(expected_token) +
                 "_PARAMETER' command takes a '" +
                 Tokenizer::KeywordToString(expected_token) +
-                "' argument, not a '" + token->GetText() + "' argument");
+                "' argument, not a '" + token.GetText() + "' argument");
         return false;
       }
       if (got_target_identifier) {
         message_consumer_->Message(
-            MessageConsumer::Severity::kError, token.get(),
+            MessageConsumer::Severity::kError, &token,
             "Multiple '" + Tokenizer::KeywordToString(expected_token) +
                 "' parmaters provided, already got '" + target_identifier +
                 "'");
         return false;
       }
       token = tokenizer_->NextToken();
-      if (!token->IsIdentifier()) {
+      if (!token.IsIdentifier()) {
         std::stringstream stringstream;
         stringstream << "Expected identifier for target "
                      << (expected_token == Token::Type::kKeywordTexture
                              ? "texture"
                              : "sampler")
-                     << ", got '" << token->GetText() << "'";
+                     << ", got '" << token.GetText() << "'";
         message_consumer_->Message(MessageConsumer::Severity::kError,
-                                   token.get(), stringstream.str());
+                                   &token, stringstream.str());
         return false;
       }
-      target_identifier = token->GetText();
+      target_identifier = token.GetText();
       got_target_identifier = true;
-    } else if (token->GetType() == Token::Type::kKeywordTextureMagFilter ||
-               token->GetType() == Token::Type::kKeywordTextureMinFilter) {
+    } else if (next_token_type == Token::Type::kKeywordTextureMagFilter ||
+               next_token_type == Token::Type::kKeywordTextureMinFilter) {
+      auto parameter_name = tokenizer_->NextToken();
       if (got_parameter) {
         std::stringstream stringstream;
         stringstream << "Multiple parameters specified for "
                      << (is_set_texture ? "texture" : "sampler");
         message_consumer_->Message(MessageConsumer::Severity::kError,
-                                   token.get(), stringstream.str());
+                                   &parameter_name, stringstream.str());
         return false;
       }
       got_parameter = true;
-      auto parameter_name = tokenizer_->NextToken();
-      token = tokenizer_->NextToken();
-      parameter = parameter_name->GetText() == "TEXTURE_MAG_FILTER"
-                      ? CommandSetSamplerOrTextureParameter::TextureParameter::
-                            kMagFilter
-                      : CommandSetSamplerOrTextureParameter::TextureParameter::
-                            kMinFilter;
-      if (token->GetText() == "LINEAR") {
+      auto token = tokenizer_->NextToken();
+      parameter =
+          parameter_name.GetType() == Token::Type::kKeywordTextureMagFilter
+              ? CommandSetSamplerOrTextureParameter::TextureParameter::
+                    kMagFilter
+              : CommandSetSamplerOrTextureParameter::TextureParameter::
+                    kMinFilter;
+      if (token.TextEquals("LINEAR")) {
         parameter_value =
             CommandSetSamplerOrTextureParameter::TextureParameterValue::kLinear;
-      } else if (token->GetText() == "NEAREST") {
+      } else if (token.TextEquals("NEAREST")) {
         parameter_value = CommandSetSamplerOrTextureParameter::
             TextureParameterValue::kNearest;
       } else {
         message_consumer_->Message(
-            MessageConsumer::Severity::kError, token.get(),
-            "Expected value for the '" + parameter_name->GetText() +
-                "' parameter, got '" + token->GetText());
+            MessageConsumer::Severity::kError, &token,
+            "Expected value for the '" + parameter_name.GetText() +
+                "' parameter, got '" + token.GetText());
         return false;
       }
     } else {
@@ -1122,7 +1369,7 @@ bool Parser::ParseCommandSetTextureOrSamplerParameter() {
     stringstream << "No target " << (is_set_texture ? "texture" : "sampler")
                  << " was specified";
     message_consumer_->Message(MessageConsumer::Severity::kError,
-                               start_token.get(), stringstream.str());
+                               &start_token, stringstream.str());
     return false;
   }
   if (!got_parameter) {
@@ -1130,11 +1377,11 @@ bool Parser::ParseCommandSetTextureOrSamplerParameter() {
     stringstream << "No " << (is_set_texture ? "texture" : "sampler")
                  << " parameter was specified";
     message_consumer_->Message(MessageConsumer::Severity::kError,
-                               start_token.get(), stringstream.str());
+                               &start_token, stringstream.str());
     return false;
   }
-  parsed_commands_.push_back(MakeUnique<CommandSetSamplerOrTextureParameter>(
-      std::move(start_token), target_identifier, parameter, parameter_value));
+  parsed_commands_.push_back(arena_->New<CommandSetSamplerOrTextureParameter>(
+      RetainToken(start_token), target_identifier, parameter, parameter_value));
   return true;
 }
 
@@ -1144,20 +1391,20 @@ bool Parser::ParseCommandSetUniform() {
   size_t location;
   UniformValue::ElementType type;
   std::pair<bool, size_t> maybe_array_size;
-  std::vector<std::unique_ptr<Token>> values;
+  std::vector<Token> values;
   if (!ParseParameters(
           {{Token::Type::kKeywordProgram,
             [this, &program_identifier]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (!token->IsIdentifier()) {
+              if (!token.IsIdentifier()) {
                 message_consumer_->Message(MessageConsumer::Severity::kError,
-                                           token.get(),
+                                           &token,
                                            "Expected identifier of program for "
                                            "which uniform is to be set, got '" +
-                                               token->GetText() + "'");
+                                               token.GetText() + "'");
                 return false;
               }
-              program_identifier = token->GetText();
+              program_identifier = token.GetText();
               return true;
             }},
            {Token::Type::kKeywordLocation,
@@ -1172,55 +1419,56 @@ bool Parser::ParseCommandSetUniform() {
            {Token::Type::kKeywordType,
             [this, &maybe_array_size, &type]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (token->GetText() == "float") {
+              if (token.TextEquals("float")) {
                 type = UniformValue::ElementType::kFloat;
-              } else if (token->GetText() == "vec2") {
+              } else if (token.TextEquals("vec2")) {
                 type = UniformValue::ElementType::kVec2;
-              } else if (token->GetText() == "vec3") {
+              } else if (token.TextEquals("vec3")) {
                 type = UniformValue::ElementType::kVec3;
-              } else if (token->GetText() == "vec4") {
+              } else if (token.TextEquals("vec4")) {
                 type = UniformValue::ElementType::kVec4;
-              } else if (token->GetText() == "int") {
+              } else if (token.TextEquals("int")) {
                 type = UniformValue::ElementType::kInt;
-              } else if (token->GetText() == "ivec2") {
+              } else if (token.TextEquals("ivec2")) {
                 type = UniformValue::ElementType::kIvec2;
-              } else if (token->GetText() == "ivec3") {
+              } else if (token.TextEquals("ivec3")) {
                 type = UniformValue::ElementType::kIvec3;
-              } else if (token->GetText() == "ivec4") {
+              } else if (token.TextEquals("ivec4")) {
                 type = UniformValue::ElementType::kIvec4;
-              } else if (token->GetText() == "uint") {
+              } else if (token.TextEquals("uint")) {
                 type = UniformValue::ElementType::kUint;
-              } else if (token->GetText() == "uvec2") {
+              } else if (token.TextEquals("uvec2")) {
                 type = UniformValue::ElementType::kUvec2;
-              } else if (token->GetText() == "uvec3") {
+              } else if (token.TextEquals("uvec3")) {
                 type = UniformValue::ElementType::kUvec3;
-              } else if (token->GetText() == "uvec4") {
+              } else if (token.TextEquals("uvec4")) {
                 type = UniformValue::ElementType::kUvec4;
-              } else if (token->GetText() == "mat2x2") {
+              } else if (token.TextEquals("mat2x2")) {
                 type = UniformValue::ElementType::kMat2x2;
-              } else if (token->GetText() == "mat2x3") {
+              } else if (token.TextEquals("mat2x3")) {
                 type = UniformValue::ElementType::kMat2x3;
-              } else if (token->GetText() == "mat2x4") {
+              } else if (token.TextEquals("mat2x4")) {
                 type = UniformValue::ElementType::kMat2x4;
-              } else if (token->GetText() == "mat3x2") {
+              } else if (token.TextEquals("mat3x2")) {
                 type = UniformValue::ElementType::kMat3x2;
-              } else if (token->GetText() == "mat3x3") {
+              } else if (token.TextEquals("mat3x3")) {
                 type = UniformValue::ElementType::kMat3x3;
-              } else if (token->GetText() == "mat3x4") {
+              } else if (token.TextEquals("mat3x4")) {
                 type = UniformValue::ElementType::kMat3x4;
-              } else if (token->GetText() == "mat4x2") {
+              } else if (token.TextEquals("mat4x2")) {
                 type = UniformValue::ElementType::kMat4x2;
-              } else if (token->GetText() == "mat4x3") {
+              } else if (token.TextEquals("mat4x3")) {
                 type = UniformValue::ElementType::kMat4x3;
-              } else if (token->GetText() == "mat4x4") {
+              } else if (token.TextEquals("mat4x4")) {
                 type = UniformValue::ElementType::kMat4x4;
               } else {
                 message_consumer_->Message(
-                    MessageConsumer::Severity::kError, token.get(),
-                    "Unexpected type '" + token->GetText() + "'");
+                    MessageConsumer::Severity::kError, &token,
+                    "Unexpected type '" + token.GetText() + "'");
                 return false;
               }
-              if (tokenizer_->PeekNextToken()->GetText() == "[") {
+              if (tokenizer_->PeekNextToken().GetType() ==
+                  Token::Type::kSquareBracketOpen) {
                 tokenizer_->NextToken();
                 auto maybe_size = ParseUint32("array size");
                 if (!maybe_size.first) {
@@ -1228,10 +1476,10 @@ bool Parser::ParseCommandSetUniform() {
                 }
                 maybe_array_size = {true, maybe_array_size.second};
                 token = tokenizer_->NextToken();
-                if (token->GetText() != "]") {
+                if (token.GetType() != Token::Type::kSquareBracketClose) {
                   message_consumer_->Message(
-                      MessageConsumer::Severity::kError, token.get(),
-                      "Expected ']', got '" + token->GetText() + "'");
+                      MessageConsumer::Severity::kError, &token,
+                      "Expected ']', got '" + token.GetText() + "'");
                 }
               } else {
                 maybe_array_size = {false, 0U};
@@ -1239,8 +1487,8 @@ bool Parser::ParseCommandSetUniform() {
               return true;
             }},
            {Token::Type::kKeywordValues, [this, &values]() -> bool {
-              while (tokenizer_->PeekNextToken()->IsIntLiteral() ||
-                     tokenizer_->PeekNextToken()->IsFloatLiteral()) {
+              while (tokenizer_->PeekNextToken().IsIntLiteral() ||
+                     tokenizer_->PeekNextToken().IsFloatLiteral()) {
                 values.push_back(tokenizer_->NextToken());
               }
               return true;
@@ -1252,16 +1500,16 @@ bool Parser::ParseCommandSetUniform() {
   if (!maybe_uniform_value.first) {
     return false;
   }
-  parsed_commands_.push_back(
-      MakeUnique<CommandSetUniform>(std::move(start_token), program_identifier,
-                                    location, maybe_uniform_value.second));
+  parsed_commands_.push_back(arena_->New<CommandSetUniform>(
+      RetainToken(start_token), program_identifier, location,
+      maybe_uniform_value.second));
   return true;
 }
 
 std::pair<bool, UniformValue> Parser::ProcessUniformValue(
     UniformValue::ElementType type,
     const std::pair<bool, size_t>& maybe_array_size,
-    const std::vector<std::unique_ptr<Token>>& values) {
+    const std::vector<Token>& values) {
   std::pair<bool, UniformValue> failure_result{
       false,
       UniformValue(UniformValue::ElementType::kFloat, std::vector<float>())};
@@ -1275,14 +1523,24 @@ std::pair<bool, UniformValue> Parser::ProcessUniformValue(
     case UniformValue::ElementType::kIvec4: {
       std::vector<int32_t> int_values;
       for (const auto& value : values) {
-        if (!value->IsIntLiteral()) {
+        if (!value.IsIntLiteral()) {
           message_consumer_->Message(
-              MessageConsumer::Severity::kError, value.get(),
-              "Found non-integer value '" + value->GetText() +
+              MessageConsumer::Severity::kError, &value,
+              "Found non-integer value '" + value.GetText() +
                   "' for integer uniform");
           return failure_result;
         }
-        int_values.push_back(std::stoi(value->GetText()));
+        int64_t int_value;
+        if (!ConvertIntLiteral(value, &int_value)) {
+          return failure_result;
+        }
+        if (int_value < INT32_MIN || int_value > INT32_MAX) {
+          message_consumer_->Message(
+              MessageConsumer::Severity::kError, &value,
+              "Integer value '" + value.GetText() + "' is out of range");
+          return failure_result;
+        }
+        int_values.push_back(static_cast<int32_t>(int_value));
       }
       if (maybe_array_size.first) {
         return {true, UniformValue(type, int_values, maybe_array_size.second)};
@@ -1295,16 +1553,25 @@ std::pair<bool, UniformValue> Parser::ProcessUniformValue(
     case UniformValue::ElementType::kUvec4: {
       std::vector<uint32_t> uint_values;
       for (const auto& value : values) {
-        if (!value->IsIntLiteral() || std::stoi(value->GetText()) < 0) {
+        int64_t uint_value;
+        if (value.IsIntLiteral() && !ConvertIntLiteral(value, &uint_value)) {
+          return failure_result;
+        }
+        if (!value.IsIntLiteral() || uint_value < 0) {
           message_consumer_->Message(MessageConsumer::Severity::kError,
-                                     value.get(),
+                                     &value,
                                      "An unsigned uniform requires a "
                                      "non-negative integer value, got '" +
-                                         value->GetText() + "'");
+                                         value.GetText() + "'");
           return failure_result;
         }
-        uint_values.push_back(
-            static_cast<uint32_t>(std::stoi(value->GetText())));
+        if (uint_value > UINT32_MAX) {
+          message_consumer_->Message(
+              MessageConsumer::Severity::kError, &value,
+              "Integer value '" + value.GetText() + "' is out of range");
+          return failure_result;
+        }
+        uint_values.push_back(static_cast<uint32_t>(uint_value));
       }
       if (maybe_array_size.first) {
         return {true, UniformValue(type, uint_values, maybe_array_size.second)};
@@ -1314,14 +1581,18 @@ std::pair<bool, UniformValue> Parser::ProcessUniformValue(
     default: {
       std::vector<float> float_values;
       for (const auto& value : values) {
-        if (!value->IsFloatLiteral()) {
+        if (!value.IsFloatLiteral()) {
           message_consumer_->Message(
-              MessageConsumer::Severity::kError, value.get(),
-              "Found non-float value '" + value->GetText() +
+              MessageConsumer::Severity::kError, &value,
+              "Found non-float value '" + value.GetText() +
                   "' for float uniform");
           return failure_result;
         }
-        float_values.push_back(std::stof(value->GetText()));
+        float float_value;
+        if (!ConvertFloatLiteral(value, &float_value)) {
+          return failure_result;
+        }
+        float_values.push_back(float_value);
       }
       if (maybe_array_size.first) {
         return {true,
@@ -1333,36 +1604,67 @@ std::pair<bool, UniformValue> Parser::ProcessUniformValue(
 }
 
 bool Parser::ParseParameters(
-    const std::map<Token::Type, std::function<bool()>>& parameter_parsers) {
-  std::set<Token::Type> observed;
+    std::initializer_list<ParameterParser> parameter_parsers) {
+  // Parameters are identified by their position in |parameter_parsers|, so
+  // that the parameters seen so far can be tracked with a bitmask.
+  assert(parameter_parsers.size() <= kMaxParameters &&
+         "Too many parameters for a single command.");
+  uint32_t required = 0;
+  uint32_t parameter_bit = 1;
+  for (const auto& parameter_parser : parameter_parsers) {
+    if (!parameter_parser.IsOptional()) {
+      required |= parameter_bit;
+    }
+    parameter_bit <<= 1U;
+  }
+  uint32_t observed = 0;
   while (true) {
     auto token = tokenizer_->PeekNextToken();
-    if (parameter_parsers.count(token->GetType()) == 0) {
+    parameter_bit = 1;
+    const ParameterParser* parameter_parser = parameter_parsers.begin();
+    while (parameter_parser != parameter_parsers.end() &&
+           parameter_parser->GetType() != token.GetType()) {
+      parameter_bit <<= 1U;
+      parameter_parser++;
+    }
+    if (parameter_parser == parameter_parsers.end()) {
       break;
     }
-    if (observed.count(token->GetType()) > 0) {
+    if ((observed & parameter_bit) != 0) {
       message_consumer_->Message(
-          MessageConsumer::Severity::kError, token.get(),
-          "Duplicate parameter '" + token->GetText() + "'");
+          MessageConsumer::Severity::kError, &token,
+          "Duplicate parameter '" + token.GetText() + "'");
       return false;
     }
-    observed.insert(token->GetType());
+    observed |= parameter_bit;
     tokenizer_->NextToken();
-    if (!parameter_parsers.at(token->GetType())()) {
+    if (!(*parameter_parser)()) {
       return false;
     }
   }
-  bool all_parameters_present = true;
-  for (const auto& entry : parameter_parsers) {
-    if (observed.count(entry.first) == 0) {
-      message_consumer_->Message(
-          MessageConsumer::Severity::kError, tokenizer_->PeekNextToken().get(),
-          "Missing parameter '" + Tokenizer::KeywordToString(entry.first) +
-              "'");
-      all_parameters_present = false;
+  if ((observed & required) == required) {
+    return true;
+  }
+  // Missing parameters are reported in keyword order, regardless of the order
+  // in which the parameters were listed.
+  std::array<Token::Type, kMaxParameters> missing;
+  size_t num_missing = 0;
+  parameter_bit = 1;
+  for (const auto& parameter_parser : parameter_parsers) {
+    if ((required & ~observed & parameter_bit) != 0) {
+      missing[num_missing++] = parameter_parser.GetType();
     }
+    parameter_bit <<= 1U;
   }
-  return all_parameters_present;
+  std::sort(missing.begin(), missing.begin() + num_missing);
+  auto next_token = tokenizer_->PeekNextToken();
+  for (size_t index = 0; index < num_missing; index++) {
+    message_consumer_->Message(
+        MessageConsumer::Severity::kError, &next_token,
+        "Missing parameter '" + Tokenizer::KeywordToString(missing[index]) +
+            "'");
+  }
+  return false;
 }
 
 std::pair<bool, VertexAttributeInfo> Parser::ParseVertexAttributeInfo() {
@@ -1374,14 +1676,14 @@ std::pair<bool, VertexAttributeInfo> Parser::ParseVertexAttributeInfo() {
           {{Token::Type::kKeywordBuffer,
             [this, &buffer_identifier]() -> bool {
               auto token = tokenizer_->NextToken();
-              if (!token->IsIdentifier()) {
+              if (!token.IsIdentifier()) {
                 message_consumer_->Message(
-                    MessageConsumer::Severity::kError, token.get(),
+                    MessageConsumer::Severity::kError, &token,
                     "Expected identifier for vertex buffer, got '" +
-                        token->GetText() + "'");
+                        token.GetText() + "'");
                 return false;
               }
-              buffer_identifier = token->GetText();
+              buffer_identifier = token.GetText();
               return true;
             }},
            {Token::Type::kKeywordOffsetBytes,
@@ -1418,18 +1720,21 @@ std::pair<bool, VertexAttributeInfo> Parser::ParseVertexAttributeInfo() {
 
 std::pair<bool, uint8_t> Parser::ParseUint8(const std::string& result_name) {
   auto token = tokenizer_->NextToken();
-  if (!token->IsIntLiteral()) {
+  if (!token.IsIntLiteral()) {
     message_consumer_->Message(
-        MessageConsumer::Severity::kError, token.get(),
-        "Expected integer " + result_name + ", got '" + token->GetText() + "'");
+        MessageConsumer::Severity::kError, &token,
+        "Expected integer " + result_name + ", got '" + token.GetText() + "'");
+    return {false, static_cast<uint8_t>(0U)};
+  }
+  int64_t result;
+  if (!ConvertIntLiteral(token, &result)) {
     return {false, static_cast<uint8_t>(0U)};
   }
-  int64_t result = std::stol(token->GetText());
   if (result < 0 || result > UINT8_MAX) {
-    message_consumer_->Message(MessageConsumer::Severity::kError, token.get(),
+    message_consumer_->Message(MessageConsumer::Severity::kError, &token,
                                "Expected integer " + result_name +
                                    " in the range [0, 255], got '" +
-                                   token->GetText() + "'");
+                                   token.GetText() + "'");
     return {false, static_cast<uint8_t>(0U)};
   }
   return {true, static_cast<uint8_t>(result)};
@@ -1437,23 +1742,26 @@ std::pair<bool, uint8_t> Parser::ParseUint8(const std::string& result_name) {
 
 std::pair<bool, uint32_t> Parser::ParseUint32(const std::string& result_name) {
   auto token = tokenizer_->NextToken();
-  if (!token->IsIntLiteral()) {
+  if (!token.IsIntLiteral()) {
     message_consumer_->Message(
-        MessageConsumer::Severity::kError, token.get(),
-        "Expected integer " + result_name + ", got '" + token->GetText() + "'");
+        MessageConsumer::Severity::kError, &token,
+        "Expected integer " + result_name + ", got '" + token.GetText() + "'");
+    return {false, 0U};
+  }
+  int64_t result;
+  if (!ConvertIntLiteral(token, &result)) {
     return {false, 0U};
   }
-  int64_t result = std::stol(token->GetText());
   if (result < 0) {
-    message_consumer_->Message(MessageConsumer::Severity::kError, token.get(),
+    message_consumer_->Message(MessageConsumer::Severity::kError, &token,
                                "Expected non-negative integer " + result_name +
-                                   ", got '" + token->GetText() + "'");
+                                   ", got '" + token.GetText() + "'");
     return {false, 0U};
   }
   if (result > UINT32_MAX) {
     message_consumer_->Message(
-        MessageConsumer::Severity::kError, token.get(),
-        "Value '" + token->GetText() + "' is out of range");
+        MessageConsumer::Severity::kError, &token,
+        "Value '" + token.GetText() + "' is out of range");
     return {false, 0U};
   }
   return {true, static_cast<uint32_t>(result)};
@@ -1461,17 +1769,78 @@ std::pair<bool, uint32_t> Parser::ParseUint32(const std::string& result_name) {
 
 std::pair<bool, float> Parser::ParseFloat(const std::string& result_name) {
   auto token = tokenizer_->NextToken();
-  if (!token->IsFloatLiteral()) {
+  if (!token.IsFloatLiteral()) {
     message_consumer_->Message(
-        MessageConsumer::Severity::kError, token.get(),
-        "Expected float " + result_name + ", got '" + token->GetText() + "'");
+        MessageConsumer::Severity::kError, &token,
+        "Expected float " + result_name + ", got '" + token.GetText() + "'");
     return {false, 0.0F};
   }
-  return {true, std::stof(token->GetText())};
+  float result;
+  if (!ConvertFloatLiteral(token, &result)) {
+    return {false, 0.0F};
+  }
+  return {true, result};
+}
+
+bool Parser::ConvertIntLiteral(const Token& token, int64_t* result) {
+  assert(token.IsIntLiteral() && "Expected an integer literal.");
+  if (!ParseIntLiteral(token.GetData(), token.GetLength(), result)) {
+    message_consumer_->Message(
+        MessageConsumer::Severity::kError, &token,
+        "Invalid integer literal '" + token.GetText() + "'");
+    return false;
+  }
+  return true;
+}
+
+bool Parser::ConvertFloatLiteral(const Token& token, float* result) {
+  assert(token.IsFloatLiteral() && "Expected a float literal.");
+  if (!ParseFloatLiteral(token.GetData(), token.GetLength(), result)) {
+    message_consumer_->Message(
+        MessageConsumer::Severity::kError, &token,
+        "Invalid float literal '" + token.GetText() + "'");
+    return false;
+  }
+  return true;
+}
+
+const SourceBuffer* Parser::LoadFile(const Token& filename) {
+  if (!filename.IsString()) {
+    message_consumer_->Message(
+        MessageConsumer::Severity::kError, &filename,
+        "Expected filename string, got '" + filename.GetText() + "'");
+    return nullptr;
+  }
+  std::string name =
+      filename.GetText().substr(1, filename.GetText().length() - 2);
+  // "-" would denote standard input, which holds the script itself (if
+  // anything), not the contents of a file that the script refers to.
+  if (name == "-") {
+    message_consumer_->Message(MessageConsumer::Severity::kError, &filename,
+                               "Standard input cannot be used as a file");
+    return nullptr;
+  }
+  std::string error_message;
+  std::shared_ptr<const SourceBuffer> file =
+      file_cache_->Load(name, &error_message);
+  if (file == nullptr) {
+    message_consumer_->Message(MessageConsumer::Severity::kError, &filename,
+                               error_message);
+    return nullptr;
+  }
+  // The arena shares ownership of the file, so that the file's contents
+  // remain valid for as long as the commands that refer to them.
+  return arena_->New<std::shared_ptr<const SourceBuffer>>(std::move(file))
+      ->get();
+}
+
+const Token* Parser::RetainToken(const Token& token) {
+  return arena_->New<Token>(token);
 }
 
 std::unique_ptr<ShaderTrapProgram> Parser::GetParsedProgram() {
-  return MakeUnique<ShaderTrapProgram>(std::move(parsed_commands_));
+  return MakeUnique<ShaderTrapProgram>(
+      std::move(source_), std::move(arena_), std::move(parsed_commands_));
 }
 
 }  // namespace shadertrap
@@ -18,8 +18,11 @@
 
 namespace shadertrap {
 
-ShaderTrapProgram::ShaderTrapProgram(
-    std::vector<std::unique_ptr<Command>> commands)
-    : commands_(std::move(commands)) {}
+ShaderTrapProgram::ShaderTrapProgram(std::unique_ptr<SourceBuffer> source,
+                                     std::unique_ptr<Arena> arena,
+                                     std::vector<Command*> commands)
+    : source_(std::move(source)),
+      arena_(std::move(arena)),
+      commands_(std::move(commands)) {}
 
 }  // namespace shadertrap
@@ -0,0 +1,141 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libshadertrap/source_buffer.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <fstream>
+#include <iostream>
+#include <istream>
+#include <iterator>
+#include <utility>
+
+#include "libshadertrap/make_unique.h"
+
+namespace shadertrap {
+
+namespace {
+
+std::string ReadStream(std::istream* stream) {
+  return std::string(std::istreambuf_iterator<char>(*stream),
+                     std::istreambuf_iterator<char>());
+}
+
+// Used for files that cannot be memory-mapped, such as pipes.
+std::unique_ptr<SourceBuffer> ReadFile(const std::string& filename,
+                                       std::string* error_message) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file) {
+    *error_message = "Could not open '" + filename + "'";
+    return nullptr;
+  }
+  return MakeUnique<SourceBuffer>(ReadStream(&file));
+}
+
+}  // namespace
+
+SourceBuffer::SourceBuffer(std::string data)
+    : owned_data_(std::move(data)),
+      mapping_(nullptr),
+      data_(owned_data_.data()),
+      size_(owned_data_.size()) {}
+
+SourceBuffer::SourceBuffer(void* mapping, size_t size)
+    : mapping_(mapping), data_(static_cast<char*>(mapping)), size_(size) {}
+
+SourceBuffer::~SourceBuffer() {
+  if (mapping_ == nullptr) {
+    return;
+  }
+#if defined(_WIN32)
+  UnmapViewOfFile(mapping_);
+#else
+  munmap(mapping_, size_);
+#endif
+}
+
+std::unique_ptr<SourceBuffer> SourceBuffer::FromFile(
+    const std::string& filename, std::string* error_message) {
+  if (filename == "-") {
+    return MakeUnique<SourceBuffer>(ReadStream(&std::cin));
+  }
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    *error_message = "Could not open '" + filename + "'";
+    return nullptr;
+  }
+  LARGE_INTEGER file_size;
+  if (GetFileType(file) != FILE_TYPE_DISK ||
+      GetFileSizeEx(file, &file_size) == 0 || file_size.QuadPart == 0) {
+    CloseHandle(file);
+    return ReadFile(filename, error_message);
+  }
+  HANDLE file_mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  void* mapping = file_mapping == nullptr
+                      ? nullptr
+                      : MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0);
+  // The view keeps the file mapping alive, so the handles can be closed.
+  if (file_mapping != nullptr) {
+    CloseHandle(file_mapping);
+  }
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    return ReadFile(filename, error_message);
+  }
+  return std::unique_ptr<SourceBuffer>(
+      new SourceBuffer(mapping, static_cast<size_t>(file_size.QuadPart)));
+#else
+  int file = open(filename.c_str(), O_RDONLY);
+  if (file == -1) {
+    *error_message = "Could not open '" + filename + "'";
+    return nullptr;
+  }
+  struct stat file_status = {};
+  if (fstat(file, &file_status) != 0 || !S_ISREG(file_status.st_mode) ||
+      file_status.st_size == 0) {
+    // Pipes and other special files cannot be mapped, and an empty mapping is
+    // not permitted.
+    close(file);
+    return ReadFile(filename, error_message);
+  }
+  const auto size = static_cast<size_t>(file_status.st_size);
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+  // The mapping remains valid after the file is closed.
+  close(file);
+  if (mapping == MAP_FAILED) {
+    return ReadFile(filename, error_message);
+  }
+  return std::unique_ptr<SourceBuffer>(new SourceBuffer(mapping, size));
+#endif
+}
+
+}  // namespace shadertrap
@@ -0,0 +1,193 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libshadertrap/text_scanning.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SHADERTRAP_SCAN_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SHADERTRAP_SCAN_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace shadertrap {
+
+namespace {
+
+bool IsWhitespace(char c) {
+  switch (c) {
+    case '\0':
+    case '\t':
+    case '\n':
+    case '\f':
+    case '\r':
+    case ' ':
+      return true;
+    default:
+      return false;
+  }
+}
+
+#if defined(SHADERTRAP_SCAN_AVX2) || defined(SHADERTRAP_SCAN_SSE2)
+
+// A thin layer over the vector instructions, so that the scanning routines
+// below can be written once for both instruction sets. A mask has bit i set if
+// byte i of the corresponding vector is 0xFF.
+#if defined(SHADERTRAP_SCAN_AVX2)
+using Vector = __m256i;
+const size_t kVectorSize = 32;
+const uint32_t kAllLanes = 0xFFFFFFFFU;
+
+Vector Load(const char* data) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+}
+
+Vector Splat(char c) { return _mm256_set1_epi8(c); }
+
+Vector Equal(Vector a, Vector b) { return _mm256_cmpeq_epi8(a, b); }
+
+Vector Or(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+
+uint32_t Mask(Vector a) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(a));
+}
+#else
+using Vector = __m128i;
+const size_t kVectorSize = 16;
+const uint32_t kAllLanes = 0xFFFFU;
+
+Vector Load(const char* data) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+Vector Splat(char c) { return _mm_set1_epi8(c); }
+
+Vector Equal(Vector a, Vector b) { return _mm_cmpeq_epi8(a, b); }
+
+Vector Or(Vector a, Vector b) { return _mm_or_si128(a, b); }
+
+uint32_t Mask(Vector a) { return static_cast<uint32_t>(_mm_movemask_epi8(a)); }
+#endif
+
+// Yields the index of the lowest set bit of |mask|, which must be non-zero.
+size_t LowestSetBit(uint32_t mask) {
+#if defined(_MSC_VER)
+  unsigned long result;  // NOLINT(google-runtime-int)
+  _BitScanForward(&result, mask);
+  return static_cast<size_t>(result);
+#else
+  return static_cast<size_t>(__builtin_ctz(mask));
+#endif
+}
+
+size_t CountSetBits(uint32_t mask) {
+  mask = mask - ((mask >> 1U) & 0x55555555U);
+  mask = (mask & 0x33333333U) + ((mask >> 2U) & 0x33333333U);
+  return static_cast<size_t>(
+      (((mask + (mask >> 4U)) & 0x0F0F0F0FU) * 0x01010101U) >> 24U);
+}
+
+#endif
+
+}  // namespace
+
+size_t FindNonWhitespace(const char* data, size_t begin, size_t end) {
+  size_t position = begin;
+  // Whitespace runs are usually short, so check the first byte before paying
+  // for a vector load.
+  if (position < end && !IsWhitespace(data[position])) {
+    return position;
+  }
+#if defined(SHADERTRAP_SCAN_AVX2) || defined(SHADERTRAP_SCAN_SSE2)
+  const Vector nul = Splat('\0');
+  const Vector tab = Splat('\t');
+  const Vector newline = Splat('\n');
+  const Vector form_feed = Splat('\f');
+  const Vector carriage_return = Splat('\r');
+  const Vector space = Splat(' ');
+  for (; position + kVectorSize <= end; position += kVectorSize) {
+    const Vector bytes = Load(data + position);
+    const uint32_t whitespace = Mask(
+        Or(Or(Or(Equal(bytes, nul), Equal(bytes, tab)),
+              Or(Equal(bytes, newline), Equal(bytes, form_feed))),
+           Or(Equal(bytes, carriage_return), Equal(bytes, space))));
+    if (whitespace != kAllLanes) {
+      return position + LowestSetBit(~whitespace & kAllLanes);
+    }
+  }
+#endif
+  while (position < end && IsWhitespace(data[position])) {
+    position++;
+  }
+  return position;
+}
+
+size_t FindNewline(const char* data, size_t begin, size_t end) {
+  if (begin >= end) {
+    return end;
+  }
+  // memchr is vectorized by the C library on all of the platforms of interest.
+  const void* newline = std::memchr(data + begin, '\n', end - begin);
+  return newline == nullptr
+             ? end
+             : static_cast<size_t>(static_cast<const char*>(newline) - data);
+}
+
+size_t FindQuoteOrNewline(const char* data, size_t begin, size_t end) {
+  size_t position = begin;
+#if defined(SHADERTRAP_SCAN_AVX2) || defined(SHADERTRAP_SCAN_SSE2)
+  const Vector quote = Splat('"');
+  const Vector newline = Splat('\n');
+  for (; position + kVectorSize <= end; position += kVectorSize) {
+    const Vector bytes = Load(data + position);
+    const uint32_t matches =
+        Mask(Or(Equal(bytes, quote), Equal(bytes, newline)));
+    if (matches != 0) {
+      return position + LowestSetBit(matches);
+    }
+  }
+#endif
+  while (position < end && data[position] != '"' && data[position] != '\n') {
+    position++;
+  }
+  return position;
+}
+
+size_t CountNewlines(const char* data, size_t begin, size_t end) {
+  size_t result = 0;
+  size_t position = begin;
+#if defined(SHADERTRAP_SCAN_AVX2) || defined(SHADERTRAP_SCAN_SSE2)
+  const Vector newline = Splat('\n');
+  for (; position + kVectorSize <= end; position += kVectorSize) {
+    result += CountSetBits(Mask(Equal(Load(data + position), newline)));
+  }
+#endif
+  for (; position < end; position++) {
+    if (data[position] == '\n') {
+      result++;
+    }
+  }
+  return result;
+}
+
+}  // namespace shadertrap
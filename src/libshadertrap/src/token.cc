@@ -14,16 +14,32 @@
 
 #include "libshadertrap/token.h"
 
+#include <cstring>
 #include <sstream>
-#include <utility>
 
 namespace shadertrap {
 
 Token::Token(Type type, size_t line, size_t column)
-    : text_(std::string()), type_(type), line_(line), column_(column) {}
-
-Token::Token(Type type, std::string text, size_t line, size_t column)
-    : text_(std::move(text)), type_(type), line_(line), column_(column) {}
+    : type_(type),
+      source_(""),
+      offset_(0),
+      length_(0),
+      line_(line),
+      column_(column) {}
+
+Token::Token(Type type, const char* source, size_t offset, size_t length,
+             size_t line, size_t column)
+    : type_(type),
+      source_(source),
+      offset_(offset),
+      length_(length),
+      line_(line),
+      column_(column) {}
+
+bool Token::TextEquals(const char* text) const {
+  return strlen(text) == length_ &&
+         memcmp(source_ + offset_, text, length_) == 0;
+}
 
 bool Token::IsEOS() const { return type_ == Type::kEOS; }
 
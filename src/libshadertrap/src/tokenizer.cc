@@ -14,252 +14,506 @@
 
 #include "libshadertrap/tokenizer.h"
 
-#include <algorithm>
 #include <cassert>
-#include <cctype>
-#include <cstdint>
-#include <sstream>
-#include <utility>
+#include <cstring>
+#include <initializer_list>
 
-#include "libshadertrap/make_unique.h"
+#include "libshadertrap/text_scanning.h"
 
 namespace shadertrap {
 
-Tokenizer::Tokenizer(std::string data) : data_(std::move(data)) {}
+namespace {
 
-std::unique_ptr<Token> Tokenizer::NextToken(
-    bool ignore_whitespace_and_comments) {
+// Locale-independent replacements for the <cctype> classification functions,
+// which also avoid undefined behaviour for negative char values.
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+bool IsAlpha(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+bool IsAlnum(char c) { return IsAlpha(c) || IsDigit(c); }
+
+struct Keyword {
+  const char* text;
+  Token::Type type;
+};
+
+// The keywords, in the order in which their token types are declared, so that
+// the text of a keyword can be found by indexing with its token type.
+constexpr Keyword kKeywords[] = {
+    {"ASSERT_PIXELS", Token::Type::kKeywordAssertPixels},
+    {"ASSERT_EQUAL", Token::Type::kKeywordAssertEqual},
+    {"ASSERT_SIMILAR_EMD_HISTOGRAM",
+     Token::Type::kKeywordAssertSimilarEmdHistogram},
+    {"BINDING", Token::Type::kKeywordBinding},
+    {"BIND_SAMPLER", Token::Type::kKeywordBindSampler},
+    {"BIND_STORAGE_BUFFER", Token::Type::kKeywordBindStorageBuffer},
+    {"BIND_TEXTURE", Token::Type::kKeywordBindTexture},
+    {"BIND_UNIFORM_BUFFER", Token::Type::kKeywordBindUniformBuffer},
+    {"BUFFER", Token::Type::kKeywordBuffer},
+    {"BUFFER1", Token::Type::kKeywordBuffer1},
+    {"BUFFER2", Token::Type::kKeywordBuffer2},
+    {"COMPILE_SHADER", Token::Type::kKeywordCompileShader},
+    {"COMPUTE", Token::Type::kKeywordCompute},
+    {"CREATE_BUFFER", Token::Type::kKeywordCreateBuffer},
+    {"CREATE_EMPTY_TEXTURE_2D", Token::Type::kKeywordCreateEmptyTexture2d},
+    {"CREATE_PROGRAM", Token::Type::kKeywordCreateProgram},
+    {"CREATE_RENDERBUFFER", Token::Type::kKeywordCreateRenderbuffer},
+    {"CREATE_SAMPLER", Token::Type::kKeywordCreateSampler},
+    {"DECLARE_SHADER", Token::Type::kKeywordDeclareShader},
+    {"DIMENSION", Token::Type::kKeywordDimension},
+    {"DUMP_RENDERBUFFER", Token::Type::kKeywordDumpRenderbuffer},
+    {"END", Token::Type::kKeywordEnd},
+    {"EXPECTED", Token::Type::kKeywordExpected},
+    {"FILE", Token::Type::kKeywordFile},
+    {"FORMAT", Token::Type::kKeywordFormat},
+    {"FRAGMENT", Token::Type::kKeywordFragment},
+    {"FRAMEBUFFER_ATTACHMENTS", Token::Type::kKeywordFramebufferAttachments},
+    {"HEIGHT", Token::Type::kKeywordHeight},
+    {"INDEX_DATA", Token::Type::kKeywordIndexData},
+    {"INIT_PATTERN", Token::Type::kKeywordInitPattern},
+    {"INIT_TYPE", Token::Type::kKeywordInitType},
+    {"INIT_VALUES", Token::Type::kKeywordInitValues},
+    {"LOCATION", Token::Type::kKeywordLocation},
+    {"NUM_GROUPS_X", Token::Type::kKeywordNumGroupsX},
+    {"NUM_GROUPS_Y", Token::Type::kKeywordNumGroupsY},
+    {"NUM_GROUPS_Z", Token::Type::kKeywordNumGroupsZ},
+    {"OFFSET_BYTES", Token::Type::kKeywordOffsetBytes},
+    {"PROGRAM", Token::Type::kKeywordProgram},
+    {"RECTANGLE", Token::Type::kKeywordRectangle},
+    {"RENDERBUFFER", Token::Type::kKeywordRenderbuffer},
+    {"RUN_COMPUTE", Token::Type::kKeywordRunCompute},
+    {"RUN_GRAPHICS", Token::Type::kKeywordRunGraphics},
+    {"SAMPLER", Token::Type::kKeywordSampler},
+    {"SET_SAMPLER_PARAMETER", Token::Type::kKeywordSetSamplerParameter},
+    {"SET_TEXTURE_PARAMETER", Token::Type::kKeywordSetTextureParameter},
+    {"SET_UNIFORM", Token::Type::kKeywordSetUniform},
+    {"SHADER", Token::Type::kKeywordShader},
+    {"SHADERS", Token::Type::kKeywordShaders},
+    {"SIZE_BYTES", Token::Type::kKeywordSizeBytes},
+    {"STRIDE_BYTES", Token::Type::kKeywordStrideBytes},
+    {"TEXTURE", Token::Type::kKeywordTexture},
+    {"TEXTURE_MAG_FILTER", Token::Type::kKeywordTextureMagFilter},
+    {"TEXTURE_MIN_FILTER", Token::Type::kKeywordTextureMinFilter},
+    {"TEXTURE_UNIT", Token::Type::kKeywordTextureUnit},
+    {"TOLERANCE", Token::Type::kKeywordTolerance},
+    {"TOPOLOGY", Token::Type::kKeywordTopology},
+    {"TRIANGLES", Token::Type::kKeywordTriangles},
+    {"TYPE", Token::Type::kKeywordType},
+    {"VALUES", Token::Type::kKeywordValues},
+    {"VERTEX", Token::Type::kKeywordVertex},
+    {"VERTEX_COUNT", Token::Type::kKeywordVertexCount},
+    {"VERTEX_DATA", Token::Type::kKeywordVertexData},
+    {"WIDTH", Token::Type::kKeywordWidth},
+};
+
+constexpr size_t kNumKeywords = sizeof(kKeywords) / sizeof(kKeywords[0]);
+
+constexpr size_t KeywordIndex(Token::Type type) {
+  return static_cast<size_t>(type) -
+         static_cast<size_t>(Token::Type::kKeywordAssertPixels);
+}
+
+constexpr bool KeywordTableIsInTypeOrder(size_t index) {
+  return index == kNumKeywords ||
+         (KeywordIndex(kKeywords[index].type) == index &&
+          KeywordTableIsInTypeOrder(index + 1));
+}
+
+static_assert(kNumKeywords == KeywordIndex(Token::Type::kKeywordWidth) + 1,
+              "Every keyword token type must have an entry in kKeywords.");
+static_assert(KeywordTableIsInTypeOrder(0),
+              "kKeywords must be ordered by token type.");
+
+// Yields whichever of |candidates| has text |text|, or kIdentifier if there is
+// no such candidate. All candidates must have length |length|.
+Token::Type MatchKeyword(const char* text, size_t length,
+                         std::initializer_list<Token::Type> candidates) {
+  for (auto candidate : candidates) {
+    assert(std::strlen(kKeywords[KeywordIndex(candidate)].text) == length &&
+           "Keyword candidates must have the length being matched.");
+    if (std::memcmp(text, kKeywords[KeywordIndex(candidate)].text, length) ==
+        0) {
+      return candidate;
+    }
+  }
+  return Token::Type::kIdentifier;
+}
+
+// Determines whether the identifier-like token with text |text| of length
+// |length| is a keyword, without hashing or allocating: the length and first
+// character of the keywords are enough to narrow the search to at most a
+// few candidates, which are then compared directly.
+Token::Type LookupKeyword(const char* text, size_t length) {
+  switch (length) {
+    case 3:
+      return MatchKeyword(text, length, {Token::Type::kKeywordEnd});
+    case 4:
+      switch (text[0]) {
+        case 'F':
+          return MatchKeyword(text, length, {Token::Type::kKeywordFile});
+        case 'T':
+          return MatchKeyword(text, length, {Token::Type::kKeywordType});
+        default:
+          return Token::Type::kIdentifier;
+      }
+    case 5:
+      return MatchKeyword(text, length, {Token::Type::kKeywordWidth});
+    case 6:
+      switch (text[0]) {
+        case 'B':
+          return MatchKeyword(text, length, {Token::Type::kKeywordBuffer});
+        case 'F':
+          return MatchKeyword(text, length, {Token::Type::kKeywordFormat});
+        case 'H':
+          return MatchKeyword(text, length, {Token::Type::kKeywordHeight});
+        case 'S':
+          return MatchKeyword(text, length, {Token::Type::kKeywordShader});
+        case 'V':
+          return MatchKeyword(
+              text, length, {Token::Type::kKeywordValues,
+                             Token::Type::kKeywordVertex});
+        default:
+          return Token::Type::kIdentifier;
+      }
+    case 7:
+      switch (text[0]) {
+        case 'B':
+          return MatchKeyword(
+              text, length, {Token::Type::kKeywordBinding,
+                             Token::Type::kKeywordBuffer1,
+                             Token::Type::kKeywordBuffer2});
+        case 'C':
+          return MatchKeyword(text, length, {Token::Type::kKeywordCompute});
+        case 'P':
+          return MatchKeyword(text, length, {Token::Type::kKeywordProgram});
+        case 'S':
+          return MatchKeyword(
+              text, length, {Token::Type::kKeywordSampler,
+                             Token::Type::kKeywordShaders});
+        case 'T':
+          return MatchKeyword(text, length, {Token::Type::kKeywordTexture});
+        default:
+          return Token::Type::kIdentifier;
+      }
+    case 8:
+      switch (text[0]) {
+        case 'E':
+          return MatchKeyword(text, length, {Token::Type::kKeywordExpected});
+        case 'F':
+          return MatchKeyword(text, length, {Token::Type::kKeywordFragment});
+        case 'L':
+          return MatchKeyword(text, length, {Token::Type::kKeywordLocation});
+        case 'T':
+          return MatchKeyword(text, length, {Token::Type::kKeywordTopology});
+        default:
+          return Token::Type::kIdentifier;
+      }
+    case 9:
+      switch (text[0]) {
+        case 'D':
+          return MatchKeyword(text, length, {Token::Type::kKeywordDimension});
+        case 'I':
+          return MatchKeyword(text, length, {Token::Type::kKeywordInitType});
+        case 'R':
+          return MatchKeyword(text, length, {Token::Type::kKeywordRectangle});
+        case 'T':
+          return MatchKeyword(
+              text, length, {Token::Type::kKeywordTolerance,
+                             Token::Type::kKeywordTriangles});
+        default:
+          return Token::Type::kIdentifier;
+      }
+    case 10:
+      switch (text[0]) {
+        case 'I':
+          return MatchKeyword(text, length, {Token::Type::kKeywordIndexData});
+        case 'S':
+          return MatchKeyword(text, length, {Token::Type::kKeywordSizeBytes});
+        default:
+          return Token::Type::kIdentifier;
+      }
+    case 11:
+      switch (text[0]) {
+        case 'I':
+          return MatchKeyword(text, length, {Token::Type::kKeywordInitValues});
+        case 'R':
+          return MatchKeyword(text, length, {Token::Type::kKeywordRunCompute});
+        case 'S':
+          return MatchKeyword(text, length, {Token::Type::kKeywordSetUniform});
+        case 'V':
+          return MatchKeyword(text, length, {Token::Type::kKeywordVertexData});
+        default:
+          return Token::Type::kIdentifier;
+      }
+    case 12:
+      switch (text[0]) {
+        case 'A':
+          return MatchKeyword(text, length, {Token::Type::kKeywordAssertEqual});
+        case 'B':
+          return MatchKeyword(
+              text, length, {Token::Type::kKeywordBindSampler,
+                             Token::Type::kKeywordBindTexture});
+        case 'I':
+          return MatchKeyword(text, length, {Token::Type::kKeywordInitPattern});
+        case 'N':
+          return MatchKeyword(
+              text, length, {Token::Type::kKeywordNumGroupsX,
+                             Token::Type::kKeywordNumGroupsY,
+                             Token::Type::kKeywordNumGroupsZ});
+        case 'O':
+          return MatchKeyword(text, length, {Token::Type::kKeywordOffsetBytes});
+        case 'R':
+          return MatchKeyword(
+              text, length, {Token::Type::kKeywordRenderbuffer,
+                             Token::Type::kKeywordRunGraphics});
+        case 'S':
+          return MatchKeyword(text, length, {Token::Type::kKeywordStrideBytes});
+        case 'T':
+          return MatchKeyword(text, length, {Token::Type::kKeywordTextureUnit});
+        case 'V':
+          return MatchKeyword(text, length, {Token::Type::kKeywordVertexCount});
+        default:
+          return Token::Type::kIdentifier;
+      }
+    case 13:
+      switch (text[0]) {
+        case 'A':
+          return MatchKeyword(
+              text, length, {Token::Type::kKeywordAssertPixels});
+        case 'C':
+          return MatchKeyword(
+              text, length, {Token::Type::kKeywordCreateBuffer});
+        default:
+          return Token::Type::kIdentifier;
+      }
+    case 14:
+      switch (text[0]) {
+        case 'C':
+          return MatchKeyword(
+              text, length, {Token::Type::kKeywordCompileShader,
+                             Token::Type::kKeywordCreateProgram,
+                             Token::Type::kKeywordCreateSampler});
+        case 'D':
+          return MatchKeyword(
+              text, length, {Token::Type::kKeywordDeclareShader});
+        default:
+          return Token::Type::kIdentifier;
+      }
+    case 17:
+      return MatchKeyword(
+          text, length, {Token::Type::kKeywordDumpRenderbuffer});
+    case 18:
+      return MatchKeyword(
+          text, length, {Token::Type::kKeywordTextureMagFilter,
+                         Token::Type::kKeywordTextureMinFilter});
+    case 19:
+      switch (text[0]) {
+        case 'B':
+          return MatchKeyword(
+              text, length, {Token::Type::kKeywordBindStorageBuffer,
+                             Token::Type::kKeywordBindUniformBuffer});
+        case 'C':
+          return MatchKeyword(
+              text, length, {Token::Type::kKeywordCreateRenderbuffer});
+        default:
+          return Token::Type::kIdentifier;
+      }
+    case 21:
+      return MatchKeyword(
+          text, length, {Token::Type::kKeywordSetSamplerParameter,
+                         Token::Type::kKeywordSetTextureParameter});
+    case 23:
+      switch (text[0]) {
+        case 'C':
+          return MatchKeyword(
+              text, length, {Token::Type::kKeywordCreateEmptyTexture2d});
+        case 'F':
+          return MatchKeyword(
+              text, length, {Token::Type::kKeywordFramebufferAttachments});
+        default:
+          return Token::Type::kIdentifier;
+      }
+    case 28:
+      return MatchKeyword(
+          text, length, {Token::Type::kKeywordAssertSimilarEmdHistogram});
+    default:
+      return Token::Type::kIdentifier;
+  }
+}
+
+}  // namespace
+
+Tokenizer::Tokenizer(const SourceBuffer* source)
+    : data_(source->GetData()), length_(source->GetSize()) {}
+
+Token Tokenizer::LexToken(bool ignore_whitespace_and_comments) {
   if (ignore_whitespace_and_comments) {
     SkipWhitespaceAndComments();
   }
+  const size_t start_position = position_;
   const size_t start_line = line_;
-  const size_t start_column = column_;
-  if (position_ >= data_.length()) {
-    return MakeUnique<Token>(Token::Type::kEOS, start_line, start_column);
+  const size_t start_column = GetColumn();
+  if (position_ >= length_) {
+    return Token(Token::Type::kEOS, start_line, start_column);
   }
+  // None of the tokens below, apart from strings, can span a newline, so the
+  // position can be moved on without tracking lines.
   if (data_[position_] == ',') {
-    AdvanceCharacter();
-    return MakeUnique<Token>(Token::Type::kComma, ",", start_line,
-                             start_column);
+    position_++;
+    return Token(Token::Type::kComma, data_, start_position, 1U, start_line,
+                 start_column);
   }
 
   if (data_[position_] == '[') {
-    AdvanceCharacter();
-    return MakeUnique<Token>(Token::Type::kSquareBracketOpen, "[", start_line,
-                             start_column);
+    position_++;
+    return Token(Token::Type::kSquareBracketOpen, data_, start_position, 1U,
+                 start_line, start_column);
   }
 
   if (data_[position_] == ']') {
-    AdvanceCharacter();
-    return MakeUnique<Token>(Token::Type::kSquareBracketClose, "]", start_line,
-                             start_column);
+    position_++;
+    return Token(Token::Type::kSquareBracketClose, data_, start_position, 1U,
+                 start_line, start_column);
   }
 
-  if (data_[position_] == '-' && position_ + 1 < data_.length() &&
+  if (data_[position_] == '-' && position_ + 1 < length_ &&
       data_[position_ + 1] == '>') {
-    AdvanceCharacter();
-    AdvanceCharacter();
-    return MakeUnique<Token>(Token::Type::kArrow, "->", start_line,
-                             start_column);
+    position_ += 2;
+    return Token(Token::Type::kArrow, data_, start_position, 2U, start_line,
+                 start_column);
   }
 
-  if (std::isalpha(data_[position_]) != 0 || data_[position_] == '_') {
-    std::stringstream stringstream;
-    stringstream << data_[position_];
-    AdvanceCharacter();
-    while (std::isalnum(data_[position_]) != 0 || data_[position_] == '_') {
-      stringstream << data_[position_];
-      AdvanceCharacter();
+  if (IsAlpha(data_[position_]) || data_[position_] == '_') {
+    position_++;
+    while (position_ < length_ &&
+           (IsAlnum(data_[position_]) || data_[position_] == '_')) {
+      position_++;
     }
-    return MakeUnique<Token>(keyword_to_token_type.count(stringstream.str()) > 0
-                                 ? keyword_to_token_type.at(stringstream.str())
-                                 : Token::Type::kIdentifier,
-                             stringstream.str(), start_line, start_column);
+    const size_t length = position_ - start_position;
+    return Token(LookupKeyword(data_ + start_position, length), data_,
+                 start_position, length, start_line, start_column);
   }
-  if (std::isdigit(data_[position_]) != 0 || data_[position_] == '.' ||
+  if (IsDigit(data_[position_]) || data_[position_] == '.' ||
       data_[position_] == '-') {
     bool is_float = data_[position_] == '.';
-    std::stringstream stringstream;
-    stringstream << data_[position_];
-    AdvanceCharacter();
-    while (std::isdigit(data_[position_]) != 0 || data_[position_] == '.') {
+    position_++;
+    while (position_ < length_ &&
+           (IsDigit(data_[position_]) || data_[position_] == '.')) {
       is_float |= data_[position_] == '.';
-      stringstream << data_[position_];
-      AdvanceCharacter();
+      position_++;
     }
-    return MakeUnique<Token>(
+    return Token(
         is_float ? Token::Type::kFloatLiteral : Token::Type::kIntLiteral,
-        stringstream.str(), start_line, start_column);
+        data_, start_position, position_ - start_position, start_line,
+        start_column);
   }
   if (data_[position_] == '"') {
-    size_t backup_position = position_;
-    size_t backup_column = column_;
-    std::stringstream stringstream;
-    do {
-      stringstream << data_[position_];
-      AdvanceCharacter();
-    } while (data_[position_] != '\n' && data_[position_] != '"' &&
-             position_ < data_.length());
-    if (data_[position_] == '"') {
-      stringstream << data_[position_];
-      AdvanceCharacter();
-      return MakeUnique<Token>(Token::Type::kString, stringstream.str(),
-                               start_line, start_column);
+    // A string must be terminated on the line on which it starts.
+    const size_t string_end =
+        FindQuoteOrNewline(data_, position_ + 1, length_);
+    if (string_end < length_ && data_[string_end] == '"') {
+      position_ = string_end + 1;
+      return Token(Token::Type::kString, data_, start_position,
+                   position_ - start_position, start_line, start_column);
     }
-    position_ = backup_position;
-    column_ = backup_column;
   }
-  return MakeUnique<Token>(Token::Type::kUnknown, start_line, start_column);
+  return Token(Token::Type::kUnknown, start_line, start_column);
 }
 
-std::unique_ptr<Token> Tokenizer::NextToken() { return NextToken(true); }
-
-std::unique_ptr<Token> Tokenizer::PeekNextToken(
-    bool ignore_whitespace_and_comments) {
-  size_t position_backup = position_;
-  size_t line_backup = line_;
-  size_t column_backup = column_;
-  auto result = NextToken(ignore_whitespace_and_comments);
-  position_ = position_backup;
-  line_ = line_backup;
-  column_ = column_backup;
-  return result;
+Token Tokenizer::NextToken(bool ignore_whitespace_and_comments) {
+  Lookahead& lookahead =
+      ignore_whitespace_and_comments ? lookahead_skipping_ : lookahead_raw_;
+  if (lookahead.valid) {
+    position_ = lookahead.position;
+    line_ = lookahead.line;
+    line_start_ = lookahead.line_start;
+    InvalidateLookahead();
+    return lookahead.token;
+  }
+  InvalidateLookahead();
+  return LexToken(ignore_whitespace_and_comments);
+}
+
+Token Tokenizer::PeekNextToken(bool ignore_whitespace_and_comments) {
+  Lookahead& lookahead =
+      ignore_whitespace_and_comments ? lookahead_skipping_ : lookahead_raw_;
+  if (!lookahead.valid) {
+    size_t position_backup = position_;
+    size_t line_backup = line_;
+    size_t line_start_backup = line_start_;
+    lookahead.token = LexToken(ignore_whitespace_and_comments);
+    lookahead.position = position_;
+    lookahead.line = line_;
+    lookahead.line_start = line_start_;
+    lookahead.valid = true;
+    position_ = position_backup;
+    line_ = line_backup;
+    line_start_ = line_start_backup;
+  }
+  return lookahead.token;
 }
 
-std::unique_ptr<Token> Tokenizer::PeekNextToken() {
-  return PeekNextToken(true);
+Token Tokenizer::PeekNextToken() { return PeekNextToken(true); }
+
+Token Tokenizer::NextToken() { return NextToken(true); }
+
+void Tokenizer::InvalidateLookahead() {
+  lookahead_raw_.valid = false;
+  lookahead_skipping_.valid = false;
 }
 
 void Tokenizer::SkipWhitespace() {
-  const uint8_t kFf = 0x0c;
-  while (position_ < data_.size()) {
-    switch (data_[position_]) {
-      case '\0':
-      case '\t':
-      case '\r':
-      case kFf:
-      case ' ':
-      case '\n':
-        AdvanceCharacter();
-        break;
-      default:
-        return;
-    }
-  }
+  InvalidateLookahead();
+  ConsumeWhitespace();
 }
 
-void Tokenizer::SkipWhitespaceAndComments() {
-  SkipWhitespace();
-  while (position_ < data_.size() && data_[position_] == '#') {
-    SkipLine();
-    SkipWhitespace();
-  }
+void Tokenizer::SkipLine() {
+  InvalidateLookahead();
+  ConsumeLine();
 }
 
-void Tokenizer::AdvanceCharacter() {
-  if (data_[position_] == '\n') {
-    line_++;
-    column_ = 1;
-  } else {
-    column_++;
+void Tokenizer::ConsumeWhitespace() {
+  AdvanceTo(FindNonWhitespace(data_, position_, length_));
+}
+
+void Tokenizer::SkipWhitespaceAndComments() {
+  ConsumeWhitespace();
+  while (position_ < length_ && data_[position_] == '#') {
+    ConsumeLine();
+    ConsumeWhitespace();
   }
-  position_++;
 }
 
-std::string Tokenizer::SkipLine() {
-  std::stringstream stringstream;
-  while (position_ < data_.length()) {
-    stringstream << data_[position_];
-    bool end_of_line = data_[position_] == '\n';
-    AdvanceCharacter();
-    if (end_of_line) {
-      break;
+void Tokenizer::AdvanceTo(size_t new_position) {
+  const size_t newlines = CountNewlines(data_, position_, new_position);
+  if (newlines > 0) {
+    line_ += newlines;
+    line_start_ = new_position;
+    while (data_[line_start_ - 1] != '\n') {
+      line_start_--;
     }
   }
-  return stringstream.str();
+  position_ = new_position;
 }
 
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wexit-time-destructors"
-#pragma clang diagnostic ignored "-Wglobal-constructors"
-// TODO(afd): Non constinit global variables are strongly discouraged.  Consider
-//  an alternative approach.
-const std::unordered_map<std::string, Token::Type>
-    Tokenizer::keyword_to_token_type = {  // NOLINT(cert-err58-cpp)
-        {"ASSERT_PIXELS", Token::Type::kKeywordAssertPixels},
-        {"ASSERT_EQUAL", Token::Type::kKeywordAssertEqual},
-        {"ASSERT_SIMILAR_EMD_HISTOGRAM",
-         Token::Type::kKeywordAssertSimilarEmdHistogram},
-        {"BINDING", Token::Type::kKeywordBinding},
-        {"BIND_SAMPLER", Token::Type::kKeywordBindSampler},
-        {"BIND_STORAGE_BUFFER", Token::Type::kKeywordBindStorageBuffer},
-        {"BIND_TEXTURE", Token::Type::kKeywordBindTexture},
-        {"BIND_UNIFORM_BUFFER", Token::Type::kKeywordBindUniformBuffer},
-        {"BUFFER", Token::Type::kKeywordBuffer},
-        {"BUFFER1", Token::Type::kKeywordBuffer1},
-        {"BUFFER2", Token::Type::kKeywordBuffer2},
-        {"COMPILE_SHADER", Token::Type::kKeywordCompileShader},
-        {"COMPUTE", Token::Type::kKeywordCompute},
-        {"CREATE_BUFFER", Token::Type::kKeywordCreateBuffer},
-        {"CREATE_EMPTY_TEXTURE_2D", Token::Type::kKeywordCreateEmptyTexture2d},
-        {"CREATE_PROGRAM", Token::Type::kKeywordCreateProgram},
-        {"CREATE_RENDERBUFFER", Token::Type::kKeywordCreateRenderbuffer},
-        {"CREATE_SAMPLER", Token::Type::kKeywordCreateSampler},
-        {"DECLARE_SHADER", Token::Type::kKeywordDeclareShader},
-        {"DIMENSION", Token::Type::kKeywordDimension},
-        {"DUMP_RENDERBUFFER", Token::Type::kKeywordDumpRenderbuffer},
-        {"END", Token::Type::kKeywordEnd},
-        {"EXPECTED", Token::Type::kKeywordExpected},
-        {"FILE", Token::Type::kKeywordFile},
-        {"FORMAT", Token::Type::kKeywordFormat},
-        {"FRAGMENT", Token::Type::kKeywordFragment},
-        {"FRAMEBUFFER_ATTACHMENTS",
-         Token::Type::kKeywordFramebufferAttachments},
-        {"HEIGHT", Token::Type::kKeywordHeight},
-        {"INDEX_DATA", Token::Type::kKeywordIndexData},
-        {"INIT_TYPE", Token::Type::kKeywordInitType},
-        {"INIT_VALUES", Token::Type::kKeywordInitValues},
-        {"LOCATION", Token::Type::kKeywordLocation},
-        {"NUM_GROUPS_X", Token::Type::kKeywordNumGroupsX},
-        {"NUM_GROUPS_Y", Token::Type::kKeywordNumGroupsY},
-        {"NUM_GROUPS_Z", Token::Type::kKeywordNumGroupsZ},
-        {"OFFSET_BYTES", Token::Type::kKeywordOffsetBytes},
-        {"PROGRAM", Token::Type::kKeywordProgram},
-        {"RECTANGLE", Token::Type::kKeywordRectangle},
-        {"RENDERBUFFER", Token::Type::kKeywordRenderbuffer},
-        {"RUN_COMPUTE", Token::Type::kKeywordRunCompute},
-        {"RUN_GRAPHICS", Token::Type::kKeywordRunGraphics},
-        {"SAMPLER", Token::Type::kKeywordSampler},
-        {"SET_SAMPLER_PARAMETER", Token::Type::kKeywordSetSamplerParameter},
-        {"SET_TEXTURE_PARAMETER", Token::Type::kKeywordSetTextureParameter},
-        {"SET_UNIFORM", Token::Type::kKeywordSetUniform},
-        {"SHADER", Token::Type::kKeywordShader},
-        {"SHADERS", Token::Type::kKeywordShaders},
-        {"SIZE_BYTES", Token::Type::kKeywordSizeBytes},
-        {"STRIDE_BYTES", Token::Type::kKeywordStrideBytes},
-        {"TEXTURE", Token::Type::kKeywordTexture},
-        {"TEXTURE_MAG_FILTER", Token::Type::kKeywordTextureMagFilter},
-        {"TEXTURE_MIN_FILTER", Token::Type::kKeywordTextureMinFilter},
-        {"TEXTURE_UNIT", Token::Type::kKeywordTextureUnit},
-        {"TOLERANCE", Token::Type::kKeywordTolerance},
-        {"TOPOLOGY", Token::Type::kKeywordTopology},
-        {"TRIANGLES", Token::Type::kKeywordTriangles},
-        {"TYPE", Token::Type::kKeywordType},
-        {"VALUES", Token::Type::kKeywordValues},
-        {"VERTEX", Token::Type::kKeywordVertex},
-        {"VERTEX_COUNT", Token::Type::kKeywordVertexCount},
-        {"VERTEX_DATA", Token::Type::kKeywordVertexData},
-        {"WIDTH", Token::Type::kKeywordWidth}};
-#pragma clang diagnostic pop
+void Tokenizer::ConsumeLine() {
+  const size_t newline = FindNewline(data_, position_, length_);
+  if (newline < length_) {
+    position_ = newline + 1;
+    line_++;
+    line_start_ = position_;
+  } else {
+    position_ = length_;
+  }
+}
 
 std::string Tokenizer::KeywordToString(Token::Type keyword_token_type) {
-  auto maybe_result = std::find_if(
-      keyword_to_token_type.begin(), keyword_to_token_type.end(),
-      [keyword_token_type](const std::pair<std::string, Token::Type>& entry)
-          -> bool { return entry.second == keyword_token_type; });
-  assert(maybe_result != keyword_to_token_type.end() &&
+  assert(keyword_token_type >= Token::Type::kKeywordAssertPixels &&
+         keyword_token_type <= Token::Type::kKeywordWidth &&
          "A keyword must exist for every keyword token type.");
-  return maybe_result->first;
+  return kKeywords[KeywordIndex(keyword_token_type)].text;
 }
 
 }  // namespace shadertrap
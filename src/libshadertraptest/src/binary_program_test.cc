@@ -0,0 +1,177 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libshadertrap/binary_program_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "libshadertrap/binary_program_writer.h"
+#include "libshadertrap/checker.h"
+#include "libshadertrap/collecting_message_consumer.h"
+#include "libshadertrap/command_create_buffer.h"
+#include "libshadertrap/command_declare_shader.h"
+#include "libshadertrap/make_unique.h"
+#include "libshadertrap/parser.h"
+#include "libshadertrap/source_buffer.h"
+#include "libshadertraptest/gtest.h"
+
+namespace shadertrap {
+namespace {
+
+const char* const kScript = R"(DECLARE_SHADER comp COMPUTE
+#version 310 es
+layout(local_size_x = 1) in;
+void main() {}
+END
+COMPILE_SHADER comp_compiled SHADER comp
+CREATE_PROGRAM prog SHADERS comp_compiled
+CREATE_BUFFER values SIZE_BYTES 8 INIT_TYPE float INIT_VALUES 1.5 2.5
+CREATE_BUFFER ramp SIZE_BYTES 16 INIT_TYPE uint INIT_PATTERN ramp 1 2
+CREATE_BUFFER noise SIZE_BYTES 4 INIT_TYPE byte INIT_PATTERN random 7
+SET_UNIFORM PROGRAM prog LOCATION 0 TYPE vec2 VALUES 1.0 2.0
+BIND_STORAGE_BUFFER BUFFER values BINDING 0
+RUN_COMPUTE PROGRAM prog NUM_GROUPS_X 1 NUM_GROUPS_Y 1 NUM_GROUPS_Z 1
+CREATE_RENDERBUFFER rb WIDTH 4 HEIGHT 4
+ASSERT_PIXELS EXPECTED 255 0 0 255 RENDERBUFFER rb RECTANGLE 0 0 4 4
+ASSERT_EQUAL BUFFER1 ramp BUFFER2 ramp
+)";
+
+std::unique_ptr<ShaderTrapProgram> ReadBinaryProgram(
+    const std::string& binary_program,
+    CollectingMessageConsumer* message_consumer) {
+  BinaryProgramReader reader(MakeUnique<SourceBuffer>(binary_program),
+                             message_consumer);
+  if (!reader.Read()) {
+    return nullptr;
+  }
+  return reader.GetProgram();
+}
+
+TEST(BinaryProgram, RoundTrip) {
+  CollectingMessageConsumer message_consumer;
+  Parser parser(kScript, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  auto parsed_program = parser.GetParsedProgram();
+  std::string binary_program =
+      BinaryProgramWriter().Write(parsed_program.get());
+  ASSERT_TRUE(
+      BinaryProgramReader::IsBinaryProgram(SourceBuffer(binary_program)));
+  ASSERT_FALSE(BinaryProgramReader::IsBinaryProgram(SourceBuffer(kScript)));
+
+  auto read_program = ReadBinaryProgram(binary_program, &message_consumer);
+  ASSERT_NE(nullptr, read_program);
+  ASSERT_EQ(0, message_consumer.GetNumMessages());
+  ASSERT_EQ(parsed_program->GetNumCommands(), read_program->GetNumCommands());
+  // Writing the program that was read yields the same binary form.
+  ASSERT_EQ(binary_program, BinaryProgramWriter().Write(read_program.get()));
+
+  // Bulk data is referred to in place rather than copied.
+  const char* begin = read_program->GetSource()->GetData();
+  const char* end = begin + read_program->GetSource()->GetSize();
+  auto* declare_shader =
+      dynamic_cast<CommandDeclareShader*>(read_program->GetCommand(0));
+  ASSERT_NE(nullptr, declare_shader);
+  ASSERT_EQ(
+      "#version 310 es\nlayout(local_size_x = 1) in;\nvoid main() {}\n",
+      declare_shader->GetShaderText());
+  ASSERT_TRUE(declare_shader->GetShaderTextData() >= begin &&
+              declare_shader->GetShaderTextData() < end);
+  auto* create_buffer =
+      dynamic_cast<CommandCreateBuffer*>(read_program->GetCommand(3));
+  ASSERT_NE(nullptr, create_buffer);
+  ASSERT_EQ(8, create_buffer->GetSizeBytes());
+  const auto* initial_data =
+      reinterpret_cast<const char*>(create_buffer->GetInitialData());
+  ASSERT_TRUE(initial_data >= begin && initial_data < end);
+
+  // Source locations are preserved, for the sake of diagnostics.
+  ASSERT_EQ("8:15", create_buffer->GetResultIdentifierToken()
+                        ->GetLocationString());
+}
+
+TEST(BinaryProgram, DiagnosticsReferToScript) {
+  std::string program = R"(CREATE_SAMPLER s
+CREATE_SAMPLER s
+)";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  std::string binary_program =
+      BinaryProgramWriter().Write(parser.GetParsedProgram().get());
+  auto read_program = ReadBinaryProgram(binary_program, &message_consumer);
+  ASSERT_NE(nullptr, read_program);
+  Checker checker(&message_consumer);
+  ASSERT_FALSE(checker.VisitCommands(read_program.get()));
+  ASSERT_EQ(1U, message_consumer.GetNumMessages());
+  ASSERT_EQ("2:16: Identifier 's' already used at 1:16",
+            message_consumer.GetMessageString(0));
+}
+
+TEST(BinaryProgram, Malformed) {
+  CollectingMessageConsumer message_consumer;
+  Parser parser(kScript, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  std::string binary_program =
+      BinaryProgramWriter().Write(parser.GetParsedProgram().get());
+
+  // Every proper prefix of a binary program is rejected.
+  for (size_t length = 0; length < binary_program.size(); length++) {
+    CollectingMessageConsumer prefix_message_consumer;
+    ASSERT_EQ(nullptr, ReadBinaryProgram(binary_program.substr(0, length),
+                                         &prefix_message_consumer));
+    ASSERT_EQ(1U, prefix_message_consumer.GetNumMessages());
+  }
+
+  // The version follows the 8-byte magic number.
+  std::string wrong_version = binary_program;
+  const uint32_t version = 1;
+  memcpy(&wrong_version[8], &version, sizeof(version));
+  ASSERT_EQ(nullptr, ReadBinaryProgram(wrong_version, &message_consumer));
+  ASSERT_EQ(1U, message_consumer.GetNumMessages());
+  ASSERT_EQ(
+      "unknown location: Unsupported binary program version 1; expected "
+      "version 2",
+      message_consumer.GetMessageString(0));
+
+  // A SET_UNIFORM payload too small for its type is rejected, rather than
+  // read past its end. The vec2 payload is shrunk to a single component.
+  const uint64_t payload_size = 8;
+  const float payload[2] = {1.0F, 2.0F};
+  std::string payload_bytes(reinterpret_cast<const char*>(&payload_size),
+                            sizeof(payload_size));
+  payload_bytes.append(reinterpret_cast<const char*>(payload),
+                       sizeof(payload));
+  const size_t payload_position = binary_program.find(payload_bytes);
+  ASSERT_NE(std::string::npos, payload_position);
+  std::string short_uniform = binary_program;
+  const uint64_t short_payload_size = 4;
+  memcpy(&short_uniform[payload_position], &short_payload_size,
+         sizeof(short_payload_size));
+  short_uniform.erase(payload_position + payload_bytes.size() - sizeof(float),
+                      sizeof(float));
+  CollectingMessageConsumer uniform_message_consumer;
+  ASSERT_EQ(nullptr,
+            ReadBinaryProgram(short_uniform, &uniform_message_consumer));
+  ASSERT_EQ(1U, uniform_message_consumer.GetNumMessages());
+  ASSERT_EQ("unknown location: Invalid value for uniform at location 0",
+            uniform_message_consumer.GetMessageString(0));
+}
+
+}  // namespace
+}  // namespace shadertrap
@@ -14,10 +14,13 @@
 
 #include "libshadertrap/checker.h"
 
+#include <cstdio>
+#include <fstream>
 #include <memory>
+#include <string>
 
+#include "libshadertrap/collecting_message_consumer.h"
 #include "libshadertrap/parser.h"
-#include "libshadertraptest/collecting_message_consumer.h"
 #include "libshadertraptest/gtest.h"
 
 namespace shadertrap {
@@ -367,5 +370,96 @@ CREATE_EMPTY_TEXTURE_2D name WIDTH 12 HEIGHT 12
             message_consumer.GetMessageString(0));
 }
 
+TEST(CreateBuffer, FileTooSmall) {
+  const std::string filename = "checker_test_file_too_small.bin";
+  {
+    std::ofstream file(filename, std::ios::binary);
+    file << "0123456789";
+  }
+  std::string program = "CREATE_BUFFER buf SIZE_BYTES 8 FILE \"" + filename +
+                        "\" OFFSET_BYTES 4\n";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  auto parsed_program = parser.GetParsedProgram();
+  std::remove(filename.c_str());
+  Checker checker(&message_consumer);
+  ASSERT_FALSE(checker.VisitCommands(parsed_program.get()));
+  ASSERT_EQ(1U, message_consumer.GetNumMessages());
+  ASSERT_EQ("1:37: Size mismatch: buffer 'buf' declared with size 8 bytes, "
+            "but file '" +
+                filename + "' provides only 6 bytes from offset 4",
+            message_consumer.GetMessageString(0));
+}
+
+TEST(CreateRenderbuffer, NameAlreadyUsed) {
+  std::string program =
+      "CREATE_BUFFER name SIZE_BYTES 4 INIT_TYPE uint INIT_VALUES 1\n"
+      "CREATE_RENDERBUFFER name WIDTH 12 HEIGHT 12\n";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  Checker checker(&message_consumer);
+  ASSERT_FALSE(checker.VisitCommands(parser.GetParsedProgram().get()));
+  ASSERT_EQ(1U, message_consumer.GetNumMessages());
+  ASSERT_EQ("2:21: Identifier 'name' already used at 1:15",
+            message_consumer.GetMessageString(0));
+}
+
+TEST(BindStorageBuffer, NotABuffer) {
+  std::string program = R"(CREATE_RENDERBUFFER rb WIDTH 12 HEIGHT 12
+BIND_STORAGE_BUFFER BUFFER rb BINDING 0
+  )";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  Checker checker(&message_consumer);
+  ASSERT_FALSE(checker.VisitCommands(parser.GetParsedProgram().get()));
+  ASSERT_EQ(1U, message_consumer.GetNumMessages());
+  ASSERT_EQ("2:1: Identifier 'rb' does not correspond to a buffer",
+            message_consumer.GetMessageString(0));
+}
+
+TEST(AssertEqual, BufferAndRenderbuffer) {
+  std::string program =
+      "CREATE_BUFFER buf SIZE_BYTES 4 INIT_TYPE uint INIT_VALUES 1\n"
+      "CREATE_RENDERBUFFER rb WIDTH 12 HEIGHT 12\n"
+      "ASSERT_EQUAL BUFFER1 buf BUFFER2 rb\n";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  Checker checker(&message_consumer);
+  ASSERT_FALSE(checker.VisitCommands(parser.GetParsedProgram().get()));
+  ASSERT_EQ(1U, message_consumer.GetNumMessages());
+  ASSERT_EQ(
+      "3:1: Arguments to 'ASSERT_EQUAL' must both be buffers or both be "
+      "renderbuffers",
+      message_consumer.GetMessageString(0));
+}
+
+TEST(Checker, ResolvesIdentifiersToSlots) {
+  std::string program =
+      "CREATE_BUFFER a SIZE_BYTES 4 INIT_TYPE uint INIT_VALUES 1\n"
+      "CREATE_BUFFER b SIZE_BYTES 4 INIT_TYPE uint INIT_VALUES 1\n"
+      "ASSERT_EQUAL BUFFER1 b BUFFER2 a\n";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  auto parsed_program = parser.GetParsedProgram();
+  Checker checker(&message_consumer);
+  ASSERT_TRUE(checker.VisitCommands(parsed_program.get()));
+  ASSERT_EQ(0U, message_consumer.GetNumMessages());
+  const auto* assert_equal =
+      dynamic_cast<CommandAssertEqual*>(parsed_program->GetCommand(2));
+  ASSERT_NE(nullptr, assert_equal);
+  ASSERT_EQ(1U, assert_equal->GetBufferSlot1());
+  ASSERT_EQ(0U, assert_equal->GetBufferSlot2());
+}
+
 }  // namespace
 }  // namespace shadertrap
@@ -0,0 +1,292 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libshadertrap/data_comparison.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "libshadertraptest/gtest.h"
+
+namespace shadertrap {
+namespace {
+
+// Larger than the amount of data that the comparisons give each thread, so
+// that runs of mismatches cross the boundaries between pieces wherever they
+// fall.
+const size_t kLargeSize = 16 * 1024 * 1024 + 13;
+
+// Compares buffers a byte at a time, as a reference for CompareBuffers.
+BufferComparison CompareBuffersSlowly(const std::vector<uint8_t>& data_1,
+                                      const std::vector<uint8_t>& data_2,
+                                      size_t max_recorded) {
+  BufferComparison result{0, 0, 0, 0, {}};
+  for (size_t index = 0; index < data_1.size(); index++) {
+    if (data_1[index] == data_2[index]) {
+      continue;
+    }
+    if (result.num_mismatches == 0) {
+      result.first_index = index;
+    }
+    result.num_mismatches++;
+    result.last_index = index;
+    result.max_delta = std::max(
+        result.max_delta,
+        static_cast<uint8_t>(std::max(data_1[index], data_2[index]) -
+                             std::min(data_1[index], data_2[index])));
+    if (result.first_mismatches.size() < max_recorded) {
+      result.first_mismatches.push_back(
+          {index, data_1[index], data_2[index]});
+    }
+  }
+  return result;
+}
+
+void ExpectSameComparison(const BufferComparison& expected,
+                          const BufferComparison& actual) {
+  ASSERT_EQ(expected.num_mismatches, actual.num_mismatches);
+  if (expected.num_mismatches != 0) {
+    ASSERT_EQ(expected.first_index, actual.first_index);
+    ASSERT_EQ(expected.last_index, actual.last_index);
+    ASSERT_EQ(expected.max_delta, actual.max_delta);
+  }
+  ASSERT_EQ(expected.first_mismatches.size(), actual.first_mismatches.size());
+  for (size_t index = 0; index < expected.first_mismatches.size(); index++) {
+    ASSERT_EQ(expected.first_mismatches[index].index,
+              actual.first_mismatches[index].index);
+    ASSERT_EQ(expected.first_mismatches[index].value_1,
+              actual.first_mismatches[index].value_1);
+    ASSERT_EQ(expected.first_mismatches[index].value_2,
+              actual.first_mismatches[index].value_2);
+  }
+}
+
+TEST(DataComparison, FindMismatchAtEveryOffset) {
+  // Covers mismatches in the vector body and in the scalar tail, for ranges
+  // that start at unaligned offsets.
+  const size_t size = 130;
+  std::vector<uint8_t> data_1(size);
+  for (size_t index = 0; index < size; index++) {
+    data_1[index] = static_cast<uint8_t>(index * 7);
+  }
+  for (size_t begin = 0; begin < 5; begin++) {
+    for (size_t end = begin; end <= size; end += 3) {
+      ASSERT_EQ(end, FindMismatch(data_1.data(), data_1.data(), begin, end));
+      for (size_t mismatch = begin; mismatch < end; mismatch++) {
+        std::vector<uint8_t> data_2 = data_1;
+        data_2[mismatch] ^= 0x80;
+        ASSERT_EQ(mismatch,
+                  FindMismatch(data_1.data(), data_2.data(), begin, end));
+        // A later mismatch does not hide an earlier one.
+        data_2[end - 1] ^= 0x01;
+        ASSERT_EQ(mismatch,
+                  FindMismatch(data_1.data(), data_2.data(), begin, end));
+      }
+    }
+  }
+}
+
+TEST(DataComparison, CompareBuffersRecordsOnlyTheFirstMismatches) {
+  std::vector<uint8_t> data_1(1000, 10);
+  std::vector<uint8_t> data_2 = data_1;
+  for (size_t index = 3; index < 1000; index += 9) {
+    data_2[index] = static_cast<uint8_t>(index % 50 + 11);
+  }
+  BufferComparison comparison =
+      CompareBuffers(data_1.data(), data_2.data(), data_1.size(), 16);
+  ASSERT_EQ(16U, comparison.first_mismatches.size());
+  ASSERT_EQ(3U, comparison.first_index);
+  ASSERT_EQ(993U, comparison.last_index);
+  ExpectSameComparison(CompareBuffersSlowly(data_1, data_2, 16), comparison);
+
+  comparison = CompareBuffers(data_1.data(), data_2.data(), data_1.size(), 0);
+  ASSERT_TRUE(comparison.first_mismatches.empty());
+  ASSERT_EQ(111U, comparison.num_mismatches);
+}
+
+TEST(DataComparison, CompareEqualBuffers) {
+  std::vector<uint8_t> data(kLargeSize, 42);
+  BufferComparison comparison =
+      CompareBuffers(data.data(), data.data(), data.size(), 16);
+  ASSERT_EQ(0U, comparison.num_mismatches);
+  ASSERT_TRUE(comparison.first_mismatches.empty());
+}
+
+TEST(DataComparison, CompareLargeBuffers) {
+  std::vector<uint8_t> data_1(kLargeSize);
+  for (size_t index = 0; index < kLargeSize; index++) {
+    data_1[index] = static_cast<uint8_t>(index ^ (index >> 8));
+  }
+  std::vector<uint8_t> data_2 = data_1;
+  // Runs of mismatches around every point at which the buffer might be split
+  // between up to 16 threads, and a mismatch in the very last byte.
+  for (size_t num_pieces = 2; num_pieces <= 16; num_pieces++) {
+    for (size_t piece = 1; piece < num_pieces; piece++) {
+      const size_t split = (kLargeSize + num_pieces - 1) / num_pieces * piece;
+      for (size_t index = split - 37; index < split + 41; index++) {
+        data_2[index] = static_cast<uint8_t>(data_1[index] + 1 + index % 3);
+      }
+    }
+  }
+  data_2[kLargeSize - 1] = static_cast<uint8_t>(data_1[kLargeSize - 1] + 200);
+  ExpectSameComparison(
+      CompareBuffersSlowly(data_1, data_2, 64),
+      CompareBuffers(data_1.data(), data_2.data(), kLargeSize, 64));
+}
+
+TEST(DataComparison, CompareImagesCountsRowsFromTheTop) {
+  const size_t width = 5;
+  const size_t height = 4;
+  std::vector<uint8_t> image_1(width * height * 4, 0);
+  std::vector<uint8_t> image_2 = image_1;
+  // The images are laid out bottom row first, so the second row of the data
+  // is the third row from the top.
+  image_2[(1 * width + 3) * 4 + 0] = 5;
+  image_2[(1 * width + 1) * 4 + 2] = 9;
+  image_2[(2 * width + 4) * 4 + 3] = 250;
+  ImageComparison comparison = CompareImages(image_1.data(), image_2.data(),
+                                             width, height, 2);
+  ASSERT_EQ(3U, comparison.num_mismatches);
+  ASSERT_EQ(1U, comparison.min_x);
+  ASSERT_EQ(1U, comparison.min_y);
+  ASSERT_EQ(4U, comparison.max_x);
+  ASSERT_EQ(2U, comparison.max_y);
+  ASSERT_EQ(5, comparison.max_channel_delta[0]);
+  ASSERT_EQ(0, comparison.max_channel_delta[1]);
+  ASSERT_EQ(9, comparison.max_channel_delta[2]);
+  ASSERT_EQ(250, comparison.max_channel_delta[3]);
+  // Only the first two mismatches, from the top, are recorded.
+  ASSERT_EQ(2U, comparison.first_mismatches.size());
+  ASSERT_EQ(4U, comparison.first_mismatches[0].x);
+  ASSERT_EQ(1U, comparison.first_mismatches[0].y);
+  ASSERT_EQ(250, comparison.first_mismatches[0].pixel_2[3]);
+  ASSERT_EQ(1U, comparison.first_mismatches[1].x);
+  ASSERT_EQ(2U, comparison.first_mismatches[1].y);
+  ASSERT_EQ(9, comparison.first_mismatches[1].pixel_2[2]);
+}
+
+TEST(DataComparison, CompareLargeImages) {
+  const size_t width = 1000;
+  const size_t height = kLargeSize / (width * 4);
+  std::vector<uint8_t> image_1(width * height * 4, 128);
+  std::vector<uint8_t> image_2 = image_1;
+  // A run that starts at the end of one row and continues into the next,
+  // near the middle of the image, and a lone mismatch near the top.
+  const size_t middle_row = height / 2;
+  for (size_t byte = (middle_row * width + width - 2) * 4;
+       byte < ((middle_row + 1) * width + 3) * 4; byte++) {
+    image_2[byte] = 130;
+  }
+  image_2[((height - 2) * width + 7) * 4 + 1] = 0;
+  ImageComparison comparison = CompareImages(image_1.data(), image_2.data(),
+                                             width, height, 64);
+  ASSERT_EQ(6U, comparison.num_mismatches);
+  ASSERT_EQ(0U, comparison.min_x);
+  ASSERT_EQ(1U, comparison.min_y);
+  ASSERT_EQ(width - 1, comparison.max_x);
+  ASSERT_EQ(height - 1 - middle_row, comparison.max_y);
+  ASSERT_EQ(2, comparison.max_channel_delta[0]);
+  ASSERT_EQ(128, comparison.max_channel_delta[1]);
+  ASSERT_EQ(6U, comparison.first_mismatches.size());
+  ASSERT_EQ(7U, comparison.first_mismatches[0].x);
+  ASSERT_EQ(1U, comparison.first_mismatches[0].y);
+  // The row above the middle comes first.
+  ASSERT_EQ(0U, comparison.first_mismatches[1].x);
+  ASSERT_EQ(height - 2 - middle_row, comparison.first_mismatches[1].y);
+  ASSERT_EQ(width - 1, comparison.first_mismatches[5].x);
+  ASSERT_EQ(height - 1 - middle_row, comparison.first_mismatches[5].y);
+}
+
+TEST(DataComparison, AccumulateHistograms) {
+  const size_t num_pixels = 1001;
+  std::vector<uint8_t> image(num_pixels * 4);
+  for (size_t index = 0; index < image.size(); index++) {
+    image[index] = static_cast<uint8_t>(index * 31 + index / 7);
+  }
+  std::vector<uint32_t> expected(4 * kNumHistogramBins, 1);
+  for (size_t index = 0; index < image.size(); index++) {
+    expected[(index % 4) * kNumHistogramBins + image[index]]++;
+  }
+  // Counts are added to those already present.
+  std::vector<uint32_t> histograms(4 * kNumHistogramBins, 1);
+  AccumulateHistograms(image.data(), num_pixels, histograms.data());
+  ASSERT_EQ(expected, histograms);
+}
+
+TEST(DataComparison, MaxHistogramEmdOfEqualHistograms) {
+  const size_t num_pixels = 100;
+  std::vector<uint32_t> histograms(4 * kNumHistogramBins, 0);
+  for (size_t channel = 0; channel < 4; channel++) {
+    histograms[channel * kNumHistogramBins + channel * 10] = num_pixels;
+  }
+  ASSERT_EQ(0.0,
+            MaxHistogramEmd(histograms.data(), histograms.data(), num_pixels));
+}
+
+TEST(DataComparison, MaxHistogramEmdTakesTheWorstChannel) {
+  const size_t num_pixels = 10;
+  std::vector<uint32_t> histograms_1(4 * kNumHistogramBins, 0);
+  std::vector<uint32_t> histograms_2(4 * kNumHistogramBins, 0);
+  for (size_t channel = 0; channel < 4; channel++) {
+    histograms_1[channel * kNumHistogramBins + 5] = num_pixels;
+    histograms_2[channel * kNumHistogramBins + 5] = num_pixels;
+  }
+  // In channel 1, half of the pixels move up by one bin.
+  histograms_2[kNumHistogramBins + 5] = 5;
+  histograms_2[kNumHistogramBins + 6] = 5;
+  ASSERT_DOUBLE_EQ(0.5 / kNumHistogramBins,
+                   MaxHistogramEmd(histograms_1.data(), histograms_2.data(),
+                                   num_pixels));
+  // In channel 3, every pixel moves from the lowest bin to the highest; the
+  // distance does not depend on the direction of the move.
+  histograms_1[3 * kNumHistogramBins + 5] = 0;
+  histograms_1[3 * kNumHistogramBins] = num_pixels;
+  histograms_2[3 * kNumHistogramBins + 5] = 0;
+  histograms_2[4 * kNumHistogramBins - 1] = num_pixels;
+  const double expected =
+      static_cast<double>(kNumHistogramBins - 1) / kNumHistogramBins;
+  ASSERT_DOUBLE_EQ(expected, MaxHistogramEmd(histograms_1.data(),
+                                             histograms_2.data(), num_pixels));
+  ASSERT_DOUBLE_EQ(expected, MaxHistogramEmd(histograms_2.data(),
+                                             histograms_1.data(), num_pixels));
+}
+
+TEST(DataComparison, MaxHistogramEmdOfImages) {
+  // Two images that differ only in the order of their pixels have the same
+  // histograms.
+  const size_t num_pixels = 4096;
+  std::vector<uint8_t> image_1(num_pixels * 4);
+  for (size_t index = 0; index < image_1.size(); index++) {
+    image_1[index] = static_cast<uint8_t>(index * 7 + index / 13);
+  }
+  std::vector<uint8_t> image_2(image_1.size());
+  for (size_t pixel = 0; pixel < num_pixels; pixel++) {
+    auto source = image_1.begin() + static_cast<std::ptrdiff_t>(pixel * 4);
+    std::copy(source, source + 4,
+              image_2.begin() +
+                  static_cast<std::ptrdiff_t>((num_pixels - 1 - pixel) * 4));
+  }
+  std::vector<uint32_t> histograms(2 * 4 * kNumHistogramBins, 0);
+  AccumulateHistograms(image_1.data(), num_pixels, &histograms[0]);
+  AccumulateHistograms(image_2.data(), num_pixels,
+                       &histograms[4 * kNumHistogramBins]);
+  ASSERT_EQ(0.0, MaxHistogramEmd(&histograms[0],
+                                 &histograms[4 * kNumHistogramBins],
+                                 num_pixels));
+}
+
+}  // namespace
+}  // namespace shadertrap
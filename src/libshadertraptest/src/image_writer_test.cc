@@ -0,0 +1,107 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libshadertrap/image_writer.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "libshadertraptest/gtest.h"
+
+namespace shadertrap {
+namespace {
+
+// A 2x2 image, bottom row first: red and green below, blue and white above.
+const std::vector<uint8_t> kPixels = {255, 0,   0,   10, 0,   255, 0,   20,
+                                      0,   0,   255, 30, 255, 255, 255, 40};
+
+std::string ReadFile(const std::string& filename) {
+  std::ifstream file(filename, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+TEST(ImageWriter, RawRgba) {
+  const std::string filename = "image_writer_test_raw_rgba.rgba";
+  ImageWriter image_writer;
+  image_writer.Write(filename, ImageWriter::Format::kRawRgba, 2, 2,
+                     kPixels.data());
+  std::string error;
+  ASSERT_TRUE(image_writer.Wait(&error));
+  std::string contents = ReadFile(filename);
+  std::remove(filename.c_str());
+  ASSERT_EQ(std::string({0, 0, '\xff', 30, '\xff', '\xff', '\xff', 40, '\xff',
+                         0, 0, 10, 0, '\xff', 0, 20}),
+            contents);
+}
+
+TEST(ImageWriter, Ppm) {
+  const std::string filename = "image_writer_test_ppm.ppm";
+  ImageWriter image_writer;
+  image_writer.Write(filename, ImageWriter::Format::kPpm, 2, 2,
+                     kPixels.data());
+  std::string error;
+  ASSERT_TRUE(image_writer.Wait(&error));
+  std::string contents = ReadFile(filename);
+  std::remove(filename.c_str());
+  ASSERT_EQ(std::string("P6\n2 2\n255\n") +
+                std::string({0, 0, '\xff', '\xff', '\xff', '\xff', '\xff', 0,
+                             0, 0, '\xff', 0}),
+            contents);
+}
+
+TEST(ImageWriter, ZeroWidth) {
+  const std::string filename = "image_writer_test_zero_width.ppm";
+  ImageWriter image_writer;
+  image_writer.Write(filename, ImageWriter::Format::kPpm, 0, 2,
+                     kPixels.data());
+  std::string error;
+  ASSERT_TRUE(image_writer.Wait(&error));
+  std::string contents = ReadFile(filename);
+  std::remove(filename.c_str());
+  ASSERT_EQ("P6\n0 2\n255\n", contents);
+}
+
+TEST(ImageWriter, LastWriteToAFileWins) {
+  const std::string filename = "image_writer_test_last_write.rgba";
+  ImageWriter image_writer;
+  for (uint8_t value = 0; value < 100; value++) {
+    std::vector<uint8_t> pixels(64 * 64 * 4, value);
+    image_writer.Write(filename, ImageWriter::Format::kRawRgba, 64, 64,
+                       pixels.data());
+  }
+  std::string error;
+  ASSERT_TRUE(image_writer.Wait(&error));
+  std::string contents = ReadFile(filename);
+  std::remove(filename.c_str());
+  ASSERT_EQ(std::string(64 * 64 * 4, static_cast<char>(99)), contents);
+}
+
+TEST(ImageWriter, UnwritableFile) {
+  ImageWriter image_writer;
+  image_writer.Write("no_such_directory/image.ppm", ImageWriter::Format::kPpm,
+                     2, 2, kPixels.data());
+  std::string error;
+  ASSERT_FALSE(image_writer.Wait(&error));
+  ASSERT_EQ("Could not write 'no_such_directory/image.ppm'", error);
+  // The failure is reported only once.
+  ASSERT_TRUE(image_writer.Wait(&error));
+}
+
+}  // namespace
+}  // namespace shadertrap
@@ -0,0 +1,251 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libshadertrap/lowerer.h"
+
+#include <glad/glad.h>
+
+#include <memory>
+#include <string>
+
+#include "libshadertrap/checker.h"
+#include "libshadertrap/collecting_message_consumer.h"
+#include "libshadertrap/instruction.h"
+#include "libshadertrap/lowered_program.h"
+#include "libshadertrap/parser.h"
+#include "libshadertrap/shadertrap_program.h"
+#include "libshadertraptest/gtest.h"
+
+namespace shadertrap {
+namespace {
+
+const char* const kShaders = R"(DECLARE_SHADER vert VERTEX
+#version 320 es
+void main(void) {
+}
+END
+DECLARE_SHADER frag FRAGMENT
+#version 320 es
+void main(void) {
+}
+END
+COMPILE_SHADER vert_compiled SHADER vert
+COMPILE_SHADER frag_compiled SHADER frag
+CREATE_PROGRAM prog SHADERS vert_compiled frag_compiled
+)";
+
+TEST(Lowerer, DeclarationsAreNotInstructions) {
+  std::string program = kShaders;
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  auto parsed_program = parser.GetParsedProgram();
+  Checker checker(&message_consumer);
+  ASSERT_TRUE(checker.VisitCommands(parsed_program.get()));
+  Lowerer lowerer;
+  ASSERT_TRUE(lowerer.VisitCommands(parsed_program.get()));
+  auto lowered_program = lowerer.GetLoweredProgram();
+
+  const auto& instructions = lowered_program->GetInstructions();
+  ASSERT_EQ(3U, instructions.size());
+  ASSERT_EQ(Instruction::Opcode::kCompileShader, instructions[0].opcode);
+  ASSERT_EQ(parsed_program->GetCommand(0),
+            instructions[0].compile_shader.declaration);
+  ASSERT_EQ(parsed_program->GetCommand(2)->GetStartToken(),
+            lowered_program->GetInstructionToken(0));
+  ASSERT_EQ(static_cast<GLenum>(GL_VERTEX_SHADER),
+            instructions[0].compile_shader.shader_kind);
+  ASSERT_EQ(Instruction::Opcode::kCompileShader, instructions[1].opcode);
+  ASSERT_EQ(static_cast<GLenum>(GL_FRAGMENT_SHADER),
+            instructions[1].compile_shader.shader_kind);
+  ASSERT_EQ(Instruction::Opcode::kCreateProgram, instructions[2].opcode);
+  const auto& create_program = instructions[2].create_program;
+  ASSERT_EQ(2U, create_program.num_compiled_shaders);
+  ASSERT_EQ(instructions[0].compile_shader.result_slot,
+            lowered_program->GetCompiledShaderSlot(
+                create_program.first_compiled_shader));
+  ASSERT_EQ(instructions[1].compile_shader.result_slot,
+            lowered_program->GetCompiledShaderSlot(
+                create_program.first_compiled_shader + 1));
+}
+
+TEST(Lowerer, MemoryBarriers) {
+  std::string program = R"(
+CREATE_BUFFER a SIZE_BYTES 4 INIT_TYPE uint INIT_VALUES 0
+CREATE_BUFFER b SIZE_BYTES 4 INIT_TYPE uint INIT_VALUES 0
+DECLARE_SHADER shader COMPUTE
+#version 320 es
+layout(local_size_x=1, local_size_y=1, local_size_z=1) in;
+layout(binding = 0) buffer ssbo {
+  uint data;
+};
+void main() {
+  data++;
+}
+END
+COMPILE_SHADER shader_compiled SHADER shader
+CREATE_PROGRAM prog SHADERS shader_compiled
+BIND_STORAGE_BUFFER BUFFER a BINDING 0
+RUN_COMPUTE PROGRAM prog NUM_GROUPS_X 1 NUM_GROUPS_Y 1 NUM_GROUPS_Z 1
+BIND_STORAGE_BUFFER BUFFER b BINDING 0
+RUN_COMPUTE PROGRAM prog NUM_GROUPS_X 1 NUM_GROUPS_Y 1 NUM_GROUPS_Z 1
+BIND_UNIFORM_BUFFER BUFFER a BINDING 0
+RUN_COMPUTE PROGRAM prog NUM_GROUPS_X 1 NUM_GROUPS_Y 1 NUM_GROUPS_Z 1
+ASSERT_EQUAL BUFFER1 a BUFFER2 b
+)";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  auto parsed_program = parser.GetParsedProgram();
+  Checker checker(&message_consumer);
+  ASSERT_TRUE(checker.VisitCommands(parsed_program.get()));
+  Lowerer lowerer;
+  ASSERT_TRUE(lowerer.VisitCommands(parsed_program.get()));
+  auto lowered_program = lowerer.GetLoweredProgram();
+
+  const auto& instructions = lowered_program->GetInstructions();
+  ASSERT_EQ(13U, instructions.size());
+  // The first two runs write different buffers, so need no barrier between
+  // them.
+  ASSERT_EQ(Instruction::Opcode::kRunCompute, instructions[5].opcode);
+  ASSERT_EQ(Instruction::Opcode::kBindBufferBase, instructions[6].opcode);
+  ASSERT_EQ(Instruction::Opcode::kRunCompute, instructions[7].opcode);
+  // The third run reads the buffer that the first wrote as a uniform buffer,
+  // and writes the buffer that the second wrote.
+  ASSERT_EQ(Instruction::Opcode::kMemoryBarrier, instructions[9].opcode);
+  ASSERT_EQ(static_cast<GLbitfield>(GL_SHADER_STORAGE_BARRIER_BIT |
+                                    GL_UNIFORM_BARRIER_BIT),
+            instructions[9].memory_barrier.barriers);
+  // Errors in a barrier are reported against the command that needs it.
+  ASSERT_EQ(parsed_program->GetCommand(10)->GetStartToken(),
+            lowered_program->GetInstructionToken(9));
+  ASSERT_EQ(Instruction::Opcode::kRunCompute, instructions[10].opcode);
+  // Both buffers are then mapped.
+  ASSERT_EQ(Instruction::Opcode::kMemoryBarrier, instructions[11].opcode);
+  ASSERT_EQ(static_cast<GLbitfield>(GL_BUFFER_UPDATE_BARRIER_BIT),
+            instructions[11].memory_barrier.barriers);
+  ASSERT_EQ(Instruction::Opcode::kAssertEqualBuffers, instructions[12].opcode);
+}
+
+TEST(Lowerer, RunGraphics) {
+  std::string program = std::string(kShaders) + R"(
+CREATE_BUFFER vertices SIZE_BYTES 24 INIT_TYPE float INIT_VALUES
+  0.0 0.0 1.0 0.0 0.0 1.0
+CREATE_BUFFER indices SIZE_BYTES 12 INIT_TYPE uint INIT_VALUES 0 1 2
+CREATE_RENDERBUFFER rb WIDTH 16 HEIGHT 16
+CREATE_EMPTY_TEXTURE_2D tex WIDTH 16 HEIGHT 16
+RUN_GRAPHICS
+  PROGRAM prog
+  VERTEX_DATA
+    [ 1 -> BUFFER vertices OFFSET_BYTES 4 STRIDE_BYTES 8 DIMENSION 2,
+      0 -> BUFFER vertices OFFSET_BYTES 0 STRIDE_BYTES 8 DIMENSION 1 ]
+  INDEX_DATA indices
+  VERTEX_COUNT 3
+  TOPOLOGY TRIANGLES
+  FRAMEBUFFER_ATTACHMENTS
+    [ 2 -> tex,
+      0 -> rb ]
+)";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  auto parsed_program = parser.GetParsedProgram();
+  Checker checker(&message_consumer);
+  ASSERT_TRUE(checker.VisitCommands(parsed_program.get()));
+  Lowerer lowerer;
+  ASSERT_TRUE(lowerer.VisitCommands(parsed_program.get()));
+  auto lowered_program = lowerer.GetLoweredProgram();
+
+  const auto& instructions = lowered_program->GetInstructions();
+  ASSERT_EQ(8U, instructions.size());
+  ASSERT_EQ(Instruction::Opcode::kRunGraphics, instructions[7].opcode);
+  const auto& run_graphics = instructions[7].run_graphics;
+  ASSERT_EQ(instructions[2].create_program.result_slot,
+            run_graphics.program_slot);
+  ASSERT_EQ(instructions[4].create_buffer.result_slot,
+            run_graphics.index_data_buffer_slot);
+  ASSERT_EQ(static_cast<GLenum>(GL_TRIANGLES), run_graphics.topology);
+  ASSERT_EQ(3, run_graphics.vertex_count);
+
+  ASSERT_EQ(2U, run_graphics.num_vertex_attributes);
+  ASSERT_EQ(0U, lowered_program
+                    ->GetVertexAttribute(run_graphics.first_vertex_attribute)
+                    .location);
+  const auto& vertex_attribute = lowered_program->GetVertexAttribute(
+      run_graphics.first_vertex_attribute + 1);
+  ASSERT_EQ(1U, vertex_attribute.location);
+  ASSERT_EQ(2, vertex_attribute.dimension);
+  ASSERT_EQ(8, vertex_attribute.stride_bytes);
+  ASSERT_EQ(4U, vertex_attribute.offset_bytes);
+  ASSERT_EQ(instructions[3].create_buffer.result_slot,
+            vertex_attribute.buffer_slot);
+
+  ASSERT_EQ(2U, run_graphics.num_framebuffer_attachments);
+  const auto& attachment_0 = lowered_program->GetFramebufferAttachment(
+      run_graphics.first_framebuffer_attachment);
+  ASSERT_EQ(static_cast<GLenum>(GL_COLOR_ATTACHMENT0), attachment_0.attachment);
+  ASSERT_TRUE(attachment_0.is_renderbuffer);
+  ASSERT_EQ(instructions[5].create_image.result_slot, attachment_0.slot);
+  const auto& attachment_2 = lowered_program->GetFramebufferAttachment(
+      run_graphics.first_framebuffer_attachment + 1);
+  ASSERT_EQ(static_cast<GLenum>(GL_COLOR_ATTACHMENT2), attachment_2.attachment);
+  ASSERT_FALSE(attachment_2.is_renderbuffer);
+  ASSERT_EQ(instructions[6].create_image.result_slot, attachment_2.slot);
+
+  ASSERT_EQ(3U, run_graphics.num_draw_buffers);
+  const GLenum* draw_buffers =
+      lowered_program->GetDrawBuffers(run_graphics.first_draw_buffer);
+  ASSERT_EQ(static_cast<GLenum>(GL_COLOR_ATTACHMENT0), draw_buffers[0]);
+  ASSERT_EQ(static_cast<GLenum>(GL_NONE), draw_buffers[1]);
+  ASSERT_EQ(static_cast<GLenum>(GL_COLOR_ATTACHMENT2), draw_buffers[2]);
+}
+
+TEST(Lowerer, SamplerAndTextureParameters) {
+  std::string program = R"(CREATE_SAMPLER s
+CREATE_EMPTY_TEXTURE_2D t WIDTH 16 HEIGHT 16
+SET_SAMPLER_PARAMETER SAMPLER s TEXTURE_MIN_FILTER NEAREST
+SET_TEXTURE_PARAMETER TEXTURE t TEXTURE_MAG_FILTER LINEAR
+)";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  auto parsed_program = parser.GetParsedProgram();
+  Checker checker(&message_consumer);
+  ASSERT_TRUE(checker.VisitCommands(parsed_program.get()));
+  Lowerer lowerer;
+  ASSERT_TRUE(lowerer.VisitCommands(parsed_program.get()));
+  auto lowered_program = lowerer.GetLoweredProgram();
+
+  const auto& instructions = lowered_program->GetInstructions();
+  ASSERT_EQ(4U, instructions.size());
+  ASSERT_EQ(Instruction::Opcode::kSetSamplerParameter, instructions[2].opcode);
+  ASSERT_EQ(instructions[0].create_sampler.result_slot,
+            instructions[2].set_parameter.target_slot);
+  ASSERT_EQ(static_cast<GLenum>(GL_TEXTURE_MIN_FILTER),
+            instructions[2].set_parameter.parameter);
+  ASSERT_EQ(GL_NEAREST, instructions[2].set_parameter.parameter_value);
+  ASSERT_EQ(Instruction::Opcode::kSetTextureParameter, instructions[3].opcode);
+  ASSERT_EQ(instructions[1].create_image.result_slot,
+            instructions[3].set_parameter.target_slot);
+  ASSERT_EQ(static_cast<GLenum>(GL_TEXTURE_MAG_FILTER),
+            instructions[3].set_parameter.parameter);
+  ASSERT_EQ(GL_LINEAR, instructions[3].set_parameter.parameter_value);
+}
+
+}  // namespace
+}  // namespace shadertrap
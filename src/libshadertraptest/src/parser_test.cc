@@ -14,7 +14,19 @@
 
 #include "libshadertrap/parser.h"
 
-#include "libshadertraptest/collecting_message_consumer.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "libshadertrap/collecting_message_consumer.h"
+#include "libshadertrap/command_create_buffer.h"
+#include "libshadertrap/command_declare_shader.h"
+#include "libshadertrap/file_cache.h"
+#include "libshadertrap/make_unique.h"
+#include "libshadertrap/source_buffer.h"
 #include "libshadertraptest/gtest.h"
 
 namespace shadertrap {
@@ -33,5 +45,360 @@ TEST(Parser, NoShaders) {
               std::string::npos);
 }
 
+TEST(Parser, IdentifiersResemblingKeywords) {
+  // Each identifier has the same length and first character as a keyword.
+  std::string program = R"(CREATE_BUFFER BUFFER3 SIZE_BYTES 4 INIT_TYPE uint
+    INIT_VALUES 1
+CREATE_BUFFER ENDS SIZE_BYTES 4 INIT_TYPE uint INIT_VALUES 2
+CREATE_BUFFER Width SIZE_BYTES 4 INIT_TYPE uint INIT_VALUES 3
+    )";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  ASSERT_EQ(0, message_consumer.GetNumMessages());
+}
+
+TEST(Parser, MissingParameterNamesKeyword) {
+  std::string program = R"(CREATE_BUFFER buf SIZE_BYTES 4 INIT_TYPE uint
+    )";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_FALSE(parser.Parse());
+  ASSERT_EQ(1, message_consumer.GetNumMessages());
+  ASSERT_TRUE(message_consumer.GetMessageString(0).find(
+                  "Missing parameter 'INIT_VALUES' or 'INIT_PATTERN'") !=
+              std::string::npos);
+}
+
+TEST(Parser, LocationAfterLongWhitespaceAndComments) {
+  std::string program =
+      "# A comment that is long enough to span several vector registers\n"
+      "\n"
+      "                                                                \n"
+      "  # An indented comment\n"
+      "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t"
+      "                                      CREATE_BUFFER";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_FALSE(parser.Parse());
+  ASSERT_EQ(1, message_consumer.GetNumMessages());
+  ASSERT_EQ(0, message_consumer.GetMessageString(0).find("5:72: "));
+}
+
+TEST(Parser, UnterminatedString) {
+  std::string program = R"(DUMP_RENDERBUFFER RENDERBUFFER rb FILE "a.png
+    )";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_FALSE(parser.Parse());
+  ASSERT_EQ(1, message_consumer.GetNumMessages());
+  ASSERT_EQ(0, message_consumer.GetMessageString(0).find("1:40: "));
+}
+
+TEST(Parser, BufferLiterals) {
+  // INIT_VALUES precedes INIT_TYPE in the second command, so that its
+  // literals cannot be decoded until the type is known.
+  std::string program = R"(CREATE_BUFFER bytes SIZE_BYTES 3 INIT_TYPE byte
+    INIT_VALUES 0 128 255
+CREATE_BUFFER floats SIZE_BYTES 12 INIT_VALUES 0.1 -2.5 3.14159265358979
+    INIT_TYPE float
+CREATE_BUFFER ints SIZE_BYTES 8 INIT_TYPE int INIT_VALUES -2147483648 7
+    )";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  auto parsed_program = parser.GetParsedProgram();
+  ASSERT_EQ(3, parsed_program->GetNumCommands());
+
+  auto* bytes =
+      dynamic_cast<CommandCreateBuffer*>(parsed_program->GetCommand(0));
+  ASSERT_NE(nullptr, bytes);
+  ASSERT_EQ(3, bytes->GetInitialDataSize());
+  ASSERT_EQ(std::vector<uint8_t>({0, 128, 255}),
+            std::vector<uint8_t>(bytes->GetInitialData(),
+                                 bytes->GetInitialData() + 3));
+
+  auto* floats =
+      dynamic_cast<CommandCreateBuffer*>(parsed_program->GetCommand(1));
+  ASSERT_NE(nullptr, floats);
+  ASSERT_EQ(CommandCreateBuffer::InitialDataType::kFloat,
+            floats->GetInitialDataType());
+  float float_values[3];
+  memcpy(float_values, floats->GetInitialData(), sizeof(float_values));
+  ASSERT_EQ(0.1F, float_values[0]);
+  ASSERT_EQ(-2.5F, float_values[1]);
+  ASSERT_EQ(3.14159265358979F, float_values[2]);
+
+  auto* ints =
+      dynamic_cast<CommandCreateBuffer*>(parsed_program->GetCommand(2));
+  ASSERT_NE(nullptr, ints);
+  int32_t int_values[2];
+  memcpy(int_values, ints->GetInitialData(), sizeof(int_values));
+  ASSERT_EQ(INT32_MIN, int_values[0]);
+  ASSERT_EQ(7, int_values[1]);
+}
+
+TEST(Parser, BufferLiteralOutOfRange) {
+  std::string program = R"(CREATE_BUFFER buf SIZE_BYTES 8 INIT_TYPE uint
+    INIT_VALUES 1 4294967296
+    )";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_FALSE(parser.Parse());
+  ASSERT_EQ(1, message_consumer.GetNumMessages());
+  ASSERT_EQ("2:19: uint literal out of range, got '4294967296'",
+            message_consumer.GetMessageString(0));
+}
+
+TEST(Parser, MalformedFloatLiteral) {
+  std::string program = R"(CREATE_BUFFER buf SIZE_BYTES 4 INIT_TYPE float
+    INIT_VALUES 1.2.3
+    )";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_FALSE(parser.Parse());
+  ASSERT_EQ(1, message_consumer.GetNumMessages());
+  ASSERT_EQ("2:17: Invalid float literal '1.2.3'",
+            message_consumer.GetMessageString(0));
+}
+
+TEST(Parser, DuplicateParameter) {
+  std::string program = R"(RUN_COMPUTE PROGRAM prog NUM_GROUPS_X 1
+    NUM_GROUPS_Y 1 NUM_GROUPS_X 2 NUM_GROUPS_Z 1
+    )";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_FALSE(parser.Parse());
+  ASSERT_EQ(1, message_consumer.GetNumMessages());
+  ASSERT_EQ("2:20: Duplicate parameter 'NUM_GROUPS_X'",
+            message_consumer.GetMessageString(0));
+}
+
+TEST(Parser, MissingParametersReportedInKeywordOrder) {
+  std::string program = R"(RUN_COMPUTE NUM_GROUPS_Y 1
+CREATE_BUFFER buf SIZE_BYTES 4 INIT_TYPE uint INIT_VALUES 0
+    )";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_FALSE(parser.Parse());
+  ASSERT_EQ(3, message_consumer.GetNumMessages());
+  ASSERT_EQ("2:1: Missing parameter 'NUM_GROUPS_X'",
+            message_consumer.GetMessageString(0));
+  ASSERT_EQ("2:1: Missing parameter 'NUM_GROUPS_Z'",
+            message_consumer.GetMessageString(1));
+  ASSERT_EQ("2:1: Missing parameter 'PROGRAM'",
+            message_consumer.GetMessageString(2));
+}
+
+TEST(Parser, BufferFromFile) {
+  const std::string filename = "parser_test_buffer_from_file.bin";
+  {
+    std::ofstream file(filename, std::ios::binary);
+    file << "0123456789";
+  }
+  std::string program = "CREATE_BUFFER buf SIZE_BYTES 4 FILE \"" + filename +
+                        "\" OFFSET_BYTES 3\n";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  auto parsed_program = parser.GetParsedProgram();
+  std::remove(filename.c_str());
+  ASSERT_EQ(1, parsed_program->GetNumCommands());
+  auto* buffer =
+      dynamic_cast<CommandCreateBuffer*>(parsed_program->GetCommand(0));
+  ASSERT_NE(nullptr, buffer);
+  ASSERT_TRUE(buffer->HasInitialDataFile());
+  ASSERT_EQ(filename, buffer->GetInitialDataFilename());
+  ASSERT_EQ(3, buffer->GetOffsetBytes());
+  ASSERT_EQ(7, buffer->GetInitialDataSize());
+  ASSERT_EQ("3456", std::string(reinterpret_cast<const char*>(
+                                    buffer->GetInitialData()),
+                                4));
+}
+
+TEST(Parser, BufferFromMissingFile) {
+  std::string program = R"(CREATE_BUFFER buf SIZE_BYTES 4 FILE "data.bin"
+    )";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_FALSE(parser.Parse());
+  ASSERT_EQ(1, message_consumer.GetNumMessages());
+  ASSERT_EQ("1:37: Could not open 'data.bin'",
+            message_consumer.GetMessageString(0));
+}
+
+TEST(Parser, BufferFromStandardInput) {
+  std::string program = R"(CREATE_BUFFER buf SIZE_BYTES 4 FILE "-"
+    )";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_FALSE(parser.Parse());
+  ASSERT_EQ(1, message_consumer.GetNumMessages());
+  ASSERT_EQ("1:37: Standard input cannot be used as a file",
+            message_consumer.GetMessageString(0));
+}
+
+TEST(Parser, BufferPatterns) {
+  std::string program = R"(CREATE_BUFFER constant SIZE_BYTES 12
+    INIT_PATTERN constant 7 INIT_TYPE uint
+CREATE_BUFFER ramp SIZE_BYTES 16 INIT_TYPE int INIT_PATTERN ramp 10 -3
+CREATE_BUFFER repeat SIZE_BYTES 5 INIT_TYPE byte INIT_PATTERN repeat 1 2
+CREATE_BUFFER random SIZE_BYTES 4096 INIT_TYPE float INIT_PATTERN random 42
+    )";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  auto parsed_program = parser.GetParsedProgram();
+  ASSERT_EQ(4, parsed_program->GetNumCommands());
+
+  auto* constant =
+      dynamic_cast<CommandCreateBuffer*>(parsed_program->GetCommand(0));
+  ASSERT_NE(nullptr, constant);
+  ASSERT_TRUE(constant->HasInitialDataPattern());
+  uint32_t uint_values[3];
+  constant->ExpandInitialDataPattern(
+      0, sizeof(uint_values), reinterpret_cast<uint8_t*>(uint_values));
+  ASSERT_EQ(7, uint_values[0]);
+  ASSERT_EQ(7, uint_values[2]);
+
+  auto* ramp =
+      dynamic_cast<CommandCreateBuffer*>(parsed_program->GetCommand(1));
+  ASSERT_NE(nullptr, ramp);
+  int32_t int_values[2];
+  ramp->ExpandInitialDataPattern(8, sizeof(int_values),
+                                 reinterpret_cast<uint8_t*>(int_values));
+  ASSERT_EQ(4, int_values[0]);
+  ASSERT_EQ(1, int_values[1]);
+
+  auto* repeat =
+      dynamic_cast<CommandCreateBuffer*>(parsed_program->GetCommand(2));
+  ASSERT_NE(nullptr, repeat);
+  std::vector<uint8_t> byte_values(5);
+  repeat->ExpandInitialDataPattern(0, 5, byte_values.data());
+  ASSERT_EQ(std::vector<uint8_t>({1, 2, 1, 2, 1}), byte_values);
+
+  // Expanding the random pattern in pieces must give the same values as
+  // expanding it all at once.
+  auto* random =
+      dynamic_cast<CommandCreateBuffer*>(parsed_program->GetCommand(3));
+  ASSERT_NE(nullptr, random);
+  std::vector<float> whole(1024);
+  std::vector<float> pieces(1024);
+  random->ExpandInitialDataPattern(0, 4096,
+                                   reinterpret_cast<uint8_t*>(whole.data()));
+  random->ExpandInitialDataPattern(0, 2048,
+                                   reinterpret_cast<uint8_t*>(pieces.data()));
+  random->ExpandInitialDataPattern(
+      2048, 2048, reinterpret_cast<uint8_t*>(pieces.data() + 512));
+  ASSERT_EQ(whole, pieces);
+  for (float value : whole) {
+    ASSERT_TRUE(value >= 0.0F && value < 1.0F);
+  }
+  ASSERT_NE(whole[0], whole[1]);
+}
+
+TEST(Parser, BufferPatternWithValues) {
+  std::string program = R"(CREATE_BUFFER buf SIZE_BYTES 4 INIT_TYPE uint
+    INIT_VALUES 1 INIT_PATTERN constant 1
+    )";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_FALSE(parser.Parse());
+  ASSERT_EQ(1, message_consumer.GetNumMessages());
+  ASSERT_EQ(
+      "1:1: A buffer cannot have both 'INIT_VALUES' and 'INIT_PATTERN'",
+      message_consumer.GetMessageString(0));
+}
+
+TEST(Parser, ShaderTextIsSliceOfScript) {
+  std::string program = R"(DECLARE_SHADER frag FRAGMENT
+  #version 320 es
+void main() {
+  END
+}
+END
+)";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_TRUE(parser.Parse());
+  auto parsed_program = parser.GetParsedProgram();
+  ASSERT_EQ(1, parsed_program->GetNumCommands());
+  auto* declare_shader =
+      dynamic_cast<CommandDeclareShader*>(parsed_program->GetCommand(0));
+  ASSERT_NE(nullptr, declare_shader);
+  ASSERT_EQ("#version 320 es\nvoid main() {\n  END\n}\n",
+            declare_shader->GetShaderText());
+  ASSERT_EQ(parsed_program->GetSource()->GetData() + 31,
+            declare_shader->GetShaderTextData());
+}
+
+TEST(Parser, ShaderFromFileLoadedOnce) {
+  const std::string filename = "parser_test_shader_from_file.frag";
+  {
+    std::ofstream file(filename);
+    file << "#version 320 es\nvoid main() {}\n";
+  }
+  std::string program = "DECLARE_SHADER a FRAGMENT FILE \"" + filename +
+                        "\"\nDECLARE_SHADER b FRAGMENT FILE \"" + filename +
+                        "\"\n";
+
+  // Scripts parsed with the same cache share the file's contents.
+  FileCache file_cache;
+  CollectingMessageConsumer message_consumer;
+  Parser parser_1(MakeUnique<SourceBuffer>(program), &file_cache,
+                  &message_consumer);
+  ASSERT_TRUE(parser_1.Parse());
+  Parser parser_2(MakeUnique<SourceBuffer>(program), &file_cache,
+                  &message_consumer);
+  ASSERT_TRUE(parser_2.Parse());
+  auto parsed_program_1 = parser_1.GetParsedProgram();
+  auto parsed_program_2 = parser_2.GetParsedProgram();
+  std::remove(filename.c_str());
+  ASSERT_EQ(2, parsed_program_1->GetNumCommands());
+  ASSERT_EQ(2, parsed_program_2->GetNumCommands());
+  std::vector<const char*> shader_texts;
+  for (auto* parsed_program :
+       {parsed_program_1.get(), parsed_program_2.get()}) {
+    for (size_t index = 0; index < 2; index++) {
+      auto* declare_shader = dynamic_cast<CommandDeclareShader*>(
+          parsed_program->GetCommand(index));
+      ASSERT_NE(nullptr, declare_shader);
+      ASSERT_EQ("#version 320 es\nvoid main() {}\n",
+                declare_shader->GetShaderText());
+      shader_texts.push_back(declare_shader->GetShaderTextData());
+    }
+  }
+  for (const char* shader_text : shader_texts) {
+    ASSERT_EQ(shader_texts[0], shader_text);
+  }
+}
+
+TEST(Parser, ShaderFromStandardInput) {
+  std::string program = R"(DECLARE_SHADER frag FRAGMENT FILE "-"
+    )";
+
+  CollectingMessageConsumer message_consumer;
+  Parser parser(program, &message_consumer);
+  ASSERT_FALSE(parser.Parse());
+  ASSERT_EQ(1, message_consumer.GetNumMessages());
+  ASSERT_EQ("1:35: Standard input cannot be used as a file",
+            message_consumer.GetMessageString(0));
+}
+
 }  // namespace
 }  // namespace shadertrap
@@ -18,20 +18,21 @@
 #include <fstream>
 #include <iostream>
 #include <memory>
-#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "libshadertrap/binary_program_reader.h"
+#include "libshadertrap/binary_program_writer.h"
 #include "libshadertrap/checker.h"
-#include "libshadertrap/command_visitor.h"
-#include "libshadertrap/compound_visitor.h"
 #include "libshadertrap/executor.h"
 #include "libshadertrap/helpers.h"
-#include "libshadertrap/make_unique.h"
+#include "libshadertrap/image_writer.h"
+#include "libshadertrap/lowerer.h"
 #include "libshadertrap/message_consumer.h"
 #include "libshadertrap/parser.h"
 #include "libshadertrap/shadertrap_program.h"
+#include "libshadertrap/source_buffer.h"
 #include "libshadertrap/token.h"
 
 namespace {
@@ -54,31 +55,191 @@ class ConsoleMessageConsumer : public shadertrap::MessageConsumer {
   }
 };
 
-std::vector<char> ReadFile(const std::string& input_file) {
-  std::ifstream file(input_file);
-  std::ostringstream stringstream;
-  stringstream << file.rdbuf();
-  const std::string& temp = stringstream.str();
-  return std::vector<char>(temp.begin(), temp.end());
+// Yields the program held by |source|, which may be either the text of a
+// script or a binary program, or nullptr if it cannot be loaded.
+std::unique_ptr<shadertrap::ShaderTrapProgram> LoadProgram(
+    std::unique_ptr<shadertrap::SourceBuffer> source,
+    shadertrap::MessageConsumer* message_consumer) {
+  if (shadertrap::BinaryProgramReader::IsBinaryProgram(*source)) {
+    shadertrap::BinaryProgramReader reader(std::move(source),
+                                           message_consumer);
+    if (!reader.Read()) {
+      return nullptr;
+    }
+    return reader.GetProgram();
+  }
+  shadertrap::Parser parser(std::move(source), message_consumer);
+  if (!parser.Parse()) {
+    return nullptr;
+  }
+  return parser.GetParsedProgram();
+}
+
+// Checks |program| and writes it in binary form to |filename|.
+int CompileScript(shadertrap::ShaderTrapProgram* program,
+                  const std::string& filename,
+                  shadertrap::MessageConsumer* message_consumer) {
+  shadertrap::Checker checker(message_consumer);
+  if (!checker.VisitCommands(program)) {
+    return 1;
+  }
+  shadertrap::BinaryProgramWriter writer;
+  std::string binary_program = writer.Write(program);
+  std::ofstream output(filename, std::ios::binary);
+  output.write(binary_program.data(),
+               static_cast<std::streamsize>(binary_program.size()));
+  output.close();
+  if (!output) {
+    std::cerr << "Could not write '" << filename << "'" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Sets |format| to the dump format named |name|, yielding false if there is
+// no such format.
+bool ParseDumpFormat(const std::string& name,
+                     shadertrap::ImageWriter::Format* format) {
+  if (name == "png") {
+    *format = shadertrap::ImageWriter::Format::kPng;
+  } else if (name == "fast-png") {
+    *format = shadertrap::ImageWriter::Format::kFastPng;
+  } else if (name == "rgba") {
+    *format = shadertrap::ImageWriter::Format::kRawRgba;
+  } else if (name == "ppm") {
+    *format = shadertrap::ImageWriter::Format::kPpm;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Sets |gl_error_checking| to the error checking named |name|, yielding false
+// if there is no such error checking.
+bool ParseGlErrorChecking(
+    const std::string& name,
+    shadertrap::Executor::GlErrorChecking* gl_error_checking) {
+  if (name == "per-call") {
+    *gl_error_checking = shadertrap::Executor::GlErrorChecking::kPerCall;
+  } else if (name == "per-command") {
+    *gl_error_checking = shadertrap::Executor::GlErrorChecking::kPerCommand;
+  } else if (name == "debug-callback") {
+    *gl_error_checking = shadertrap::Executor::GlErrorChecking::kDebugCallback;
+  } else {
+    return false;
+  }
+  return true;
 }
 
 }  // namespace
 
 int main(int argc, const char** argv) {
   std::vector<std::string> args(argv, argv + argc);
-  if (args.size() != 2) {
-    std::cerr << "Usage: " << args[0] + " SCRIPT" << std::endl;
+  bool compare_renderbuffers_on_gpu = false;
+  bool conservative_memory_barriers = false;
+  auto histogram_computation =
+      shadertrap::Executor::HistogramComputation::kPreferGpu;
+  auto dump_format = shadertrap::ImageWriter::Format::kPng;
+  auto gl_error_checking = shadertrap::Executor::GlErrorChecking::kPerCall;
+  bool report_vertex_arrays = false;
+  bool valid_options = true;
+  while (valid_options && args.size() > 1 && args[1] != "--compile-script" &&
+         args[1].compare(0, 2, "--") == 0) {
+    if (args[1] == "--compare-renderbuffers-on-gpu") {
+      compare_renderbuffers_on_gpu = true;
+      args.erase(args.begin() + 1);
+    } else if (args[1] == "--conservative-memory-barriers") {
+      conservative_memory_barriers = true;
+      args.erase(args.begin() + 1);
+    } else if (args[1] == "--emd-histograms-on-cpu") {
+      histogram_computation =
+          shadertrap::Executor::HistogramComputation::kOnCpu;
+      args.erase(args.begin() + 1);
+    } else if (args[1] == "--check-emd-histograms") {
+      histogram_computation =
+          shadertrap::Executor::HistogramComputation::kCheckGpuAgainstCpu;
+      args.erase(args.begin() + 1);
+    } else if (args[1] == "--report-vertex-arrays") {
+      report_vertex_arrays = true;
+      args.erase(args.begin() + 1);
+    } else if (args[1] == "--dump-format" && args.size() > 2 &&
+               ParseDumpFormat(args[2], &dump_format)) {
+      args.erase(args.begin() + 1, args.begin() + 3);
+    } else if (args[1] == "--gl-error-checking" && args.size() > 2 &&
+               ParseGlErrorChecking(args[2], &gl_error_checking)) {
+      args.erase(args.begin() + 1, args.begin() + 3);
+    } else {
+      valid_options = false;
+    }
+  }
+  const bool compile_script = args.size() == 4 && args[1] == "--compile-script";
+  if (!valid_options || (args.size() != 2 && !compile_script)) {
+    std::cerr << "Usage: " << args[0]
+              << " [--compare-renderbuffers-on-gpu] "
+                 "[--conservative-memory-barriers] [--emd-histograms-on-cpu] "
+                 "[--check-emd-histograms] [--dump-format FORMAT] "
+                 "[--gl-error-checking CHECKING] [--report-vertex-arrays] "
+                 "SCRIPT"
+              << std::endl;
+    std::cerr << "       " << args[0] + " --compile-script SCRIPT OUTPUT"
+              << std::endl;
+    std::cerr << "Use '-' as SCRIPT to read the script from standard input."
+              << std::endl;
+    std::cerr << "SCRIPT may also be a binary program, as written by "
+                 "'--compile-script'."
+              << std::endl;
+    std::cerr << "With '--compare-renderbuffers-on-gpu', ASSERT_EQUAL compares "
+                 "renderbuffers with a compute shader where compute shaders "
+                 "are available, and lists mismatching pixels only if there "
+                 "are few of them."
+              << std::endl;
+    std::cerr << "With '--conservative-memory-barriers', every memory barrier "
+                 "is issued before each RUN_COMPUTE and RUN_GRAPHICS, and the "
+                 "work is flushed after it, rather than issuing only the "
+                 "barriers that the script needs."
+              << std::endl;
+    std::cerr << "With '--emd-histograms-on-cpu', ASSERT_SIMILAR_EMD_HISTOGRAM "
+                 "computes histograms on the CPU even where it could use a "
+                 "compute shader."
+              << std::endl;
+    std::cerr << "With '--check-emd-histograms', ASSERT_SIMILAR_EMD_HISTOGRAM "
+                 "computes histograms both with a compute shader and on the "
+                 "CPU, and fails if they differ."
+              << std::endl;
+    std::cerr << "With '--report-vertex-arrays', the number of vertex array "
+                 "objects that RUN_GRAPHICS created, and the number of times "
+                 "it reused one, are printed after execution."
+              << std::endl;
+    std::cerr << "FORMAT is the format in which DUMP_RENDERBUFFER writes "
+                 "images: 'png' (the default), 'fast-png' (larger files, "
+                 "written more quickly), 'rgba' (raw bytes, top row first) or "
+                 "'ppm'."
+              << std::endl;
+    std::cerr << "CHECKING is when OpenGL errors are checked for: 'per-call' "
+                 "(the default, after every OpenGL call), 'per-command' "
+                 "(once after each command) or 'debug-callback' (collected by "
+                 "a KHR_debug callback and reported after each command)."
+              << std::endl;
     return 1;
   }
 
-  auto char_data = ReadFile(args[1]);
-  auto data = std::string(char_data.begin(), char_data.end());
+  std::string error_message;
+  auto source = shadertrap::SourceBuffer::FromFile(
+      compile_script ? args[2] : args[1], &error_message);
+  if (source == nullptr) {
+    std::cerr << error_message << std::endl;
+    return 1;
+  }
 
   ConsoleMessageConsumer message_consumer;
-  shadertrap::Parser parser(data, &message_consumer);
-  if (!parser.Parse()) {
+  std::unique_ptr<shadertrap::ShaderTrapProgram> shadertrap_program =
+      LoadProgram(std::move(source), &message_consumer);
+  if (shadertrap_program == nullptr) {
     return 1;
   }
+  if (compile_script) {
+    return CompileScript(shadertrap_program.get(), args[3], &message_consumer);
+  }
 
   EGLDisplay display;
   EGLConfig config;
@@ -99,6 +260,13 @@ int main(int argc, const char** argv) {
   const EGLint context_attrib_list[] = {EGL_CONTEXT_CLIENT_VERSION, 3,
                                         EGL_NONE};
 
+  // A driver need only send KHR_debug messages to a debug context.
+  const EGLint debug_context_attrib_list[] = {EGL_CONTEXT_CLIENT_VERSION,
+                                              3,
+                                              EGL_CONTEXT_OPENGL_DEBUG,
+                                              EGL_TRUE,
+                                              EGL_NONE};
+
   // TODO(afd): For offscreen rendering, do width and height matter?  If no,
   //  are there more sensible default values than these?  If yes, should they be
   //  controllable from the command line?
@@ -133,8 +301,18 @@ int main(int argc, const char** argv) {
     crash("%s", "eglChooseConfig did not return 1 config.");
   }
 
-  context =
-      eglCreateContext(display, config, EGL_NO_CONTEXT, context_attrib_list);
+  context = EGL_NO_CONTEXT;
+  if (gl_error_checking ==
+      shadertrap::Executor::GlErrorChecking::kDebugCallback) {
+    // Debug contexts need EGL 1.5, and without one, errors are still found by
+    // glGetError.
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT,
+                               debug_context_attrib_list);
+  }
+  if (context == EGL_NO_CONTEXT) {
+    context =
+        eglCreateContext(display, config, EGL_NO_CONTEXT, context_attrib_list);
+  }
   if (context == EGL_NO_CONTEXT) {
     crash("eglCreateContext failed: %x", eglGetError());
   }
@@ -151,15 +329,33 @@ int main(int argc, const char** argv) {
     crash("gladLoadGLES2Loader failed");
   }
 
-  std::unique_ptr<shadertrap::ShaderTrapProgram> shadertrap_program =
-      parser.GetParsedProgram();
-  std::vector<std::unique_ptr<shadertrap::CommandVisitor>> temp;
-  temp.push_back(
-      shadertrap::MakeUnique<shadertrap::Checker>(&message_consumer));
-  temp.push_back(
-      shadertrap::MakeUnique<shadertrap::Executor>(&message_consumer));
-  shadertrap::CompoundVisitor checker_and_executor(std::move(temp));
-  if (!checker_and_executor.VisitCommands(shadertrap_program.get())) {
+  shadertrap::Checker checker(&message_consumer);
+  shadertrap::Lowerer lowerer;
+  shadertrap::Executor executor(&message_consumer);
+  if (compare_renderbuffers_on_gpu) {
+    executor.SetRenderbufferComparison(
+        shadertrap::Executor::RenderbufferComparison::kOnGpu);
+  }
+  executor.SetHistogramComputation(histogram_computation);
+  if (conservative_memory_barriers) {
+    executor.SetMemoryBarriers(
+        shadertrap::Executor::MemoryBarriers::kConservative);
+  }
+  executor.SetGlErrorChecking(gl_error_checking);
+  executor.SetDumpFormat(dump_format);
+  if (!checker.VisitCommands(shadertrap_program.get()) ||
+      !lowerer.VisitCommands(shadertrap_program.get())) {
+    std::cerr << "Errors occurred during execution." << std::endl;
+    return 1;
+  }
+  const bool executed = executor.Execute(*lowerer.GetLoweredProgram());
+  if (report_vertex_arrays) {
+    std::cerr << "Vertex array objects: "
+              << executor.GetNumVertexArraysCreated() << " created, "
+              << executor.GetNumVertexArraysReused() << " reused."
+              << std::endl;
+  }
+  if (!executed) {
     std::cerr << "Errors occurred during execution." << std::endl;
     return 1;
   }
@@ -0,0 +1,209 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks for the routines that ASSERT_EQUAL and
+// ASSERT_SIMILAR_EMD_HISTOGRAM use to examine renderbuffers on the CPU. They
+// run on synthetic images of various contents and sizes and do not require an
+// OpenGL context, so they can be run anywhere.
+//
+// For each routine, image content and size, the fastest and median times over
+// a number of repetitions are reported, together with the throughput in
+// megapixels/s.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "libshadertrap/data_comparison.h"
+
+namespace {
+
+// Each content stresses the histogram kernels differently: uniform images
+// increment the same bins over and over, gradients move slowly through the
+// bins, and noise scatters increments across all of them.
+enum class Content { kUniform, kGradient, kNoise };
+
+struct ImageKind {
+  const char* name;
+  Content content;
+};
+
+const ImageKind kImageKinds[] = {
+    {"uniform", Content::kUniform},
+    {"gradient", Content::kGradient},
+    {"noise", Content::kNoise},
+};
+
+const size_t kImageSizes[] = {256, 1024, 4096};
+
+// Yields a square RGBA8 image of |size| by |size| pixels.
+std::vector<uint8_t> GenerateImage(Content content, size_t size) {
+  std::vector<uint8_t> image(size * size * 4);
+  uint32_t state = 1;
+  for (size_t y = 0; y < size; y++) {
+    for (size_t x = 0; x < size; x++) {
+      uint8_t* pixel = &image[(y * size + x) * 4];
+      switch (content) {
+        case Content::kUniform:
+          pixel[0] = 32;
+          pixel[1] = 64;
+          pixel[2] = 128;
+          pixel[3] = 255;
+          break;
+        case Content::kGradient:
+          pixel[0] = static_cast<uint8_t>(x * 256 / size);
+          pixel[1] = static_cast<uint8_t>(y * 256 / size);
+          pixel[2] = static_cast<uint8_t>((x + y) * 128 / size);
+          pixel[3] = 255;
+          break;
+        case Content::kNoise:
+          for (size_t channel = 0; channel < 4; channel++) {
+            // A linear congruential generator is random enough to defeat any
+            // locality in the bins.
+            state = state * 1664525U + 1013904223U;
+            pixel[channel] = static_cast<uint8_t>(state >> 24U);
+          }
+          break;
+      }
+    }
+  }
+  return image;
+}
+
+// The straightforward histogram loop that the kernel replaced, against which
+// both its speed and its results are checked.
+void AccumulateHistogramsReference(const uint8_t* image, size_t num_pixels,
+                                   uint32_t* histograms) {
+  for (size_t pixel = 0; pixel < num_pixels; pixel++) {
+    for (size_t channel = 0; channel < 4; channel++) {
+      histograms[channel * shadertrap::kNumHistogramBins +
+                 image[pixel * 4 + channel]]++;
+    }
+  }
+}
+
+// Runs |run| |repetitions| times and reports its speed on |num_pixels|
+// pixels.
+void Benchmark(const std::string& name, size_t num_pixels, size_t repetitions,
+               const std::function<void()>& run) {
+  std::vector<double> seconds;
+  for (size_t i = 0; i < repetitions; i++) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    auto end = std::chrono::steady_clock::now();
+    seconds.push_back(std::chrono::duration<double>(end - start).count());
+  }
+  std::sort(seconds.begin(), seconds.end());
+  const double megapixels = static_cast<double>(num_pixels) / 1e6;
+  std::cout << name << ": " << num_pixels << " pixels, min "
+            << seconds.front() * 1e3 << " ms, median "
+            << seconds[seconds.size() / 2] * 1e3 << " ms, "
+            << megapixels / seconds.front() << " Mpixels/s" << std::endl;
+}
+
+// Runs every benchmark on an image of the given kind and size.
+bool BenchmarkImage(const ImageKind& kind, size_t size,
+                    const std::string& filter, size_t repetitions) {
+  const std::vector<uint8_t> image = GenerateImage(kind.content, size);
+  // The second image differs from the first in one pixel near the end, so
+  // that comparing them scans almost all of both.
+  std::vector<uint8_t> other_image = image;
+  other_image[other_image.size() - 1]++;
+  const size_t num_pixels = size * size;
+  const std::string suffix =
+      std::string("/") + kind.name + "/" + std::to_string(size);
+
+  std::vector<uint32_t> histograms(4 * shadertrap::kNumHistogramBins);
+  std::vector<uint32_t> reference_histograms(histograms.size());
+  struct Run {
+    const char* name;
+    std::function<void()> run;
+  };
+  const Run runs[] = {
+      {"histogram",
+       [&image, &histograms, num_pixels]() {
+         std::fill(histograms.begin(), histograms.end(), 0);
+         shadertrap::AccumulateHistograms(image.data(), num_pixels,
+                                          histograms.data());
+       }},
+      {"histogram_reference",
+       [&image, &reference_histograms, num_pixels]() {
+         std::fill(reference_histograms.begin(), reference_histograms.end(),
+                   0);
+         AccumulateHistogramsReference(image.data(), num_pixels,
+                                       reference_histograms.data());
+       }},
+      {"compare",
+       [&image, &other_image, size]() {
+         shadertrap::CompareImages(image.data(), other_image.data(), size,
+                                   size, 16);
+       }},
+  };
+  for (const auto& run : runs) {
+    const std::string name = run.name + suffix;
+    if (name.find(filter) == std::string::npos) {
+      continue;
+    }
+    Benchmark(name, num_pixels, repetitions, run.run);
+  }
+  std::fill(histograms.begin(), histograms.end(), 0);
+  std::fill(reference_histograms.begin(), reference_histograms.end(), 0);
+  shadertrap::AccumulateHistograms(image.data(), num_pixels,
+                                   histograms.data());
+  AccumulateHistogramsReference(image.data(), num_pixels,
+                                reference_histograms.data());
+  if (histograms != reference_histograms) {
+    std::cerr << "histogram" << suffix
+              << " does not match the reference histogram" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  std::vector<std::string> args(argv, argv + argc);
+  if (args.size() > 3) {
+    std::cerr << "Usage: " << args[0] << " [FILTER [REPETITIONS]]"
+              << std::endl;
+    std::cerr << "Only benchmarks whose names contain FILTER are run."
+              << std::endl;
+    return 1;
+  }
+  const std::string filter = args.size() > 1 ? args[1] : "";
+  size_t repetitions = 5;
+  if (args.size() > 2) {
+    repetitions =
+        static_cast<size_t>(std::strtoull(args[2].c_str(), nullptr, 10));
+    if (repetitions == 0) {
+      std::cerr << "REPETITIONS must be positive" << std::endl;
+      return 1;
+    }
+  }
+  for (const auto& kind : kImageKinds) {
+    for (auto size : kImageSizes) {
+      if (!BenchmarkImage(kind, size, filter, repetitions)) {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,28 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SHADERTRAP_FRONTEND_BENCH_ALLOCATION_COUNTER_H
+#define SHADERTRAP_FRONTEND_BENCH_ALLOCATION_COUNTER_H
+
+#include <cstddef>
+
+namespace shadertrap {
+
+// The number of allocations made so far via the global operator new, which
+// the benchmark replaces in order to count them.
+size_t GetAllocationCount();
+
+}  // namespace shadertrap
+
+#endif  // SHADERTRAP_FRONTEND_BENCH_ALLOCATION_COUNTER_H
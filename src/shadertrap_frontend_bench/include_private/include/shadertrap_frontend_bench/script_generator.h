@@ -0,0 +1,48 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SHADERTRAP_FRONTEND_BENCH_SCRIPT_GENERATOR_H
+#define SHADERTRAP_FRONTEND_BENCH_SCRIPT_GENERATOR_H
+
+#include <cstddef>
+#include <string>
+
+namespace shadertrap {
+
+// The shape of a synthetic script. A script consists of a block of comment
+// lines, then a number of compute programs, each declared, compiled, created,
+// given a uniform and run, then a number of buffers, each created with
+// literal values and bound. Every program and buffer has fresh identifiers,
+// so the script passes the checker.
+struct ScriptShape {
+  size_t num_comment_lines;
+  size_t num_programs;
+  // The number of lines in the body of each shader.
+  size_t num_shader_lines;
+  size_t num_buffers;
+  // The number of INIT_VALUES literals for each buffer.
+  size_t num_buffer_values;
+
+  // Each program contributes 5 commands and each buffer 2.
+  size_t GetNumCommands() const { return 5 * num_programs + 2 * num_buffers; }
+
+  // Each program contributes 3 identifiers and each buffer 1.
+  size_t GetNumIdentifiers() const { return 3 * num_programs + num_buffers; }
+};
+
+std::string GenerateScript(const ScriptShape& shape);
+
+}  // namespace shadertrap
+
+#endif  // SHADERTRAP_FRONTEND_BENCH_SCRIPT_GENERATOR_H
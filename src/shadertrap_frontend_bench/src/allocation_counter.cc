@@ -0,0 +1,48 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "shadertrap_frontend_bench/allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+size_t allocation_count = 0;
+
+void* Allocate(size_t size) {
+  allocation_count++;
+  // malloc(0) may yield nullptr, which operator new must not.
+  void* result = std::malloc(size == 0 ? 1 : size);
+  if (result == nullptr) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+}  // namespace
+
+namespace shadertrap {
+
+size_t GetAllocationCount() { return allocation_count; }
+
+}  // namespace shadertrap
+
+void* operator new(size_t size) { return Allocate(size); }
+
+void* operator new[](size_t size) { return Allocate(size); }
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
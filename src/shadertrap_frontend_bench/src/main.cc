@@ -0,0 +1,218 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks for the ShaderTrap front end: the tokenizer, the parser, the
+// checker, and the loading of programs compiled to binary form. They run on
+// synthetic scripts of various shapes and do not require an OpenGL context, so
+// they can be run anywhere.
+//
+// For each stage and script shape, the fastest and median times over a number
+// of repetitions are reported, together with the throughput in MB/s and
+// commands/s, and the number of allocations made per repetition.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "libshadertrap/binary_program_reader.h"
+#include "libshadertrap/binary_program_writer.h"
+#include "libshadertrap/checker.h"
+#include "libshadertrap/collecting_message_consumer.h"
+#include "libshadertrap/make_unique.h"
+#include "libshadertrap/parser.h"
+#include "libshadertrap/source_buffer.h"
+#include "libshadertrap/token.h"
+#include "libshadertrap/tokenizer.h"
+#include "shadertrap_frontend_bench/allocation_counter.h"
+#include "shadertrap_frontend_bench/script_generator.h"
+
+namespace {
+
+// Prints the messages collected while a benchmark ran, which explain why it
+// failed.
+void PrintMessages(shadertrap::CollectingMessageConsumer* message_consumer) {
+  for (size_t i = 0; i < message_consumer->GetNumMessages(); i++) {
+    std::cerr << "ERROR at " << message_consumer->GetMessageString(i)
+              << std::endl;
+  }
+}
+
+struct Shape {
+  const char* name;
+  shadertrap::ScriptShape shape;
+};
+
+// Each shape stresses a different part of the front end: the per-command
+// overhead of parameter parsing, the decoding of literals, the skipping of
+// shader text and comments, and the tracking of identifiers by the checker.
+const Shape kShapes[] = {
+    {"commands", {0, 2000, 2, 20000, 4}},
+    {"buffer_values", {0, 0, 0, 1, 1000000}},
+    {"shader_lines", {10000, 1, 100000, 0, 0}},
+    {"identifiers", {0, 0, 0, 100000, 1}},
+};
+
+// A stage of the front end. |setup| is run before each repetition of |run|,
+// outside the timed region; |run| yields false if it fails.
+struct Stage {
+  const char* name;
+  std::function<void()> setup;
+  std::function<bool()> run;
+};
+
+// Runs |stage| |repetitions| times and reports its speed on |script|.
+bool Benchmark(const std::string& name, const std::string& script,
+               size_t num_commands, size_t repetitions, const Stage& stage) {
+  std::vector<double> seconds;
+  size_t allocations = 0;
+  for (size_t i = 0; i < repetitions; i++) {
+    stage.setup();
+    const size_t allocations_before = shadertrap::GetAllocationCount();
+    auto start = std::chrono::steady_clock::now();
+    if (!stage.run()) {
+      std::cerr << name << " failed" << std::endl;
+      return false;
+    }
+    auto end = std::chrono::steady_clock::now();
+    allocations = shadertrap::GetAllocationCount() - allocations_before;
+    seconds.push_back(std::chrono::duration<double>(end - start).count());
+  }
+  std::sort(seconds.begin(), seconds.end());
+  const double megabytes = static_cast<double>(script.size()) / 1e6;
+  std::cout << name << ": " << script.size() << " bytes, " << num_commands
+            << " commands, min " << seconds.front() * 1e3 << " ms, median "
+            << seconds[seconds.size() / 2] * 1e3 << " ms, "
+            << megabytes / seconds.front() << " MB/s, "
+            << static_cast<double>(num_commands) / seconds.front()
+            << " commands/s, " << allocations << " allocations" << std::endl;
+  return true;
+}
+
+// Runs every stage of the front end on a script of the given shape.
+bool BenchmarkShape(const Shape& shape, const std::string& filter,
+                    size_t repetitions) {
+  const std::string script = shadertrap::GenerateScript(shape.shape);
+  const size_t num_commands = shape.shape.GetNumCommands();
+  shadertrap::CollectingMessageConsumer message_consumer;
+
+  // Checking and loading are benchmarked on a program parsed up front.
+  shadertrap::Parser parser(script, &message_consumer);
+  if (!parser.Parse()) {
+    PrintMessages(&message_consumer);
+    return false;
+  }
+  std::unique_ptr<shadertrap::ShaderTrapProgram> program =
+      parser.GetParsedProgram();
+  const std::string binary_program =
+      shadertrap::BinaryProgramWriter().Write(program.get());
+
+  // Sources are created outside the timed region, as in practice they would
+  // be memory-mapped rather than copied. Likewise the result of each
+  // repetition is only destroyed during the setup of the next.
+  const shadertrap::SourceBuffer source(script);
+  std::unique_ptr<shadertrap::SourceBuffer> binary_source;
+  std::unique_ptr<shadertrap::ShaderTrapProgram> result;
+
+  const Stage stages[] = {
+      {"tokenize", []() {},
+       [&source]() -> bool {
+         // Unrecognized tokens, such as those in shader text, are skipped a
+         // line at a time, as the parser skips shader text.
+         shadertrap::Tokenizer tokenizer(&source);
+         for (shadertrap::Token token = tokenizer.NextToken(); !token.IsEOS();
+              token = tokenizer.NextToken()) {
+           if (token.GetType() == shadertrap::Token::Type::kUnknown) {
+             tokenizer.SkipLine();
+           }
+         }
+         return true;
+       }},
+      {"parse", [&result]() { result.reset(); },
+       [&script, &message_consumer, &result]() -> bool {
+         shadertrap::Parser benchmark_parser(script, &message_consumer);
+         if (!benchmark_parser.Parse()) {
+           return false;
+         }
+         result = benchmark_parser.GetParsedProgram();
+         return true;
+       }},
+      {"check", []() {},
+       [&program, &message_consumer]() -> bool {
+         shadertrap::Checker checker(&message_consumer);
+         return checker.VisitCommands(program.get());
+       }},
+      {"load",
+       [&binary_source, &binary_program, &result]() {
+         result.reset();
+         binary_source =
+             shadertrap::MakeUnique<shadertrap::SourceBuffer>(binary_program);
+       },
+       [&binary_source, &message_consumer, &result]() -> bool {
+         shadertrap::BinaryProgramReader reader(std::move(binary_source),
+                                                &message_consumer);
+         if (!reader.Read()) {
+           return false;
+         }
+         result = reader.GetProgram();
+         return true;
+       }},
+  };
+  for (const auto& stage : stages) {
+    const std::string name = std::string(stage.name) + "/" + shape.name;
+    if (name.find(filter) == std::string::npos) {
+      continue;
+    }
+    if (!Benchmark(name, script, num_commands, repetitions, stage)) {
+      PrintMessages(&message_consumer);
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  std::vector<std::string> args(argv, argv + argc);
+  if (args.size() > 3) {
+    std::cerr << "Usage: " << args[0] << " [FILTER [REPETITIONS]]"
+              << std::endl;
+    std::cerr << "Only benchmarks whose names contain FILTER are run."
+              << std::endl;
+    return 1;
+  }
+  const std::string filter = args.size() > 1 ? args[1] : "";
+  size_t repetitions = 5;
+  if (args.size() > 2) {
+    repetitions =
+        static_cast<size_t>(std::strtoull(args[2].c_str(), nullptr, 10));
+    if (repetitions == 0) {
+      std::cerr << "REPETITIONS must be positive" << std::endl;
+      return 1;
+    }
+  }
+  for (const auto& shape : kShapes) {
+    if (!BenchmarkShape(shape, filter, repetitions)) {
+      return 1;
+    }
+  }
+  return 0;
+}
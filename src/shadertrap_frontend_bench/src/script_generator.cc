@@ -0,0 +1,59 @@
+// Copyright 2021 The ShaderTrap Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "shadertrap_frontend_bench/script_generator.h"
+
+#include <cstdint>
+
+namespace shadertrap {
+
+std::string GenerateScript(const ScriptShape& shape) {
+  std::string result;
+  for (size_t i = 0; i < shape.num_comment_lines; i++) {
+    result += "# A comment line, which the tokenizer skips over.\n";
+  }
+  for (size_t i = 0; i < shape.num_programs; i++) {
+    const std::string suffix = std::to_string(i);
+    result += "\nDECLARE_SHADER shader_" + suffix + " COMPUTE\n";
+    result += "#version 310 es\nlayout(local_size_x = 1) in;\n";
+    result += "layout(std430, binding = 0) buffer Buf { float data[]; };\n";
+    result += "layout(location = 0) uniform float scale;\nvoid main() {\n";
+    for (size_t j = 0; j < shape.num_shader_lines; j++) {
+      result += "        data[" + std::to_string(j) +
+                "] += vec4(0.25, 0.5, 0.75, 1.0).x * scale;\n";
+    }
+    result += "}\nEND\n";
+    result += "COMPILE_SHADER compiled_" + suffix + " SHADER shader_" + suffix +
+              "\n";
+    result += "CREATE_PROGRAM program_" + suffix + " SHADERS compiled_" +
+              suffix + "\n";
+    result += "SET_UNIFORM PROGRAM program_" + suffix +
+              " LOCATION 0 TYPE float VALUES 1.5\n";
+    result += "RUN_COMPUTE PROGRAM program_" + suffix +
+              " NUM_GROUPS_X 1 NUM_GROUPS_Y 1 NUM_GROUPS_Z 1\n";
+  }
+  for (size_t i = 0; i < shape.num_buffers; i++) {
+    const std::string identifier = "buffer_" + std::to_string(i);
+    result += "CREATE_BUFFER " + identifier + " SIZE_BYTES " +
+              std::to_string(shape.num_buffer_values * sizeof(uint32_t)) +
+              " INIT_TYPE uint INIT_VALUES";
+    for (size_t j = 0; j < shape.num_buffer_values; j++) {
+      result += " " + std::to_string(j % 1000);
+    }
+    result += "\nBIND_STORAGE_BUFFER BUFFER " + identifier + " BINDING 0\n";
+  }
+  return result;
+}
+
+}  // namespace shadertrap